@@ -15,11 +15,13 @@ limitations under the License.
 **************************************************************************/
 
 #include <Aggregator/BlockAddMissingDefaults.h>
+#include <Aggregator/DefaultsFillingActionsCache.h>
 #include <Interpreters/addMissingDefaults.h>
 #include <Storages/ColumnsDescription.h>
 #include <Interpreters/ExpressionActions.h>
 
 #include "common/logging.hpp"
+#include "monitor/metrics_collector.hpp"
 
 /**
  * This utility takes care the filling of the missing columns with:
@@ -30,6 +32,29 @@ limitations under the License.
  */
 namespace nuclm {
 
+static DB::ActionsDAGPtr compileAddingDefaultsDAG(const DB::Block& block, const DB::NamesAndTypesList& required_columns,
+                                                  const DB::ColumnsDescription& required_columns_description,
+                                                  DB::ContextMutablePtr context) {
+    DB::Block header = block.cloneEmpty();
+    // we choose the default parameter value: bool null_as_default = false, as it is used only for the INSERT SELECT
+    // statement
+    return DB::addMissingDefaults(header, required_columns, required_columns_description, context);
+}
+
+/**
+ * A function without arguments gets folded into a constant when the actions are compiled, which for a default
+ * expression such as now() or today() would be frozen at the time of the compilation if the actions were reused.
+ */
+static bool hasNonDeterministicFunctions(const DB::ActionsDAG& dag) {
+    for (const auto& node : dag.getNodes()) {
+        if (node.type == DB::ActionsDAG::ActionType::FUNCTION && node.function_base != nullptr &&
+            !node.function_base->isDeterministic()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 DB::Block blockAddMissingDefaults(const DB::Block& block, const DB::NamesAndTypesList& required_columns,
                                   const DB::ColumnsDescription& required_columns_description,
                                   DB::ContextMutablePtr context) {
@@ -45,16 +70,51 @@ DB::Block blockAddMissingDefaults(const DB::Block& block, const DB::NamesAndType
         LOG_AGGRPROC(4) << "structure dumped for passed in block structure: " << block.dumpStructure();
     }
 
-    DB::Block header = block.cloneEmpty();
-    // we choose the default parameter value: bool null_as_default = false, as it is used only for the INSERT SELECT
-    // statement
-    DB::ActionsDAGPtr dag = DB::addMissingDefaults(header, required_columns, required_columns_description, context);
+    DB::ExpressionActionsPtr adding_defaults_actions = std::make_shared<DB::ExpressionActions>(
+        compileAddingDefaultsDAG(block, required_columns, required_columns_description, context));
+    auto copy_block = block;
+    adding_defaults_actions->execute(copy_block);
+
+    return copy_block;
+}
+
+DB::Block blockAddMissingDefaults(const DB::Block& block, const DB::NamesAndTypesList& required_columns,
+                                  const DB::ColumnsDescription& required_columns_description,
+                                  const std::string& table_name, size_t schema_key, DB::ContextMutablePtr context) {
+    std::shared_ptr<LoaderMetrics> loader_metrics = MetricsCollector::instance().getLoaderMetrics();
+    DefaultsFillingActionsCachePtr actions_cache = DefaultsFillingActionsCache::getTableCache(table_name);
+
+    DB::NamesAndTypesList input_columns = block.getNamesAndTypesList();
+    DB::ExpressionActionsPtr adding_defaults_actions = actions_cache->get(schema_key, input_columns, required_columns);
+    if (adding_defaults_actions != nullptr) {
+        loader_metrics->defaults_filling_actions_cache_hits_total->labels({{"table", table_name}}).increment();
+    } else {
+        LOG_AGGRPROC(4) << "to compile defaults filling actions for table: " << table_name
+                        << " with passed in block structure: " << block.dumpStructure();
+        loader_metrics->defaults_filling_actions_cache_misses_total->labels({{"table", table_name}}).increment();
+        DB::ActionsDAGPtr dag =
+            compileAddingDefaultsDAG(block, required_columns, required_columns_description, context);
+        bool cacheable = !hasNonDeterministicFunctions(*dag);
+        adding_defaults_actions = std::make_shared<DB::ExpressionActions>(std::move(dag));
+        if (cacheable) {
+            actions_cache->put(schema_key, input_columns, required_columns, adding_defaults_actions);
+        } else {
+            LOG_AGGRPROC(4) << "defaults filling actions for table: " << table_name
+                            << " not cached, as they have non-deterministic default expressions";
+        }
+    }
 
-    DB::ExpressionActionsPtr adding_defaults_actions = std::make_shared<DB::ExpressionActions>(std::move(dag));
     auto copy_block = block;
     adding_defaults_actions->execute(copy_block);
 
     return copy_block;
 }
 
+bool hasNonDeterministicDefaults(const DB::Block& header, const DB::NamesAndTypesList& required_columns,
+                                 const DB::ColumnsDescription& required_columns_description,
+                                 DB::ContextMutablePtr context) {
+    DB::ActionsDAGPtr dag = compileAddingDefaultsDAG(header, required_columns, required_columns_description, context);
+    return hasNonDeterministicFunctions(*dag);
+}
+
 } // namespace nuclm
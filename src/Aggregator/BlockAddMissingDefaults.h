@@ -41,4 +41,25 @@ DB::Block blockAddMissingDefaults(const DB::Block& block, const DB::NamesAndType
                                   const DB::ColumnsDescription& required_columns_description,
                                   DB::ContextMutablePtr context);
 
+/**
+ * The same as above, with the compiled actions that fill the missing columns looked up in the defaults filling actions
+ * cache of the table first, and added to the cache if they have to be compiled. The actions with non-deterministic
+ * default expressions, such as now() or today(), are compiled for each call and never cached.
+ *
+ * @param table_name the table whose cache is shared by all of the buffers of the table
+ * @param schema_key the key of the table schema that required_columns_description is of, as computed by
+ * InsertColumnsPlanCache::computeSchemaKey.
+ */
+DB::Block blockAddMissingDefaults(const DB::Block& block, const DB::NamesAndTypesList& required_columns,
+                                  const DB::ColumnsDescription& required_columns_description,
+                                  const std::string& table_name, size_t schema_key, DB::ContextMutablePtr context);
+
+/**
+ * Whether filling the missing columns of the blocks with the header involves a non-deterministic default expression,
+ * such as now() or today(), whose values depend on the time that the defaults get filled.
+ */
+bool hasNonDeterministicDefaults(const DB::Block& header, const DB::NamesAndTypesList& required_columns,
+                                 const DB::ColumnsDescription& required_columns_description,
+                                 DB::ContextMutablePtr context);
+
 } // namespace nuclm
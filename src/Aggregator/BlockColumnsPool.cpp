@@ -0,0 +1,164 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include <Aggregator/BlockColumnsPool.h>
+#include "common/logging.hpp"
+#include "common/settings_factory.hpp"
+#include "monitor/metrics_collector.hpp"
+
+#include <tuple>
+#include <unordered_map>
+
+namespace nuclm {
+
+// Whether the column, or any of the columns nested in it, is LowCardinality.
+static bool hasLowCardinality(DB::IColumn& column) {
+    if (column.lowCardinality()) {
+        return true;
+    }
+    bool found = false;
+    column.forEachSubcolumn([&found](DB::IColumn::WrappedPtr& subcolumn) {
+        if (!found) {
+            found = hasLowCardinality(*subcolumn);
+        }
+    });
+    return found;
+}
+
+BlockColumnsPoolPtr BlockColumnsPool::getTablePool(const std::string& table_name) {
+    static std::mutex table_pools_mutex;
+    static std::unordered_map<std::string, BlockColumnsPoolPtr> table_pools;
+
+    std::lock_guard<std::mutex> lck(table_pools_mutex);
+    auto it = table_pools.find(table_name);
+    if (it != table_pools.end()) {
+        return it->second;
+    }
+
+    auto [capacity, max_bytes] = with_settings([](SETTINGS s) {
+        return std::make_tuple(s.config.aggregatorLoader.block_columns_pool_size_per_table,
+                               s.config.aggregatorLoader.block_columns_pool_max_bytes_per_table);
+    });
+    LOG_AGGRPROC(4) << "create block columns pool for table: " << table_name << " with capacity: " << capacity
+                    << " and max bytes: " << max_bytes;
+    auto pool = std::make_shared<BlockColumnsPool>(table_name, capacity, max_bytes);
+    table_pools.emplace(table_name, pool);
+    return pool;
+}
+
+void BlockColumnsPool::release(DB::Block&& block) {
+    if (capacity == 0 || !block) {
+        return;
+    }
+    for (const auto& column : block) {
+        if (!column.column || column.column->use_count() > 1) {
+            LOG_AGGRPROC(4) << "block with column: " << column.name << " still in use, not given back to pool";
+            return;
+        }
+    }
+
+    size_t rows = block.rows();
+    DB::MutableColumns columns = block.mutateColumns();
+    for (size_t cindex = 0; cindex < columns.size(); cindex++) {
+        if (hasLowCardinality(*columns[cindex])) {
+            // The dictionary keeps the values of the rows removed, and thus the column starts over.
+            columns[cindex] = block.getByPosition(cindex).type->createColumn();
+        } else if (!columns[cindex]->empty()) {
+            columns[cindex]->popBack(columns[cindex]->size());
+        }
+    }
+    DB::Block recycled_block = block.cloneWithColumns(std::move(columns));
+    size_t recycled_bytes = recycled_block.allocatedBytes();
+
+    {
+        std::lock_guard<std::mutex> lck(mutex);
+        expected_rows = (expected_rows == 0) ? rows : (expected_rows * 7 + rows) / 8;
+        if (max_bytes > 0 && recycled_bytes > max_bytes) {
+            LOG_AGGRPROC(4) << "block with bytes: " << recycled_bytes << " beyond max bytes: " << max_bytes
+                            << ", not given back to pool";
+            return;
+        }
+        entries.push_front(Entry{std::move(recycled_block), recycled_bytes});
+        allocated_bytes += recycled_bytes;
+        while (entries.size() > capacity || (max_bytes > 0 && allocated_bytes > max_bytes)) {
+            allocated_bytes -= entries.back().allocated_bytes;
+            entries.pop_back();
+        }
+    }
+    updateSizeMetrics();
+}
+
+DB::Block BlockColumnsPool::acquire(const DB::Block& header) {
+    if (capacity == 0) {
+        return header;
+    }
+
+    std::shared_ptr<LoaderMetrics> loader_metrics = MetricsCollector::instance().getLoaderMetrics();
+    DB::Block block;
+    size_t rows_to_reserve = 0;
+    {
+        std::lock_guard<std::mutex> lck(mutex);
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (DB::blocksHaveEqualStructure(it->block, header)) {
+                block = std::move(it->block);
+                allocated_bytes -= it->allocated_bytes;
+                entries.erase(it);
+                break;
+            }
+        }
+        rows_to_reserve = expected_rows;
+    }
+
+    if (block) {
+        loader_metrics->block_columns_pool_hits_total->labels({{"table", table}}).increment();
+        updateSizeMetrics();
+        return block;
+    }
+
+    loader_metrics->block_columns_pool_misses_total->labels({{"table", table}}).increment();
+    DB::MutableColumns columns = header.cloneEmptyColumns();
+    if (rows_to_reserve > 0) {
+        for (auto& column : columns) {
+            column->reserve(rows_to_reserve);
+        }
+    }
+    return header.cloneWithColumns(std::move(columns));
+}
+
+size_t BlockColumnsPool::size() const {
+    std::lock_guard<std::mutex> lck(mutex);
+    return entries.size();
+}
+
+size_t BlockColumnsPool::getExpectedRows() const {
+    std::lock_guard<std::mutex> lck(mutex);
+    return expected_rows;
+}
+
+void BlockColumnsPool::updateSizeMetrics() {
+    size_t number_of_blocks = 0;
+    size_t bytes = 0;
+    {
+        std::lock_guard<std::mutex> lck(mutex);
+        number_of_blocks = entries.size();
+        bytes = allocated_bytes;
+    }
+    std::shared_ptr<LoaderMetrics> loader_metrics = MetricsCollector::instance().getLoaderMetrics();
+    loader_metrics->block_columns_pool_blocks->labels({{"table", table}}).update(number_of_blocks);
+    loader_metrics->block_columns_pool_bytes->labels({{"table", table}}).update(bytes);
+}
+
+} // namespace nuclm
@@ -0,0 +1,95 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <Core/Block.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace nuclm {
+
+class BlockColumnsPool;
+using BlockColumnsPoolPtr = std::shared_ptr<BlockColumnsPool>;
+
+/**
+ * A bounded pool of the columns of the blocks that have been flushed, cleared with their capacity kept, for the
+ * buffers of the table to build their next blocks in. Without the pool, each block starts with empty columns that
+ * regrow up to the block size, and the columns of the flushed block are freed once the block is inserted, which
+ * churns large allocations on every flush.
+ *
+ * The flush tasks give back the columns of their blocks once done with them. A buffer takes the most recently given
+ * back columns of the same structure, or on pool miss, gets empty columns reserved for the rows that the recent
+ * blocks have had. The pool of a table is shared by all of the buffers of the table, and the least recently given
+ * back columns are freed once the pool holds more blocks than its capacity, or more bytes than its maximum bytes.
+ */
+class BlockColumnsPool {
+  public:
+    // max_bytes_ of 0 is for the pool to be bounded by the number of blocks only.
+    BlockColumnsPool(const std::string& table_, size_t capacity_, size_t max_bytes_ = 0) :
+            table(table_), capacity(capacity_), max_bytes(max_bytes_) {}
+
+    ~BlockColumnsPool() = default;
+
+    /**
+     * The pool shared by the buffers of the table, with its capacity and its maximum bytes taken from
+     * aggregatorLoader.block_columns_pool_size_per_table and block_columns_pool_max_bytes_per_table at the time the
+     * pool is created.
+     */
+    static BlockColumnsPoolPtr getTablePool(const std::string& table_name);
+
+    /**
+     * To give back the columns of the block, which is left without its columns. The columns still shared with
+     * others are not taken, and neither are the columns beyond the maximum bytes on their own, or if the pool is
+     * disabled.
+     */
+    void release(DB::Block&& block);
+
+    // A block with the structure of the header, to build in.
+    DB::Block acquire(const DB::Block& header);
+
+    // the number of the blocks of columns held by the pool.
+    size_t size() const;
+
+    size_t getCapacity() const { return capacity; }
+
+    // the rows to reserve the columns for on pool miss.
+    size_t getExpectedRows() const;
+
+  private:
+    struct Entry {
+        DB::Block block;
+        size_t allocated_bytes;
+    };
+
+    void updateSizeMetrics();
+
+    const std::string table;
+    const size_t capacity;
+    const size_t max_bytes;
+
+    mutable std::mutex mutex;
+    // the most recently given back columns at the front.
+    std::list<Entry> entries;
+    size_t allocated_bytes = 0;
+    // the moving average of the rows of the blocks given back.
+    size_t expected_rows = 0;
+};
+
+} // namespace nuclm
@@ -33,6 +33,37 @@ static int64_t now() {
 
 std::atomic<unsigned long> BlockSupportedBuffer::buffer_id{0};
 
+std::unique_ptr<ProtobufMessageArena> BlockSupportedBuffer::createMessageArena() {
+    return with_settings([](SETTINGS s) -> std::unique_ptr<ProtobufMessageArena> {
+        auto& aggregator_loader = s.config.aggregatorLoader;
+        if (!aggregator_loader.protobuf_arena_enabled) {
+            return nullptr;
+        }
+        return std::make_unique<ProtobufMessageArena>(aggregator_loader.protobuf_arena_min_initial_block_size,
+                                                      aggregator_loader.protobuf_arena_max_initial_block_size);
+    });
+}
+
+std::unique_ptr<DeferredDefaultsSegment> BlockSupportedBuffer::createDeferredDefaultsSegment() {
+    bool enabled =
+        with_settings([](SETTINGS s) { return s.config.aggregatorLoader.deferred_defaults_filling_enabled; });
+    return enabled ? std::make_unique<DeferredDefaultsSegment>() : nullptr;
+}
+
+void BlockSupportedBuffer::materializeDeferredDefaults() {
+    if (deferred_defaults_segment == nullptr || deferred_defaults_segment->empty()) {
+        return;
+    }
+
+    size_t staged_rows = deferred_defaults_segment->rows();
+    size_t messages_dropped = deferred_defaults_segment->materialize(block_holder, context);
+    if (messages_dropped > 0) {
+        LOG(ERROR) << "BlockSupportedBuffer cannot fill defaults for staged messages: " << messages_dropped
+                   << " out of staged rows: " << staged_rows << " in buffer: " << assigned_buffer_id
+                   << " for table: " << table;
+    }
+}
+
 bool BlockSupportedBuffer::append(const char* data, size_t data_size, int64_t offset, int64_t timestamp) {
     std::shared_ptr<LoaderMetrics> loader_metrics = MetricsCollector::instance().getLoaderMetrics();
     loader_metrics->total_batched_kafka_messages_received_metrics->labels({{"table", table_definition.getTableName()}})
@@ -50,12 +81,15 @@ bool BlockSupportedBuffer::append(const char* data, size_t data_size, int64_t of
 
     bool result = false;
     try {
-        std::string serialized_message(data, data_size); // NOTE: the data is copied to the message.
-        // need to have per-message-serialization definition and then merging to the block_holder.
-
+        // need to have per-message-serialization definition and then merging to the block_holder. The message is
+        // parsed directly from the passed-in payload, without being copied.
         LOG_AGGRPROC(4) << "right before loading message into a block for table: " << table_definition.getTableName()
                         << " with size: " << data_size;
-        ProtobufBatchReader batchReader(serialized_message, schema_update_tracker, block_holder, context);
+        ProtobufBatchReader batchReader(data, data_size, schema_update_tracker, block_holder, context);
+        if (message_arena != nullptr) {
+            batchReader.setArena(message_arena->get());
+        }
+        batchReader.setDeferredDefaultsSegment(deferred_defaults_segment.get());
         result = batchReader.read();
         if (result) {
             update_maxmin_msg_timestamp(timestamp);
@@ -67,13 +101,11 @@ bool BlockSupportedBuffer::append(const char* data, size_t data_size, int64_t of
                             << " minimum timestamp in buffer: " << minmax_msg_timestamp.first
                             << " maximum timestamp in buffer: " << minmax_msg_timestamp.second;
 
-            std::string names_holder = block_holder.dumpNames();
+            // the dumps are only built when the verbose logging is on.
             LOG_AGGRPROC(4) << " in buffer: " << assigned_buffer_id << " in partition: " << partitionId
-                            << " column names dumped in block holder : " << names_holder;
-
-            std::string structure = block_holder.dumpStructure();
+                            << " column names dumped in block holder : " << block_holder.dumpNames();
             LOG_AGGRPROC(4) << " in buffer: " << assigned_buffer_id << " in partition: " << partitionId
-                            << " structure dumped in block holder: " << structure;
+                            << " structure dumped in block holder: " << block_holder.dumpStructure();
 
             total_message_bytes_size += data_size;
             maximum_stream_offset = offset;
@@ -106,6 +138,16 @@ bool BlockSupportedBuffer::append(const char* data, size_t data_size, int64_t of
                    << ", exception: " << DB::getCurrentExceptionMessage(true);
     }
 
+    // The message parsed on the arena is gone with the batch reader, and thus the arena is ready for the next one.
+    if (message_arena != nullptr) {
+        size_t arena_bytes_used = message_arena->reset();
+        loader_metrics->protobuf_arena_bytes_in_buffers->labels({{"table", table}, {"kind", "used"}})
+            .update(arena_bytes_used);
+        loader_metrics->protobuf_arena_bytes_in_buffers->labels({{"table", table}, {"kind", "initial_block"}})
+            .update(message_arena->getInitialBlockSize());
+        loader_metrics->protobuf_arena_resets_in_buffers_total->labels({{"table", table}}).increment();
+    }
+
     if (!result) {
         loader_metrics->messages_failed_to_be_processed_total->labels({{"table", table}}).increment();
         loader_metrics->bytes_failed_to_be_processed_total->labels({{"table", table}}).increment(data_size);
@@ -116,6 +158,7 @@ bool BlockSupportedBuffer::append(const char* data, size_t data_size, int64_t of
 kafka::FlushTaskPtr BlockSupportedBuffer::flush() {
     LOG_AGGRPROC(4) << "BlockSupportedBuffer flush entering at buffer (id): " << assigned_buffer_id;
     kafka::FlushTaskPtr task = nullptr;
+    materializeDeferredDefaults();
     if (block_holder.rows() > 0) {
         const TableColumnsDescription& latest_table_definition = schema_update_tracker->getLatestSchema();
         task = std::make_shared<BlockSupportedBufferFlushTask>(
@@ -123,10 +166,10 @@ kafka::FlushTaskPtr BlockSupportedBuffer::flush() {
             minmax_msg_timestamp, latest_table_definition.getFullColumnTypesAndNamesDefinitionCache(), loader_manager,
             context, kafka_connector);
         block_holder.clear(); // it has been transferred to buffer in flush task.
-        // then we still need to give it the header definition
-        // TODO: Maybe unnecessary, as BlockSupportedBufferFlushTask will do swap.
-        block_holder = SerializationHelper::getBlockDefinition(
-            latest_table_definition.getFullColumnTypesAndNamesDefinitionCache());
+        // then we still need to give it the header definition, with the columns recycled from the flushed blocks.
+        const ColumnTypesAndNamesTableDefinition& latest_columns_definition =
+            latest_table_definition.getFullColumnTypesAndNamesDefinitionCache();
+        block_holder = block_columns_pool->acquire(SerializationHelper::getBlockDefinition(latest_columns_definition));
         LOG_AGGRPROC(4) << "Buffer with id: " << assigned_buffer_id.load(std::memory_order_relaxed) << ",  " << table
                         << "[" << begin_ << "," << end_
                         << "]: Flushing non-empty buffer. After block holder being cleared, block "
@@ -156,12 +199,26 @@ bool BlockSupportedBuffer::flushable() {
     // LOG_AGGRPROC(5)<< "aggregator loader max_allowed_block_size_in_rows: " << max_allowed_block_size_in_rows;
     // LOG_AGGRPROC(5) << "aggregator batch time (in ms): " << batchTimeout;
 
-    return (block_holder.allocatedBytes() > max_allowed_block_size_in_bytes) ||
-        (block_holder.rows() > max_allowed_block_size_in_rows) ||
+    size_t staged_bytes = 0;
+    size_t staged_rows = 0;
+    if (deferred_defaults_segment != nullptr) {
+        staged_bytes = deferred_defaults_segment->allocatedBytes();
+        staged_rows = deferred_defaults_segment->rows();
+    }
+
+    // The columns recycled by the pool come with the capacity of the blocks before, and thus the block is measured by
+    // the bytes of its rows rather than by the bytes allocated to it.
+    size_t block_bytes =
+        block_columns_pool->getCapacity() > 0 ? block_holder.bytes() : block_holder.allocatedBytes();
+
+    return (block_bytes + staged_bytes > max_allowed_block_size_in_bytes) ||
+        (block_holder.rows() + staged_rows > max_allowed_block_size_in_rows) ||
         (t_now - flushedAt > batchTimeout * 1000000); // TODO: Potential problem for complex unit test.
 }
 
-bool BlockSupportedBuffer::empty() { return (block_holder.rows() == 0); }
+bool BlockSupportedBuffer::empty() {
+    return (block_holder.rows() == 0) && (deferred_defaults_segment == nullptr || deferred_defaults_segment->empty());
+}
 
 // update the time-stamp only for rows that can be de-serialized correctly
 void BlockSupportedBuffer::update_maxmin_msg_timestamp(int64_t timestamp) {
@@ -19,6 +19,9 @@ limitations under the License.
 #include <Aggregator/AggregatorLoaderManager.h>
 #include <Aggregator/SerializationHelper.h>
 #include <Aggregator/ProtobufBatchReader.h>
+#include <Aggregator/ProtobufMessageArena.h>
+#include <Aggregator/DeferredDefaultsSegment.h>
+#include <Aggregator/BlockColumnsPool.h>
 
 #include <KafkaConnector/Buffer.h>
 #include <KafkaConnector/KafkaConnector.h>
@@ -57,8 +60,12 @@ class BlockSupportedBuffer : public kafka::Buffer {
             context(context_),
             kafka_connector(kafka_connector_),
             schema_update_tracker{
-                std::make_shared<TableSchemaUpdateTracker>(table_, table_definition, loader_manager)} {
+                std::make_shared<TableSchemaUpdateTracker>(table_, table_definition, loader_manager)},
+            message_arena{createMessageArena()},
+            deferred_defaults_segment{createDeferredDefaultsSegment()},
+            block_columns_pool{BlockColumnsPool::getTablePool(table_)} {
         assigned_buffer_id = buffer_id++;
+        block_holder = block_columns_pool->acquire(block_holder);
     }
 
     ~BlockSupportedBuffer() override = default;
@@ -95,6 +102,22 @@ class BlockSupportedBuffer : public kafka::Buffer {
     kafka::KafkaConnector* kafka_connector;
     TableSchemaUpdateTrackerPtr schema_update_tracker;
 
+    // the arena to parse the messages on, reset after each message. nullptr if the arena is disabled.
+    std::unique_ptr<ProtobufMessageArena> message_arena;
+
+    static std::unique_ptr<ProtobufMessageArena> createMessageArena();
+
+    // the rows staged for their missing columns to be filled at the flush. nullptr if filled per message instead.
+    std::unique_ptr<DeferredDefaultsSegment> deferred_defaults_segment;
+
+    static std::unique_ptr<DeferredDefaultsSegment> createDeferredDefaultsSegment();
+
+    // To fill the defaults of the staged rows and to append them to the block holder.
+    void materializeDeferredDefaults();
+
+    // the columns recycled from the flushed blocks of the table, for the block holder to be built in.
+    BlockColumnsPoolPtr block_columns_pool;
+
     void update_maxmin_msg_timestamp(int64_t timestamp);
 };
 
@@ -28,6 +28,7 @@ limitations under the License.
 #include <Aggregator/BlockSupportedBufferFlushTask.h>
 #include <Aggregator/AggregatorLoader.h>
 #include <Aggregator/DistributedLoaderLock.h>
+#include <Aggregator/BlockColumnsPool.h>
 
 namespace DB {
 namespace ErrorCodes {
@@ -666,6 +667,13 @@ bool BlockSupportedBufferFlushTask::blockWait() {
 void BlockSupportedBufferFlushTask::moveBlock(DB::Block& other_block) {
     block_to_load = SerializationHelper::getBlockDefinition(columns_definition);
 
+    // With the columns given back to the pool once the task is done, the columns are moved over rather than copied,
+    // and the buffer builds its next block in the columns recycled by the pool.
+    if (BlockColumnsPool::getTablePool(table)->getCapacity() > 0) {
+        block_to_load.setColumns(other_block.mutateColumns());
+        return;
+    }
+
     DB::MutableColumns columns = other_block.cloneEmptyColumns();
     DB::MutableColumns other_columns = other_block.mutateColumns();
 
@@ -699,6 +707,9 @@ BlockSupportedBufferFlushTask::~BlockSupportedBufferFlushTask() {
         send_loading_future.wait();
         LOG_AGGRPROC(3) << "FlushTask " << assigned_task_id << " finished";
     }
+
+    // The block is done with, whether it has been loaded or not, and thus its columns get recycled.
+    BlockColumnsPool::getTablePool(table)->release(std::move(block_to_load));
 }
 
 } // namespace nuclm
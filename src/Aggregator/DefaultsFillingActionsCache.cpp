@@ -0,0 +1,133 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include <Aggregator/DefaultsFillingActionsCache.h>
+#include "common/logging.hpp"
+#include "common/settings_factory.hpp"
+
+#include <boost/functional/hash.hpp>
+
+namespace nuclm {
+
+DefaultsFillingActionsCachePtr DefaultsFillingActionsCache::getTableCache(const std::string& table_name) {
+    static std::mutex table_caches_mutex;
+    static std::unordered_map<std::string, DefaultsFillingActionsCachePtr> table_caches;
+
+    std::lock_guard<std::mutex> lck(table_caches_mutex);
+    auto it = table_caches.find(table_name);
+    if (it != table_caches.end()) {
+        return it->second;
+    }
+
+    size_t capacity = with_settings(
+        [](SETTINGS s) { return s.config.aggregatorLoader.defaults_filling_actions_cache_size_per_table; });
+    LOG_AGGRPROC(4) << "create defaults filling actions cache for table: " << table_name
+                    << " with capacity: " << capacity;
+    auto cache = std::make_shared<DefaultsFillingActionsCache>(capacity);
+    table_caches.emplace(table_name, cache);
+    return cache;
+}
+
+size_t DefaultsFillingActionsCache::computeEntryKey(size_t schema_key, const DB::NamesAndTypesList& input_columns,
+                                                    const DB::NamesAndTypesList& required_columns) {
+    size_t seed = schema_key;
+    for (const auto& column : input_columns) {
+        boost::hash_combine(seed, column.name);
+    }
+    // the input columns and the required columns are told apart by the size of the input columns.
+    boost::hash_combine(seed, input_columns.size());
+    for (const auto& column : required_columns) {
+        boost::hash_combine(seed, column.name);
+    }
+    return seed;
+}
+
+DB::ExpressionActionsPtr DefaultsFillingActionsCache::get(size_t schema_key, const DB::NamesAndTypesList& input_columns,
+                                                          const DB::NamesAndTypesList& required_columns) {
+    if (capacity == 0) {
+        return nullptr;
+    }
+
+    size_t key = computeEntryKey(schema_key, input_columns, required_columns);
+    std::lock_guard<std::mutex> lck(mutex);
+    auto range = index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto entry = it->second;
+        // the types are compared along with the names.
+        if (entry->schema_key == schema_key && entry->input_columns == input_columns &&
+            entry->required_columns == required_columns) {
+            entries.splice(entries.begin(), entries, entry);
+            return entry->actions;
+        }
+    }
+    return nullptr;
+}
+
+void DefaultsFillingActionsCache::put(size_t schema_key, const DB::NamesAndTypesList& input_columns,
+                                      const DB::NamesAndTypesList& required_columns,
+                                      DB::ExpressionActionsPtr actions) {
+    if (capacity == 0) {
+        return;
+    }
+
+    size_t key = computeEntryKey(schema_key, input_columns, required_columns);
+    std::lock_guard<std::mutex> lck(mutex);
+    auto range = index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto entry = it->second;
+        if (entry->schema_key == schema_key && entry->input_columns == input_columns &&
+            entry->required_columns == required_columns) {
+            // compiled concurrently by another buffer of the table, and the two are equivalent.
+            entries.splice(entries.begin(), entries, entry);
+            return;
+        }
+    }
+
+    if (entries.size() >= capacity) {
+        const Entry& evicted = entries.back();
+        size_t evicted_key = computeEntryKey(evicted.schema_key, evicted.input_columns, evicted.required_columns);
+        auto evicted_range = index.equal_range(evicted_key);
+        for (auto it = evicted_range.first; it != evicted_range.second; ++it) {
+            if (it->second == std::prev(entries.end())) {
+                index.erase(it);
+                break;
+            }
+        }
+        entries.pop_back();
+    }
+
+    entries.push_front(Entry{schema_key, input_columns, required_columns, std::move(actions)});
+    index.emplace(key, entries.begin());
+}
+
+void DefaultsFillingActionsCache::retainSchema(size_t schema_key) {
+    std::lock_guard<std::mutex> lck(mutex);
+    for (auto it = index.begin(); it != index.end();) {
+        if (it->second->schema_key != schema_key) {
+            entries.erase(it->second);
+            it = index.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t DefaultsFillingActionsCache::size() const {
+    std::lock_guard<std::mutex> lck(mutex);
+    return entries.size();
+}
+
+} // namespace nuclm
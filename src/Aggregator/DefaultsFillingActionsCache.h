@@ -0,0 +1,94 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <Core/Block.h>
+#include <Core/NamesAndTypes.h>
+#include <Interpreters/ExpressionActions.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace nuclm {
+
+class DefaultsFillingActionsCache;
+using DefaultsFillingActionsCachePtr = std::shared_ptr<DefaultsFillingActionsCache>;
+
+/**
+ * A bounded cache of the compiled actions that fill the missing columns of a block with their defaults, as built by
+ * blockAddMissingDefaults, keyed by the key of the table schema and the columns in and out of the actions. A message
+ * that leaves out the same default columns as the previous ones, or a block to be migrated to the same schema, runs
+ * the actions already compiled rather than compiling the default expressions again. The actions of non-deterministic
+ * default expressions, such as now() or today(), are not put into the cache, as their values get folded at compile
+ * time.
+ *
+ * The cache of a table is shared by all of the buffers of the table. The least recently used actions are evicted once
+ * the cache is full, and the actions compiled against the schemas other than the latest one are dropped when a buffer
+ * moves to the latest schema.
+ */
+class DefaultsFillingActionsCache {
+  public:
+    explicit DefaultsFillingActionsCache(size_t capacity_) : capacity(capacity_) {}
+
+    ~DefaultsFillingActionsCache() = default;
+
+    /**
+     * The cache shared by the buffers of the table, with its capacity taken from
+     * aggregatorLoader.defaults_filling_actions_cache_size_per_table at the time the cache is created.
+     */
+    static DefaultsFillingActionsCachePtr getTableCache(const std::string& table_name);
+
+    // Return nullptr if no actions are compiled for the columns against the schema.
+    DB::ExpressionActionsPtr get(size_t schema_key, const DB::NamesAndTypesList& input_columns,
+                                 const DB::NamesAndTypesList& required_columns);
+
+    void put(size_t schema_key, const DB::NamesAndTypesList& input_columns,
+             const DB::NamesAndTypesList& required_columns, DB::ExpressionActionsPtr actions);
+
+    // To drop the actions compiled against the schemas other than the specified one.
+    void retainSchema(size_t schema_key);
+
+    size_t size() const;
+
+    size_t getCapacity() const { return capacity; }
+
+  private:
+    struct Entry {
+        size_t schema_key;
+        // to tell apart the columns with the same hash.
+        DB::NamesAndTypesList input_columns;
+        DB::NamesAndTypesList required_columns;
+        DB::ExpressionActionsPtr actions;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    static size_t computeEntryKey(size_t schema_key, const DB::NamesAndTypesList& input_columns,
+                                  const DB::NamesAndTypesList& required_columns);
+
+    const size_t capacity;
+
+    mutable std::mutex mutex;
+    // the most recently used entry at the front.
+    EntryList entries;
+    std::unordered_multimap<size_t, EntryList::iterator> index;
+};
+
+} // namespace nuclm
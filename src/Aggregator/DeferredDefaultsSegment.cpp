@@ -0,0 +1,141 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include <Aggregator/DeferredDefaultsSegment.h>
+#include <Aggregator/ProtobufBatchReader.h>
+
+#include "common/logging.hpp"
+#include "monitor/metrics_collector.hpp"
+
+namespace nuclm {
+
+size_t DeferredDefaultsSegment::allocatedBytes() const {
+    size_t bytes = 0;
+    for (const auto& column : staged_columns) {
+        bytes += column->allocatedBytes();
+    }
+    return bytes;
+}
+
+bool DeferredDefaultsSegment::accepts(const InsertColumnsPlanPtr& columns_plan, size_t columns_schema_key) const {
+    if (empty()) {
+        return true;
+    }
+    if (columns_schema_key != schema_key) {
+        return false;
+    }
+    if (columns_plan == plan) {
+        return true;
+    }
+
+    // The same statement planned again, after its plan has been evicted from the plan cache.
+    const ColumnTypesAndNamesTableDefinition& staged_definition = plan->columns_definition;
+    const ColumnTypesAndNamesTableDefinition& columns_definition = columns_plan->columns_definition;
+    if (staged_definition.size() != columns_definition.size()) {
+        return false;
+    }
+    for (size_t cindex = 0; cindex < staged_definition.size(); cindex++) {
+        if (staged_definition[cindex].name != columns_definition[cindex].name ||
+            staged_definition[cindex].type_name != columns_definition[cindex].type_name) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DeferredDefaultsSegment::startMessage() {
+    if (message_rows.empty() || message_rows.back() > 0) {
+        message_rows.push_back(0);
+    }
+}
+
+void DeferredDefaultsSegment::append(const InsertColumnsPlanPtr& columns_plan, size_t columns_schema_key,
+                                     const TableColumnsDescription& columns_table_definition,
+                                     DB::MutableColumns& columns) {
+    size_t rows_appended = columns.empty() ? 0 : columns[0]->size();
+    if (empty()) {
+        plan = columns_plan;
+        if (table_definition == nullptr || schema_key != columns_schema_key) {
+            table_definition = std::make_unique<TableColumnsDescription>(columns_table_definition);
+        }
+        schema_key = columns_schema_key;
+        staged_columns = std::move(columns);
+    } else {
+        for (size_t cindex = 0; cindex < staged_columns.size(); cindex++) {
+            staged_columns[cindex]->insertRangeFrom(*columns[cindex], 0, columns[cindex]->size());
+        }
+    }
+    number_of_rows += rows_appended;
+    if (message_rows.empty()) {
+        message_rows.push_back(0);
+    }
+    message_rows.back() += rows_appended;
+}
+
+size_t DeferredDefaultsSegment::materialize(DB::Block& block, DB::ContextMutablePtr context) {
+    if (empty()) {
+        return 0;
+    }
+
+    const std::string& table = table_definition->getTableName();
+    LOG_AGGRPROC(4) << "to fill defaults for staged rows: " << number_of_rows << " for table: " << table;
+    DB::MutableColumns columns = std::move(staged_columns);
+    std::vector<size_t> rows_of_messages = std::move(message_rows);
+    clear();
+    try {
+        // the staged columns are handed back if the filling fails.
+        ProtobufBatchReader::populateMissingColumnsByFillingDefaults(*table_definition, schema_key,
+                                                                     plan->columns_definition, columns, block, context);
+        return 0;
+    } catch (...) {
+        LOG(WARNING) << "failed to fill defaults for staged rows of " << rows_of_messages.size()
+                     << " messages for table: " << table << ", to fill them message by message, with exception: "
+                     << DB::getCurrentExceptionMessage(false);
+    }
+
+    size_t messages_dropped = 0;
+    size_t row_offset = 0;
+    for (size_t rows : rows_of_messages) {
+        DB::MutableColumns message_columns;
+        for (const auto& column : columns) {
+            message_columns.push_back(DB::IColumn::mutate(column->cut(row_offset, rows)));
+        }
+        row_offset += rows;
+        try {
+            ProtobufBatchReader::populateMissingColumnsByFillingDefaults(
+                *table_definition, schema_key, plan->columns_definition, message_columns, block, context);
+        } catch (...) {
+            messages_dropped++;
+            LOG(ERROR) << "failed to fill defaults for staged rows: " << rows << " of a message for table: " << table
+                       << " with exception return code: " << DB::getCurrentExceptionCode()
+                       << ", exception: " << DB::getCurrentExceptionMessage(true);
+        }
+    }
+
+    if (messages_dropped > 0) {
+        std::shared_ptr<LoaderMetrics> loader_metrics = MetricsCollector::instance().getLoaderMetrics();
+        loader_metrics->messages_failed_to_be_processed_total->labels({{"table", table}}).increment(messages_dropped);
+    }
+    return messages_dropped;
+}
+
+void DeferredDefaultsSegment::clear() {
+    staged_columns.clear();
+    number_of_rows = 0;
+    message_rows.clear();
+}
+
+} // namespace nuclm
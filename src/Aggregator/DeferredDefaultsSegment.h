@@ -0,0 +1,92 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <Aggregator/InsertColumnsPlanCache.h>
+#include <Aggregator/TableColumnsDescription.h>
+
+#include <Core/Block.h>
+#include <Interpreters/Context.h>
+
+#include <memory>
+#include <vector>
+
+namespace nuclm {
+
+/**
+ * The rows of the consecutive messages that leave out the same columns, staged in the columns of their insert plan,
+ * for the missing columns to be filled with their defaults once over all of the rows, instead of once per message.
+ *
+ * The staged rows are always behind the rows already in the block of the buffer, and the segment is materialized into
+ * the block before any other rows get appended to the block, before the block gets migrated to a new schema, and
+ * when the block gets flushed. Thus the rows in the block keep the order of the messages, and the block constructed
+ * for a range of offsets is the same as when the defaults are filled per message, as long as the default expressions
+ * are deterministic. The rows whose defaults involve now(), today() or another non-deterministic expression are not
+ * staged, and are filled per message instead, as their values would otherwise be taken at the materializing.
+ */
+class DeferredDefaultsSegment {
+  public:
+    DeferredDefaultsSegment() = default;
+
+    ~DeferredDefaultsSegment() = default;
+
+    bool empty() const { return number_of_rows == 0; }
+
+    size_t rows() const { return number_of_rows; }
+
+    size_t allocatedBytes() const;
+
+    // Whether the columns decoded by the plan against the schema can be staged behind the rows of the segment.
+    bool accepts(const InsertColumnsPlanPtr& columns_plan, size_t columns_schema_key) const;
+
+    // To start the rows of another message, for the rows staged afterwards to be told apart from the earlier ones.
+    void startMessage();
+
+    /**
+     * To stage the columns decoded by the plan against the table definition, which the caller has to have checked with
+     * accepts() if the segment is not empty. The rows belong to the message last started.
+     */
+    void append(const InsertColumnsPlanPtr& columns_plan, size_t columns_schema_key,
+                const TableColumnsDescription& columns_table_definition, DB::MutableColumns& columns);
+
+    /**
+     * To fill the missing columns of the staged rows with their defaults, and to append the rows to the block, which
+     * has to follow the table definition that the rows have been staged against. If the filling fails over all of the
+     * staged rows, the rows are filled message by message, with only the messages failing on their own dropped and
+     * counted in messages_failed_to_be_processed_total, the same as when the defaults are filled per message. Return
+     * the number of the messages dropped. The segment is empty afterwards.
+     */
+    size_t materialize(DB::Block& block, DB::ContextMutablePtr context);
+
+    size_t messages() const { return message_rows.size(); }
+
+    // To drop the staged rows.
+    void clear();
+
+  private:
+    InsertColumnsPlanPtr plan;
+    size_t schema_key = 0;
+    // kept across the segments of the same schema.
+    std::unique_ptr<TableColumnsDescription> table_definition;
+
+    DB::MutableColumns staged_columns;
+    size_t number_of_rows = 0;
+    // the number of the staged rows of each message, in the staged order.
+    std::vector<size_t> message_rows;
+};
+
+} // namespace nuclm
@@ -0,0 +1,129 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include <Aggregator/InsertColumnsPlanCache.h>
+#include "common/logging.hpp"
+#include "common/settings_factory.hpp"
+
+#include <boost/functional/hash.hpp>
+
+namespace nuclm {
+
+InsertColumnsPlanCachePtr InsertColumnsPlanCache::getTableCache(const std::string& table_name) {
+    static std::mutex table_caches_mutex;
+    static std::unordered_map<std::string, InsertColumnsPlanCachePtr> table_caches;
+
+    std::lock_guard<std::mutex> lck(table_caches_mutex);
+    auto it = table_caches.find(table_name);
+    if (it != table_caches.end()) {
+        return it->second;
+    }
+
+    size_t capacity =
+        with_settings([](SETTINGS s) { return s.config.aggregatorLoader.insert_columns_plan_cache_size_per_table; });
+    LOG_AGGRPROC(4) << "create insert columns plan cache for table: " << table_name << " with capacity: " << capacity;
+    auto cache = std::make_shared<InsertColumnsPlanCache>(capacity);
+    table_caches.emplace(table_name, cache);
+    return cache;
+}
+
+size_t InsertColumnsPlanCache::computeSchemaKey(const TableColumnsDescription& table_definition) {
+    size_t seed = table_definition.getSchemaHash();
+    for (const auto& column : table_definition.getColumnsDescription()) {
+        boost::hash_combine(seed, column.column_name);
+        boost::hash_combine(seed, column.column_type);
+        boost::hash_combine(seed, static_cast<int>(column.column_default_description.column_kind));
+        boost::hash_combine(seed, column.column_default_description.expression);
+    }
+    return seed;
+}
+
+size_t InsertColumnsPlanCache::computeEntryKey(const std::string& sql_statement, size_t schema_key) {
+    size_t seed = std::hash<std::string>{}(sql_statement);
+    boost::hash_combine(seed, schema_key);
+    return seed;
+}
+
+InsertColumnsPlanPtr InsertColumnsPlanCache::get(const std::string& sql_statement, size_t schema_key) {
+    if (capacity == 0) {
+        return nullptr;
+    }
+
+    size_t key = computeEntryKey(sql_statement, schema_key);
+    std::lock_guard<std::mutex> lck(mutex);
+    auto range = index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto entry = it->second;
+        if (entry->schema_key == schema_key && entry->sql_statement == sql_statement) {
+            entries.splice(entries.begin(), entries, entry);
+            return entry->plan;
+        }
+    }
+    return nullptr;
+}
+
+void InsertColumnsPlanCache::put(const std::string& sql_statement, size_t schema_key, InsertColumnsPlanPtr plan) {
+    if (capacity == 0) {
+        return;
+    }
+
+    size_t key = computeEntryKey(sql_statement, schema_key);
+    std::lock_guard<std::mutex> lck(mutex);
+    auto range = index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto entry = it->second;
+        if (entry->schema_key == schema_key && entry->sql_statement == sql_statement) {
+            // built concurrently by another batch reader of the table, and the two plans are the same.
+            entries.splice(entries.begin(), entries, entry);
+            return;
+        }
+    }
+
+    if (entries.size() >= capacity) {
+        const Entry& evicted = entries.back();
+        size_t evicted_key = computeEntryKey(evicted.sql_statement, evicted.schema_key);
+        auto evicted_range = index.equal_range(evicted_key);
+        for (auto it = evicted_range.first; it != evicted_range.second; ++it) {
+            if (it->second == std::prev(entries.end())) {
+                index.erase(it);
+                break;
+            }
+        }
+        entries.pop_back();
+    }
+
+    entries.push_front(Entry{sql_statement, schema_key, std::move(plan)});
+    index.emplace(key, entries.begin());
+}
+
+void InsertColumnsPlanCache::retainSchema(size_t schema_key) {
+    std::lock_guard<std::mutex> lck(mutex);
+    for (auto it = index.begin(); it != index.end();) {
+        if (it->second->schema_key != schema_key) {
+            entries.erase(it->second);
+            it = index.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t InsertColumnsPlanCache::size() const {
+    std::lock_guard<std::mutex> lck(mutex);
+    return entries.size();
+}
+
+} // namespace nuclm
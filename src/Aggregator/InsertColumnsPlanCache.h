@@ -0,0 +1,114 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <Aggregator/TableColumnsDescription.h>
+#include <Aggregator/SerializationHelper.h>
+#include <Core/Block.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nuclm {
+
+/**
+ * The decode plan of an insert query statement against a table schema, which is what
+ * ProtobufBatchReader::determineColumnsDefinition works out of the statement, plus what the batch reader derives from
+ * it before decoding the rows. A plan is immutable once built, and is shared by the batch readers of the table.
+ */
+struct InsertColumnsPlan {
+    ColumnTypesAndNamesTableDefinition columns_definition;
+    bool table_definition_followed = false;
+    bool default_columns_missing = true;
+    bool columns_not_covered_no_deflexpres = false;
+    bool column_shuffled_needed = false;
+    // whether the defaults of the missing columns involve a non-deterministic default expression, such as now().
+    bool defaults_non_deterministic = false;
+    std::vector<size_t> order_mapping;
+    ColumnSerializers column_serializers;
+    // the block header of the columns in the statement, to clone the empty columns to decode into.
+    DB::Block sample_block;
+};
+
+using InsertColumnsPlanPtr = std::shared_ptr<const InsertColumnsPlan>;
+
+class InsertColumnsPlanCache;
+using InsertColumnsPlanCachePtr = std::shared_ptr<InsertColumnsPlanCache>;
+
+/**
+ * A bounded cache of the decode plans of a table, keyed by the hash of the insert query statement and the key of the
+ * table schema. The producers send the same few statements over and over again, and thus a plan saves the parsing of
+ * the statement and the lookup of its columns in the table schema for each message.
+ *
+ * The cache of a table is shared by all of the buffers of the table, across the partitions and the flushes. The least
+ * recently used plan is evicted once the cache is full. When the schema tracker of a buffer moves to a new schema,
+ * the plans built against the other schemas are dropped.
+ */
+class InsertColumnsPlanCache {
+  public:
+    explicit InsertColumnsPlanCache(size_t capacity_) : capacity(capacity_) {}
+
+    ~InsertColumnsPlanCache() = default;
+
+    /**
+     * The cache shared by the buffers of the table, with its capacity taken from
+     * aggregatorLoader.insert_columns_plan_cache_size_per_table at the time the cache is created.
+     */
+    static InsertColumnsPlanCachePtr getTableCache(const std::string& table_name);
+
+    /**
+     * The key of the schema that the plans are built against. The schema hash does not cover the default expressions,
+     * which the plans depend on, and thus they are folded into the key as well.
+     */
+    static size_t computeSchemaKey(const TableColumnsDescription& table_definition);
+
+    // Return nullptr if the statement has no plan against the schema.
+    InsertColumnsPlanPtr get(const std::string& sql_statement, size_t schema_key);
+
+    void put(const std::string& sql_statement, size_t schema_key, InsertColumnsPlanPtr plan);
+
+    // To drop the plans built against the schemas other than the specified one.
+    void retainSchema(size_t schema_key);
+
+    size_t size() const;
+
+    size_t getCapacity() const { return capacity; }
+
+  private:
+    struct Entry {
+        std::string sql_statement; // to tell apart the statements with the same hash.
+        size_t schema_key;
+        InsertColumnsPlanPtr plan;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    static size_t computeEntryKey(const std::string& sql_statement, size_t schema_key);
+
+    const size_t capacity;
+
+    mutable std::mutex mutex;
+    // the most recently used entry at the front.
+    EntryList entries;
+    std::unordered_multimap<size_t, EntryList::iterator> index;
+};
+
+} // namespace nuclm
@@ -26,13 +26,18 @@ limitations under the License.
 
 #include <memory>
 #include <atomic>
+#include <string>
 
 namespace nuclm {
 
 class IOServiceBasedThreadPool : public kafka::GenericThreadPool {
   public:
-    IOServiceBasedThreadPool(boost::asio::io_service* io_service_, size_t thread_num_) :
-            io_service(io_service_), number_of_thread(thread_num_), running(true) {}
+    IOServiceBasedThreadPool(boost::asio::io_service* io_service_, size_t thread_num_,
+                             const std::string& thread_name_prefix_ = "KConsumer") :
+            io_service(io_service_),
+            number_of_thread(thread_num_),
+            thread_name_prefix(thread_name_prefix_),
+            running(true) {}
 
     void init() override {
         pwork.reset(new boost::asio::io_service::work(*io_service));
@@ -40,15 +45,15 @@ class IOServiceBasedThreadPool : public kafka::GenericThreadPool {
         for (size_t i = 0; i < number_of_thread; i++) {
             thread_pool.create_thread([this, i]() {
                 // It's for kafka consumer only, so name it
-                std::string name = "KConsumer-" + std::to_string(i);
+                std::string name = thread_name_prefix + "-" + std::to_string(i);
 #ifdef __APPLE__
                 pthread_setname_np(name.c_str());
 #else
                 pthread_setname_np(pthread_self(), name.c_str());
 #endif /* __APPLE__ */
-                LOG(INFO) << "Kafka consumer thread " << i << " started";
+                LOG(INFO) << "Kafka consumer thread " << name << " started";
                 io_service->run();
-                LOG(INFO) << "Kafka consumer thread " << i << " exited";
+                LOG(INFO) << "Kafka consumer thread " << name << " exited";
             });
         }
 
@@ -98,6 +103,7 @@ class IOServiceBasedThreadPool : public kafka::GenericThreadPool {
     boost::thread_group thread_pool;
     std::shared_ptr<boost::asio::io_service::work> pwork; // to stop the thread pool from existing
     size_t number_of_thread;
+    std::string thread_name_prefix;
     std::atomic<bool> running;
 };
 
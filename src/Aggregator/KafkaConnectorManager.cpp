@@ -48,6 +48,16 @@ bool KafkaConnectorManager::initKafkaEnvironment() {
                 size_t number_of_threads_in_pool = s.config.kafka.configVariants.size();
                 thread_pool = std::make_shared<IOServiceBasedThreadPool>(&io_service, number_of_threads_in_pool);
                 thread_pool->init();
+
+                size_t partition_processing_thread_pool_size =
+                    s.config.kafka.consumerConf.partition_processing_thread_pool_size;
+                if (partition_processing_thread_pool_size > 0) {
+                    partition_thread_pool = std::make_shared<IOServiceBasedThreadPool>(
+                        &partition_io_service, partition_processing_thread_pool_size, "KPartition");
+                    partition_thread_pool->init();
+                    LOG(INFO) << " KafkaConnector Manager has initialized partition processing thread pool with size: "
+                              << partition_processing_thread_pool_size;
+                }
                 kafka_env_initialized = true;
                 LOG(INFO) << " KafkaConnector Manager has initialized thread pool for kafka environment.";
 
@@ -132,7 +142,7 @@ KafkaConnectorManager::KafkaConnectorPtr KafkaConnectorManager::startKafkaConnec
                 "session.timeout.ms", std::to_string(KafkaConnectorParametersChecker::adjustSessionTimeoutMs()),
                 "metadata.request.timeout.ms", std::to_string(cons_conf.metadata_request_timeout_ms),
                 "statistics.interval.ms", std::to_string(10000),
-                "partition.assignment.strategy", "range"
+                "partition.assignment.strategy", std::string(cons_conf.cooperative_rebalance ? "cooperative-sticky" : "range")
             );
             const char * kafka_debug = getenv("KAFKA_DEBUG");
             if (kafka_debug != nullptr) {
@@ -224,7 +234,8 @@ KafkaConnectorManager::KafkaConnectorPtr KafkaConnectorManager::startKafkaConnec
             };
 
             KafkaConnectorPtr kafka_connector =
-                std::make_shared<kafka::KafkaConnector>(idx, &conf, thread_pool, database_health_checker);
+                std::make_shared<kafka::KafkaConnector>(idx, &conf, thread_pool, database_health_checker,
+                                                        partition_thread_pool);
             // if (kafka_connector->start() ==0) {
             kafka_connector->start();
             std::string consumer_group_id_assigned =
@@ -264,6 +275,9 @@ bool KafkaConnectorManager::shutdownKafkaConnectors() {
 
         if (kafka_env_initialized) {
             thread_pool->shutdown();
+            if (partition_thread_pool != nullptr) {
+                partition_thread_pool->shutdown();
+            }
         }
 
         result = true;
@@ -356,6 +370,11 @@ void KafkaConnectorManager::getKafkaConnectorFreezeStatus(nlohmann::json& status
 }
 
 bool KafkaConnectorManager::setMetadataVersion(int version) {
+    // the metadata version is shared by all of the kafka connectors.
+    for (KafkaConnectorPtr& instance : kafka_connector_instances) {
+        if (!instance->allowsMetadataVersion(version))
+            return false;
+    }
     if (!kafka_connector_instances.empty()) {
         return kafka_connector_instances[0]->setMetadataVersion(version);
     }
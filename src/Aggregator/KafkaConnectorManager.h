@@ -42,6 +42,7 @@ class KafkaConnectorManager {
             loader_manager(loader_manager_),
             kafka_connector_instances{},
             thread_pool{nullptr},
+            partition_thread_pool{nullptr},
             kafka_env_initialized{false},
             kafka_connectors_started{false} {}
 
@@ -94,6 +95,10 @@ class KafkaConnectorManager {
     boost::asio::io_service io_service;
     std::shared_ptr<kafka::GenericThreadPool> thread_pool;
 
+    // the optional pool shared by the kafka connectors to process the partitions of a batch in parallel.
+    boost::asio::io_service partition_io_service;
+    std::shared_ptr<kafka::GenericThreadPool> partition_thread_pool;
+
     std::atomic<bool> kafka_env_initialized;
     std::atomic<bool> kafka_connectors_started;
 };
@@ -17,14 +17,19 @@ limitations under the License.
 #include <Aggregator/ProtobufBatchReader.h>
 #include <Serializable/ProtobufReader.h>
 #include <Aggregator/BlockAddMissingDefaults.h>
+#include <Aggregator/SQLBatchRequestStreamDecoder.h>
 
 #include "common/logging.hpp"
 #include "monitor/metrics_collector.hpp"
+#include "common/settings_factory.hpp"
 
 #include <Parsers/ASTInsertQuery.h>
 #include <Parsers/ParserQuery.h>
 #include <Parsers/parseQuery.h>
 #include <Parsers/formatAST.h>
+#include <DataStreams/NativeBlockInputStream.h>
+#include <IO/ReadBufferFromMemory.h>
+#include <Common/quoteString.h>
 
 #include <boost/algorithm/string.hpp>
 #include <string.h>
@@ -54,6 +59,19 @@ static DB::ASTPtr parseQuery(const char*& pos, const char* end, bool allow_multi
     return res;
 }
 
+// The insert query statement with the columns named explicitly, for the encodings that carry the column names.
+static std::string buildInsertStatementOfColumns(const std::string& table_name,
+                                                 const std::vector<std::string>& column_names) {
+    std::string sql_statement = "insert into " + DB::backQuoteIfNeed(table_name) + " (";
+    std::string placeholders;
+    for (size_t cindex = 0; cindex < column_names.size(); cindex++) {
+        sql_statement += (cindex == 0 ? "" : ", ") + DB::backQuoteIfNeed(column_names[cindex]);
+        placeholders += (cindex == 0 ? "?" : ", ?");
+    }
+    sql_statement += ") values (" + placeholders + ")";
+    return sql_statement;
+}
+
 /**
  * Case 1 (Implicit Columns):
  *          insert into table values(?, ?, ?, ....?), that indicates that we are inserting full columns
@@ -149,7 +167,6 @@ ProtobufBatchReader::determineColumnsDefinition(const std::string& sql_statement
                                                 std::vector<size_t>& order_mapping,
                                                 const TableColumnsDescription& table_definition) {
     std::string table_name = table_definition.getTableName();
-    // TODO: Potential opportunity to improve performance by caching sql parsed columns.
     auto extracted_column_names = ProtobufBatchReader::extractColumnNames(sql_statement, table_name);
 
     ColumnTypesAndNamesTableDefinition columns_chosen_for_deserialization;
@@ -264,9 +281,127 @@ static bool check_column_order_different(const ColumnTypesAndNamesTableDefinitio
     return false;
 }
 
+InsertColumnsPlanPtr ProtobufBatchReader::buildInsertColumnsPlan(const std::string& sql_statement,
+                                                                 const TableColumnsDescription& table_definition) {
+    auto plan = std::make_shared<InsertColumnsPlan>();
+
+    // Get the per-insertion specific ordered columns definition.
+    // The "true value" of columns_not_covered_no_deflexpres indicates that: the columns that are not covered in batched
+    // columns definition from incoming message, do not have user-defined default expressions associated with.
+    // Construct the column order_mapping for the returned columns definition also.
+    plan->columns_definition = determineColumnsDefinition(sql_statement, plan->table_definition_followed,
+                                                          plan->default_columns_missing,
+                                                          plan->columns_not_covered_no_deflexpres,
+                                                          plan->order_mapping, table_definition);
+
+    LOG_AGGRPROC(4)
+        << " columns not covered by those specified in incoming message have default expressions associated: "
+        << (plan->columns_not_covered_no_deflexpres ? "YES" : "NO");
+
+    // The corresponding column deserializer based on the per-insertion specific ordered columns definition.
+    plan->column_serializers = SerializationHelper::getColumnSerializers(plan->columns_definition);
+    LOG_AGGRPROC(4) << "column serializer selected is: "
+                    << SerializationHelper::strOfColumnSerializers(plan->column_serializers)
+                    << " with table definition being followed: " << plan->table_definition_followed
+                    << " with default columns missing: " << plan->default_columns_missing;
+
+    // Get the block header definition based on the per-insertion ordered columns definition for the current batch.
+    plan->sample_block = SerializationHelper::getBlockDefinition(plan->columns_definition);
+
+    // Include both ordinary + default.
+    // FullColumnTypesAndNamesDefinition from cache instead of rebuilding the definition each time.
+    const ColumnTypesAndNamesTableDefinition& full_columns_definition =
+        table_definition.getFullColumnTypesAndNamesDefinitionCache();
+    // The columns can be full columns, but still being altered by the Client application. Thus, checking full size does
+    // not change the shuffle or not decision.
+    // The dynamic schema update can also introduce the situation that always, table_definition_followed is false, for
+    // both implicit columns insert statement, and explicit columns insert statements.
+    if (!plan->table_definition_followed) {
+        if (check_column_order_different(plan->columns_definition, full_columns_definition)) {
+            plan->column_shuffled_needed = true;
+            LOG_AGGRPROC(4) << " column_shuffled_needed is: " << plan->column_shuffled_needed;
+            size_t column_index = 0;
+            for (size_t mapping_result : plan->order_mapping) {
+                LOG_AGGRPROC(4) << " column index : " << column_index++ << " mapped to column: " << mapping_result;
+            }
+        } else {
+            LOG_AGGRPROC(4) << " no column shuffled_needed ";
+        }
+    } else {
+        LOG_AGGRPROC(4) << " table definition fully followed, thus no column shuffled_needed";
+    }
+
+    if (plan->default_columns_missing || plan->columns_not_covered_no_deflexpres) {
+        DB::NamesAndTypesList required_columns;
+        for (const auto& column_definition : full_columns_definition) {
+            required_columns.emplace_back(column_definition.name, column_definition.type);
+        }
+        try {
+            plan->defaults_non_deterministic = hasNonDeterministicDefaults(
+                plan->sample_block, required_columns, table_definition.getNativeDBColumnsDescriptionCache(), context);
+        } catch (...) {
+            // The filling fails on each message then, which is not to be deferred either.
+            LOG_AGGRPROC(2) << "failed to compile defaults filling actions for sql statement: " << sql_statement
+                            << " with exception: " << DB::getCurrentExceptionMessage(false);
+            plan->defaults_non_deterministic = true;
+        }
+        LOG_AGGRPROC(4) << " defaults of missing columns are non-deterministic: " << plan->defaults_non_deterministic;
+    }
+
+    return plan;
+}
+
+size_t ProtobufBatchReader::getSchemaKey(const TableColumnsDescription& table_definition) const {
+    // The key of the latest schema is computed once by the schema tracker. A table definition passed in from elsewhere
+    // (in testing) has its key computed here.
+    return (&table_definition == &schema_tracker->getLatestSchema())
+        ? schema_tracker->getLatestSchemaPlanKey()
+        : InsertColumnsPlanCache::computeSchemaKey(table_definition);
+}
+
+InsertColumnsPlanPtr ProtobufBatchReader::getInsertColumnsPlan(const std::string& sql_statement,
+                                                               const TableColumnsDescription& table_definition) {
+    size_t schema_key = getSchemaKey(table_definition);
+    const InsertColumnsPlanCachePtr& plan_cache = schema_tracker->getInsertColumnsPlanCache();
+    InsertColumnsPlanPtr plan = plan_cache->get(sql_statement, schema_key);
+    if (plan != nullptr) {
+        LOG_AGGRPROC(4) << "insert columns plan found in cache for sql statement: " << sql_statement;
+        return plan;
+    }
+
+    // A statement that fails to be planned throws, and thus never gets into the cache.
+    plan = buildInsertColumnsPlan(sql_statement, table_definition);
+    plan_cache->put(sql_statement, schema_key, plan);
+    return plan;
+}
+
 bool ProtobufBatchReader::read() {
-    nucolumnar::aggregator::v1::SQLBatchRequest deserialized_batch_request;
-    deserialized_batch_request.ParseFromString(message);
+    bool streaming_decoder_enabled =
+        with_settings([](SETTINGS s) { return s.config.aggregatorLoader.streaming_protobuf_decoder_enabled; });
+    if (streaming_decoder_enabled) {
+        SQLBatchRequestStreamDecoder decoder(message_data, message_size);
+        if (decoder.scanRequest()) {
+            LOG_AGGRPROC(4) << "shard id decoded: " << decoder.getShard();
+            LOG_AGGRPROC(4) << "table name decoded: " << decoder.getTable();
+            LOG_AGGRPROC(4) << "table schema hash value: " << decoder.getSchemaHashCode();
+            trackSchemaOfMessage(decoder.getSchemaHashCode(), decoder.getTable());
+
+            bool processing_result = true;
+            if (readStreamed(schema_tracker->getLatestSchema(), decoder, processing_result)) {
+                return processing_result;
+            }
+
+            // The rows are malformed, and the parsed message decides what can be salvaged out of them, as before.
+            LOG_AGGRPROC(2) << "stream decoder failed on the rows of the message for table: " << decoder.getTable()
+                            << " thus to fall back to the parsed message";
+            std::unique_ptr<nucolumnar::aggregator::v1::SQLBatchRequest> heap_holder;
+            return read(schema_tracker->getLatestSchema(), *parseMessage(heap_holder));
+        }
+        LOG_AGGRPROC(4) << "message is not decodable by the stream decoder, thus to fall back to the parsed message";
+    }
+
+    std::unique_ptr<nucolumnar::aggregator::v1::SQLBatchRequest> heap_holder;
+    const nucolumnar::aggregator::v1::SQLBatchRequest& deserialized_batch_request = *parseMessage(heap_holder);
 
     LOG_AGGRPROC(4) << " total received debug message size: " << deserialized_batch_request.ByteSizeLong()
                     << " has content: " << deserialized_batch_request.DebugString();
@@ -276,7 +411,27 @@ bool ProtobufBatchReader::read() {
 
     size_t hash_code = deserialized_batch_request.schema_hashcode();
     LOG_AGGRPROC(4) << "table schema hash value: " << hash_code;
+    trackSchemaOfMessage(hash_code, deserialized_batch_request.table());
 
+    bool processing_result = read(schema_tracker->getLatestSchema(), deserialized_batch_request);
+    return processing_result;
+}
+
+nucolumnar::aggregator::v1::SQLBatchRequest*
+ProtobufBatchReader::parseMessage(std::unique_ptr<nucolumnar::aggregator::v1::SQLBatchRequest>& heap_holder) {
+    nucolumnar::aggregator::v1::SQLBatchRequest* deserialized_batch_request = nullptr;
+    if (arena != nullptr) {
+        deserialized_batch_request =
+            google::protobuf::Arena::CreateMessage<nucolumnar::aggregator::v1::SQLBatchRequest>(arena);
+    } else {
+        heap_holder = std::make_unique<nucolumnar::aggregator::v1::SQLBatchRequest>();
+        deserialized_batch_request = heap_holder.get();
+    }
+    deserialized_batch_request->ParseFromArray(message_data, static_cast<int>(message_size));
+    return deserialized_batch_request;
+}
+
+void ProtobufBatchReader::trackSchemaOfMessage(size_t hash_code, const std::string& table_in_message) {
     std::shared_ptr<SchemaTrackingMetrics> schema_tracking_metrics =
         MetricsCollector::instance().getSchemaTrackingMetrics();
     std::string table_name = schema_tracker->getLatestSchema().getTableName();
@@ -305,16 +460,21 @@ bool ProtobufBatchReader::read() {
     if (new_schema_fetched || !schema_tracker->currentSchemaUsedInBlockMatchesLatestSchema()) {
         // To Do: need to have a metric to show the migration
         if (new_schema_fetched) {
-            LOG_AGGRPROC(2) << "new version schema is fetched for table: " << deserialized_batch_request.table()
+            LOG_AGGRPROC(2) << "new version schema is fetched for table: " << table_in_message
                             << " thus block migration to latest schema is needed";
             schema_tracking_metrics->schema_tracking_new_schema_fetched_total->labels({{"table", table_name}})
                 .increment(1);
         }
         if (!schema_tracker->currentSchemaUsedInBlockMatchesLatestSchema()) {
             LOG_AGGRPROC(2) << "current block construction associated schema is not latest for table: "
-                            << deserialized_batch_request.table() << " thus block migration to latest schema is needed";
+                            << table_in_message << " thus block migration to latest schema is needed";
+        }
+        if (deferred_defaults_segment != nullptr) {
+            // The staged rows follow the schema of the block, and thus get into the block ahead of the migration.
+            deferred_defaults_segment->materialize(block, context);
         }
-        migrateBlockToMatchLatestSchema(block, schema_tracker->getLatestSchema(), context);
+        migrateBlockToMatchLatestSchema(block, schema_tracker->getLatestSchema(),
+                                        schema_tracker->getLatestSchemaPlanKey(), context);
         schema_tracker->updateCurrentSchemaUsedInBlockWithLatestSchema();
 
         schema_tracking_metrics->schema_tracking_block_schema_migration_total->labels({{"table", table_name}})
@@ -322,20 +482,26 @@ bool ProtobufBatchReader::read() {
     } else {
         LOG_AGGRPROC(4)
             << "new version schema is not fetched and current schema used for block construction is latest for table: "
-            << deserialized_batch_request.table();
+            << table_in_message;
     }
 
     std::string latest_schema_hash = std::to_string(schema_tracker->getLatestSchema().getSchemaHash());
     schema_tracking_metrics->schema_tracking_current_schema_used
         ->labels({{"table", table_name}, {"version", latest_schema_hash}})
         .update(1);
-
-    bool processing_result = read(schema_tracker->getLatestSchema(), deserialized_batch_request);
-    return processing_result;
 }
 
 bool ProtobufBatchReader::read(const TableColumnsDescription& table_definition,
                                const nucolumnar::aggregator::v1::SQLBatchRequest& deserialized_batch_request) {
+    if (deserialized_batch_request.has_clickhouseencoding()) {
+        LOG_AGGRPROC(4) << "has clickhouse native encoding for table: " << deserialized_batch_request.table();
+        return readNativeBlocks(table_definition, deserialized_batch_request.clickhouseencoding());
+    }
+    if (deserialized_batch_request.has_columnarencoding()) {
+        LOG_AGGRPROC(4) << "has columnar encoding for table: " << deserialized_batch_request.table();
+        return readColumnarBatch(table_definition, deserialized_batch_request.columnarencoding());
+    }
+
     bool processing_result = true;
     LOG_AGGRPROC(4) << "has nucolumnar encoding or not: " << deserialized_batch_request.has_nucolumnarencoding();
     const nucolumnar::aggregator::v1::SqlWithBatchBindings& deserialized_batch_bindings =
@@ -348,74 +514,32 @@ bool ProtobufBatchReader::read(const TableColumnsDescription& table_definition,
     size_t total_number_rows = deserialized_batch_bindings.batch_bindings_size();
     LOG_AGGRPROC(4) << "total number of the rows involved are: " << total_number_rows;
 
-    // Get the per-insertion specific ordered columns definition.
-    bool table_definition_followed = false;
-    bool default_columns_missing = true;
-    // The "true value" indicates that: the columns that are not covered in batched columns definition from incoming
-    // message, do not have user-defined default expressions associated with.
-    bool columns_not_covered_no_deflexpres = false;
-    // Construct the column order_mapping for the returned columns definition also.
-    std::vector<size_t> order_mapping;
-    ColumnTypesAndNamesTableDefinition batched_columns_definition = determineColumnsDefinition(
-        deserialized_batch_bindings.sql(), table_definition_followed, default_columns_missing,
-        columns_not_covered_no_deflexpres, order_mapping, table_definition);
-
-    LOG_AGGRPROC(4)
-        << " columns not covered by those specified in incoming message have default expressions associated: "
-        << (columns_not_covered_no_deflexpres ? "YES" : "NO");
-
-    // The corresponding column deserializer based on the per-insertion specific ordered columns definition.
-    ColumnSerializers columnSerializers = SerializationHelper::getColumnSerializers(batched_columns_definition);
-    LOG_AGGRPROC(4) << "column serializer selected is: "
-                    << SerializationHelper::strOfColumnSerializers(columnSerializers)
-                    << " with table definition being followed: " << table_definition_followed
-                    << " with default columns missing: " << default_columns_missing;
-
-    // Get the block header definition based on the per-insertion ordered columns definition for the current batch.
-    DB::Block current_sample_block = SerializationHelper::getBlockDefinition(batched_columns_definition);
-    DB::MutableColumns current_columns = current_sample_block.cloneEmptyColumns();
+    // Get the per-insertion specific decode plan, which is shared by the messages with the same sql statement.
+    InsertColumnsPlanPtr plan = getInsertColumnsPlan(deserialized_batch_bindings.sql(), table_definition);
+    const ColumnSerializers& columnSerializers = plan->column_serializers;
 
-    bool column_shuffled_needed = false;
-
-    // Include both ordinary + default.
-    // FullColumnTypesAndNamesDefinition from cache instead of rebuilding the definition each time.
-    const ColumnTypesAndNamesTableDefinition& full_columns_definition =
-        table_definition.getFullColumnTypesAndNamesDefinitionCache();
-    // The columns can be full columns, but still being altered by the Client application. Thus, checking full size does
-    // not change the shuffle or not decision.
-    // The dynamic schema update can also introduce the situation that always, table_definition_followed is false, for
-    // both implicit columns insert statement, and explicit columns insert statements.
-    if (!table_definition_followed) {
-        if (check_column_order_different(batched_columns_definition, full_columns_definition)) {
-            column_shuffled_needed = true;
-            LOG_AGGRPROC(4) << " column_shuffled_needed is: " << column_shuffled_needed;
-            size_t column_index = 0;
-            for (size_t mapping_result : order_mapping) {
-                LOG_AGGRPROC(4) << " column index : " << column_index++ << " mapped to column: " << mapping_result;
-            }
-        } else {
-            LOG_AGGRPROC(4) << " no column shuffled_needed ";
-        }
-    } else {
-        LOG_AGGRPROC(4) << " table definition fully followed, thus no column shuffled_needed";
-    }
+    // The rows that need neither shuffling nor filling go straight into the block, with nothing to copy afterwards.
+    bool decode_into_block = isDecodableIntoBlock(*plan);
+    std::vector<size_t> block_column_sizes;
+    DB::MutableColumns current_columns =
+        decode_into_block ? takeColumnsOfBlock(block_column_sizes) : plan->sample_block.cloneEmptyColumns();
 
     // Only some columns are populated in the full column definition, because of the incoming message to be
     // deserialized.
     bool columns_number_mismatched = false;
     size_t total_mismatched_rows_count = 0;
+    size_t expected_number_of_columns = columnSerializers.size();
     try {
         for (size_t rindex = 0; rindex < total_number_rows; rindex++) {
             const nucolumnar::aggregator::v1::DataBindingList& row = deserialized_batch_bindings.batch_bindings(rindex);
 
             size_t number_of_columns = row.values().size();
-            size_t expected_number_of_columns = columnSerializers.size();
             LOG_AGGRPROC(4) << "total number of columns available in received row: " << rindex
                             << " is: " << number_of_columns;
             LOG_AGGRPROC(4) << "total number of columns expected from the defined schema in received row: " << rindex
                             << " is: " << expected_number_of_columns;
 
-            // still let the deserializer to continue, but log the detected error.
+            // still check the rest of the rows, but log the detected error.
             if (number_of_columns != expected_number_of_columns) {
                 columns_number_mismatched = true;
                 total_mismatched_rows_count++;
@@ -425,40 +549,37 @@ bool ProtobufBatchReader::read(const TableColumnsDescription& table_definition,
                     " according to schema defined for: " + table_definition.getTableName();
                 LOG(ERROR) << err_msg;
             }
+        }
 
-            // The number of the columns need to follow what columnSerializer has provided.
-            for (size_t cindex = 0; cindex < expected_number_of_columns; cindex++) {
-                const nucolumnar::datatypes::v1::ValueP& row_value = row.values(cindex);
-                ProtobufReader reader(row_value);
-
-                // need to invoke the deserializer: SerializableDataTypePtr
-                LOG_AGGRPROC(4) << "to deserialize column: " << cindex;
-                bool row_added;
-                columnSerializers[cindex]->deserializeProtobuf(*current_columns[cindex], reader, true, row_added);
-                if (!row_added) {
-                    processing_result = false;
-                    LOG(ERROR) << "protobuf-reader deserialization for column index: " << cindex << " and column name "
-                               << current_columns[cindex]->getName() + " failed";
-                } else {
-                    LOG_AGGRPROC(4) << "finish deserialize column: " << cindex;
-                }
-
-                total_bytes_processed += reader.getTotalBytesRead();
-
-                if (!column_shuffled_needed) {
-                    LOG_AGGRPROC(4) << "row: " << rindex << " column:  " << cindex
-                                    << " protobuf-reader processes: " << reader.getTotalBytesRead();
-                } else {
-                    LOG_AGGRPROC(4) << "row: " << rindex << " column:  " << cindex
-                                    << " protobuf-reader processes: " << reader.getTotalBytesRead();
-                }
+        // The columns are decoded one at a time across all of the rows, with each column type looping over its values
+        // in one go. The number of the columns need to follow what columnSerializer has provided.
+        for (size_t cindex = 0; cindex < expected_number_of_columns && !columns_number_mismatched; cindex++) {
+            ProtobufColumnReader reader(deserialized_batch_bindings.batch_bindings(), cindex);
+
+            // need to invoke the deserializer: SerializableDataTypePtr
+            LOG_AGGRPROC(4) << "to deserialize column: " << cindex;
+            size_t rows_added = 0;
+            columnSerializers[cindex]->deserializeProtobufColumn(*current_columns[cindex], reader, rows_added);
+            if (rows_added != total_number_rows) {
+                processing_result = false;
+                LOG(ERROR) << "protobuf-reader deserialization for column index: " << cindex << " and column name "
+                           << current_columns[cindex]->getName() << " failed for "
+                           << total_number_rows - rows_added << " rows";
+            } else {
+                LOG_AGGRPROC(4) << "finish deserialize column: " << cindex;
             }
+
+            total_bytes_processed += reader.getTotalBytesRead();
+            LOG_AGGRPROC(4) << "column: " << cindex << " protobuf-reader processes: " << reader.getTotalBytesRead();
         }
     } catch (const DB::Exception& ex) {
         LOG(ERROR) << DB::getCurrentExceptionMessage(true);
         auto code = DB::getCurrentExceptionCode();
 
         LOG(ERROR) << "with exception return code: " << code;
+        if (decode_into_block) {
+            returnColumnsToBlock(current_columns, block_column_sizes, true);
+        }
 
         std::string err_msg =
             "DB::Exception captured. Failed to de-serialize received message with total number of rows: " +
@@ -470,6 +591,9 @@ bool ProtobufBatchReader::read(const TableColumnsDescription& table_definition,
         auto code = DB::getCurrentExceptionCode();
 
         LOG(ERROR) << "with exception return code: " << code;
+        if (decode_into_block) {
+            returnColumnsToBlock(current_columns, block_column_sizes, true);
+        }
 
         std::string err_msg = "Exception other than DB::Exception captured. Failed to de-serialize received message "
                               "with total number of rows: " +
@@ -479,21 +603,352 @@ bool ProtobufBatchReader::read(const TableColumnsDescription& table_definition,
     }
 
     LOG_AGGRPROC(4) << "totally rows: " << total_number_rows << " processed with bytes: " << total_bytes_processed
-                    << " compared to passed in message with bytes: " << message.size();
+                    << " compared to passed in message with bytes: " << message_size;
 
     // if columns number mismatched, throw exception.
     if (columns_number_mismatched) {
-        size_t expected_number_of_columns = columnSerializers.size();
         std::string err_msg =
             " number of available columns in the received rows does not match number of expected columns: " +
             std::to_string(expected_number_of_columns) +
             " according to schema defined for: " + table_definition.getTableName();
         +" total number of rows identified such mismatch: " + std::to_string(total_mismatched_rows_count);
         LOG(ERROR) << err_msg;
+        if (decode_into_block) {
+            returnColumnsToBlock(current_columns, block_column_sizes, true);
+        }
         throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_DESERIALIZE_MESSAGE);
     }
 
+    if (decode_into_block) {
+        // The values that fail to be decoded would leave the columns of the block at different sizes, and thus the
+        // whole message is taken out of the block.
+        returnColumnsToBlock(current_columns, block_column_sizes, !processing_result);
+        if (processing_result) {
+            total_rows_processed += total_number_rows;
+        }
+        return processing_result;
+    }
+
+    appendColumnsToBlock(table_definition, plan, current_columns, total_number_rows);
+    return processing_result;
+}
+
+bool ProtobufBatchReader::readStreamed(const TableColumnsDescription& table_definition,
+                                       SQLBatchRequestStreamDecoder& decoder, bool& processing_result) {
+    processing_result = true;
+    LOG_AGGRPROC(4) << "insert related sql statement is: " << decoder.getSql();
+    size_t total_number_rows = decoder.getNumberOfRows();
+    LOG_AGGRPROC(4) << "total number of the rows involved are: " << total_number_rows;
+
+    InsertColumnsPlanPtr plan = getInsertColumnsPlan(decoder.getSql(), table_definition);
+    const ColumnSerializers& columnSerializers = plan->column_serializers;
+    size_t expected_number_of_columns = columnSerializers.size();
+
+    bool decode_into_block = isDecodableIntoBlock(*plan);
+    std::vector<size_t> block_column_sizes;
+    DB::MutableColumns current_columns =
+        decode_into_block ? takeColumnsOfBlock(block_column_sizes) : plan->sample_block.cloneEmptyColumns();
+    SQLBatchRequestStreamDecoder::DecodeStats stats;
+    try {
+        if (!decoder.decodeRows(columnSerializers, current_columns, stats)) {
+            if (decode_into_block) {
+                returnColumnsToBlock(current_columns, block_column_sizes, true);
+            }
+            return false;
+        }
+    } catch (...) {
+        LOG(ERROR) << DB::getCurrentExceptionMessage(true);
+        LOG(ERROR) << "with exception return code: " << DB::getCurrentExceptionCode();
+        if (decode_into_block) {
+            returnColumnsToBlock(current_columns, block_column_sizes, true);
+        }
+
+        std::string err_msg =
+            "Exception captured. Failed to stream-decode received message with total number of rows: " +
+            std::to_string(total_number_rows) + " for table: " + table_definition.getTableName();
+        LOG(ERROR) << err_msg;
+        throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_DESERIALIZE_MESSAGE);
+    }
+
+    for (size_t cindex = 0; cindex < expected_number_of_columns; cindex++) {
+        if (stats.failed_values[cindex] > 0) {
+            processing_result = false;
+            LOG(ERROR) << "protobuf stream decoder for column index: " << cindex << " and column name "
+                       << current_columns[cindex]->getName() << " failed for " << stats.failed_values[cindex]
+                       << " rows";
+        }
+    }
+    total_bytes_processed += stats.bytes_read;
+    LOG_AGGRPROC(4) << "totally rows: " << stats.rows << " processed with bytes: " << total_bytes_processed
+                    << " compared to passed in message with bytes: " << message_size;
+
+    if (stats.mismatched_rows > 0) {
+        std::string err_msg =
+            " number of available columns in the received rows does not match number of expected columns: " +
+            std::to_string(expected_number_of_columns) + " according to schema defined for: " +
+            table_definition.getTableName() + " total number of rows identified such mismatch: " +
+            std::to_string(stats.mismatched_rows);
+        LOG(ERROR) << err_msg;
+        if (decode_into_block) {
+            returnColumnsToBlock(current_columns, block_column_sizes, true);
+        }
+        throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_DESERIALIZE_MESSAGE);
+    }
+
+    if (decode_into_block) {
+        returnColumnsToBlock(current_columns, block_column_sizes, !processing_result);
+        if (processing_result) {
+            total_rows_processed += total_number_rows;
+        }
+        return true;
+    }
+
+    appendColumnsToBlock(table_definition, plan, current_columns, total_number_rows);
+    return true;
+}
+
+bool ProtobufBatchReader::isDecodableIntoBlock(const InsertColumnsPlan& plan) const {
+    if (plan.default_columns_missing || plan.columns_not_covered_no_deflexpres || plan.column_shuffled_needed) {
+        return false;
+    }
+    bool decode_into_block_enabled =
+        with_settings([](SETTINGS s) { return s.config.aggregatorLoader.decode_into_block_enabled; });
+    if (!decode_into_block_enabled) {
+        return false;
+    }
+
+    // The block follows the schema it has been migrated to, which the plan is built against, unless a table
+    // definition other than the latest schema is passed in (in testing).
+    size_t number_of_columns = plan.columns_definition.size();
+    if (block.columns() != number_of_columns) {
+        return false;
+    }
+    for (size_t cindex = 0; cindex < number_of_columns; cindex++) {
+        const DB::ColumnWithTypeAndName& block_column = block.getByPosition(cindex);
+        const ColumnTypeAndNameDefinition& column_definition = plan.columns_definition[cindex];
+        if (block_column.name != column_definition.name || !block_column.type->equals(*column_definition.type)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+DB::MutableColumns ProtobufBatchReader::takeColumnsOfBlock(std::vector<size_t>& column_sizes) {
+    if (deferred_defaults_segment != nullptr) {
+        // The staged rows go into the block ahead of the rows of this message.
+        deferred_defaults_segment->materialize(block, context);
+    }
+
+    DB::MutableColumns block_columns = block.mutateColumns();
+    column_sizes.resize(block_columns.size());
+    for (size_t cindex = 0; cindex < block_columns.size(); cindex++) {
+        column_sizes[cindex] = block_columns[cindex]->size();
+    }
+    return block_columns;
+}
+
+void ProtobufBatchReader::returnColumnsToBlock(DB::MutableColumns& block_columns,
+                                               const std::vector<size_t>& column_sizes, bool rollback) {
+    if (rollback) {
+        for (size_t cindex = 0; cindex < block_columns.size(); cindex++) {
+            size_t current_size = block_columns[cindex]->size();
+            if (current_size > column_sizes[cindex]) {
+                block_columns[cindex]->popBack(current_size - column_sizes[cindex]);
+            }
+        }
+        LOG_AGGRPROC(4) << "columns decoded into the block rolled back to the sizes before the message";
+    }
+    block.setColumns(std::move(block_columns));
+}
+
+bool ProtobufBatchReader::readNativeBlocks(const TableColumnsDescription& table_definition,
+                                           const nucolumnar::aggregator::v1::ClickHouseNativeBlock& native_block) {
+    const std::string& native_data = native_block.block();
+    DB::ReadBufferFromMemory native_input(native_data.data(), native_data.size());
+    // As with "FORMAT Native", the blocks are written without the block info of the TCP protocol.
+    DB::NativeBlockInputStream native_stream(native_input, 0);
+
+    // All of the blocks get decoded and checked against the schema before any of them is appended, so that a message
+    // failing on a later block does not leave the rows of its earlier blocks behind.
+    std::vector<std::pair<DB::Block, InsertColumnsPlanPtr>> native_blocks;
+    size_t total_number_blocks = 0;
+    // The end of the data is checked ahead of each block, as the native stream returns an empty block both at the end
+    // and for a block written without any column.
+    while (!native_input.eof()) {
+        DB::Block native_columns;
+        try {
+            native_columns = native_stream.read();
+        } catch (...) {
+            LOG(ERROR) << DB::getCurrentExceptionMessage(true);
+            LOG(ERROR) << "with exception return code: " << DB::getCurrentExceptionCode();
+
+            std::string err_msg = "Failed to decode clickhouse native block: " + std::to_string(total_number_blocks) +
+                " in received message for table: " + table_definition.getTableName();
+            LOG(ERROR) << err_msg;
+            throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_DESERIALIZE_MESSAGE);
+        }
+        if (native_columns.columns() == 0) {
+            std::string err_msg = "clickhouse native block: " + std::to_string(total_number_blocks) +
+                " carries no columns in received message for table: " + table_definition.getTableName();
+            LOG(ERROR) << err_msg;
+            throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_DESERIALIZE_MESSAGE);
+        }
+
+        LOG_AGGRPROC(4) << "clickhouse native block: " << total_number_blocks << " has columns: "
+                        << native_columns.dumpStructure();
+
+        // The columns of the block are treated as the explicit columns of an insert query statement, so that the
+        // columns get reordered and the missing columns get filled, the same way as the nucolumnar encoding.
+        std::string sql_statement =
+            buildInsertStatementOfColumns(table_definition.getTableName(), native_columns.getNames());
+        InsertColumnsPlanPtr plan = getInsertColumnsPlan(sql_statement, table_definition);
+        if (native_columns.columns() != plan->columns_definition.size()) {
+            std::string err_msg = "clickhouse native block: " + std::to_string(total_number_blocks) + " carries: " +
+                std::to_string(native_columns.columns()) + " columns, while the insert plan expects: " +
+                std::to_string(plan->columns_definition.size()) + " columns for table: " +
+                table_definition.getTableName();
+            LOG(ERROR) << err_msg;
+            throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_DESERIALIZE_MESSAGE);
+        }
+
+        for (size_t cindex = 0; cindex < native_columns.columns(); cindex++) {
+            const DB::ColumnWithTypeAndName& native_column = native_columns.getByPosition(cindex);
+            const ColumnTypeAndNameDefinition& column_definition = plan->columns_definition[cindex];
+            if (!native_column.type->equals(*column_definition.type)) {
+                std::string err_msg = "clickhouse native block column: " + native_column.name + " has type: " +
+                    native_column.type->getName() + " that does not match type: " + column_definition.type_name +
+                    " according to schema defined for: " + table_definition.getTableName();
+                LOG(ERROR) << err_msg;
+                throw DB::Exception(err_msg, ErrorCodes::COLUMN_DEFINITION_NOT_MATCHED_WITH_SCHEMA);
+            }
+        }
+
+        native_blocks.emplace_back(std::move(native_columns), plan);
+        total_number_blocks++;
+    }
+
+    for (auto& [native_columns, plan] : native_blocks) {
+        size_t total_number_rows = native_columns.rows();
+        total_bytes_processed += native_columns.bytes();
+        DB::MutableColumns current_columns = native_columns.mutateColumns();
+        appendColumnsToBlock(table_definition, plan, current_columns, total_number_rows);
+    }
+
+    LOG_AGGRPROC(4) << "totally native blocks: " << total_number_blocks << " with rows: " << total_rows_processed
+                    << " processed with bytes: " << total_bytes_processed
+                    << " compared to passed in message with bytes: " << message_size;
+    return true;
+}
+
+bool ProtobufBatchReader::readColumnarBatch(const TableColumnsDescription& table_definition,
+                                            const nucolumnar::aggregator::v1::ColumnarBatch& columnar_batch) {
+    size_t total_number_rows = columnar_batch.number_of_rows();
+    std::vector<std::string> column_names;
+    for (const auto& column_values : columnar_batch.columns()) {
+        column_names.push_back(column_values.name());
+    }
+    if (column_names.empty()) {
+        std::string err_msg = "columnar encoding with: " + std::to_string(total_number_rows) +
+            " rows carries no columns for table: " + table_definition.getTableName();
+        LOG(ERROR) << err_msg;
+        throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_DESERIALIZE_MESSAGE);
+    }
+
+    // The columns are treated as the explicit columns of an insert query statement, the same as the native blocks.
+    std::string sql_statement = buildInsertStatementOfColumns(table_definition.getTableName(), column_names);
+    InsertColumnsPlanPtr plan = getInsertColumnsPlan(sql_statement, table_definition);
+    const ColumnSerializers& column_serializers = plan->column_serializers;
+    // The columns get decoded by position, thus each column of the plan has to be carried by the batch, and the other
+    // way around.
+    if (column_names.size() != plan->columns_definition.size()) {
+        std::string err_msg = "columnar encoding carries: " + std::to_string(column_names.size()) +
+            " columns, while the insert plan expects: " + std::to_string(plan->columns_definition.size()) +
+            " columns for table: " + table_definition.getTableName();
+        LOG(ERROR) << err_msg;
+        throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_DESERIALIZE_MESSAGE);
+    }
+
+    // As with the nucolumnar encoding, the columns in the order of the block get decoded straight into the block.
+    bool decode_into_block = isDecodableIntoBlock(*plan);
+    std::vector<size_t> block_column_sizes;
+    DB::MutableColumns current_columns =
+        decode_into_block ? takeColumnsOfBlock(block_column_sizes) : plan->sample_block.cloneEmptyColumns();
+    size_t cindex = 0;
+    try {
+        // Each column is appended in bulk out of its packed values.
+        for (; cindex < column_serializers.size(); cindex++) {
+            const auto& column_values = columnar_batch.columns(static_cast<int>(cindex));
+            size_t old_bytes = current_columns[cindex]->byteSize();
+            if (!column_serializers[cindex]->deserializeColumnarValues(*current_columns[cindex], column_values,
+                                                                       total_number_rows)) {
+                break;
+            }
+            total_bytes_processed += current_columns[cindex]->byteSize() - old_bytes;
+        }
+    } catch (...) {
+        LOG(ERROR) << DB::getCurrentExceptionMessage(true);
+        LOG(ERROR) << "with exception return code: " << DB::getCurrentExceptionCode();
+        if (decode_into_block) {
+            returnColumnsToBlock(current_columns, block_column_sizes, true);
+        }
+        std::string err_msg = "Failed to decode columnar encoding column: " + column_names[cindex] +
+            " for table: " + table_definition.getTableName();
+        LOG(ERROR) << err_msg;
+        throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_DESERIALIZE_MESSAGE);
+    }
+
+    if (cindex < column_serializers.size()) {
+        if (decode_into_block) {
+            returnColumnsToBlock(current_columns, block_column_sizes, true);
+        }
+        std::string err_msg = "columnar encoding column: " + column_names[cindex] +
+            " does not carry the values of: " + std::to_string(total_number_rows) + " rows of type: " +
+            plan->columns_definition[cindex].type_name + " for table: " + table_definition.getTableName();
+        LOG(ERROR) << err_msg;
+        throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_DESERIALIZE_MESSAGE);
+    }
+
+    if (decode_into_block) {
+        returnColumnsToBlock(current_columns, block_column_sizes, false);
+        total_rows_processed += total_number_rows;
+    } else {
+        appendColumnsToBlock(table_definition, plan, current_columns, total_number_rows);
+    }
+
+    LOG_AGGRPROC(4) << "columnar encoding with columns: " << column_names.size() << " and rows: " << total_number_rows
+                    << " processed with bytes: " << total_bytes_processed
+                    << " compared to passed in message with bytes: " << message_size;
+    return true;
+}
+
+void ProtobufBatchReader::appendColumnsToBlock(const TableColumnsDescription& table_definition,
+                                               const InsertColumnsPlanPtr& plan, DB::MutableColumns& current_columns,
+                                               size_t total_number_rows) {
+    const ColumnTypesAndNamesTableDefinition& batched_columns_definition = plan->columns_definition;
+    const std::vector<size_t>& order_mapping = plan->order_mapping;
+    bool default_columns_missing = plan->default_columns_missing;
+    bool columns_not_covered_no_deflexpres = plan->columns_not_covered_no_deflexpres;
+    bool column_shuffled_needed = plan->column_shuffled_needed;
+
     try {
+        if (deferred_defaults_segment != nullptr) {
+            // The non-deterministic defaults are filled per message, as they would take the time of the materializing.
+            bool defaults_filling_needed = (default_columns_missing || columns_not_covered_no_deflexpres) &&
+                !plan->defaults_non_deterministic;
+            size_t schema_key = getSchemaKey(table_definition);
+            // The staged rows go into the block ahead of the rows of this message, unless they are staged together.
+            if (!defaults_filling_needed || !deferred_defaults_segment->accepts(plan, schema_key)) {
+                deferred_defaults_segment->materialize(block, context);
+            }
+            if (defaults_filling_needed) {
+                LOG_AGGRPROC(4) << "rows: " << total_number_rows << " staged for deferred defaults filling, with "
+                                << deferred_defaults_segment->rows() << " rows staged before";
+                deferred_defaults_segment->append(plan, schema_key, table_definition, current_columns);
+                total_rows_processed += total_number_rows;
+                return;
+            }
+        }
+
         if (!default_columns_missing) {
             // The block is the accumulated bock up to now, which we need to make sure that the result is fully
             // populated by following the latest schema version.
@@ -540,15 +995,15 @@ bool ProtobufBatchReader::read(const TableColumnsDescription& table_definition,
             } else {
                 // Perform column filling based on the system-default expression for those columns that are missing
                 // in incoming message and these columns do not have explicit default expressions
-                populateMissingColumnsByFillingDefaults(table_definition, batched_columns_definition, current_columns,
-                                                        block, context);
+                populateMissingColumnsByFillingDefaults(table_definition, getSchemaKey(table_definition),
+                                                        batched_columns_definition, current_columns, block, context);
             }
         } else {
             // Perform column filling for the columns that have the user-provided explicit default expression, or
             // otherwise, use the system-default expression for the columns that do not have user-provided explicit
             // default expression.
-            populateMissingColumnsByFillingDefaults(table_definition, batched_columns_definition, current_columns,
-                                                    block, context);
+            populateMissingColumnsByFillingDefaults(table_definition, getSchemaKey(table_definition),
+                                                    batched_columns_definition, current_columns, block, context);
         }
 
         total_rows_processed += total_number_rows;
@@ -562,12 +1017,10 @@ bool ProtobufBatchReader::read(const TableColumnsDescription& table_definition,
             std::to_string(total_number_rows) + " for table: " + table_definition.getTableName();
         throw DB::Exception(err_msg, ErrorCodes::FAILED_TO_RECONSTRUCT_BLOCKS);
     }
-
-    return processing_result;
 }
 
 void ProtobufBatchReader::populateMissingColumnsByFillingDefaults(
-    const TableColumnsDescription& table_definition,
+    const TableColumnsDescription& table_definition, size_t schema_key,
     const ColumnTypesAndNamesTableDefinition& batched_columns_definition, DB::MutableColumns& current_columns,
     DB::Block& block_under_transformation, DB::ContextMutablePtr transformation_context) {
     LOG_AGGRPROC(4) << "missing columns encountered, to fix by filling default values with user/system-provided "
@@ -579,8 +1032,6 @@ void ProtobufBatchReader::populateMissingColumnsByFillingDefaults(
     const DB::ColumnDefaults& column_defaults = table_definition.getColumnDefaultsCache();
     LOG_AGGRPROC(4) << "number of column defaults identified is: " << column_defaults.size();
 
-    DB::MutableColumns block_columns = block_under_transformation.mutateColumns();
-
     if (CVLOG_IS_ON(VMODULE_AGGR_PROCESSOR, 4)) {
         for (const std::pair<std::string, DB::ColumnDefault> column_default : column_defaults) {
             LOG_AGGRPROC(4) << "column name is: " << column_default.first;
@@ -610,9 +1061,18 @@ void ProtobufBatchReader::populateMissingColumnsByFillingDefaults(
     current_constructed_block.setColumns(std::move(current_columns));
 
     const DB::ColumnsDescription& required_columns_definition = table_definition.getNativeDBColumnsDescriptionCache();
-    DB::Block processed_columns = blockAddMissingDefaults(current_constructed_block, required_columns,
-                                                          required_columns_definition, transformation_context);
+    DB::Block processed_columns;
+    try {
+        processed_columns = blockAddMissingDefaults(current_constructed_block, required_columns,
+                                                    required_columns_definition, table_definition.getTableName(),
+                                                    schema_key, transformation_context);
+    } catch (...) {
+        // the columns are handed back to the caller, with the block under transformation left as it was.
+        current_columns = current_constructed_block.mutateColumns();
+        throw;
+    }
     DB::MutableColumns processed_mutable_columns = processed_columns.mutateColumns();
+    DB::MutableColumns block_columns = block_under_transformation.mutateColumns();
     // finally, update to the block holder, following the table ordered used in the required_columns,
     size_t number_of_columns = block_columns.size();
     for (size_t column_index = 0; column_index < number_of_columns; column_index++) {
@@ -627,6 +1087,7 @@ void ProtobufBatchReader::populateMissingColumnsByFillingDefaults(
 
 void ProtobufBatchReader::migrateBlockToMatchLatestSchema(DB::Block& current_block,
                                                           const TableColumnsDescription& latest_schema,
+                                                          size_t latest_schema_key,
                                                           DB::ContextMutablePtr migration_context) {
     // Construct an empty block from the latest schema,
     DB::Block block_from_latest_schema =
@@ -637,8 +1098,9 @@ void ProtobufBatchReader::migrateBlockToMatchLatestSchema(DB::Block& current_blo
     const DB::ColumnsDescription& required_columns_definition = latest_schema.getNativeDBColumnsDescriptionCache();
     LOG_AGGRPROC(4) << "required columns definition has number of columns: " << required_columns_definition.size();
 
-    DB::Block migrated_block =
-        blockAddMissingDefaults(current_block, required_columns, required_columns_definition, migration_context);
+    DB::Block migrated_block = blockAddMissingDefaults(current_block, required_columns, required_columns_definition,
+                                                       latest_schema.getTableName(), latest_schema_key,
+                                                       migration_context);
 
     // Change current block's definition and then swap it with the one that has been populated with the latest schema
     LOG_AGGRPROC(4) << "migrated block has number of columns: " << migrated_block.columns();
@@ -17,6 +17,9 @@ limitations under the License.
 #pragma once
 
 #include <Aggregator/TableColumnsDescription.h>
+#include <Aggregator/InsertColumnsPlanCache.h>
+#include <Aggregator/DeferredDefaultsSegment.h>
+#include <Aggregator/SQLBatchRequestStreamDecoder.h>
 #include <Aggregator/SerializationHelper.h>
 #include <Aggregator/TableSchemaUpdateTracker.h>
 #include <Core/Block.h>
@@ -25,7 +28,11 @@ limitations under the License.
 #include <nucolumnar/aggregator/v1/nucolumnaraggregator.pb.h>
 #include <nucolumnar/datatypes/v1/columnartypes.pb.h>
 
+#include <google/protobuf/arena.h>
+
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace nuclm {
 
@@ -41,18 +48,47 @@ class ProtobufBatchReader {
      */
     ProtobufBatchReader(const std::string& message_, TableSchemaUpdateTrackerPtr schema_tracker_, DB::Block& block_,
                         DB::ContextMutablePtr context_) :
+            ProtobufBatchReader(message_.data(), message_.size(), schema_tracker_, block_, context_) {}
+
+    /**
+     * To read directly out of the message payload held by the caller (for example, the Kafka message), without the
+     * payload being copied. The payload has to outlive the reader.
+     */
+    ProtobufBatchReader(const char* message_data_, size_t message_size_, TableSchemaUpdateTrackerPtr schema_tracker_,
+                        DB::Block& block_, DB::ContextMutablePtr context_) :
             total_rows_processed(0),
             total_bytes_processed(0),
-            message(message_),
+            message_data(message_data_),
+            message_size(message_size_),
             block(block_),
             context(context_),
-            schema_tracker(schema_tracker_) {}
+            schema_tracker(schema_tracker_),
+            arena(nullptr),
+            deferred_defaults_segment(nullptr) {}
 
     ~ProtobufBatchReader() = default;
 
     // To perform the deserialization on the received message
     bool read();
 
+    /**
+     * To parse the message on the arena, rather than on the heap. The arena is owned by the caller, which resets it
+     * after the read.
+     */
+    void setArena(google::protobuf::Arena* arena_) { arena = arena_; }
+
+    /**
+     * To stage the rows that need the missing columns filled with defaults in the segment, rather than to fill them
+     * per message. The segment is owned by the caller, which materializes it into the block at the flush.
+     */
+    // The rows staged by the reader are of the message being read.
+    void setDeferredDefaultsSegment(DeferredDefaultsSegment* segment_) {
+        deferred_defaults_segment = segment_;
+        if (deferred_defaults_segment != nullptr) {
+            deferred_defaults_segment->startMessage();
+        }
+    }
+
     // to perform actual deserialization based on the latest table schema and the incoming message.
     bool read(const TableColumnsDescription& table_definition,
               const nucolumnar::aggregator::v1::SQLBatchRequest& deserialized_batch_request);
@@ -63,25 +99,28 @@ class ProtobufBatchReader {
      * (2) or using the system-default expression if the user-provided column default expression is not available
 
      * @param table_definition the table definition used for the batch reader
+     * @param schema_key the key of table_definition, as computed by InsertColumnsPlanCache::computeSchemaKey
      * @param batched_columns_definition the subset of the table definitions for the columns that show up in the
      incoming
      * kafka message
-     * @param current_columns the columns that have been constructed from the incoming message.
+     * @param current_columns the columns that have been constructed from the incoming message, which are handed back
+     * if the filling fails.
      *
      * @param block_under_transformation the candidate block that needs to  be populated with missing columns.
      *
      * @param transformation_context the context used for transformation.
      */
     static void
-    populateMissingColumnsByFillingDefaults(const TableColumnsDescription& table_definition,
+    populateMissingColumnsByFillingDefaults(const TableColumnsDescription& table_definition, size_t schema_key,
                                             const ColumnTypesAndNamesTableDefinition& batched_columns_definition,
                                             DB::MutableColumns& current_columns, DB::Block& block_under_transformation,
                                             DB::ContextMutablePtr transformation_context);
 
     // To perform missing column values filling for current block, to satisfy the latest schema. As a result of this
-    // call, current_block's column definitions get changed to follow the new schema.
+    // call, current_block's column definitions get changed to follow the new schema. latest_schema_key is the key of
+    // the latest schema, as computed by InsertColumnsPlanCache::computeSchemaKey.
     static void migrateBlockToMatchLatestSchema(DB::Block& current_block, const TableColumnsDescription& latest_schema,
-                                                DB::ContextMutablePtr migration_context);
+                                                size_t latest_schema_key, DB::ContextMutablePtr migration_context);
 
     /**
      * Based on the passed-in SQL statement's column specification, return the corresponding column type/name pairs that
@@ -115,6 +154,13 @@ class ProtobufBatchReader {
                                bool& default_columns_missing, bool& columns_not_covered_no_deflexpres,
                                std::vector<size_t>& order_mapping, const TableColumnsDescription& table_definition);
 
+    /**
+     * The decode plan of the SQL statement against the table definition, out of the plan cache of the table if the
+     * statement has been seen before, or otherwise built by determineColumnsDefinition and then added to the cache.
+     */
+    InsertColumnsPlanPtr getInsertColumnsPlan(const std::string& sql_statement,
+                                              const TableColumnsDescription& table_definition);
+
     size_t getRowsProcessed() { return total_rows_processed; }
 
     size_t getBytesProcessed() { return total_bytes_processed; }
@@ -122,16 +168,77 @@ class ProtobufBatchReader {
     static std::pair<std::vector<std::string>, size_t> extractColumnNames(const std::string& sql_statement,
                                                                           const std::string& table_name);
 
+  private:
+    // The key of the table definition in the caches of the plans and of the defaults filling actions.
+    size_t getSchemaKey(const TableColumnsDescription& table_definition) const;
+
+    InsertColumnsPlanPtr buildInsertColumnsPlan(const std::string& sql_statement,
+                                                const TableColumnsDescription& table_definition);
+
+    // To parse the message, on the arena if there is one. The heap-allocated message is held by heap_holder.
+    nucolumnar::aggregator::v1::SQLBatchRequest*
+    parseMessage(std::unique_ptr<nucolumnar::aggregator::v1::SQLBatchRequest>& heap_holder);
+
+    // To bring the schema tracker and the block under construction to the latest schema, for the hash in the message.
+    void trackSchemaOfMessage(size_t hash_code, const std::string& table_in_message);
+
+    /**
+     * To decode the rows scanned by the stream decoder, based on the latest table schema. Return false if the rows are
+     * malformed, with the block left untouched, for the parsed message to be read instead. processing_result is what
+     * read() returns otherwise.
+     */
+    bool readStreamed(const TableColumnsDescription& table_definition, SQLBatchRequestStreamDecoder& decoder,
+                      bool& processing_result);
+
+    /**
+     * To append the ClickHouse Native format blocks in the message, with the columns of each block checked against
+     * the table definition by name and by type.
+     */
+    bool readNativeBlocks(const TableColumnsDescription& table_definition,
+                          const nucolumnar::aggregator::v1::ClickHouseNativeBlock& native_block);
+
+    /**
+     * To append the columns of the columnar encoding, each out of its packed values in bulk, with the columns named by
+     * the encoding treated as the explicit columns of an insert query statement.
+     */
+    bool readColumnarBatch(const TableColumnsDescription& table_definition,
+                           const nucolumnar::aggregator::v1::ColumnarBatch& columnar_batch);
+
+    /**
+     * Whether the rows of the plan can be decoded straight into the columns of the block, rather than into the columns
+     * cloned from the plan, to be copied into the block afterwards. It is the case when the statement covers the
+     * columns of the block in their order, with nothing to shuffle and nothing to fill.
+     */
+    bool isDecodableIntoBlock(const InsertColumnsPlan& plan) const;
+
+    // To take the columns out of the block to decode into, with their sizes kept for the rollback.
+    DB::MutableColumns takeColumnsOfBlock(std::vector<size_t>& column_sizes);
+
+    // To put the columns back into the block, cut back to their sizes before the decoding if rollback is true.
+    void returnColumnsToBlock(DB::MutableColumns& block_columns, const std::vector<size_t>& column_sizes,
+                              bool rollback);
+
+    /**
+     * To append the decoded columns to the block, with the columns shuffled or the missing columns filled as planned.
+     * The columns with the missing columns are staged instead, if there is a deferred defaults segment.
+     */
+    void appendColumnsToBlock(const TableColumnsDescription& table_definition, const InsertColumnsPlanPtr& plan,
+                              DB::MutableColumns& current_columns, size_t total_number_rows);
+
   private:
     size_t total_rows_processed;
     size_t total_bytes_processed;
 
-    const std::string& message;
+    const char* message_data;
+    size_t message_size;
     DB::Block& block;
     DB::ContextMutablePtr context;
 
     // it holds multiple versions of the schemas seen in the life-time of the buffer.
     TableSchemaUpdateTrackerPtr schema_tracker;
+
+    google::protobuf::Arena* arena;
+    DeferredDefaultsSegment* deferred_defaults_segment;
 };
 
 } // namespace nuclm
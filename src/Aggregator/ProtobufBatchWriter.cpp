@@ -0,0 +1,233 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include <Aggregator/ProtobufBatchWriter.h>
+#include <Serializable/ProtobufWriter.h>
+
+#include <Common/quoteString.h>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+namespace nuclm {
+
+namespace ErrorCodes {
+extern const int COLUMN_DEFINITION_NOT_MATCHED_WITH_SCHEMA;
+} // namespace ErrorCodes
+
+using google::protobuf::io::CodedOutputStream;
+using WireFormatLite = google::protobuf::internal::WireFormatLite;
+
+namespace {
+
+// the field numbers of SQLBatchRequest
+constexpr int REQUEST_SHARD = 1;
+constexpr int REQUEST_TABLE = 2;
+constexpr int REQUEST_NUCOLUMNAR_ENCODING = 3;
+constexpr int REQUEST_SCHEMA_HASHCODE = 5;
+
+// the field numbers of SqlWithBatchBindings
+constexpr int BINDINGS_SQL = 1;
+constexpr int BINDINGS_BATCH_BINDINGS = 2;
+
+// the tag and the length of a length-delimited field, with the field itself to be appended by the caller.
+void appendFieldHeader(std::string& out, int field, size_t length) {
+    uint8_t header[16];
+    uint8_t* end = WireFormatLite::WriteTagToArray(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, header);
+    end = CodedOutputStream::WriteVarint32ToArray(static_cast<uint32_t>(length), end);
+    out.append(reinterpret_cast<const char*>(header), end - header);
+}
+
+void appendLengthDelimited(std::string& out, int field, const std::string& value) {
+    appendFieldHeader(out, field, value.size());
+    out.append(value);
+}
+
+void appendVarint(std::string& out, int field, uint64_t value) {
+    uint8_t buffer[16];
+    uint8_t* end = WireFormatLite::WriteTagToArray(field, WireFormatLite::WIRETYPE_VARINT, buffer);
+    end = CodedOutputStream::WriteVarint64ToArray(value, end);
+    out.append(reinterpret_cast<const char*>(buffer), end - buffer);
+}
+
+std::string buildSql(const std::string& table, const ColumnTypesAndNamesTableDefinition& columns_definition) {
+    std::string column_names;
+    std::string placeholders;
+    for (const auto& column_definition : columns_definition) {
+        if (!column_names.empty()) {
+            column_names += ", ";
+            placeholders += ", ";
+        }
+        column_names += DB::backQuoteIfNeed(column_definition.name);
+        placeholders += "?";
+    }
+    return "insert into " + DB::backQuoteIfNeed(table) + " (" + column_names + ") values (" + placeholders + ")";
+}
+
+} // namespace
+
+ProtobufBatchWriter::ProtobufBatchWriter(const std::string& table_, const std::string& shard_,
+                                         const ColumnTypesAndNamesTableDefinition& columns_definition_,
+                                         int64_t schema_hashcode_, Encoding encoding_) :
+        table(table_),
+        shard(shard_),
+        columns_definition(columns_definition_),
+        schema_hashcode(schema_hashcode_),
+        sql(buildSql(table_, columns_definition_)),
+        encoding(encoding_),
+        column_serializers(SerializationHelper::getColumnSerializers(columns_definition_)) {
+    for (const auto& column_definition : columns_definition) {
+        row_values.add_values();
+        row_columns.push_back(column_definition.type->createColumn());
+        if (encoding == Encoding::COLUMNAR)
+            staged_columns.push_back(column_definition.type->createColumn());
+    }
+    appendLengthDelimited(bindings, BINDINGS_SQL, sql);
+}
+
+void ProtobufBatchWriter::appendBlock(const DB::Block& block) {
+    // the columns held, in case that some of them are constant columns to be converted to the full ones.
+    DB::Columns full_columns;
+    std::vector<const DB::IColumn*> columns;
+    for (const auto& column_definition : columns_definition) {
+        const DB::ColumnWithTypeAndName& column = block.getByName(column_definition.name);
+        if (!column.type->equals(*column_definition.type)) {
+            std::string err_msg = "column: " + column_definition.name + " in block has type: " +
+                column.type->getName() + " that does not match the type to write: " + column_definition.type_name;
+            throw DB::Exception(err_msg, ErrorCodes::COLUMN_DEFINITION_NOT_MATCHED_WITH_SCHEMA);
+        }
+        full_columns.push_back(column.column->convertToFullColumnIfConst());
+        columns.push_back(full_columns.back().get());
+    }
+
+    size_t rows = block.rows();
+    if (encoding == Encoding::COLUMNAR) {
+        for (size_t cindex = 0; cindex < columns.size(); cindex++) {
+            staged_columns[cindex]->insertRangeFrom(*columns[cindex], 0, rows);
+        }
+        number_of_rows += rows;
+        return;
+    }
+    for (size_t row_num = 0; row_num < rows; row_num++) {
+        encodeRow(columns, row_num);
+    }
+}
+
+void ProtobufBatchWriter::appendRow(const std::vector<DB::Field>& row) {
+    if (row.size() != columns_definition.size()) {
+        std::string err_msg = "row with number of values: " + std::to_string(row.size()) +
+            " does not match number of columns to write: " + std::to_string(columns_definition.size());
+        throw DB::Exception(err_msg, ErrorCodes::COLUMN_DEFINITION_NOT_MATCHED_WITH_SCHEMA);
+    }
+
+    if (encoding == Encoding::COLUMNAR) {
+        size_t cindex = 0;
+        try {
+            for (; cindex < row.size(); cindex++) {
+                staged_columns[cindex]->insert(row[cindex]);
+            }
+        } catch (...) {
+            for (size_t inserted = 0; inserted < cindex; inserted++) {
+                staged_columns[inserted]->popBack(1);
+            }
+            throw;
+        }
+        number_of_rows++;
+        return;
+    }
+
+    std::vector<const DB::IColumn*> columns;
+    try {
+        for (size_t cindex = 0; cindex < row.size(); cindex++) {
+            row_columns[cindex]->insert(row[cindex]);
+            columns.push_back(row_columns[cindex].get());
+        }
+        encodeRow(columns, 0);
+    } catch (...) {
+        for (auto& column : row_columns) {
+            if (!column->empty())
+                column->popBack(column->size());
+        }
+        throw;
+    }
+
+    for (auto& column : row_columns) {
+        column->popBack(1);
+    }
+}
+
+void ProtobufBatchWriter::encodeRow(const std::vector<const DB::IColumn*>& columns, size_t row_num) {
+    size_t value_index = 0;
+    for (size_t cindex = 0; cindex < columns.size(); cindex++) {
+        ProtobufWriter writer(*row_values.mutable_values(static_cast<int>(cindex)));
+        column_serializers[cindex]->serializeProtobuf(*columns[cindex], row_num, writer, value_index);
+    }
+
+    // The row is appended only once all of its values are written, for a row that fails not to be left half-encoded.
+    size_t row_size = row_values.ByteSizeLong();
+    appendFieldHeader(bindings, BINDINGS_BATCH_BINDINGS, row_size);
+    size_t old_size = bindings.size();
+    bindings.resize(old_size + row_size);
+    row_values.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(bindings.data() + old_size));
+    number_of_rows++;
+}
+
+std::string ProtobufBatchWriter::finish() {
+    if (encoding == Encoding::COLUMNAR) {
+        return finishColumnar();
+    }
+
+    std::string message;
+    message.reserve(shard.size() + table.size() + bindings.size() + 32);
+    if (!shard.empty()) {
+        appendLengthDelimited(message, REQUEST_SHARD, shard);
+    }
+    if (!table.empty()) {
+        appendLengthDelimited(message, REQUEST_TABLE, table);
+    }
+    appendLengthDelimited(message, REQUEST_NUCOLUMNAR_ENCODING, bindings);
+    if (schema_hashcode != 0) {
+        appendVarint(message, REQUEST_SCHEMA_HASHCODE, static_cast<uint64_t>(schema_hashcode));
+    }
+
+    bindings.clear();
+    appendLengthDelimited(bindings, BINDINGS_SQL, sql);
+    number_of_rows = 0;
+    return message;
+}
+
+std::string ProtobufBatchWriter::finishColumnar() {
+    nucolumnar::aggregator::v1::SQLBatchRequest request;
+    request.set_shard(shard);
+    request.set_table(table);
+    request.set_schema_hashcode(schema_hashcode);
+    nucolumnar::aggregator::v1::ColumnarBatch* columnar_batch = request.mutable_columnarencoding();
+    columnar_batch->set_number_of_rows(number_of_rows);
+    for (size_t cindex = 0; cindex < staged_columns.size(); cindex++) {
+        nucolumnar::aggregator::v1::ColumnValues* column_values = columnar_batch->add_columns();
+        column_values->set_name(columns_definition[cindex].name);
+        column_serializers[cindex]->serializeColumnarValues(*staged_columns[cindex], *column_values);
+    }
+    std::string message = request.SerializeAsString();
+
+    for (auto& column : staged_columns) {
+        column = column->cloneEmpty();
+    }
+    number_of_rows = 0;
+    return message;
+}
+
+} // namespace nuclm
@@ -16,12 +16,84 @@ limitations under the License.
 
 #pragma once
 
+#include <Aggregator/SerializationHelper.h>
+#include <Core/Block.h>
+#include <Core/Field.h>
+
+#include <nucolumnar/aggregator/v1/nucolumnaraggregator.pb.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace nuclm {
 
-class ProtobufWriter {
+/**
+ * To encode rows into an SQLBatchRequest (nucolumnaraggregator.proto) in the nucolumnar encoding, the counterpart of
+ * ProtobufBatchReader, for the producers, the tests and the tools to have a reference encoder of the format. The insert
+ * query statement names the columns of the writer in their order, and each value is written by the serializer of its
+ * column, which writes the kind that the deserializer of the column reads back into the same value.
+ *
+ * The rows are encoded straight into the wire format of the request, with one DataBindingList reused across the rows,
+ * rather than the message tree of a DataBindingList per row and a ValueP per cell being built and then serialized.
+ * The same as the stream decoder on the reading side, which makes the writer fast enough to drive the load tests.
+ *
+ * With the columnar encoding, the rows are staged into the columns instead, and each column is written out by its
+ * serializer as the packed values of the type (ColumnValues) once the request is finished.
+ */
+class ProtobufBatchWriter {
   public:
-    ProtobufWriter() = default;
-    ~ProtobufWriter() = default;
+    enum class Encoding { NUCOLUMNAR, COLUMNAR };
+
+    /**
+     * @param columns_definition_ the columns to encode, which can be any subset of the table columns in any order, for
+     * the batch reader to fill in the others with their defaults.
+     */
+    ProtobufBatchWriter(const std::string& table_, const std::string& shard_,
+                        const ColumnTypesAndNamesTableDefinition& columns_definition_, int64_t schema_hashcode_ = 0,
+                        Encoding encoding_ = Encoding::NUCOLUMNAR);
+
+    ~ProtobufBatchWriter() = default;
+
+    const std::string& getSql() const { return sql; }
+
+    size_t getNumberOfRows() const { return number_of_rows; }
+
+    /**
+     * To encode the rows of the block, with the columns of the writer looked up in the block by name, and checked to
+     * be of the same type. The block can carry the other columns, which are left out.
+     */
+    void appendBlock(const DB::Block& block);
+
+    // To encode one row, with one value per column of the writer in its order, each of the column type.
+    void appendRow(const std::vector<DB::Field>& row);
+
+    // To produce the serialized request of the rows appended so far, and to start over with no rows.
+    std::string finish();
+
+  private:
+    void encodeRow(const std::vector<const DB::IColumn*>& columns, size_t row_num);
+
+    std::string finishColumnar();
+
+    const std::string table;
+    const std::string shard;
+    const ColumnTypesAndNamesTableDefinition columns_definition;
+    const int64_t schema_hashcode;
+    const std::string sql;
+    const Encoding encoding;
+
+    ColumnSerializers column_serializers;
+    // the row reused across the rows, with one value per column.
+    nucolumnar::aggregator::v1::DataBindingList row_values;
+    // the columns of one row that the values of appendRow get inserted into, to be written by the serializers.
+    DB::MutableColumns row_columns;
+    // the rows appended so far with the columnar encoding, one column per column of the writer.
+    DB::MutableColumns staged_columns;
+
+    // the payload of the embedded SqlWithBatchBindings, the sql statement followed by the rows encoded so far.
+    std::string bindings;
+    size_t number_of_rows = 0;
 };
 
 } // namespace nuclm
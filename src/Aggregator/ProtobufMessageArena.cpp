@@ -0,0 +1,80 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include <Aggregator/ProtobufMessageArena.h>
+#include "common/logging.hpp"
+
+#include <algorithm>
+
+namespace nuclm {
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t size) {
+    size_t rounded = 1;
+    while (rounded < size) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+} // namespace
+
+ProtobufMessageArena::ProtobufMessageArena(size_t min_initial_block_size_, size_t max_initial_block_size_) :
+        min_initial_block_size(std::max<size_t>(256, std::min(min_initial_block_size_, max_initial_block_size_))),
+        max_initial_block_size(std::max<size_t>(256, max_initial_block_size_)) {
+    rebuild(min_initial_block_size);
+}
+
+size_t ProtobufMessageArena::reset() {
+    size_t bytes_used = arena->SpaceUsed();
+    arena->Reset();
+    number_of_resets++;
+
+    if (number_of_resets == 1) {
+        learned_bytes_used = bytes_used;
+    } else {
+        learned_bytes_used = (learned_bytes_used * 7 + bytes_used) / 8;
+    }
+
+    // With a quarter of headroom over what the messages use, to not grow on each message slightly above the average.
+    size_t wanted = std::max(bytes_used, learned_bytes_used + learned_bytes_used / 4);
+    size_t target = std::clamp(roundUpToPowerOfTwo(wanted), min_initial_block_size, max_initial_block_size);
+    if (target > initial_block_size || target * 4 <= initial_block_size) {
+        rebuild(target);
+    }
+    return bytes_used;
+}
+
+void ProtobufMessageArena::rebuild(size_t new_initial_block_size) {
+    LOG_AGGRPROC(4) << "protobuf message arena to have initial block size: " << new_initial_block_size
+                    << " from initial block size: " << initial_block_size
+                    << " with learned bytes used: " << learned_bytes_used;
+
+    // The arena goes before the initial block that it is built upon.
+    arena.reset();
+    initial_block = std::make_unique<char[]>(new_initial_block_size);
+    initial_block_size = new_initial_block_size;
+
+    google::protobuf::ArenaOptions options;
+    options.initial_block = initial_block.get();
+    options.initial_block_size = initial_block_size;
+    options.start_block_size = initial_block_size;
+    options.max_block_size = std::max(initial_block_size, options.max_block_size);
+    arena = std::make_unique<google::protobuf::Arena>(options);
+}
+
+} // namespace nuclm
@@ -0,0 +1,72 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <google/protobuf/arena.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace nuclm {
+
+/**
+ * The protobuf arena that a buffer parses its messages on, one message at a time. A parsed SQLBatchRequest holds a
+ * DataBindingList per row and a ValueP per cell, which are all carved out of the arena instead of being allocated and
+ * freed one by one.
+ *
+ * The arena is reset after each message. It owns an initial block, which the arena keeps across the resets, sized to
+ * what the recent messages have used, so that a message of the usual size is parsed without any allocation at all.
+ * The initial block grows as soon as the messages outgrow it, and shrinks only once the messages have become much
+ * smaller than it.
+ */
+class ProtobufMessageArena {
+  public:
+    ProtobufMessageArena(size_t min_initial_block_size_, size_t max_initial_block_size_);
+
+    ~ProtobufMessageArena() = default;
+
+    google::protobuf::Arena* get() { return arena.get(); }
+
+    /**
+     * To release the messages parsed on the arena, and to learn from the bytes they have used. Return the bytes
+     * used by the messages.
+     */
+    size_t reset();
+
+    size_t getInitialBlockSize() const { return initial_block_size; }
+
+    size_t getLearnedBytesUsed() const { return learned_bytes_used; }
+
+    uint64_t getNumberOfResets() const { return number_of_resets; }
+
+  private:
+    void rebuild(size_t new_initial_block_size);
+
+    const size_t min_initial_block_size;
+    const size_t max_initial_block_size;
+
+    size_t initial_block_size = 0;
+    std::unique_ptr<char[]> initial_block;
+    std::unique_ptr<google::protobuf::Arena> arena;
+
+    // the moving average of the bytes used by the recent messages.
+    size_t learned_bytes_used = 0;
+    uint64_t number_of_resets = 0;
+};
+
+} // namespace nuclm
@@ -0,0 +1,295 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include <Aggregator/SQLBatchRequestStreamDecoder.h>
+#include <Serializable/ProtobufReader.h>
+
+#include "common/logging.hpp"
+
+#include <google/protobuf/wire_format_lite.h>
+
+namespace nuclm {
+
+using google::protobuf::io::CodedInputStream;
+using WireFormatLite = google::protobuf::internal::WireFormatLite;
+
+namespace {
+
+// the field numbers of SQLBatchRequest
+constexpr int REQUEST_SHARD = 1;
+constexpr int REQUEST_TABLE = 2;
+constexpr int REQUEST_NUCOLUMNAR_ENCODING = 3;
+constexpr int REQUEST_CLICKHOUSE_ENCODING = 4;
+constexpr int REQUEST_SCHEMA_HASHCODE = 5;
+constexpr int REQUEST_COLUMNAR_ENCODING = 6;
+
+// the field numbers of SqlWithBatchBindings
+constexpr int BINDINGS_SQL = 1;
+constexpr int BINDINGS_BATCH_BINDINGS = 2;
+
+// the field number of DataBindingList
+constexpr int ROW_VALUES = 1;
+
+// the field numbers of ValueP
+constexpr int VALUE_NULL = 1;
+constexpr int VALUE_INT = 2;
+constexpr int VALUE_LONG = 3;
+constexpr int VALUE_UINT = 4;
+constexpr int VALUE_ULONG = 5;
+constexpr int VALUE_DOUBLE = 6;
+constexpr int VALUE_STRING = 7;
+constexpr int VALUE_BOOL = 8;
+constexpr int VALUE_TIMESTAMP = 9;
+constexpr int VALUE_LIST = 10;
+
+bool hasWireType(uint32_t tag, WireFormatLite::WireType wire_type) {
+    return WireFormatLite::GetTagWireType(tag) == wire_type;
+}
+
+// To read the length of a length-delimited field, and then to limit the input to the field.
+bool pushFieldLimit(CodedInputStream& input, CodedInputStream::Limit& limit) {
+    uint32_t length = 0;
+    if (!input.ReadVarint32(&length)) {
+        return false;
+    }
+    limit = input.PushLimit(static_cast<int>(length));
+    return true;
+}
+
+} // namespace
+
+bool SQLBatchRequestStreamDecoder::scanRequest() {
+    CodedInputStream input(data, static_cast<int>(size));
+    bool has_bindings = false;
+    uint32_t tag;
+    while ((tag = input.ReadTag()) != 0) {
+        int field = WireFormatLite::GetTagFieldNumber(tag);
+        if (field == REQUEST_SHARD && hasWireType(tag, WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+            if (!WireFormatLite::ReadString(&input, &shard))
+                return false;
+        } else if (field == REQUEST_TABLE && hasWireType(tag, WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+            if (!WireFormatLite::ReadString(&input, &table))
+                return false;
+        } else if (field == REQUEST_SCHEMA_HASHCODE && hasWireType(tag, WireFormatLite::WIRETYPE_VARINT)) {
+            uint64_t value = 0;
+            if (!input.ReadVarint64(&value))
+                return false;
+            schema_hashcode = static_cast<int64_t>(value);
+        } else if (field == REQUEST_NUCOLUMNAR_ENCODING &&
+                   hasWireType(tag, WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+            if (has_bindings) {
+                LOG_AGGRPROC(4) << "repeated nucolumnar encoding in request, not decodable by stream decoder";
+                return false;
+            }
+            uint32_t length = 0;
+            if (!input.ReadVarint32(&length))
+                return false;
+            int offset = input.CurrentPosition();
+            if (!input.Skip(static_cast<int>(length)))
+                return false;
+            bindings_data = data + offset;
+            bindings_size = length;
+            has_bindings = true;
+        } else if (field == REQUEST_CLICKHOUSE_ENCODING) {
+            LOG_AGGRPROC(4) << "clickhouse encoding in request, not decodable by stream decoder";
+            return false;
+        } else if (field == REQUEST_COLUMNAR_ENCODING) {
+            LOG_AGGRPROC(4) << "columnar encoding in request, not decodable by stream decoder";
+            return false;
+        } else if (!WireFormatLite::SkipField(&input, tag)) {
+            return false;
+        }
+    }
+    if (!input.ConsumedEntireMessage() || !has_bindings) {
+        return false;
+    }
+
+    // The sql statement is needed before the rows get decoded, wherever it is placed among the rows.
+    CodedInputStream bindings_input(bindings_data, static_cast<int>(bindings_size));
+    while ((tag = bindings_input.ReadTag()) != 0) {
+        int field = WireFormatLite::GetTagFieldNumber(tag);
+        if (field == BINDINGS_SQL && hasWireType(tag, WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+            if (!WireFormatLite::ReadString(&bindings_input, &sql))
+                return false;
+        } else {
+            if (field == BINDINGS_BATCH_BINDINGS && hasWireType(tag, WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+                number_of_rows++;
+            }
+            if (!WireFormatLite::SkipField(&bindings_input, tag))
+                return false;
+        }
+    }
+    return bindings_input.ConsumedEntireMessage();
+}
+
+bool SQLBatchRequestStreamDecoder::decodeRows(const ColumnSerializers& serializers, DB::MutableColumns& columns,
+                                              DecodeStats& stats) {
+    size_t number_of_columns = serializers.size();
+    values.resize(number_of_columns);
+    stats.failed_values.assign(number_of_columns, 0);
+    for (size_t cindex = 0; cindex < number_of_columns; cindex++) {
+        columns[cindex]->reserve(columns[cindex]->size() + number_of_rows);
+    }
+
+    CodedInputStream input(bindings_data, static_cast<int>(bindings_size));
+    uint32_t tag;
+    while ((tag = input.ReadTag()) != 0) {
+        int field = WireFormatLite::GetTagFieldNumber(tag);
+        if (field == BINDINGS_BATCH_BINDINGS && hasWireType(tag, WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+            CodedInputStream::Limit limit;
+            if (!pushFieldLimit(input, limit) || !decodeRow(input, serializers, columns, stats))
+                return false;
+            if (!input.ConsumedEntireMessage())
+                return false;
+            input.PopLimit(limit);
+        } else if (!WireFormatLite::SkipField(&input, tag)) {
+            return false;
+        }
+    }
+    return input.ConsumedEntireMessage();
+}
+
+bool SQLBatchRequestStreamDecoder::decodeRow(CodedInputStream& input, const ColumnSerializers& serializers,
+                                             DB::MutableColumns& columns, DecodeStats& stats) {
+    size_t number_of_columns = serializers.size();
+    size_t cindex = 0;
+    uint32_t tag;
+    while ((tag = input.ReadTag()) != 0) {
+        int field = WireFormatLite::GetTagFieldNumber(tag);
+        if (field != ROW_VALUES || !hasWireType(tag, WireFormatLite::WIRETYPE_LENGTH_DELIMITED)) {
+            if (!WireFormatLite::SkipField(&input, tag))
+                return false;
+            continue;
+        }
+
+        // The values beyond the expected columns are skipped, as the row is to be reported as mismatched.
+        if (cindex >= number_of_columns) {
+            if (!WireFormatLite::SkipField(&input, tag))
+                return false;
+            cindex++;
+            continue;
+        }
+
+        CodedInputStream::Limit limit;
+        if (!pushFieldLimit(input, limit) || !decodeValue(input, values[cindex]))
+            return false;
+        if (!input.ConsumedEntireMessage())
+            return false;
+        input.PopLimit(limit);
+
+        ProtobufReader reader(values[cindex]);
+        bool row_added = false;
+        serializers[cindex]->deserializeProtobuf(*columns[cindex], reader, true, row_added);
+        if (!row_added) {
+            stats.failed_values[cindex]++;
+        }
+        stats.bytes_read += reader.getTotalBytesRead();
+        cindex++;
+    }
+
+    if (cindex != number_of_columns) {
+        LOG(ERROR) << "in row: " << stats.rows << " number of available columns: " << cindex
+                   << " does not match number of expected columns: " << number_of_columns;
+        stats.mismatched_rows++;
+    }
+    stats.rows++;
+    return true;
+}
+
+bool SQLBatchRequestStreamDecoder::decodeValue(CodedInputStream& input, nucolumnar::datatypes::v1::ValueP& value) {
+    // The value is not cleared upfront, so that the string of the previous row is reused. A kind set by the value
+    // replaces the previous one, just as the last kind on the wire wins when the protobuf parser parses the value.
+    bool kind_decoded = false;
+    bool message_decoded = false;
+    uint32_t tag;
+    while ((tag = input.ReadTag()) != 0) {
+        int field = WireFormatLite::GetTagFieldNumber(tag);
+        bool is_varint = hasWireType(tag, WireFormatLite::WIRETYPE_VARINT);
+        bool is_length_delimited = hasWireType(tag, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+        if (field == VALUE_NULL && is_varint) {
+            uint32_t raw = 0;
+            if (!input.ReadVarint32(&raw))
+                return false;
+            value.set_null_value(static_cast<nucolumnar::datatypes::v1::NullValueP>(raw));
+        } else if (field == VALUE_INT && is_varint) {
+            uint32_t raw = 0;
+            if (!input.ReadVarint32(&raw))
+                return false;
+            value.set_int_value(static_cast<int32_t>(raw));
+        } else if (field == VALUE_LONG && is_varint) {
+            uint64_t raw = 0;
+            if (!input.ReadVarint64(&raw))
+                return false;
+            value.set_long_value(static_cast<int64_t>(raw));
+        } else if (field == VALUE_UINT && is_varint) {
+            uint32_t raw = 0;
+            if (!input.ReadVarint32(&raw))
+                return false;
+            value.set_uint_value(raw);
+        } else if (field == VALUE_ULONG && is_varint) {
+            uint64_t raw = 0;
+            if (!input.ReadVarint64(&raw))
+                return false;
+            value.set_ulong_value(raw);
+        } else if (field == VALUE_DOUBLE && hasWireType(tag, WireFormatLite::WIRETYPE_FIXED64)) {
+            uint64_t raw = 0;
+            if (!input.ReadLittleEndian64(&raw))
+                return false;
+            value.set_double_value(WireFormatLite::DecodeDouble(raw));
+        } else if (field == VALUE_STRING && is_length_delimited) {
+            if (!WireFormatLite::ReadString(&input, value.mutable_string_value()))
+                return false;
+        } else if (field == VALUE_BOOL && is_varint) {
+            uint64_t raw = 0;
+            if (!input.ReadVarint64(&raw))
+                return false;
+            value.set_bool_value(raw != 0);
+        } else if ((field == VALUE_TIMESTAMP || field == VALUE_LIST) && is_length_delimited) {
+            // A message kind repeated within the value is merged, while the one of the previous row is replaced.
+            google::protobuf::MessageLite* message;
+            if (field == VALUE_TIMESTAMP) {
+                bool merge = message_decoded && value.has_timestamp();
+                message = value.mutable_timestamp();
+                if (!merge)
+                    message->Clear();
+            } else {
+                bool merge = message_decoded && value.has_list_value();
+                message = value.mutable_list_value();
+                if (!merge)
+                    message->Clear();
+            }
+            CodedInputStream::Limit limit;
+            if (!pushFieldLimit(input, limit) || !message->MergePartialFromCodedStream(&input))
+                return false;
+            if (!input.ConsumedEntireMessage())
+                return false;
+            input.PopLimit(limit);
+            message_decoded = true;
+        } else {
+            if (!WireFormatLite::SkipField(&input, tag))
+                return false;
+            continue;
+        }
+        kind_decoded = true;
+    }
+
+    if (!kind_decoded) {
+        value.clear_kind();
+    }
+    return true;
+}
+
+} // namespace nuclm
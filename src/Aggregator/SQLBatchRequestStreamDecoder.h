@@ -0,0 +1,100 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <Aggregator/SerializationHelper.h>
+#include <Columns/IColumn.h>
+
+#include <nucolumnar/datatypes/v1/columnartypes.pb.h>
+
+#include <google/protobuf/io/coded_stream.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nuclm {
+
+/**
+ * To decode an SQLBatchRequest (nucolumnaraggregator.proto) straight off its wire format, without the message tree of
+ * a DataBindingList per row and a ValueP per cell being built. Each cell is decoded into a ValueP that is reused for
+ * the same column across the rows, and then handed over to the column serializer, exactly as the cell of the parsed
+ * message would be. Thus the columns constructed are identical to what the parsed message produces.
+ *
+ * The request is read in two passes: scanRequest() reads the envelope and the sql statement, skipping over the rows,
+ * so that the schema and the decode plan can be settled before decodeRows() decodes the rows into the columns.
+ *
+ * Only the shape that the producers send is decoded. A request that carries the ClickHouse native encoding or the
+ * columnar encoding, or that repeats its embedded SqlWithBatchBindings (to be merged by the protobuf parser), or that
+ * is malformed, is reported as not decodable for the caller to fall back to the parsed message.
+ */
+class SQLBatchRequestStreamDecoder {
+  public:
+    struct DecodeStats {
+        size_t rows = 0;
+        // the rows that do not carry the expected number of values.
+        size_t mismatched_rows = 0;
+        // per column, the values that the column serializer can not decode.
+        std::vector<size_t> failed_values;
+        size_t bytes_read = 0;
+    };
+
+    SQLBatchRequestStreamDecoder(const char* data_, size_t size_) :
+            data(reinterpret_cast<const uint8_t*>(data_)), size(size_) {}
+
+    ~SQLBatchRequestStreamDecoder() = default;
+
+    // Return false if the request is not decodable by the stream decoder.
+    bool scanRequest();
+
+    const std::string& getShard() const { return shard; }
+    const std::string& getTable() const { return table; }
+    int64_t getSchemaHashCode() const { return schema_hashcode; }
+    const std::string& getSql() const { return sql; }
+    size_t getNumberOfRows() const { return number_of_rows; }
+
+    /**
+     * To decode the rows of the request into the columns, one per column serializer. Return false if the rows turn out
+     * to be malformed, in which case the columns are left partially populated.
+     */
+    bool decodeRows(const ColumnSerializers& serializers, DB::MutableColumns& columns, DecodeStats& stats);
+
+  private:
+    bool decodeRow(google::protobuf::io::CodedInputStream& input, const ColumnSerializers& serializers,
+                   DB::MutableColumns& columns, DecodeStats& stats);
+
+    // To decode one ValueP (columnartypes.proto) into the value, following the merge rules of the protobuf parser.
+    static bool decodeValue(google::protobuf::io::CodedInputStream& input, nucolumnar::datatypes::v1::ValueP& value);
+
+    const uint8_t* data;
+    size_t size;
+
+    std::string shard;
+    std::string table;
+    int64_t schema_hashcode = 0;
+    std::string sql;
+    size_t number_of_rows = 0;
+
+    // the payload of the embedded SqlWithBatchBindings.
+    const uint8_t* bindings_data = nullptr;
+    size_t bindings_size = 0;
+
+    // the values reused across the rows, one per column.
+    std::vector<nucolumnar::datatypes::v1::ValueP> values;
+};
+
+} // namespace nuclm
@@ -0,0 +1,183 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include <Aggregator/TableSchemaRegistry.h>
+#include "common/logging.hpp"
+#include "common/thread_factory.hpp"
+#include "monitor/metrics_collector.hpp"
+
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+
+namespace nuclm {
+
+/**
+ * The background thread that the schema fetches of all of the tables run on, one fetch at a time, as the fetches only
+ * happen on the schema changes.
+ */
+class SchemaFetchExecutor {
+  public:
+    using Task = std::function<void()>;
+
+    static SchemaFetchExecutor& instance() {
+        // never destroyed, for the detached thread not to outlive the executor at the exit of the process.
+        static SchemaFetchExecutor* executor = new SchemaFetchExecutor();
+        return *executor;
+    }
+
+    void enqueue(Task task) {
+        std::lock_guard<std::mutex> lck(mutex);
+        tasks.push_back(std::move(task));
+        task_added.notify_one();
+    }
+
+  private:
+    SchemaFetchExecutor() {
+        std::thread worker = nucolumnar::thread_factory("SchemaFetch", &SchemaFetchExecutor::run, this);
+        worker.detach();
+    }
+
+    void run() {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lck(mutex);
+                task_added.wait(lck, [this] { return !tasks.empty(); });
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable task_added;
+    std::deque<Task> tasks;
+};
+
+TableSchemaRegistryPtr TableSchemaRegistry::getTableRegistry(const std::string& table_name) {
+    static std::mutex table_registries_mutex;
+    static std::unordered_map<std::string, TableSchemaRegistryPtr> table_registries;
+
+    std::lock_guard<std::mutex> lck(table_registries_mutex);
+    auto it = table_registries.find(table_name);
+    if (it != table_registries.end()) {
+        return it->second;
+    }
+
+    LOG_AGGRPROC(4) << "create schema registry for table: " << table_name;
+    auto registry = std::make_shared<TableSchemaRegistry>(table_name);
+    table_registries.emplace(table_name, registry);
+    return registry;
+}
+
+std::shared_ptr<const TableColumnsDescription>
+TableSchemaRegistry::resolveHash(size_t hash_code, TimePoint not_older_than, const SchemaFetcher& fetcher) {
+    std::shared_ptr<SchemaTrackingMetrics> schema_tracking_metrics =
+        MetricsCollector::instance().getSchemaTrackingMetrics();
+    std::unique_lock<std::mutex> lck(mutex);
+    while (true) {
+        if (latest_schema != nullptr && latest_schema_fetched_at >= not_older_than &&
+            latest_schema->getSchemaHash() == hash_code) {
+            number_of_coalesced_requests++;
+            schema_tracking_metrics->schema_registry_coalesced_requests_total->labels({{"table", table}})
+                .increment(1);
+            return latest_schema;
+        }
+        if (!fetch_in_flight) {
+            break;
+        }
+
+        // The fetch in flight answers the request if it is for the same hash, while a different hash can still turn
+        // out to be answered by the schema that it fetches.
+        bool shared = (hash_of_fetch_in_flight == hash_code && fetch_in_flight_started_at >= not_older_than);
+        uint64_t fetch_waited = number_of_fetches;
+        LOG_AGGRPROC(4) << "schema hash: " << hash_code << " parked on the schema fetch in flight for table: " << table;
+        fetch_completed.wait(lck, [&] { return !fetch_in_flight || number_of_fetches != fetch_waited; });
+        if (shared) {
+            number_of_coalesced_requests++;
+            schema_tracking_metrics->schema_registry_coalesced_requests_total->labels({{"table", table}})
+                .increment(1);
+            return last_fetch_result;
+        }
+    }
+
+    return fetch(hash_code, fetcher, lck);
+}
+
+std::shared_ptr<const TableColumnsDescription>
+TableSchemaRegistry::fetch(size_t hash_code, const SchemaFetcher& fetcher, std::unique_lock<std::mutex>& lck) {
+    auto start = std::chrono::steady_clock::now();
+    fetch_in_flight = true;
+    hash_of_fetch_in_flight = hash_code;
+    fetch_in_flight_started_at = start;
+    number_of_fetches++;
+    uint64_t fetch_started = number_of_fetches;
+
+    // The buffer that starts the fetch is parked on it the same as the others, which also keeps the fetcher and what
+    // it refers to alive until the fetch completes.
+    SchemaFetchExecutor::instance().enqueue([this, &fetcher, start]() { runFetch(fetcher, start); });
+    LOG_AGGRPROC(4) << "schema hash: " << hash_code << " parked on the schema fetch started for table: " << table;
+    fetch_completed.wait(lck, [&] { return !fetch_in_flight || number_of_fetches != fetch_started; });
+    return last_fetch_result;
+}
+
+void TableSchemaRegistry::runFetch(const SchemaFetcher& fetcher, TimePoint start) {
+    // The fetch goes without the lock, for the other hashes of the table to be checked against the latest schema.
+    std::shared_ptr<const TableColumnsDescription> fetched_schema;
+    try {
+        fetched_schema = std::make_shared<const TableColumnsDescription>(fetcher());
+    } catch (...) {
+        LOG(ERROR) << DB::getCurrentExceptionMessage(true);
+        LOG(ERROR) << "with exception return code: " << DB::getCurrentExceptionCode();
+        LOG(ERROR) << "schema registry cannot fetch table definition for table: " << table;
+    }
+    auto elapsed_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    MetricsCollector::instance()
+        .getSchemaTrackingMetrics()
+        ->schema_registry_refresh_time->labels({{"table", table}})
+        .observe(elapsed_us);
+
+    std::lock_guard<std::mutex> lck(mutex);
+    LOG_AGGRPROC(4) << "schema registry fetched table definition for table: " << table
+                    << " for hash: " << hash_of_fetch_in_flight << " in (us): " << elapsed_us;
+    if (fetched_schema != nullptr) {
+        latest_schema = fetched_schema;
+        latest_schema_fetched_at = start;
+    }
+    last_fetch_result = fetched_schema;
+    fetch_in_flight = false;
+    fetch_completed.notify_all();
+}
+
+std::shared_ptr<const TableColumnsDescription> TableSchemaRegistry::getLatestSchema() const {
+    std::lock_guard<std::mutex> lck(mutex);
+    return latest_schema;
+}
+
+size_t TableSchemaRegistry::getNumberOfFetches() const {
+    std::lock_guard<std::mutex> lck(mutex);
+    return number_of_fetches;
+}
+
+size_t TableSchemaRegistry::getNumberOfCoalescedRequests() const {
+    std::lock_guard<std::mutex> lck(mutex);
+    return number_of_coalesced_requests;
+}
+
+} // namespace nuclm
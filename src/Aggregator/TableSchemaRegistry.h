@@ -0,0 +1,110 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <Aggregator/TableColumnsDescription.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace nuclm {
+
+class TableSchemaRegistry;
+using TableSchemaRegistryPtr = std::shared_ptr<TableSchemaRegistry>;
+
+/**
+ * The schema of a table as last fetched from the backend, shared by the schema trackers of all of the buffers of the
+ * table across the partitions. When a message carries a schema hash that a tracker does not know, the tracker asks
+ * the registry to resolve the hash rather than fetching the table definition by itself:
+ *
+ * 1) If the schema last fetched has the hash, it is returned without a fetch, which is the case for all but the first
+ * of the buffers that see the new hash of a schema change.
+ *
+ * 2) If a fetch is in flight, the buffer is parked until the fetch completes. The buffers that ask for the same hash
+ * as the fetch share its result, and the others check the result against their hashes once it is in.
+ *
+ * 3) Otherwise a fetch of the table definition is started, with the buffer parked on it, the same as the buffers that
+ * ask in the meantime.
+ *
+ * The fetches run on a background thread shared by all of the tables, rather than on the consumer thread of the buffer
+ * that starts them. The buffers still wait for the hash to be resolved, as their messages get decoded against the
+ * schema that it resolves into. Thus the buffers that see the new hash of a schema change stall for the time of one
+ * fetch, rather than for one fetch each.
+ *
+ * One schema change leads to one fetch per table, no matter how many buffers see the new hash. A hash that the
+ * fetched schema does not match, such as the stale hash of a producer that lags behind, is fetched for again the next
+ * time it is asked for, the same as the tracker did on its own. A fetch only answers the trackers that were created
+ * before it started, as a tracker created later can start with a table definition newer than what it has fetched.
+ */
+class TableSchemaRegistry {
+  public:
+    using SchemaFetcher = std::function<TableColumnsDescription()>;
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    explicit TableSchemaRegistry(const std::string& table_) : table(table_) {}
+
+    ~TableSchemaRegistry() = default;
+
+    // The registry shared by the schema trackers of the table in the process.
+    static TableSchemaRegistryPtr getTableRegistry(const std::string& table_name);
+
+    /**
+     * To resolve the hash into the latest schema of the table, with the fetcher invoked only if no fetch started at or
+     * after not_older_than, done or in flight, answers the hash. Return nullptr if the fetch that the request ends up
+     * with fails.
+     */
+    std::shared_ptr<const TableColumnsDescription> resolveHash(size_t hash_code, TimePoint not_older_than,
+                                                               const SchemaFetcher& fetcher);
+
+    // The schema last fetched, nullptr if none yet.
+    std::shared_ptr<const TableColumnsDescription> getLatestSchema() const;
+
+    // the number of the fetches made, and the number of the requests answered without a fetch of their own.
+    size_t getNumberOfFetches() const;
+    size_t getNumberOfCoalescedRequests() const;
+
+  private:
+    // To start the fetch on the background thread, and to wait for it to complete.
+    std::shared_ptr<const TableColumnsDescription> fetch(size_t hash_code, const SchemaFetcher& fetcher,
+                                                         std::unique_lock<std::mutex>& lck);
+
+    // Run on the background thread, to fetch the table definition and to publish it to the parked buffers.
+    void runFetch(const SchemaFetcher& fetcher, TimePoint start);
+
+    const std::string table;
+
+    mutable std::mutex mutex;
+    std::condition_variable fetch_completed;
+    // the schema of the last fetch that succeeded, and the time that the fetch started at.
+    std::shared_ptr<const TableColumnsDescription> latest_schema;
+    TimePoint latest_schema_fetched_at;
+    // the result of the last fetch, nullptr if it failed.
+    std::shared_ptr<const TableColumnsDescription> last_fetch_result;
+
+    bool fetch_in_flight = false;
+    size_t hash_of_fetch_in_flight = 0;
+    TimePoint fetch_in_flight_started_at;
+    uint64_t number_of_fetches = 0;
+    uint64_t number_of_coalesced_requests = 0;
+};
+
+} // namespace nuclm
@@ -23,9 +23,21 @@ namespace nuclm {
 TableSchemaUpdateTracker::TableSchemaUpdateTracker(const std::string& table_name_,
                                                    const TableColumnsDescription& initial_table_definition_,
                                                    const AggregatorLoaderManager& loader_manager_) :
-        table_name(table_name_), loader_manager(loader_manager_) {
+        table_name(table_name_),
+        loader_manager(loader_manager_),
+        schema_registry(TableSchemaRegistry::getTableRegistry(table_name_)),
+        created_at(std::chrono::steady_clock::now()),
+        insert_columns_plan_cache(InsertColumnsPlanCache::getTableCache(table_name_)),
+        defaults_filling_actions_cache(DefaultsFillingActionsCache::getTableCache(table_name_)) {
     schema_captured.push_back(initial_table_definition_);
     hash_of_schema_currently_used = initial_table_definition_.getSchemaHash();
+    latest_schema_plan_key = InsertColumnsPlanCache::computeSchemaKey(initial_table_definition_);
+}
+
+void TableSchemaUpdateTracker::moveInsertColumnsPlansToLatestSchema() {
+    latest_schema_plan_key = InsertColumnsPlanCache::computeSchemaKey(getLatestSchema());
+    insert_columns_plan_cache->retainSchema(latest_schema_plan_key);
+    defaults_filling_actions_cache->retainSchema(latest_schema_plan_key);
 }
 
 bool TableSchemaUpdateTracker::checkHashWithLatestSchemaVersion(size_t hash_value) {
@@ -53,26 +65,25 @@ bool TableSchemaUpdateTracker::checkHashWithLatestSchemaVersion(size_t hash_valu
 
 // NOTE: schema version computation currently does not involve default column's expression
 void TableSchemaUpdateTracker::tryAddNewSchemaVersionForNewHash(size_t hash_code, bool& new_schema_fetched) {
-    // force to retrieve the table definition from the backend. We may not get the new version.
+    // force to retrieve the table definition from the backend, unless the schema registry already has the schema of
+    // the hash or is fetching it for another buffer. We may not get the new version.
     new_schema_fetched = false;
-    try {
-        const TableColumnsDescription& possible_new_schema =
-            loader_manager.getTableColumnsDefinition(table_name, false);
-        LOG_AGGRPROC(4) << "possible new schema's hash is: " << possible_new_schema.getSchemaHash()
+    std::shared_ptr<const TableColumnsDescription> possible_new_schema =
+        schema_registry->resolveHash(hash_code, created_at, [this]() {
+            return loader_manager.getTableColumnsDefinition(table_name, false);
+        });
+    if (possible_new_schema == nullptr) {
+        std::string err_msg = "Aggregator Loader Manager cannot retrieve table definition for table: " + table_name;
+        LOG(ERROR) << err_msg;
+    } else {
+        LOG_AGGRPROC(4) << "possible new schema's hash is: " << possible_new_schema->getSchemaHash()
                         << " and latest schema hash is: " << getLatestSchema().getSchemaHash();
-        if (possible_new_schema.getSchemaHash() != getLatestSchema().getSchemaHash()) {
+        if (possible_new_schema->getSchemaHash() != getLatestSchema().getSchemaHash()) {
             // we have a new version
-            schema_captured.push_back(possible_new_schema);
+            schema_captured.push_back(*possible_new_schema);
+            moveInsertColumnsPlansToLatestSchema();
             new_schema_fetched = true;
         }
-    } catch (...) {
-        LOG(ERROR) << DB::getCurrentExceptionMessage(true);
-        auto code = DB::getCurrentExceptionCode();
-
-        LOG(ERROR) << "with exception return code: " << code;
-
-        std::string err_msg = "Aggregator Loader Manager cannot retrieve table definition for table: " + table_name;
-        LOG(ERROR) << err_msg;
     }
 
     // no matter whether a new schema is fetched or not, we update the hash code's associated version, which is the
@@ -86,6 +97,7 @@ void TableSchemaUpdateTracker::tryAddNewSchemaVersionForNewHash(size_t hash_code
 void TableSchemaUpdateTracker::updateHashMapping(size_t hash_in_message,
                                                  const nuclm::TableColumnsDescription& latest_schema) {
     schema_captured.push_back(latest_schema);
+    moveInsertColumnsPlansToLatestSchema();
     updateHashWithLatestSchemaVersion(hash_in_message);
 }
 
@@ -17,6 +17,9 @@ limitations under the License.
 #pragma once
 
 #include <Aggregator/TableColumnsDescription.h>
+#include <Aggregator/TableSchemaRegistry.h>
+#include <Aggregator/InsertColumnsPlanCache.h>
+#include <Aggregator/DefaultsFillingActionsCache.h>
 #include <KafkaConnector/KafkaConnector.h>
 #include <Aggregator/AggregatorLoaderManager.h>
 
@@ -28,6 +31,8 @@ namespace nuclm {
  * of two schemas happen is that during buffer construction, a new message with a new schema comes and that triggers the
  * table schema retrieval from the backend clickhouse.
  *
+ * The retrieval goes through the schema registry of the table, which is shared with the trackers of the other buffers,
+ * for a schema change seen by the buffers of all of the partitions to be fetched once.
  */
 class TableSchemaUpdateTracker {
   public:
@@ -89,12 +94,27 @@ class TableSchemaUpdateTracker {
         hash_of_schema_currently_used = schema_captured.back().getSchemaHash();
     }
 
+    /**
+     * The decode plans of the insert query statements of the table, shared with the other buffers of the table.
+     */
+    const InsertColumnsPlanCachePtr& getInsertColumnsPlanCache() const { return insert_columns_plan_cache; }
+
+    /**
+     * The key of the latest schema in the decode plan cache.
+     */
+    size_t getLatestSchemaPlanKey() const { return latest_schema_plan_key; }
+
   protected:
     /**
      * Update incoming message's hash to the latest table schema version. This is for testing purpose
      */
     void updateHashMapping(size_t hash_in_message, const TableColumnsDescription& latest_schema);
 
+  private:
+    // To follow the latest schema captured, with the decode plans and the defaults filling actions of the other schemas
+    // dropped from the caches.
+    void moveInsertColumnsPlansToLatestSchema();
+
   private:
     std::string table_name;
     const AggregatorLoaderManager& loader_manager;
@@ -112,6 +132,13 @@ class TableSchemaUpdateTracker {
     // the current schema hash is being used for block deserializaiton. the initial one is the one passed
     // from the initial table definition.
     size_t hash_of_schema_currently_used;
+
+    TableSchemaRegistryPtr schema_registry;
+    // the schemas fetched before the tracker is created can be older than its initial table definition.
+    TableSchemaRegistry::TimePoint created_at;
+    InsertColumnsPlanCachePtr insert_columns_plan_cache;
+    size_t latest_schema_plan_key;
+    DefaultsFillingActionsCachePtr defaults_filling_actions_cache;
 };
 
 using TableSchemaUpdateTrackerPtr = std::shared_ptr<TableSchemaUpdateTracker>;
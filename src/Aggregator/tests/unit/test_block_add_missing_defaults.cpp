@@ -29,6 +29,9 @@ limitations under the License.
 #include <Aggregator/TableSchemaUpdateTracker.h>
 #include <Aggregator/ProtobufBatchReader.h>
 #include <Aggregator/DistributedLoaderLock.h>
+#include <Aggregator/BlockAddMissingDefaults.h>
+#include <Aggregator/DefaultsFillingActionsCache.h>
+#include <Aggregator/DeferredDefaultsSegment.h>
 
 #include <Serializable/ProtobufReader.h>
 
@@ -736,8 +739,9 @@ TEST_F(AggregatorBlockAddMissingDefaultsTesting, testTableWithOneSchemaUpdateWit
             ASSERT_TRUE(ordinary_columns_count == 8);
 
             // migrate block To match latestSchema
-            nuclm::ProtobufBatchReader::migrateBlockToMatchLatestSchema(global_block_holder, table_definition_version_1,
-                                                                        context);
+            nuclm::ProtobufBatchReader::migrateBlockToMatchLatestSchema(
+                global_block_holder, table_definition_version_1,
+                nuclm::InsertColumnsPlanCache::computeSchemaKey(table_definition_version_1), context);
 
             {
                 size_t total_number_of_rows_holder_1 = global_block_holder.rows();
@@ -770,8 +774,9 @@ TEST_F(AggregatorBlockAddMissingDefaultsTesting, testTableWithOneSchemaUpdateWit
             ASSERT_TRUE(ordinary_columns_count == 8);
 
             // migrate block To match latestSchema
-            nuclm::ProtobufBatchReader::migrateBlockToMatchLatestSchema(global_block_holder, table_definition_version_2,
-                                                                        context);
+            nuclm::ProtobufBatchReader::migrateBlockToMatchLatestSchema(
+                global_block_holder, table_definition_version_2,
+                nuclm::InsertColumnsPlanCache::computeSchemaKey(table_definition_version_2), context);
 
             {
                 size_t total_number_of_rows_holder_2 = global_block_holder.rows();
@@ -1230,6 +1235,255 @@ TEST_F(AggregatorBlockAddMissingDefaultsTesting, testTableWithOneSchemaUpdateWit
     ASSERT_FALSE(failed);
 }
 
+TEST_F(AggregatorBlockAddMissingDefaultsTesting, testDefaultsFillingActionsCachedAcrossBlocks) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorBlockAddMissingDefaultsTesting::shared_context->getContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+
+    std::string table_name = "defaults_filling_actions_tst";
+    DB::NamesAndTypesList required_columns{{"id", std::make_shared<DB::DataTypeUInt64>()},
+                                           {"code", std::make_shared<DB::DataTypeString>()}};
+    DB::ColumnsDescription required_columns_description(required_columns);
+    size_t schema_key = 100;
+
+    nuclm::DefaultsFillingActionsCachePtr actions_cache =
+        nuclm::DefaultsFillingActionsCache::getTableCache(table_name);
+    ASSERT_EQ(actions_cache, nuclm::DefaultsFillingActionsCache::getTableCache(table_name));
+    ASSERT_EQ(actions_cache->size(), (size_t)0);
+
+    for (size_t round = 0; round < 3; round++) {
+        auto id_column = DB::ColumnUInt64::create();
+        for (size_t row = 0; row < round + 1; row++) {
+            id_column->insertValue(row);
+        }
+        DB::Block block{{std::move(id_column), std::make_shared<DB::DataTypeUInt64>(), "id"}};
+
+        // compiled at the first round only, and found in the cache afterwards.
+        DB::Block filled_block = nuclm::blockAddMissingDefaults(block, required_columns, required_columns_description,
+                                                                table_name, schema_key, context);
+        ASSERT_EQ(actions_cache->size(), (size_t)1);
+        ASSERT_EQ(filled_block.columns(), (size_t)2);
+        ASSERT_EQ(filled_block.rows(), round + 1);
+        ASSERT_EQ(filled_block.getByPosition(1).name, "code");
+        const auto& code_column = assert_cast<const DB::ColumnString&>(*filled_block.getByPosition(1).column);
+        for (size_t row = 0; row < round + 1; row++) {
+            ASSERT_EQ(code_column.getDataAt(row).toString(), "");
+        }
+    }
+    ASSERT_NE(actions_cache->get(schema_key, DB::NamesAndTypesList{{"id", std::make_shared<DB::DataTypeUInt64>()}},
+                                 required_columns),
+              nullptr);
+
+    // the same column names with another type are compiled separately.
+    ASSERT_EQ(actions_cache->get(schema_key, DB::NamesAndTypesList{{"id", std::make_shared<DB::DataTypeUInt32>()}},
+                                 required_columns),
+              nullptr);
+
+    // the actions of the other schemas are dropped when moving to the latest schema.
+    actions_cache->retainSchema(schema_key + 1);
+    ASSERT_EQ(actions_cache->size(), (size_t)0);
+
+    // the actions of a non-deterministic default expression are never cached, for now() to be evaluated per block.
+    nuclm::TableColumnsDescription table_definition(table_name);
+    table_definition.addColumnDescription(nuclm::TableColumnDescription("id", "UInt64"));
+    table_definition.addColumnDescription(
+        nuclm::TableColumnDescription("created_at", "DateTime", nuclm::ColumnDefaultDescription("default", "now()")));
+    DB::Block sample_block =
+        nuclm::SerializationHelper::getBlockDefinition(table_definition.getFullColumnTypesAndNamesDefinition());
+    for (size_t round = 0; round < 2; round++) {
+        uint64_t start =
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        auto id_column = DB::ColumnUInt64::create();
+        id_column->insertValue(round);
+        DB::Block block{{std::move(id_column), std::make_shared<DB::DataTypeUInt64>(), "id"}};
+        DB::Block filled_block = nuclm::blockAddMissingDefaults(
+            block, sample_block.getNamesAndTypesList(), table_definition.getNativeDBColumnsDescriptionCache(),
+            table_name, schema_key + 1, context);
+        ASSERT_EQ(actions_cache->size(), (size_t)0);
+        ASSERT_EQ(filled_block.getByPosition(1).name, "created_at");
+        ASSERT_GE(filled_block.getByPosition(1).column->getUInt(0), start);
+        if (round == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        }
+    }
+}
+
+TEST_F(AggregatorBlockAddMissingDefaultsTesting, testDeferredDefaultsFillingMatchesPerMessageFilling) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorBlockAddMissingDefaultsTesting::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorBlockAddMissingDefaultsTesting::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "deferred_defaults_tst";
+    nuclm::TableColumnsDescription table_definition(table_name);
+    table_definition.addColumnDescription(nuclm::TableColumnDescription("id", "UInt64"));
+    table_definition.addColumnDescription(nuclm::TableColumnDescription("code", "String"));
+
+    // the messages leave out the column of code, but the one in the middle, which has all of the columns.
+    auto build_message = [&](size_t first_id, size_t number_of_rows, bool all_columns) {
+        nucolumnar::aggregator::v1::SQLBatchRequest request;
+        request.set_table(table_name);
+        nucolumnar::aggregator::v1::SqlWithBatchBindings* bindings = request.mutable_nucolumnarencoding();
+        bindings->set_sql(all_columns ? "insert into " + table_name + " (id, code) values (?, ?)"
+                                      : "insert into " + table_name + " (id) values (?)");
+        for (size_t row = 0; row < number_of_rows; row++) {
+            nucolumnar::aggregator::v1::DataBindingList* values = bindings->add_batch_bindings();
+            values->add_values()->set_ulong_value(first_id + row);
+            if (all_columns) {
+                values->add_values()->set_string_value("code_" + std::to_string(first_id + row));
+            }
+        }
+        return request.SerializeAsString();
+    };
+    std::vector<std::string> messages{build_message(0, 3, false), build_message(3, 2, false),
+                                      build_message(5, 2, true), build_message(7, 4, false)};
+
+    nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+        std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+    DB::Block per_message_block =
+        nuclm::SerializationHelper::getBlockDefinition(table_definition.getFullColumnTypesAndNamesDefinition());
+    DB::Block deferred_block = per_message_block.cloneEmpty();
+    nuclm::DeferredDefaultsSegment segment;
+
+    for (size_t i = 0; i < messages.size(); i++) {
+        nuclm::ProtobufBatchReader per_message_reader(messages[i], schema_tracker, per_message_block, context);
+        ASSERT_TRUE(per_message_reader.read());
+
+        nuclm::ProtobufBatchReader deferred_reader(messages[i], schema_tracker, deferred_block, context);
+        deferred_reader.setDeferredDefaultsSegment(&segment);
+        ASSERT_TRUE(deferred_reader.read());
+        ASSERT_EQ(deferred_reader.getRowsProcessed(), per_message_reader.getRowsProcessed());
+    }
+
+    // the first two messages are staged together, and get into the block ahead of the one with all of the columns.
+    ASSERT_EQ(segment.rows(), (size_t)4);
+    ASSERT_EQ(deferred_block.rows(), (size_t)7);
+    segment.materialize(deferred_block, context);
+    ASSERT_TRUE(segment.empty());
+
+    ASSERT_EQ(deferred_block.rows(), per_message_block.rows());
+    ASSERT_EQ(deferred_block.dumpStructure(), per_message_block.dumpStructure());
+    for (size_t cindex = 0; cindex < deferred_block.columns(); cindex++) {
+        const DB::IColumn& deferred_column = *deferred_block.getByPosition(cindex).column;
+        const DB::IColumn& per_message_column = *per_message_block.getByPosition(cindex).column;
+        for (size_t row = 0; row < deferred_block.rows(); row++) {
+            ASSERT_EQ(deferred_column.compareAt(row, row, per_message_column, 1), 0)
+                << "column: " << cindex << " row: " << row;
+        }
+    }
+}
+
+/**
+ * The default expression of code fails on the row with id of 0, which is in the message in the middle. The staged rows
+ * fail to be filled as a whole, and then only the message in the middle gets dropped.
+ */
+TEST_F(AggregatorBlockAddMissingDefaultsTesting, testDeferredDefaultsFillingDropsFailedMessageOnly) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorBlockAddMissingDefaultsTesting::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorBlockAddMissingDefaultsTesting::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "deferred_defaults_failure_tst";
+    nuclm::TableColumnsDescription table_definition(table_name);
+    table_definition.addColumnDescription(nuclm::TableColumnDescription("id", "UInt64"));
+    table_definition.addColumnDescription(nuclm::TableColumnDescription(
+        "code", "String", nuclm::ColumnDefaultDescription("default", "toString(intDiv(100, id))")));
+
+    auto build_message = [&](const std::vector<uint64_t>& ids) {
+        nucolumnar::aggregator::v1::SQLBatchRequest request;
+        request.set_table(table_name);
+        nucolumnar::aggregator::v1::SqlWithBatchBindings* bindings = request.mutable_nucolumnarencoding();
+        bindings->set_sql("insert into " + table_name + " (id) values (?)");
+        for (uint64_t id : ids) {
+            bindings->add_batch_bindings()->add_values()->set_ulong_value(id);
+        }
+        return request.SerializeAsString();
+    };
+    std::vector<std::string> messages{build_message({1, 2, 3}), build_message({4, 0}), build_message({5, 10})};
+
+    nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+        std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+    DB::Block deferred_block =
+        nuclm::SerializationHelper::getBlockDefinition(table_definition.getFullColumnTypesAndNamesDefinition());
+    nuclm::DeferredDefaultsSegment segment;
+
+    for (const auto& message : messages) {
+        nuclm::ProtobufBatchReader deferred_reader(message, schema_tracker, deferred_block, context);
+        deferred_reader.setDeferredDefaultsSegment(&segment);
+        ASSERT_TRUE(deferred_reader.read());
+    }
+    ASSERT_EQ(segment.rows(), (size_t)7);
+    ASSERT_EQ(segment.messages(), (size_t)3);
+
+    ASSERT_EQ(segment.materialize(deferred_block, context), (size_t)1);
+    ASSERT_TRUE(segment.empty());
+
+    std::vector<uint64_t> expected_ids{1, 2, 3, 5, 10};
+    ASSERT_EQ(deferred_block.rows(), expected_ids.size());
+    const auto& id_column = assert_cast<const DB::ColumnUInt64&>(*deferred_block.getByPosition(0).column);
+    const auto& code_column = assert_cast<const DB::ColumnString&>(*deferred_block.getByPosition(1).column);
+    for (size_t row = 0; row < expected_ids.size(); row++) {
+        ASSERT_EQ(id_column.getData()[row], expected_ids[row]);
+        ASSERT_EQ(code_column.getDataAt(row).toString(), std::to_string(100 / expected_ids[row]));
+    }
+}
+
+/**
+ * The default expression of created_at is now(), which would take the time of the materializing if the rows were
+ * staged. Thus the rows leaving out created_at are filled per message, with the segment left empty.
+ */
+TEST_F(AggregatorBlockAddMissingDefaultsTesting, testDeferredDefaultsFillingSkipsNonDeterministicDefaults) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorBlockAddMissingDefaultsTesting::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorBlockAddMissingDefaultsTesting::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "deferred_defaults_now_tst";
+    nuclm::TableColumnsDescription table_definition(table_name);
+    table_definition.addColumnDescription(nuclm::TableColumnDescription("id", "UInt64"));
+    table_definition.addColumnDescription(
+        nuclm::TableColumnDescription("created_at", "DateTime", nuclm::ColumnDefaultDescription("default", "now()")));
+
+    nucolumnar::aggregator::v1::SQLBatchRequest request;
+    request.set_table(table_name);
+    nucolumnar::aggregator::v1::SqlWithBatchBindings* bindings = request.mutable_nucolumnarencoding();
+    bindings->set_sql("insert into " + table_name + " (id) values (?)");
+    for (uint64_t id = 0; id < 3; id++) {
+        bindings->add_batch_bindings()->add_values()->set_ulong_value(id);
+    }
+    std::string message = request.SerializeAsString();
+
+    nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+        std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+    DB::Block deferred_block =
+        nuclm::SerializationHelper::getBlockDefinition(table_definition.getFullColumnTypesAndNamesDefinition());
+    nuclm::DeferredDefaultsSegment segment;
+
+    for (size_t round = 0; round < 2; round++) {
+        uint64_t start =
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        nuclm::ProtobufBatchReader deferred_reader(message, schema_tracker, deferred_block, context);
+        deferred_reader.setDeferredDefaultsSegment(&segment);
+        ASSERT_TRUE(deferred_reader.read());
+        ASSERT_TRUE(segment.empty());
+        ASSERT_EQ(deferred_block.rows(), 3 * (round + 1));
+
+        // the rows of each message take the time of their own message.
+        const DB::IColumn& created_at_column = *deferred_block.getByName("created_at").column;
+        for (size_t row = 3 * round; row < deferred_block.rows(); row++) {
+            ASSERT_GE(created_at_column.getUInt(row), start);
+        }
+        if (round == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        }
+    }
+}
+
 // Call RUN_ALL_TESTS() in main()
 // invoke:  ./test_main_launcher --config_file  <config_file>
 int main(int argc, char** argv) {
@@ -24,6 +24,7 @@ limitations under the License.
 #include "common/settings_factory.hpp"
 
 #include <Aggregator/AggregatorLoader.h>
+#include <Aggregator/BlockColumnsPool.h>
 #include <Common/Stopwatch.h>
 
 #include <Core/Block.h>
@@ -31,6 +32,9 @@ limitations under the License.
 #include <DataTypes/DataTypeDateTime.h>
 #include <DataTypes/DataTypeString.h>
 #include <DataTypes/DataTypesNumber.h>
+#include <DataTypes/DataTypeFactory.h>
+#include <Columns/ColumnArray.h>
+#include <Columns/ColumnLowCardinality.h>
 #include <Columns/ColumnString.h>
 #include <Columns/ColumnsNumber.h>
 #include <Columns/ColumnsNumber.h>
@@ -409,6 +413,113 @@ TEST(AggregatorLoaderBlockRelatedTest, testBlockSwapFunctionWithBlockInitialized
     }
 }
 
+static DB::Block buildPoolTestBlock(const DB::Block& header, size_t number_of_rows) {
+    DB::MutableColumns columns = header.cloneEmptyColumns();
+    for (size_t row = 0; row < number_of_rows; row++) {
+        columns[0]->insert(DB::Field(static_cast<DB::UInt64>(row)));
+        columns[1]->insert(DB::Field("graphdb-" + std::to_string(row)));
+        columns[2]->insert(DB::Field("tag-" + std::to_string(row % 4)));
+    }
+    return header.cloneWithColumns(std::move(columns));
+}
+
+TEST(AggregatorLoaderBlockRelatedTest, testBlockColumnsPoolRecyclesColumns) {
+    DB::Block header{{std::make_shared<DB::DataTypeUInt64>(), "id"},
+                     {std::make_shared<DB::DataTypeString>(), "name"},
+                     {DB::DataTypeFactory::instance().get("LowCardinality(String)"), "tag"}};
+    size_t number_of_rows = 10000;
+    nuclm::BlockColumnsPool pool("block_columns_pool_tst", 2);
+
+    // the columns given back are cleared, with their capacity kept, except for the dictionary-encoded column.
+    DB::Block block = buildPoolTestBlock(header, number_of_rows);
+    size_t id_allocated_bytes = block.getByPosition(0).column->allocatedBytes();
+    size_t name_allocated_bytes = block.getByPosition(1).column->allocatedBytes();
+    pool.release(std::move(block));
+    ASSERT_EQ(pool.size(), (size_t)1);
+    ASSERT_EQ(pool.getExpectedRows(), number_of_rows);
+
+    DB::Block recycled_block = pool.acquire(header);
+    ASSERT_EQ(pool.size(), (size_t)0);
+    ASSERT_TRUE(DB::blocksHaveEqualStructure(recycled_block, header));
+    ASSERT_EQ(recycled_block.rows(), (size_t)0);
+    ASSERT_EQ(recycled_block.getByPosition(0).column->allocatedBytes(), id_allocated_bytes);
+    ASSERT_EQ(recycled_block.getByPosition(1).column->allocatedBytes(), name_allocated_bytes);
+
+    // the recycled columns take in the rows as the new ones do.
+    DB::MutableColumns recycled_columns = recycled_block.mutateColumns();
+    recycled_columns[0]->insert(DB::Field(static_cast<DB::UInt64>(7)));
+    recycled_columns[1]->insert(DB::Field(std::string("graphdb-7")));
+    recycled_columns[2]->insert(DB::Field(std::string("tag-3")));
+    recycled_block.setColumns(std::move(recycled_columns));
+    ASSERT_EQ(recycled_block.rows(), (size_t)1);
+    ASSERT_EQ(recycled_block.getByPosition(1).column->getDataAt(0).toString(), "graphdb-7");
+    ASSERT_EQ(recycled_block.getByPosition(2).column->getDataAt(0).toString(), "tag-3");
+
+    // a block with a column still shared is not taken, and the pool keeps the most recent blocks up to its capacity.
+    DB::Block shared_block = buildPoolTestBlock(header, 10);
+    DB::ColumnPtr shared_column = shared_block.getByPosition(0).column;
+    pool.release(std::move(shared_block));
+    ASSERT_EQ(pool.size(), (size_t)0);
+    for (int i = 0; i < 3; i++) {
+        pool.release(buildPoolTestBlock(header, number_of_rows));
+    }
+    ASSERT_EQ(pool.size(), (size_t)2);
+
+    // on pool miss, the columns are reserved for the rows of the recent blocks.
+    DB::Block other_header{{std::make_shared<DB::DataTypeUInt64>(), "id"}};
+    DB::Block reserved_block = pool.acquire(other_header);
+    ASSERT_EQ(pool.size(), (size_t)2);
+    ASSERT_EQ(reserved_block.rows(), (size_t)0);
+    ASSERT_GE(reserved_block.getByPosition(0).column->allocatedBytes(), number_of_rows * sizeof(DB::UInt64));
+
+    // the pool with capacity of 0 is disabled.
+    nuclm::BlockColumnsPool disabled_pool("block_columns_pool_tst", 0);
+    disabled_pool.release(buildPoolTestBlock(header, number_of_rows));
+    ASSERT_EQ(disabled_pool.size(), (size_t)0);
+    ASSERT_TRUE(DB::blocksHaveEqualStructure(disabled_pool.acquire(header), header));
+}
+
+TEST(AggregatorLoaderBlockRelatedTest, testBlockColumnsPoolBoundedByBytes) {
+    DB::Block header{{std::make_shared<DB::DataTypeUInt64>(), "id"}};
+    auto build_block = [&header](size_t number_of_rows) {
+        auto id_column = DB::ColumnUInt64::create();
+        for (size_t row = 0; row < number_of_rows; row++) {
+            id_column->insertValue(row);
+        }
+        DB::MutableColumns columns;
+        columns.push_back(std::move(id_column));
+        return header.cloneWithColumns(std::move(columns));
+    };
+    size_t block_bytes = build_block(1000).allocatedBytes();
+
+    // the pool keeps the most recent blocks up to its bytes, below its capacity.
+    nuclm::BlockColumnsPool pool("block_columns_pool_tst", 4, 2 * block_bytes + block_bytes / 2);
+    for (int i = 0; i < 3; i++) {
+        pool.release(build_block(1000));
+    }
+    ASSERT_EQ(pool.size(), (size_t)2);
+
+    // and a block beyond the bytes on its own is not taken.
+    pool.release(build_block(10000));
+    ASSERT_EQ(pool.size(), (size_t)2);
+    ASSERT_EQ(pool.acquire(header).getByPosition(0).column->allocatedBytes(), block_bytes);
+
+    // the dictionary nested in an array column starts over, the same as the dictionary at the top.
+    DB::Block tags_header{{DB::DataTypeFactory::instance().get("Array(LowCardinality(String))"), "tags"}};
+    DB::MutableColumns tags_columns = tags_header.cloneEmptyColumns();
+    for (size_t row = 0; row < 100; row++) {
+        tags_columns[0]->insert(DB::Array{DB::Field("tag-" + std::to_string(row))});
+    }
+    nuclm::BlockColumnsPool tags_pool("block_columns_pool_tst", 2);
+    tags_pool.release(tags_header.cloneWithColumns(std::move(tags_columns)));
+    ASSERT_EQ(tags_pool.size(), (size_t)1);
+    DB::Block recycled_block = tags_pool.acquire(tags_header);
+    const auto& recycled_tags = assert_cast<const DB::ColumnArray&>(*recycled_block.getByPosition(0).column);
+    ASSERT_EQ(recycled_tags.size(), (size_t)0);
+    // only the default value is left in the dictionary.
+    ASSERT_EQ(assert_cast<const DB::ColumnLowCardinality&>(recycled_tags.getData()).getDictionary().size(), (size_t)1);
+}
+
 // Call RUN_ALL_TESTS() in main()
 int main(int argc, char** argv) {
 
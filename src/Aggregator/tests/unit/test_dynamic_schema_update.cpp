@@ -27,6 +27,7 @@ limitations under the License.
 
 #include <Aggregator/AggregatorLoaderManager.h>
 #include <Aggregator/TableSchemaUpdateTracker.h>
+#include <Aggregator/TableSchemaRegistry.h>
 #include <Aggregator/ProtobufBatchReader.h>
 #include <Aggregator/DistributedLoaderLock.h>
 
@@ -51,6 +52,8 @@ limitations under the License.
 
 #include <boost/functional/hash.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <iostream>
 #include <string>
@@ -1145,6 +1148,76 @@ TEST_F(AggregatorDynamicSchemaUpdateTesting, testTableSchemaUpdateTrackerWithRep
     ASSERT_FALSE(failed);
 }
 
+/**
+ * The buffers of all of the partitions that see a new schema hash at the same time lead to a single fetch, which runs
+ * on the background thread, and the buffers parked on the fetch get its schema. No backend is needed, as the fetch is
+ * simulated by the fetcher.
+ */
+TEST_F(AggregatorDynamicSchemaUpdateTesting, testTableSchemaRegistryCoalescesConcurrentFetches) {
+    std::string table_name = "schema_registry_tst";
+    nuclm::TableColumnsDescription new_schema(table_name);
+    new_schema.addColumnDescription(nuclm::TableColumnDescription("flightYear", "UInt16"));
+    new_schema.addColumnDescription(nuclm::TableColumnDescription("quarter", "UInt8"));
+    size_t new_hash_code = new_schema.getSchemaHash();
+
+    std::atomic<size_t> number_of_fetcher_calls{0};
+    // written by the fetcher, and read once the fetch is resolved under the lock of the registry.
+    std::vector<std::thread::id> fetcher_thread_ids;
+    auto fetcher = [&]() {
+        number_of_fetcher_calls++;
+        fetcher_thread_ids.push_back(std::this_thread::get_id());
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return new_schema;
+    };
+
+    nuclm::TableSchemaRegistry registry(table_name);
+    auto trackers_created_at = std::chrono::steady_clock::now();
+    size_t number_of_buffers = 8;
+    std::vector<size_t> resolved_hash_codes(number_of_buffers, 0);
+    std::vector<std::thread> buffers;
+    std::vector<std::thread::id> buffer_thread_ids;
+    for (size_t i = 0; i < number_of_buffers; i++) {
+        buffers.emplace_back([&, i]() {
+            auto schema = registry.resolveHash(new_hash_code, trackers_created_at, fetcher);
+            resolved_hash_codes[i] = (schema != nullptr) ? schema->getSchemaHash() : 0;
+        });
+    }
+    for (auto& buffer : buffers) {
+        buffer_thread_ids.push_back(buffer.get_id());
+        buffer.join();
+    }
+
+    ASSERT_EQ(number_of_fetcher_calls.load(), 1U);
+    // the fetch runs on none of the buffers.
+    for (const auto& buffer_thread_id : buffer_thread_ids) {
+        ASSERT_NE(fetcher_thread_ids[0], buffer_thread_id);
+    }
+    ASSERT_EQ(registry.getNumberOfFetches(), 1U);
+    ASSERT_EQ(registry.getNumberOfCoalescedRequests(), number_of_buffers - 1);
+    for (size_t hash_code : resolved_hash_codes) {
+        ASSERT_EQ(hash_code, new_hash_code);
+    }
+
+    // the schema fetched answers the same hash from then on.
+    ASSERT_EQ(registry.resolveHash(new_hash_code, trackers_created_at, fetcher)->getSchemaHash(), new_hash_code);
+    ASSERT_EQ(number_of_fetcher_calls.load(), 1U);
+
+    // a stale hash that the schema fetched does not match is fetched for again, as is the hash asked for by a tracker
+    // created after the fetch.
+    ASSERT_EQ(registry.resolveHash(1, trackers_created_at, fetcher)->getSchemaHash(), new_hash_code);
+    ASSERT_EQ(number_of_fetcher_calls.load(), 2U);
+    ASSERT_NE(fetcher_thread_ids[1], std::this_thread::get_id());
+    ASSERT_EQ(registry.resolveHash(new_hash_code, std::chrono::steady_clock::now(), fetcher)->getSchemaHash(),
+              new_hash_code);
+    ASSERT_EQ(number_of_fetcher_calls.load(), 3U);
+
+    // a failed fetch leaves the schema fetched before in place.
+    auto failed_fetcher = []() -> nuclm::TableColumnsDescription { throw std::runtime_error("backend not reachable"); };
+    ASSERT_EQ(registry.resolveHash(2, trackers_created_at, failed_fetcher), nullptr);
+    ASSERT_EQ(registry.getLatestSchema()->getSchemaHash(), new_hash_code);
+    ASSERT_EQ(registry.getNumberOfFetches(), 4U);
+}
+
 /**
  * To explicitly drop table at the end of the test.
  */
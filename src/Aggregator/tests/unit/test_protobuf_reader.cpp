@@ -25,9 +25,19 @@ limitations under the License.
 
 #include <Aggregator/AggregatorLoaderManager.h>
 #include <Aggregator/ProtobufBatchReader.h>
+#include <Aggregator/ProtobufBatchWriter.h>
+#include <Aggregator/ProtobufMessageArena.h>
+#include <Aggregator/SQLBatchRequestStreamDecoder.h>
+#include <Serializable/ProtobufReader.h>
 
 #include <Core/Block.h>
+#include <DataStreams/NativeBlockOutputStream.h>
+#include <IO/WriteBufferFromString.h>
+#include <Columns/ColumnString.h>
+#include <Columns/ColumnsNumber.h>
 #include <DataTypes/DataTypesNumber.h>
+#include <DataTypes/DataTypeString.h>
+#include <DataTypes/DataTypeFactory.h>
 #include <Common/assert_cast.h>
 #include <Parsers/ASTInsertQuery.h>
 #include <Parsers/ParserQuery.h>
@@ -37,6 +47,7 @@ limitations under the License.
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <string>
 #include <memory>
 #include <cstdlib>
@@ -563,6 +574,1021 @@ TEST_F(AggregatorProtobufReaderRelatedTest, testRetrieveTableDefinitionWithDefau
     ASSERT_FALSE(failed);
 }
 
+TEST_F(AggregatorProtobufReaderRelatedTest, testInsertColumnsPlanCacheEvictionAndSchemaChange) {
+    nuclm::InsertColumnsPlanCache plan_cache(2);
+    std::string sql_statement_1 = "insert into simple_event_5 values(?, ?, ?)";
+    std::string sql_statement_2 = "insert into simple_event_5 (Count, Host, Colo) values(?, ?, ?)";
+    std::string sql_statement_3 = "insert into simple_event_5 (Host, Count, Colo) values(?, ?, ?)";
+
+    auto plan_1 = std::make_shared<nuclm::InsertColumnsPlan>();
+    auto plan_2 = std::make_shared<nuclm::InsertColumnsPlan>();
+    auto plan_3 = std::make_shared<nuclm::InsertColumnsPlan>();
+    plan_cache.put(sql_statement_1, 100, plan_1);
+    plan_cache.put(sql_statement_2, 100, plan_2);
+    ASSERT_EQ(plan_cache.get(sql_statement_1, 100), plan_1);
+    ASSERT_EQ(plan_cache.get(sql_statement_2, 100), plan_2);
+    // the same statement against another schema has no plan.
+    ASSERT_EQ(plan_cache.get(sql_statement_1, 200), nullptr);
+
+    // statement 1 is the least recently used one, and gets evicted.
+    plan_cache.put(sql_statement_3, 100, plan_3);
+    ASSERT_EQ(plan_cache.size(), (size_t)2);
+    ASSERT_EQ(plan_cache.get(sql_statement_1, 100), nullptr);
+    ASSERT_EQ(plan_cache.get(sql_statement_3, 100), plan_3);
+
+    // moving to a new schema drops the plans of the old schema.
+    plan_cache.put(sql_statement_1, 200, plan_1);
+    plan_cache.retainSchema(200);
+    ASSERT_EQ(plan_cache.size(), (size_t)1);
+    ASSERT_EQ(plan_cache.get(sql_statement_1, 200), plan_1);
+    ASSERT_EQ(plan_cache.get(sql_statement_3, 100), nullptr);
+
+    // the cache with capacity of 0 is disabled.
+    nuclm::InsertColumnsPlanCache disabled_plan_cache(0);
+    disabled_plan_cache.put(sql_statement_1, 100, plan_1);
+    ASSERT_EQ(disabled_plan_cache.get(sql_statement_1, 100), nullptr);
+}
+
+TEST_F(AggregatorProtobufReaderRelatedTest, testInsertColumnsPlanSharedByBatchReaders) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    LOG(INFO) << " JSON configuration file path is: " << path;
+
+    ASSERT_TRUE(!path.empty());
+    bool failed = false;
+    try {
+        DB::ContextMutablePtr context = AggregatorProtobufReaderRelatedTest::shared_context->getContext();
+        boost::asio::io_context& ioc = AggregatorProtobufReaderRelatedTest::shared_context->getIOContext();
+        SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+
+        nuclm::AggregatorLoaderManager manager(context, ioc);
+        manager.initLoaderTableDefinitions();
+
+        std::string table_name = "xdr_tst";
+        std::string sql_statement = "insert into xdr_tst (answered, start_date, end_date) values (?, ?, ?)";
+        const nuclm::TableColumnsDescription& table_definition = manager.getTableColumnsDefinition(table_name);
+
+        DB::Block block_holder_1;
+        DB::Block block_holder_2;
+        std::string message = "";
+
+        // two buffers of the same table, each with its own schema tracker.
+        nuclm::TableSchemaUpdateTrackerPtr schema_tracker_1 =
+            std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+        nuclm::TableSchemaUpdateTrackerPtr schema_tracker_2 =
+            std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+        nuclm::ProtobufBatchReader batchReader1(message, schema_tracker_1, block_holder_1, context);
+        nuclm::ProtobufBatchReader batchReader2(message, schema_tracker_2, block_holder_2, context);
+
+        nuclm::InsertColumnsPlanPtr plan_1 =
+            batchReader1.getInsertColumnsPlan(sql_statement, schema_tracker_1->getLatestSchema());
+        nuclm::InsertColumnsPlanPtr plan_2 =
+            batchReader2.getInsertColumnsPlan(sql_statement, schema_tracker_2->getLatestSchema());
+        ASSERT_EQ(plan_1, plan_2);
+
+        ASSERT_EQ(plan_1->columns_definition.size(), (size_t)3);
+        ASSERT_FALSE(plan_1->table_definition_followed);
+        ASSERT_FALSE(plan_1->default_columns_missing);
+        ASSERT_TRUE(plan_1->columns_not_covered_no_deflexpres);
+        ASSERT_TRUE(plan_1->column_shuffled_needed);
+        ASSERT_EQ(plan_1->column_serializers.size(), (size_t)3);
+        ASSERT_EQ(plan_1->order_mapping.size(), (size_t)3);
+        ASSERT_EQ(plan_1->columns_definition[0].name, "answered");
+        ASSERT_EQ(plan_1->columns_definition[1].name, "start_date");
+        ASSERT_EQ(plan_1->columns_definition[2].name, "end_date");
+    } catch (...) {
+        LOG(ERROR) << DB::getCurrentExceptionMessage(true);
+        auto code = DB::getCurrentExceptionCode();
+
+        LOG(ERROR) << "with exception return code: " << code;
+
+        failed = true;
+    }
+
+    ASSERT_FALSE(failed);
+}
+
+TEST_F(AggregatorProtobufReaderRelatedTest, testStreamDecoderMatchesParsedMessage) {
+    nuclm::ColumnTypesAndNamesTableDefinition columns_definition;
+    columns_definition.emplace_back("UInt32", "id");
+    columns_definition.emplace_back("String", "name");
+    columns_definition.emplace_back("Nullable(String)", "note");
+    columns_definition.emplace_back("Array(String)", "tags");
+    columns_definition.emplace_back("Float64", "score");
+    nuclm::ColumnSerializers serializers = nuclm::SerializationHelper::getColumnSerializers(columns_definition);
+    DB::Block sample_block = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+
+    nucolumnar::aggregator::v1::SQLBatchRequest request;
+    request.set_shard("shard_1");
+    request.set_table("stream_decoder_tst");
+    request.set_schema_hashcode(12345);
+    nucolumnar::aggregator::v1::SqlWithBatchBindings* bindings = request.mutable_nucolumnarencoding();
+    bindings->set_sql("insert into stream_decoder_tst (id, name, note, tags, score) values (?, ?, ?, ?, ?)");
+
+    size_t number_of_rows = 50;
+    for (size_t row = 0; row < number_of_rows; row++) {
+        nucolumnar::aggregator::v1::DataBindingList* values = bindings->add_batch_bindings();
+        values->add_values()->set_uint_value(static_cast<uint32_t>(row * 7));
+        // the string values shrink and grow across the rows, as the decoded value is reused across the rows.
+        values->add_values()->set_string_value(std::string((row * 13) % 37, static_cast<char>('a' + row % 26)));
+        if (row % 3 == 0) {
+            values->add_values()->set_null_value(nucolumnar::datatypes::v1::NullValueP::NULL_VALUE);
+        } else {
+            values->add_values()->set_string_value("note_" + std::to_string(row));
+        }
+        nucolumnar::datatypes::v1::ListValueP* tags = values->add_values()->mutable_list_value();
+        for (size_t tag = 0; tag < row % 4; tag++) {
+            tags->add_value()->set_string_value("tag_" + std::to_string(tag));
+        }
+        values->add_values()->set_double_value(static_cast<double>(row) / 3);
+    }
+    std::string message = request.SerializeAsString();
+
+    nuclm::SQLBatchRequestStreamDecoder decoder(message.data(), message.size());
+    ASSERT_TRUE(decoder.scanRequest());
+    ASSERT_EQ(decoder.getShard(), "shard_1");
+    ASSERT_EQ(decoder.getTable(), "stream_decoder_tst");
+    ASSERT_EQ(decoder.getSchemaHashCode(), 12345);
+    ASSERT_EQ(decoder.getSql(), bindings->sql());
+    ASSERT_EQ(decoder.getNumberOfRows(), number_of_rows);
+
+    DB::MutableColumns stream_columns = sample_block.cloneEmptyColumns();
+    nuclm::SQLBatchRequestStreamDecoder::DecodeStats stats;
+    ASSERT_TRUE(decoder.decodeRows(serializers, stream_columns, stats));
+    ASSERT_EQ(stats.rows, number_of_rows);
+    ASSERT_EQ(stats.mismatched_rows, (size_t)0);
+
+    // the parsed message decoded in the regular way.
+    nucolumnar::aggregator::v1::SQLBatchRequest parsed_request;
+    ASSERT_TRUE(parsed_request.ParseFromString(message));
+    DB::MutableColumns parsed_columns = sample_block.cloneEmptyColumns();
+    size_t parsed_bytes_read = 0;
+    for (size_t cindex = 0; cindex < serializers.size(); cindex++) {
+        ASSERT_EQ(stats.failed_values[cindex], (size_t)0);
+        nuclm::ProtobufColumnReader reader(parsed_request.nucolumnarencoding().batch_bindings(), cindex);
+        size_t rows_added = 0;
+        serializers[cindex]->deserializeProtobufColumn(*parsed_columns[cindex], reader, rows_added);
+        ASSERT_EQ(rows_added, number_of_rows);
+        parsed_bytes_read += reader.getTotalBytesRead();
+    }
+    ASSERT_EQ(stats.bytes_read, parsed_bytes_read);
+
+    for (size_t cindex = 0; cindex < serializers.size(); cindex++) {
+        ASSERT_EQ(stream_columns[cindex]->size(), number_of_rows);
+        for (size_t row = 0; row < number_of_rows; row++) {
+            ASSERT_EQ(stream_columns[cindex]->compareAt(row, row, *parsed_columns[cindex], 1), 0)
+                << "column: " << cindex << " row: " << row;
+        }
+    }
+
+    // a row with an extra value is reported as mismatched.
+    nucolumnar::aggregator::v1::DataBindingList* extra_row = bindings->add_batch_bindings();
+    extra_row->CopyFrom(bindings->batch_bindings(0));
+    extra_row->add_values()->set_long_value(1);
+    std::string mismatched_message = request.SerializeAsString();
+    nuclm::SQLBatchRequestStreamDecoder mismatched_decoder(mismatched_message.data(), mismatched_message.size());
+    ASSERT_TRUE(mismatched_decoder.scanRequest());
+    DB::MutableColumns mismatched_columns = sample_block.cloneEmptyColumns();
+    nuclm::SQLBatchRequestStreamDecoder::DecodeStats mismatched_stats;
+    ASSERT_TRUE(mismatched_decoder.decodeRows(serializers, mismatched_columns, mismatched_stats));
+    ASSERT_EQ(mismatched_stats.rows, number_of_rows + 1);
+    ASSERT_EQ(mismatched_stats.mismatched_rows, (size_t)1);
+
+    // the ClickHouse native encoding is left to the parsed message.
+    nucolumnar::aggregator::v1::SQLBatchRequest native_request;
+    native_request.set_table("stream_decoder_tst");
+    native_request.mutable_clickhouseencoding()->set_block("native");
+    std::string native_message = native_request.SerializeAsString();
+    nuclm::SQLBatchRequestStreamDecoder native_decoder(native_message.data(), native_message.size());
+    ASSERT_FALSE(native_decoder.scanRequest());
+}
+
+TEST_F(AggregatorProtobufReaderRelatedTest, testProtobufMessageArenaLearnsInitialBlockSize) {
+    auto build_message = [](size_t number_of_rows) {
+        nucolumnar::aggregator::v1::SQLBatchRequest request;
+        request.set_table("arena_tst");
+        nucolumnar::aggregator::v1::SqlWithBatchBindings* bindings = request.mutable_nucolumnarencoding();
+        bindings->set_sql("insert into arena_tst values (?, ?)");
+        for (size_t row = 0; row < number_of_rows; row++) {
+            nucolumnar::aggregator::v1::DataBindingList* values = bindings->add_batch_bindings();
+            values->add_values()->set_long_value(static_cast<int64_t>(row));
+            values->add_values()->set_string_value("value_" + std::to_string(row));
+        }
+        return request.SerializeAsString();
+    };
+
+    size_t min_initial_block_size = 4096;
+    size_t max_initial_block_size = 1024 * 1024;
+    nuclm::ProtobufMessageArena message_arena(min_initial_block_size, max_initial_block_size);
+    ASSERT_EQ(message_arena.getInitialBlockSize(), min_initial_block_size);
+
+    // the initial block grows to what a large message has used.
+    std::string large_message = build_message(2000);
+    size_t large_bytes_used = 0;
+    for (int i = 0; i < 3; i++) {
+        auto* request =
+            google::protobuf::Arena::CreateMessage<nucolumnar::aggregator::v1::SQLBatchRequest>(message_arena.get());
+        ASSERT_TRUE(request->ParseFromString(large_message));
+        ASSERT_EQ(request->nucolumnarencoding().batch_bindings_size(), 2000);
+        large_bytes_used = message_arena.reset();
+    }
+    ASSERT_EQ(message_arena.getNumberOfResets(), (uint64_t)3);
+    ASSERT_GE(message_arena.getInitialBlockSize(), large_bytes_used);
+    ASSERT_LE(message_arena.getInitialBlockSize(), max_initial_block_size);
+    size_t grown_initial_block_size = message_arena.getInitialBlockSize();
+
+    // and shrinks back only after the messages have stayed much smaller for a while.
+    std::string small_message = build_message(2);
+    auto* request =
+        google::protobuf::Arena::CreateMessage<nucolumnar::aggregator::v1::SQLBatchRequest>(message_arena.get());
+    ASSERT_TRUE(request->ParseFromString(small_message));
+    message_arena.reset();
+    ASSERT_EQ(message_arena.getInitialBlockSize(), grown_initial_block_size);
+    for (int i = 0; i < 100; i++) {
+        request =
+            google::protobuf::Arena::CreateMessage<nucolumnar::aggregator::v1::SQLBatchRequest>(message_arena.get());
+        ASSERT_TRUE(request->ParseFromString(small_message));
+        message_arena.reset();
+    }
+    ASSERT_LT(message_arena.getInitialBlockSize(), grown_initial_block_size);
+    ASSERT_GE(message_arena.getInitialBlockSize(), min_initial_block_size);
+}
+
+/**
+ * The same rows, in the columns (name, id, score) that are shuffled against the table definition of (id, name, score),
+ * encoded in either of the two encodings of SQLBatchRequest.
+ */
+static std::string buildNativeOrNucolumnarEncodedMessage(const std::string& table_name, size_t number_of_rows,
+                                                         bool native_encoding) {
+    nucolumnar::aggregator::v1::SQLBatchRequest request;
+    request.set_shard("shard_1");
+    request.set_table(table_name);
+
+    if (native_encoding) {
+        auto name_column = DB::ColumnString::create();
+        auto id_column = DB::ColumnUInt64::create();
+        auto score_column = DB::ColumnFloat64::create();
+        for (size_t row = 0; row < number_of_rows; row++) {
+            std::string name = "name_" + std::to_string(row);
+            name_column->insertData(name.data(), name.size());
+            id_column->insertValue(row);
+            score_column->insertValue(static_cast<double>(row) / 7);
+        }
+
+        DB::Block native_columns{
+            {std::move(name_column), std::make_shared<DB::DataTypeString>(), "name"},
+            {std::move(id_column), std::make_shared<DB::DataTypeUInt64>(), "id"},
+            {std::move(score_column), std::make_shared<DB::DataTypeFloat64>(), "score"}};
+        std::string native_data;
+        {
+            DB::WriteBufferFromString native_output(native_data);
+            DB::NativeBlockOutputStream native_stream(native_output, 0, native_columns.cloneEmpty());
+            native_stream.write(native_columns);
+            native_stream.flush();
+        }
+        request.mutable_clickhouseencoding()->set_block(native_data);
+    } else {
+        nucolumnar::aggregator::v1::SqlWithBatchBindings* bindings = request.mutable_nucolumnarencoding();
+        bindings->set_sql("insert into " + table_name + " (name, id, score) values (?, ?, ?)");
+        for (size_t row = 0; row < number_of_rows; row++) {
+            nucolumnar::aggregator::v1::DataBindingList* values = bindings->add_batch_bindings();
+            values->add_values()->set_string_value("name_" + std::to_string(row));
+            values->add_values()->set_ulong_value(row);
+            values->add_values()->set_double_value(static_cast<double>(row) / 7);
+        }
+    }
+    return request.SerializeAsString();
+}
+
+static nuclm::TableColumnsDescription buildNativeEncodingTableDefinition(const std::string& table_name) {
+    nuclm::TableColumnsDescription table_definition(table_name);
+    table_definition.addColumnDescription(nuclm::TableColumnDescription("id", "UInt64"));
+    table_definition.addColumnDescription(nuclm::TableColumnDescription("name", "String"));
+    table_definition.addColumnDescription(nuclm::TableColumnDescription("score", "Float64"));
+    return table_definition;
+}
+
+TEST_F(AggregatorProtobufReaderRelatedTest, testClickHouseNativeBlockEncodingMatchesNucolumnarEncoding) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorProtobufReaderRelatedTest::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorProtobufReaderRelatedTest::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "native_block_tst";
+    nuclm::TableColumnsDescription table_definition = buildNativeEncodingTableDefinition(table_name);
+    size_t number_of_rows = 100;
+
+    DB::Block native_block_holder =
+        nuclm::SerializationHelper::getBlockDefinition(table_definition.getFullColumnTypesAndNamesDefinition());
+    DB::Block nucolumnar_block_holder = native_block_holder.cloneEmpty();
+    nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+        std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+
+    // two messages each, to have the second one appended to what the first one has populated.
+    for (int i = 0; i < 2; i++) {
+        std::string native_message = buildNativeOrNucolumnarEncodedMessage(table_name, number_of_rows, true);
+        nuclm::ProtobufBatchReader native_reader(native_message, schema_tracker, native_block_holder, context);
+        ASSERT_TRUE(native_reader.read());
+        ASSERT_EQ(native_reader.getRowsProcessed(), number_of_rows);
+
+        std::string nucolumnar_message = buildNativeOrNucolumnarEncodedMessage(table_name, number_of_rows, false);
+        nuclm::ProtobufBatchReader nucolumnar_reader(nucolumnar_message, schema_tracker, nucolumnar_block_holder,
+                                                     context);
+        ASSERT_TRUE(nucolumnar_reader.read());
+    }
+
+    ASSERT_EQ(native_block_holder.rows(), 2 * number_of_rows);
+    ASSERT_EQ(native_block_holder.dumpStructure(), nucolumnar_block_holder.dumpStructure());
+    for (size_t cindex = 0; cindex < native_block_holder.columns(); cindex++) {
+        const DB::IColumn& native_column = *native_block_holder.getByPosition(cindex).column;
+        const DB::IColumn& nucolumnar_column = *nucolumnar_block_holder.getByPosition(cindex).column;
+        for (size_t row = 0; row < native_block_holder.rows(); row++) {
+            ASSERT_EQ(native_column.compareAt(row, row, nucolumnar_column, 1), 0)
+                << "column: " << cindex << " row: " << row;
+        }
+    }
+
+    // a native block column with a type other than what the table defines is rejected.
+    nucolumnar::aggregator::v1::SQLBatchRequest mismatched_request;
+    mismatched_request.set_table(table_name);
+    {
+        auto id_column = DB::ColumnUInt32::create();
+        id_column->insertValue(1);
+        DB::Block native_columns{{std::move(id_column), std::make_shared<DB::DataTypeUInt32>(), "id"}};
+        std::string native_data;
+        {
+            DB::WriteBufferFromString native_output(native_data);
+            DB::NativeBlockOutputStream native_stream(native_output, 0, native_columns.cloneEmpty());
+            native_stream.write(native_columns);
+            native_stream.flush();
+        }
+        mismatched_request.mutable_clickhouseencoding()->set_block(native_data);
+    }
+    std::string mismatched_message = mismatched_request.SerializeAsString();
+    nuclm::ProtobufBatchReader mismatched_reader(mismatched_message, schema_tracker, native_block_holder, context);
+    ASSERT_THROW(mismatched_reader.read(), DB::Exception);
+    ASSERT_EQ(native_block_holder.rows(), 2 * number_of_rows);
+}
+
+static std::string buildInTableOrderMessage(const std::string& table_name, size_t number_of_rows,
+                                            bool with_invalid_id, bool with_missing_value) {
+    nucolumnar::aggregator::v1::SQLBatchRequest request;
+    request.set_shard("shard_1");
+    request.set_table(table_name);
+    nucolumnar::aggregator::v1::SqlWithBatchBindings* bindings = request.mutable_nucolumnarencoding();
+    bindings->set_sql("insert into " + table_name + " values (?, ?, ?)");
+    for (size_t row = 0; row < number_of_rows; row++) {
+        nucolumnar::aggregator::v1::DataBindingList* values = bindings->add_batch_bindings();
+        // the invalid value is in the last row, after the values of the other rows have got into the columns.
+        if (with_invalid_id && row == number_of_rows - 1) {
+            values->add_values()->set_string_value("not-an-id");
+        } else {
+            values->add_values()->set_ulong_value(row);
+        }
+        values->add_values()->set_string_value("name_" + std::to_string(row));
+        if (!(with_missing_value && row == number_of_rows - 1)) {
+            values->add_values()->set_double_value(static_cast<double>(row) / 7);
+        }
+    }
+    return request.SerializeAsString();
+}
+
+TEST_F(AggregatorProtobufReaderRelatedTest, testDecodeIntoBlockRollsBackFailedMessage) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorProtobufReaderRelatedTest::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorProtobufReaderRelatedTest::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "decode_into_block_tst";
+    nuclm::TableColumnsDescription table_definition = buildNativeEncodingTableDefinition(table_name);
+    size_t number_of_rows = 100;
+
+    DB::Block block_holder =
+        nuclm::SerializationHelper::getBlockDefinition(table_definition.getFullColumnTypesAndNamesDefinition());
+    DB::Block shuffled_block_holder = block_holder.cloneEmpty();
+    nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+        std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+
+    // the rows in table order are decoded into the block, the same as the shuffled rows copied into the block.
+    for (int i = 0; i < 2; i++) {
+        std::string message = buildInTableOrderMessage(table_name, number_of_rows, false, false);
+        nuclm::ProtobufBatchReader reader(message, schema_tracker, block_holder, context);
+        ASSERT_TRUE(reader.read());
+        ASSERT_EQ(reader.getRowsProcessed(), number_of_rows);
+
+        std::string shuffled_message = buildNativeOrNucolumnarEncodedMessage(table_name, number_of_rows, false);
+        nuclm::ProtobufBatchReader shuffled_reader(shuffled_message, schema_tracker, shuffled_block_holder, context);
+        ASSERT_TRUE(shuffled_reader.read());
+    }
+    ASSERT_EQ(block_holder.rows(), 2 * number_of_rows);
+    for (size_t cindex = 0; cindex < block_holder.columns(); cindex++) {
+        const DB::IColumn& column = *block_holder.getByPosition(cindex).column;
+        const DB::IColumn& shuffled_column = *shuffled_block_holder.getByPosition(cindex).column;
+        for (size_t row = 0; row < block_holder.rows(); row++) {
+            ASSERT_EQ(column.compareAt(row, row, shuffled_column, 1), 0) << "column: " << cindex << " row: " << row;
+        }
+    }
+
+    // a message that fails on its last row leaves the block as it was before the message.
+    std::string invalid_message = buildInTableOrderMessage(table_name, number_of_rows, true, false);
+    nuclm::ProtobufBatchReader invalid_reader(invalid_message, schema_tracker, block_holder, context);
+    ASSERT_FALSE(invalid_reader.read());
+
+    std::string mismatched_message = buildInTableOrderMessage(table_name, number_of_rows, false, true);
+    nuclm::ProtobufBatchReader mismatched_reader(mismatched_message, schema_tracker, block_holder, context);
+    ASSERT_THROW(mismatched_reader.read(), DB::Exception);
+
+    for (size_t cindex = 0; cindex < block_holder.columns(); cindex++) {
+        ASSERT_EQ(block_holder.getByPosition(cindex).column->size(), 2 * number_of_rows);
+    }
+
+    // and the block keeps taking in the messages afterwards.
+    std::string message = buildInTableOrderMessage(table_name, number_of_rows, false, false);
+    nuclm::ProtobufBatchReader reader(message, schema_tracker, block_holder, context);
+    ASSERT_TRUE(reader.read());
+    ASSERT_EQ(block_holder.rows(), 3 * number_of_rows);
+}
+
+/**
+ * A message of two native blocks, with the second one either having a column type other than what the table defines,
+ * or being truncated, is rejected without the rows of its first block being appended.
+ */
+TEST_F(AggregatorProtobufReaderRelatedTest, testClickHouseNativeBlocksRejectedAsWhole) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorProtobufReaderRelatedTest::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorProtobufReaderRelatedTest::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "native_blocks_tst";
+    nuclm::TableColumnsDescription table_definition = buildNativeEncodingTableDefinition(table_name);
+    size_t number_of_rows = 100;
+
+    DB::Block block_holder =
+        nuclm::SerializationHelper::getBlockDefinition(table_definition.getFullColumnTypesAndNamesDefinition());
+    nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+        std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+
+    std::string message = buildNativeOrNucolumnarEncodedMessage(table_name, number_of_rows, true);
+    nuclm::ProtobufBatchReader reader(message, schema_tracker, block_holder, context);
+    ASSERT_TRUE(reader.read());
+    ASSERT_EQ(block_holder.rows(), number_of_rows);
+
+    auto build_native_data = [number_of_rows](bool with_mismatched_type) {
+        auto id_column = DB::ColumnUInt64::create();
+        auto name_column = DB::ColumnString::create();
+        auto score_column = DB::ColumnFloat64::create();
+        for (size_t row = 0; row < number_of_rows; row++) {
+            id_column->insertValue(row);
+            std::string name = "name_" + std::to_string(row);
+            name_column->insertData(name.data(), name.size());
+            score_column->insertValue(static_cast<double>(row) / 7);
+        }
+        DB::Block first_block{{std::move(id_column), std::make_shared<DB::DataTypeUInt64>(), "id"},
+                              {std::move(name_column), std::make_shared<DB::DataTypeString>(), "name"},
+                              {std::move(score_column), std::make_shared<DB::DataTypeFloat64>(), "score"}};
+
+        auto mismatched_id_column = DB::ColumnUInt32::create();
+        mismatched_id_column->insertValue(1);
+        DB::Block second_block{{std::move(mismatched_id_column), std::make_shared<DB::DataTypeUInt32>(), "id"}};
+
+        std::string native_data;
+        {
+            DB::WriteBufferFromString native_output(native_data);
+            DB::NativeBlockOutputStream native_stream(native_output, 0, first_block.cloneEmpty());
+            native_stream.write(first_block);
+            if (with_mismatched_type) {
+                native_stream.write(second_block);
+            } else {
+                // the second block is the same as the first one, to be truncated afterwards.
+                native_stream.write(first_block);
+            }
+            native_stream.flush();
+        }
+        if (!with_mismatched_type) {
+            native_data.resize(native_data.size() - 16);
+        }
+        return native_data;
+    };
+
+    for (bool with_mismatched_type : {true, false}) {
+        nucolumnar::aggregator::v1::SQLBatchRequest request;
+        request.set_table(table_name);
+        request.mutable_clickhouseencoding()->set_block(build_native_data(with_mismatched_type));
+        std::string invalid_message = request.SerializeAsString();
+        nuclm::ProtobufBatchReader invalid_reader(invalid_message, schema_tracker, block_holder, context);
+        ASSERT_THROW(invalid_reader.read(), DB::Exception);
+        for (size_t cindex = 0; cindex < block_holder.columns(); cindex++) {
+            ASSERT_EQ(block_holder.getByPosition(cindex).column->size(), number_of_rows);
+        }
+    }
+
+    // a native block without any column is rejected as well, rather than taken as the end of the blocks.
+    std::string no_columns_data;
+    {
+        DB::Block no_columns_block;
+        DB::WriteBufferFromString native_output(no_columns_data);
+        DB::NativeBlockOutputStream native_stream(native_output, 0, no_columns_block);
+        native_stream.write(no_columns_block);
+        native_stream.flush();
+    }
+    nucolumnar::aggregator::v1::SQLBatchRequest no_columns_request;
+    no_columns_request.set_table(table_name);
+    no_columns_request.mutable_clickhouseencoding()->set_block(no_columns_data);
+    std::string no_columns_message = no_columns_request.SerializeAsString();
+    nuclm::ProtobufBatchReader no_columns_reader(no_columns_message, schema_tracker, block_holder, context);
+    ASSERT_THROW(no_columns_reader.read(), DB::Exception);
+    ASSERT_EQ(block_holder.rows(), number_of_rows);
+
+    // and the block keeps taking in the messages afterwards.
+    nuclm::ProtobufBatchReader next_reader(message, schema_tracker, block_holder, context);
+    ASSERT_TRUE(next_reader.read());
+    ASSERT_EQ(block_holder.rows(), 2 * number_of_rows);
+}
+
+/**
+ * Not a correctness test, but a benchmark of the two encodings decoding the same rows into a block, with the message
+ * size and the time per message logged for the comparison. Disabled by default, and to be run with
+ * --gtest_also_run_disabled_tests.
+ */
+TEST_F(AggregatorProtobufReaderRelatedTest, DISABLED_benchmarkClickHouseNativeBlockVersusNucolumnarEncoding) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorProtobufReaderRelatedTest::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorProtobufReaderRelatedTest::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "native_block_tst";
+    nuclm::TableColumnsDescription table_definition = buildNativeEncodingTableDefinition(table_name);
+    size_t number_of_rows = 10000;
+    size_t number_of_messages = 50;
+
+    for (bool native_encoding : {false, true}) {
+        std::string message = buildNativeOrNucolumnarEncodedMessage(table_name, number_of_rows, native_encoding);
+        DB::Block block_holder =
+            nuclm::SerializationHelper::getBlockDefinition(table_definition.getFullColumnTypesAndNamesDefinition());
+        nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+            std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < number_of_messages; i++) {
+            nuclm::ProtobufBatchReader batch_reader(message, schema_tracker, block_holder, context);
+            ASSERT_TRUE(batch_reader.read());
+        }
+        auto elapsed_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        ASSERT_EQ(block_holder.rows(), number_of_rows * number_of_messages);
+        LOG(INFO) << (native_encoding ? "clickhouse native" : "nucolumnar") << " encoding with message size: "
+                  << message.size() << " bytes and rows: " << number_of_rows
+                  << " takes per message (us): " << elapsed_us / number_of_messages;
+    }
+}
+
+static std::vector<std::pair<std::string, std::string>> getBatchWriterColumns() {
+    return {{"u8", "UInt8"},
+            {"i16", "Int16"},
+            {"i32", "Int32"},
+            {"u32", "UInt32"},
+            {"i64", "Int64"},
+            {"u64", "UInt64"},
+            {"f32", "Float32"},
+            {"f64", "Float64"},
+            {"str", "String"},
+            {"fixed_str", "FixedString(4)"},
+            {"day", "Date"},
+            {"time", "DateTime"},
+            {"time64", "DateTime64(3)"},
+            {"nullable_str", "Nullable(String)"},
+            {"nullable_i32", "Nullable(Int32)"},
+            {"array_u32", "Array(UInt32)"},
+            {"array_str", "Array(String)"},
+            {"array_nullable_i64", "Array(Nullable(Int64))"},
+            {"lc_str", "LowCardinality(String)"},
+            {"lc_nullable_str", "LowCardinality(Nullable(String))"}};
+}
+
+// one value per column of getBatchWriterColumns, with the nulls, the empty arrays and the repeated strings in between.
+static std::vector<DB::Field> buildBatchWriterRow(size_t row) {
+    bool is_null = (row % 3 == 0);
+    std::string name = "name_" + std::to_string(row % 10);
+    DB::Array numbers;
+    DB::Array strings;
+    for (size_t i = 0; i < row % 4; i++) {
+        numbers.push_back(DB::UInt64(row + i));
+        strings.push_back(DB::String("element_" + std::to_string(i)));
+    }
+    DB::Array nullable_numbers{DB::Field(), DB::Field(-static_cast<DB::Int64>(row))};
+    DB::Int64 signed_row = static_cast<DB::Int64>(row);
+
+    return {DB::Field(DB::UInt64(row % 256)),
+            DB::Field(-signed_row % 30000),
+            DB::Field(-signed_row * 1000),
+            DB::Field(DB::UInt64(row * 100000)),
+            DB::Field(-signed_row * 10000000000LL),
+            DB::Field(DB::UInt64(row) * 10000000000ULL),
+            DB::Field(static_cast<DB::Float64>(static_cast<DB::Float32>(row) / 3)),
+            DB::Field(static_cast<DB::Float64>(row) / 7),
+            DB::Field(name),
+            DB::Field(DB::String("ab")),
+            DB::Field(DB::UInt64(18000 + row % 1000)),
+            DB::Field(DB::UInt64(1600000000 + row)),
+            DB::Field(DB::DecimalField<DB::DateTime64>(DB::DateTime64(1600000000123LL + signed_row), 3)),
+            is_null ? DB::Field() : DB::Field(name),
+            is_null ? DB::Field() : DB::Field(signed_row),
+            DB::Field(numbers),
+            DB::Field(strings),
+            DB::Field(nullable_numbers),
+            DB::Field(name),
+            is_null ? DB::Field() : DB::Field(name)};
+}
+
+TEST_F(AggregatorProtobufReaderRelatedTest, testProtobufBatchWriterRoundTrip) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorProtobufReaderRelatedTest::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorProtobufReaderRelatedTest::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "batch_writer_tst";
+    nuclm::TableColumnsDescription table_definition(table_name);
+    for (const auto& column : getBatchWriterColumns()) {
+        table_definition.addColumnDescription(nuclm::TableColumnDescription(column.first, column.second));
+    }
+    nuclm::ColumnTypesAndNamesTableDefinition columns_definition =
+        table_definition.getFullColumnTypesAndNamesDefinition();
+    size_t number_of_rows = 100;
+
+    // the rows appended one by one, and the block built out of the same rows.
+    nuclm::ProtobufBatchWriter row_writer(table_name, "shard_1", columns_definition);
+    DB::Block expected_block = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+    DB::MutableColumns expected_columns = expected_block.cloneEmptyColumns();
+    for (size_t row = 0; row < number_of_rows; row++) {
+        std::vector<DB::Field> values = buildBatchWriterRow(row);
+        for (size_t cindex = 0; cindex < values.size(); cindex++) {
+            expected_columns[cindex]->insert(values[cindex]);
+        }
+        row_writer.appendRow(values);
+    }
+    expected_block.setColumns(std::move(expected_columns));
+
+    nuclm::ProtobufBatchWriter block_writer(table_name, "shard_1", columns_definition);
+    block_writer.appendBlock(expected_block);
+    ASSERT_EQ(block_writer.getNumberOfRows(), number_of_rows);
+    std::string message = block_writer.finish();
+    ASSERT_EQ(block_writer.getNumberOfRows(), 0);
+    ASSERT_EQ(message, row_writer.finish());
+
+    // the message is what the protobuf parser takes as well.
+    nucolumnar::aggregator::v1::SQLBatchRequest request;
+    ASSERT_TRUE(request.ParseFromString(message));
+    ASSERT_EQ(request.shard(), "shard_1");
+    ASSERT_EQ(request.table(), table_name);
+    ASSERT_EQ(request.nucolumnarencoding().sql(), block_writer.getSql());
+    ASSERT_EQ(static_cast<size_t>(request.nucolumnarencoding().batch_bindings_size()), number_of_rows);
+
+    // the columns in the reversed order, for the batch reader to shuffle them back into the table order.
+    nuclm::ColumnTypesAndNamesTableDefinition reversed_definition(columns_definition.rbegin(),
+                                                                  columns_definition.rend());
+    nuclm::ProtobufBatchWriter reversed_writer(table_name, "shard_1", reversed_definition);
+    reversed_writer.appendBlock(expected_block);
+    std::string reversed_message = reversed_writer.finish();
+
+    nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+        std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+    for (const std::string* encoded : {&message, &reversed_message}) {
+        DB::Block block_holder = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+        nuclm::ProtobufBatchReader reader(*encoded, schema_tracker, block_holder, context);
+        ASSERT_TRUE(reader.read());
+        ASSERT_EQ(block_holder.rows(), number_of_rows);
+        ASSERT_EQ(block_holder.dumpStructure(), expected_block.dumpStructure());
+        for (size_t cindex = 0; cindex < block_holder.columns(); cindex++) {
+            const DB::IColumn& column = *block_holder.getByPosition(cindex).column;
+            const DB::IColumn& expected_column = *expected_block.getByPosition(cindex).column;
+            for (size_t row = 0; row < number_of_rows; row++) {
+                ASSERT_EQ(column.compareAt(row, row, expected_column, 1), 0)
+                    << "column: " << block_holder.getByPosition(cindex).name << " row: " << row;
+            }
+        }
+    }
+
+    // a row with a value missing, or a block without a column to write, is rejected.
+    std::vector<DB::Field> short_row = buildBatchWriterRow(0);
+    short_row.pop_back();
+    ASSERT_THROW(row_writer.appendRow(short_row), DB::Exception);
+    ASSERT_THROW(block_writer.appendBlock(DB::Block{}), DB::Exception);
+    ASSERT_EQ(row_writer.getNumberOfRows(), 0);
+}
+
+// the columns with the values at the edges of their types, with the scale beyond the milliseconds only for the
+// columnar encoding, as the timestamp of the nucolumnar encoding carries the milliseconds at best.
+static std::vector<std::pair<std::string, std::string>> getEdgeValueColumns(bool columnar) {
+    std::vector<std::pair<std::string, std::string>> columns{{"fixed_str", "FixedString(4)"},
+                                                             {"nullable_fixed_str", "Nullable(FixedString(4))"},
+                                                             {"array_fixed_str", "Array(FixedString(4))"},
+                                                             {"time64_0", "DateTime64(0)"},
+                                                             {"time64_3", "DateTime64(3, 'UTC')"},
+                                                             {"array_lc_str", "Array(LowCardinality(String))"},
+                                                             {"lc_nullable_str", "LowCardinality(Nullable(String))"},
+                                                             {"nullable_str", "Nullable(String)"}};
+    if (columnar) {
+        columns.emplace_back("time64_6", "DateTime64(6)");
+    }
+    return columns;
+}
+
+// the full width, the empty and the zero embedded fixed strings, the empty strings apart from the nulls, and the
+// timestamps at the last millisecond of the second.
+static std::vector<DB::Field> buildEdgeValueRow(size_t row, bool columnar) {
+    static const std::vector<DB::String> fixed_strings{DB::String("abcd"), DB::String(), DB::String("a\0b", 3)};
+    DB::Array fixed_string_array;
+    DB::Array tags;
+    for (size_t i = 0; i < row % 3; i++) {
+        fixed_string_array.push_back(fixed_strings[(row + i) % 3]);
+        tags.push_back(DB::String("tag_" + std::to_string(i % 2)));
+    }
+    DB::Int64 signed_row = static_cast<DB::Int64>(row);
+    DB::Field name = (row % 4 == 1) ? DB::Field(DB::String()) : DB::Field("name_" + std::to_string(row % 5));
+
+    std::vector<DB::Field> values{
+        DB::Field(fixed_strings[row % 3]),
+        (row % 2 == 0) ? DB::Field() : DB::Field(fixed_strings[row % 3]),
+        DB::Field(fixed_string_array),
+        DB::Field(DB::DecimalField<DB::DateTime64>(DB::DateTime64(1600000000LL + signed_row), 0)),
+        DB::Field(DB::DecimalField<DB::DateTime64>(DB::DateTime64(1600000000999LL + signed_row * 1000), 3)),
+        DB::Field(tags),
+        (row % 4 == 0) ? DB::Field() : name,
+        (row % 4 == 0) ? DB::Field() : name};
+    if (columnar) {
+        values.emplace_back(DB::DecimalField<DB::DateTime64>(DB::DateTime64(1600000000123456LL + signed_row), 6));
+    }
+    return values;
+}
+
+TEST_F(AggregatorProtobufReaderRelatedTest, testProtobufBatchWriterRoundTripsEdgeValues) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorProtobufReaderRelatedTest::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorProtobufReaderRelatedTest::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "batch_writer_edge_values_tst";
+    size_t number_of_rows = 24;
+    for (auto encoding : {nuclm::ProtobufBatchWriter::Encoding::NUCOLUMNAR,
+                          nuclm::ProtobufBatchWriter::Encoding::COLUMNAR}) {
+        bool columnar = (encoding == nuclm::ProtobufBatchWriter::Encoding::COLUMNAR);
+        nuclm::TableColumnsDescription table_definition(table_name);
+        for (const auto& column : getEdgeValueColumns(columnar)) {
+            table_definition.addColumnDescription(nuclm::TableColumnDescription(column.first, column.second));
+        }
+        nuclm::ColumnTypesAndNamesTableDefinition columns_definition =
+            table_definition.getFullColumnTypesAndNamesDefinition();
+
+        // the rows appended one by one, and the block built out of the same rows.
+        nuclm::ProtobufBatchWriter row_writer(table_name, "shard_1", columns_definition, 0, encoding);
+        DB::Block expected_block = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+        DB::MutableColumns expected_columns = expected_block.cloneEmptyColumns();
+        for (size_t row = 0; row < number_of_rows; row++) {
+            std::vector<DB::Field> values = buildEdgeValueRow(row, columnar);
+            for (size_t cindex = 0; cindex < values.size(); cindex++) {
+                expected_columns[cindex]->insert(values[cindex]);
+            }
+            row_writer.appendRow(values);
+        }
+        expected_block.setColumns(std::move(expected_columns));
+
+        nuclm::ProtobufBatchWriter block_writer(table_name, "shard_1", columns_definition, 0, encoding);
+        block_writer.appendBlock(expected_block);
+        std::string message = block_writer.finish();
+        ASSERT_EQ(message, row_writer.finish());
+
+        nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+            std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+        DB::Block block_holder = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+        nuclm::ProtobufBatchReader reader(message, schema_tracker, block_holder, context);
+        ASSERT_TRUE(reader.read());
+        ASSERT_EQ(block_holder.rows(), number_of_rows);
+        ASSERT_EQ(block_holder.dumpStructure(), expected_block.dumpStructure());
+        for (size_t cindex = 0; cindex < block_holder.columns(); cindex++) {
+            const DB::IColumn& column = *block_holder.getByPosition(cindex).column;
+            const DB::IColumn& expected_column = *expected_block.getByPosition(cindex).column;
+            for (size_t row = 0; row < number_of_rows; row++) {
+                ASSERT_EQ(column.compareAt(row, row, expected_column, 1), 0)
+                    << (columnar ? "columnar" : "nucolumnar") << " column: " << block_holder.getByPosition(cindex).name
+                    << " row: " << row;
+            }
+        }
+
+        // the empty string stays apart from the null, in the dictionary encoded column and in the plain one.
+        for (const std::string& name : {std::string("lc_nullable_str"), std::string("nullable_str")}) {
+            const DB::IColumn& column = *block_holder.getByName(name).column;
+            ASSERT_TRUE(column[0].isNull());
+            ASSERT_EQ(column[1], DB::Field(DB::String()));
+        }
+
+        // a fixed string value wider than the type is rejected, with the rows appended so far kept.
+        std::vector<DB::Field> wide_row = buildEdgeValueRow(0, columnar);
+        wide_row[0] = DB::Field(DB::String("abcde"));
+        row_writer.appendRow(buildEdgeValueRow(0, columnar));
+        ASSERT_THROW(row_writer.appendRow(wide_row), DB::Exception);
+        ASSERT_EQ(row_writer.getNumberOfRows(), 1);
+    }
+}
+
+TEST_F(AggregatorProtobufReaderRelatedTest, testColumnarEncodingRoundTrip) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorProtobufReaderRelatedTest::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorProtobufReaderRelatedTest::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "columnar_encoding_tst";
+    nuclm::TableColumnsDescription table_definition(table_name);
+    for (const auto& column : getBatchWriterColumns()) {
+        table_definition.addColumnDescription(nuclm::TableColumnDescription(column.first, column.second));
+    }
+    nuclm::ColumnTypesAndNamesTableDefinition columns_definition =
+        table_definition.getFullColumnTypesAndNamesDefinition();
+    size_t number_of_rows = 100;
+    auto columnar = nuclm::ProtobufBatchWriter::Encoding::COLUMNAR;
+
+    nuclm::ProtobufBatchWriter row_writer(table_name, "shard_1", columns_definition, 0, columnar);
+    DB::Block expected_block = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+    DB::MutableColumns expected_columns = expected_block.cloneEmptyColumns();
+    for (size_t row = 0; row < number_of_rows; row++) {
+        std::vector<DB::Field> values = buildBatchWriterRow(row);
+        for (size_t cindex = 0; cindex < values.size(); cindex++) {
+            expected_columns[cindex]->insert(values[cindex]);
+        }
+        row_writer.appendRow(values);
+    }
+    expected_block.setColumns(std::move(expected_columns));
+
+    nuclm::ProtobufBatchWriter block_writer(table_name, "shard_1", columns_definition, 0, columnar);
+    block_writer.appendBlock(expected_block);
+    ASSERT_EQ(block_writer.getNumberOfRows(), number_of_rows);
+    std::string message = block_writer.finish();
+    ASSERT_EQ(block_writer.getNumberOfRows(), 0);
+    ASSERT_EQ(message, row_writer.finish());
+
+    nucolumnar::aggregator::v1::SQLBatchRequest request;
+    ASSERT_TRUE(request.ParseFromString(message));
+    ASSERT_TRUE(request.has_columnarencoding());
+    ASSERT_EQ(request.columnarencoding().number_of_rows(), number_of_rows);
+    ASSERT_EQ(static_cast<size_t>(request.columnarencoding().columns_size()), columns_definition.size());
+
+    // the stream decoder leaves the columnar encoding to the parsed message.
+    nuclm::SQLBatchRequestStreamDecoder stream_decoder(message.data(), message.size());
+    ASSERT_FALSE(stream_decoder.scanRequest());
+
+    // the columns in the reversed order, for the batch reader to shuffle them back into the table order.
+    nuclm::ColumnTypesAndNamesTableDefinition reversed_definition(columns_definition.rbegin(),
+                                                                  columns_definition.rend());
+    nuclm::ProtobufBatchWriter reversed_writer(table_name, "shard_1", reversed_definition, 0, columnar);
+    reversed_writer.appendBlock(expected_block);
+    std::string reversed_message = reversed_writer.finish();
+
+    nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+        std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+    for (const std::string* encoded : {&message, &reversed_message}) {
+        DB::Block block_holder = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+        // twice, for the second batch to be appended after the rows of the first one.
+        for (size_t round = 0; round < 2; round++) {
+            nuclm::ProtobufBatchReader reader(*encoded, schema_tracker, block_holder, context);
+            ASSERT_TRUE(reader.read());
+        }
+        ASSERT_EQ(block_holder.rows(), 2 * number_of_rows);
+        ASSERT_EQ(block_holder.dumpStructure(), expected_block.dumpStructure());
+        for (size_t cindex = 0; cindex < block_holder.columns(); cindex++) {
+            const DB::IColumn& column = *block_holder.getByPosition(cindex).column;
+            const DB::IColumn& expected_column = *expected_block.getByPosition(cindex).column;
+            for (size_t row = 0; row < 2 * number_of_rows; row++) {
+                ASSERT_EQ(column.compareAt(row, row % number_of_rows, expected_column, 1), 0)
+                    << "column: " << block_holder.getByPosition(cindex).name << " row: " << row;
+            }
+        }
+    }
+
+    // a column short of a value fails the message, with the rows decoded so far rolled back.
+    request.mutable_columnarencoding()->mutable_columns(1)->mutable_long_values()->RemoveLast();
+    std::string malformed_message = request.SerializeAsString();
+    DB::Block block_holder = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+    {
+        nuclm::ProtobufBatchReader reader(message, schema_tracker, block_holder, context);
+        ASSERT_TRUE(reader.read());
+    }
+    nuclm::ProtobufBatchReader malformed_reader(malformed_message, schema_tracker, block_holder, context);
+    ASSERT_THROW(malformed_reader.read(), DB::Exception);
+    ASSERT_EQ(block_holder.rows(), number_of_rows);
+    for (size_t cindex = 0; cindex < block_holder.columns(); cindex++) {
+        ASSERT_EQ(block_holder.getByPosition(cindex).column->size(), number_of_rows);
+    }
+}
+
+TEST_F(AggregatorProtobufReaderRelatedTest, testColumnarEncodingWithMismatchedColumnsRejected) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorProtobufReaderRelatedTest::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorProtobufReaderRelatedTest::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "columnar_encoding_mismatched_tst";
+    nuclm::TableColumnsDescription table_definition(table_name);
+    for (const auto& column : getBatchWriterColumns()) {
+        table_definition.addColumnDescription(nuclm::TableColumnDescription(column.first, column.second));
+    }
+    nuclm::ColumnTypesAndNamesTableDefinition columns_definition =
+        table_definition.getFullColumnTypesAndNamesDefinition();
+    size_t number_of_rows = 10;
+
+    nuclm::ProtobufBatchWriter writer(table_name, "shard_1", columns_definition, 0,
+                                      nuclm::ProtobufBatchWriter::Encoding::COLUMNAR);
+    for (size_t row = 0; row < number_of_rows; row++) {
+        writer.appendRow(buildBatchWriterRow(row));
+    }
+    nucolumnar::aggregator::v1::SQLBatchRequest request;
+    ASSERT_TRUE(request.ParseFromString(writer.finish()));
+
+    // the batch with the rows but without any column.
+    nucolumnar::aggregator::v1::SQLBatchRequest empty_request = request;
+    empty_request.mutable_columnarencoding()->clear_columns();
+
+    // the batch with its first column carried twice, thus with more columns than the table has.
+    nucolumnar::aggregator::v1::SQLBatchRequest mismatched_request = request;
+    *mismatched_request.mutable_columnarencoding()->add_columns() = request.columnarencoding().columns(0);
+
+    nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+        std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+    for (const auto* malformed_request : {&empty_request, &mismatched_request}) {
+        std::string malformed_message = malformed_request->SerializeAsString();
+        DB::Block block_holder = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+        nuclm::ProtobufBatchReader reader(malformed_message, schema_tracker, block_holder, context);
+        ASSERT_THROW(reader.read(), DB::Exception);
+        ASSERT_EQ(block_holder.rows(), 0);
+        for (size_t cindex = 0; cindex < block_holder.columns(); cindex++) {
+            ASSERT_EQ(block_holder.getByPosition(cindex).column->size(), 0);
+        }
+    }
+}
+
+/**
+ * Not a correctness test, but a benchmark of the columnar encoding against the nucolumnar encoding of the same rows,
+ * with the encoded bytes per row and the decode time per row logged for the comparison. Disabled by default, and to be
+ * run with --gtest_also_run_disabled_tests.
+ */
+TEST_F(AggregatorProtobufReaderRelatedTest, DISABLED_benchmarkColumnarVersusNucolumnarEncoding) {
+    std::string path = getConfigFilePath("example_aggregator_config.json");
+    DB::ContextMutablePtr context = AggregatorProtobufReaderRelatedTest::shared_context->getContext();
+    boost::asio::io_context& ioc = AggregatorProtobufReaderRelatedTest::shared_context->getIOContext();
+    SETTINGS_FACTORY.load(path); // force to load the configuration setting as the global instance.
+    nuclm::AggregatorLoaderManager manager(context, ioc);
+
+    std::string table_name = "columnar_encoding_tst";
+    nuclm::TableColumnsDescription table_definition(table_name);
+    for (const auto& column : getBatchWriterColumns()) {
+        table_definition.addColumnDescription(nuclm::TableColumnDescription(column.first, column.second));
+    }
+    nuclm::ColumnTypesAndNamesTableDefinition columns_definition =
+        table_definition.getFullColumnTypesAndNamesDefinition();
+    size_t number_of_rows = 10000;
+    size_t number_of_messages = 20;
+
+    DB::Block block = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+    DB::MutableColumns columns = block.cloneEmptyColumns();
+    for (size_t row = 0; row < number_of_rows; row++) {
+        std::vector<DB::Field> values = buildBatchWriterRow(row);
+        for (size_t cindex = 0; cindex < values.size(); cindex++) {
+            columns[cindex]->insert(values[cindex]);
+        }
+    }
+    block.setColumns(std::move(columns));
+
+    for (auto encoding : {nuclm::ProtobufBatchWriter::Encoding::NUCOLUMNAR,
+                          nuclm::ProtobufBatchWriter::Encoding::COLUMNAR}) {
+        nuclm::ProtobufBatchWriter writer(table_name, "shard_1", columns_definition, 0, encoding);
+        writer.appendBlock(block);
+        std::string message = writer.finish();
+        DB::Block block_holder = nuclm::SerializationHelper::getBlockDefinition(columns_definition);
+        nuclm::TableSchemaUpdateTrackerPtr schema_tracker =
+            std::make_shared<nuclm::TableSchemaUpdateTracker>(table_name, table_definition, manager);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < number_of_messages; i++) {
+            nuclm::ProtobufBatchReader batch_reader(message, schema_tracker, block_holder, context);
+            ASSERT_TRUE(batch_reader.read());
+        }
+        auto elapsed_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        ASSERT_EQ(block_holder.rows(), number_of_rows * number_of_messages);
+        bool columnar = (encoding == nuclm::ProtobufBatchWriter::Encoding::COLUMNAR);
+        LOG(INFO) << (columnar ? "columnar" : "nucolumnar") << " encoding with rows: " << number_of_rows
+                  << " takes bytes per row: " << static_cast<double>(message.size()) / number_of_rows
+                  << " and decode time per row (ns): " << elapsed_ns / (number_of_rows * number_of_messages);
+    }
+}
+
 // Call RUN_ALL_TESTS() in main()
 int main(int argc, char** argv) {
 
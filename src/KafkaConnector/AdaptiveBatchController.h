@@ -0,0 +1,118 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace kafka {
+
+/**
+ * It tunes the budgets of the kafka batch, in messages, in bytes and in the fetch timeout, toward a target latency of
+ * the kafka connector main loop, out of what is observed at each iteration of the loop:
+ *
+ * 1) Under backlog, which is a batch filling up its budget with the consumer lag beyond the message budget, the
+ * budgets are resized to what the observed decode cost per message and per byte allows within the target latency, so
+ * that the batches become as large as the target latency permits.
+ *
+ * 2) When the loop takes longer than the target latency, the budgets are resized down in the same way. If the flush
+ * of the buffers alone takes the whole target latency, which happens when the backend is slow, the budgets are halved.
+ *
+ * 3) When the topic is caught up, the budgets are kept, and the fetch timeout is shortened to what is left of the
+ * target latency after the processing, so that the messages get flushed without waiting for a batch to fill up.
+ *
+ * Each resizing is bounded within [half, double] of the current budget, for the budgets not to swing on a single
+ * outlier. The budgets are read by the fetch stage and updated by the process stage, which can be different threads.
+ */
+class AdaptiveBatchController {
+  public:
+    struct Budget {
+        size_t messages;
+        size_t bytes;
+        int64_t timeout_ms;
+    };
+
+    AdaptiveBatchController(size_t min_messages_, size_t max_messages_, size_t min_bytes_, size_t max_bytes_,
+                            int64_t min_timeout_ms_, int64_t max_timeout_ms_, int64_t target_latency_ms_) :
+            min_messages(std::max<size_t>(1, std::min(min_messages_, max_messages_))),
+            max_messages(std::max<size_t>(1, max_messages_)),
+            min_bytes(std::max<size_t>(1, std::min(min_bytes_, max_bytes_))),
+            max_bytes(std::max<size_t>(1, max_bytes_)),
+            min_timeout_ms(std::max<int64_t>(1, std::min(min_timeout_ms_, max_timeout_ms_))),
+            max_timeout_ms(std::max<int64_t>(1, max_timeout_ms_)),
+            target_latency_us(std::max<int64_t>(1, target_latency_ms_) * 1000) {
+        // Start from the smallest batches, and grow to the backlog if there is one.
+        budget = {min_messages, min_bytes, max_timeout_ms};
+    }
+
+    Budget getBudget() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return budget;
+    }
+
+    /**
+     * To update the budgets from the batch just processed. consumer_lag is -1 when it is not known, and
+     * flush_wait_us is the part of process_time_us spent in flushing the buffers and committing the metadata.
+     */
+    void update(size_t batch_messages, size_t batch_bytes, int64_t consumer_lag, uint64_t process_time_us,
+                uint64_t flush_wait_us) {
+        std::lock_guard<std::mutex> lck(mtx);
+        bool filled = batch_messages >= budget.messages || batch_bytes >= budget.bytes;
+        bool backlog = filled && (consumer_lag < 0 || consumer_lag >= static_cast<int64_t>(budget.messages));
+        bool too_slow = static_cast<int64_t>(process_time_us) > target_latency_us;
+
+        if (too_slow && static_cast<int64_t>(flush_wait_us) >= target_latency_us) {
+            budget.messages = std::max(min_messages, budget.messages / 2);
+            budget.bytes = std::max(min_bytes, budget.bytes / 2);
+        } else if ((backlog || too_slow) && batch_messages > 0) {
+            // The decode cost of the batch, with a floor to not divide by 0 on a tiny batch.
+            uint64_t decode_us = std::max<uint64_t>(1, process_time_us - std::min(process_time_us, flush_wait_us));
+            uint64_t allowed_us = target_latency_us - std::min<uint64_t>(target_latency_us, flush_wait_us);
+            budget.messages = resize(budget.messages, batch_messages * allowed_us / decode_us, min_messages,
+                                     max_messages);
+            budget.bytes = resize(budget.bytes, batch_bytes * allowed_us / decode_us, min_bytes, max_bytes);
+        }
+
+        if (backlog) {
+            budget.timeout_ms = max_timeout_ms;
+        } else {
+            int64_t left_ms = (target_latency_us - static_cast<int64_t>(process_time_us)) / 1000;
+            budget.timeout_ms = std::clamp(left_ms, min_timeout_ms, max_timeout_ms);
+        }
+    }
+
+  private:
+    static size_t resize(size_t current, uint64_t estimated, size_t lower, size_t upper) {
+        size_t bounded = std::clamp<uint64_t>(estimated, current / 2, current * 2);
+        return std::clamp(bounded, lower, upper);
+    }
+
+    const size_t min_messages;
+    const size_t max_messages;
+    const size_t min_bytes;
+    const size_t max_bytes;
+    const int64_t min_timeout_ms;
+    const int64_t max_timeout_ms;
+    const int64_t target_latency_us;
+
+    Budget budget;
+    std::mutex mtx;
+};
+
+} // namespace kafka
@@ -0,0 +1,138 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include "BackPressureController.h"
+#include "KafkaConnector.h"
+
+#include "common/logging.hpp"
+#include "common/settings_factory.hpp"
+#include "monitor/metrics_collector.hpp"
+
+#include <string>
+#include <vector>
+
+#define BACK_PRESSURE_ID(id) "KafkaConnector [" << id << "]: BackPressureController: "
+
+namespace kafka {
+
+void BackPressureController::reportResumed(const PausedPartition& paused, const std::string& var_topic,
+                                           const std::string& var_zone) {
+    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+    uint64_t time_diff =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - paused.since).count();
+    kafkaconnector_metrics->partition_pause_time_by_back_pressure
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}, {"reason", getBackPressureReasonName(paused.reason)}})
+        .observe(time_diff);
+    LOG_KAFKA(2) << BACK_PRESSURE_ID(kafkaConnector->getId()) << "Resuming partition ["
+                 << paused.partitionHandler->getPartitionId() << "] after being paused for " << time_diff
+                 << " (us) due to " << getBackPressureReasonName(paused.reason);
+}
+
+void BackPressureController::update(
+    RdKafka::KafkaConsumer* consumer,
+    const std::unordered_map<int, std::shared_ptr<PartitionHandler>>& partition_handlers) {
+    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+    auto [var_zone, var_topic] = with_settings([this](SETTINGS s) {
+        size_t idx = kafkaConnector->getId();
+        auto& var = s.config.kafka.configVariants[idx];
+        return std::make_tuple(var.zone, var.topic);
+    });
+
+    std::vector<RdKafka::TopicPartition*> to_resume;
+    for (auto it = pausedPartitions.begin(); it != pausedPartitions.end();) {
+        auto handler_it = partition_handlers.find(it->first);
+        bool same_handler = handler_it != partition_handlers.end() && handler_it->second == it->second.partitionHandler;
+        if (same_handler && handler_it->second->getBackPressure() != NO_BACK_PRESSURE) {
+            it++;
+            continue;
+        }
+        // A revoked partition is resumed as well, so that the pause does not outlive the assignment.
+        reportResumed(it->second, var_topic, var_zone);
+        to_resume.push_back(RdKafka::TopicPartition::create(it->second.partitionHandler->getTopic(), it->first));
+        it = pausedPartitions.erase(it);
+    }
+
+    std::vector<RdKafka::TopicPartition*> to_pause;
+    auto now = std::chrono::steady_clock::now();
+    for (auto& entry : partition_handlers) {
+        BackPressureReason reason = entry.second->getBackPressure();
+        if (reason == NO_BACK_PRESSURE || pausedPartitions.find(entry.first) != pausedPartitions.end())
+            continue;
+        LOG_KAFKA(2) << BACK_PRESSURE_ID(kafkaConnector->getId()) << "Pausing partition [" << entry.first
+                     << "] due to " << getBackPressureReasonName(reason);
+        pausedPartitions.emplace(entry.first, PausedPartition{entry.second, reason, now});
+        to_pause.push_back(RdKafka::TopicPartition::create(entry.second->getTopic(), entry.first));
+    }
+
+    if (!to_resume.empty()) {
+        // The error of a revoked partition is expected, as the partition is no longer assigned to the consumer.
+        RdKafka::ErrorCode err = consumer->resume(to_resume);
+        if (err != RdKafka::ERR_NO_ERROR) {
+            LOG_KAFKA(1) << BACK_PRESSURE_ID(kafkaConnector->getId())
+                         << "Failed to resume partitions: " << RdKafka::err2str(err);
+        }
+        RdKafka::TopicPartition::destroy(to_resume);
+    }
+
+    if (!to_pause.empty()) {
+        RdKafka::ErrorCode err = consumer->pause(to_pause);
+        for (auto toppar : to_pause) {
+            RdKafka::ErrorCode partition_err = err != RdKafka::ERR_NO_ERROR ? err : toppar->err();
+            auto it = pausedPartitions.find(toppar->partition());
+            if (partition_err != RdKafka::ERR_NO_ERROR) {
+                // The partition keeps being consumed, and the pause is attempted again at the next update.
+                LOG(WARNING) << BACK_PRESSURE_ID(kafkaConnector->getId()) << "Failed to pause partition ["
+                             << toppar->partition() << "]: " << RdKafka::err2str(partition_err);
+                pausedPartitions.erase(it);
+                continue;
+            }
+            kafkaconnector_metrics->partition_paused_by_back_pressure_total
+                ->labels({{"on_topic", var_topic},
+                          {"on_zone", var_zone},
+                          {"reason", getBackPressureReasonName(it->second.reason)}})
+                .increment();
+        }
+        RdKafka::TopicPartition::destroy(to_pause);
+    }
+
+    kafkaconnector_metrics->partitions_paused_in_kafka_connector
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+        .update(pausedPartitions.size());
+}
+
+void BackPressureController::clear() {
+    if (pausedPartitions.empty())
+        return;
+
+    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+    auto [var_zone, var_topic] = with_settings([this](SETTINGS s) {
+        size_t idx = kafkaConnector->getId();
+        auto& var = s.config.kafka.configVariants[idx];
+        return std::make_tuple(var.zone, var.topic);
+    });
+    for (auto& entry : pausedPartitions) {
+        reportResumed(entry.second, var_topic, var_zone);
+    }
+    pausedPartitions.clear();
+    kafkaconnector_metrics->partitions_paused_in_kafka_connector
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+        .update(0);
+}
+
+} // namespace kafka
@@ -0,0 +1,70 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include "PartitionHandler.h"
+
+#include <librdkafka/rdkafkacpp.h>
+
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+
+namespace kafka {
+
+class KafkaConnector;
+
+/**
+ * It pauses the fetching of the partitions that report back-pressure at their last buffer check, which happens when a
+ * table of the partition has reached its in-flight limit of flush tasks while its buffer is ready to be flushed again.
+ * A paused partition gets resumed once its back-pressure is gone. In the meantime the consumer keeps polling, so that
+ * the other partitions keep being consumed, and the consumer stays well within max.poll.interval.ms when the backend
+ * is slow. Resuming a partition continues from the last message handed to the kafka connector, and thus no message is
+ * lost or duplicated by the pause.
+ */
+class BackPressureController {
+  public:
+    explicit BackPressureController(KafkaConnector* kafkaConnector_) : kafkaConnector(kafkaConnector_) {}
+    ~BackPressureController() = default;
+
+    /**
+     * To pause the partitions that report back-pressure, and to resume the paused partitions whose back-pressure is
+     * gone, or whose partition handlers got revoked or replaced since being paused. Invoked by the kafka connector
+     * thread, after the buffers of all of the partitions are checked.
+     */
+    void update(RdKafka::KafkaConsumer* consumer,
+                const std::unordered_map<int, std::shared_ptr<PartitionHandler>>& partition_handlers);
+
+    // To forget the paused partitions, as the consumer holding the pause state is to be closed.
+    void clear();
+
+  private:
+    struct PausedPartition {
+        // the partition handler that the partition is paused under.
+        std::shared_ptr<PartitionHandler> partitionHandler;
+        BackPressureReason reason;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    void reportResumed(const PausedPartition& paused, const std::string& var_topic, const std::string& var_zone);
+
+    std::unordered_map<int, PausedPartition> pausedPartitions; // partition --> pause state
+
+    KafkaConnector* kafkaConnector;
+};
+
+} // namespace kafka
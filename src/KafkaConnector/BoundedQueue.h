@@ -0,0 +1,102 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace kafka {
+
+/**
+ * A blocking FIFO queue with a fixed capacity, used to hand items over from one pipeline stage to the next. The
+ * producer blocks while the queue is full and the consumer blocks while the queue is empty, so that a slow stage
+ * back-pressures the stage in front of it. Once closed, push fails right away, and pop drains the remaining items
+ * before it fails.
+ */
+template <typename T> class BoundedQueue {
+  public:
+    explicit BoundedQueue(size_t capacity_) : capacity(capacity_ > 0 ? capacity_ : 1), closed(false) {}
+    ~BoundedQueue() = default;
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Return false if the queue got closed, with the item not being queued.
+    bool push(T&& item) {
+        std::unique_lock<std::mutex> lck(mtx);
+        not_full.wait(lck, [this] { return closed || items.size() < capacity; });
+        if (closed)
+            return false;
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    // Return false if the queue got closed and there is no item left.
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lck(mtx);
+        not_empty.wait(lck, [this] { return closed || !items.empty(); });
+        if (items.empty())
+            return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    // To wake up the both sides, with the remaining items left for pop or clear.
+    void close() {
+        std::lock_guard<std::mutex> lck(mtx);
+        closed = true;
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lck(mtx);
+        items.clear();
+        not_full.notify_all();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return items.size();
+    }
+
+    bool full() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return items.size() >= capacity;
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return items.empty();
+    }
+
+  private:
+    const size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mtx;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+};
+
+} // namespace kafka
@@ -0,0 +1,281 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include "CommitCoordinator.h"
+#include "KafkaConnector.h"
+#include "RebalanceCb.h"
+
+#include "common/logging.hpp"
+#include "common/settings_factory.hpp"
+#include "monitor/metrics_collector.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <string>
+
+#ifdef _PRERELEASE
+#include <flip/flip.hpp>
+#endif
+
+#define COMMIT_ID(id) "KafkaConnector [" << id << "]: CommitCoordinator: "
+
+namespace kafka {
+
+void CommitCoordinator::add(const std::shared_ptr<PartitionHandler>& partition_handler) {
+    std::lock_guard<std::mutex> lck(mtx);
+    partitionHandlers.push_back(partition_handler);
+}
+
+void CommitCoordinator::open(rd_kafka_t* rk) {
+    std::lock_guard<std::mutex> lck(mtx);
+    commitQueue = rd_kafka_queue_new(rk);
+}
+
+void CommitCoordinator::close() {
+    std::lock_guard<std::mutex> lck(mtx);
+    failAll();
+    if (commitQueue != nullptr) {
+        rd_kafka_queue_destroy(commitQueue);
+        commitQueue = nullptr;
+    }
+}
+
+void CommitCoordinator::clear() {
+    std::lock_guard<std::mutex> lck(mtx);
+    failAll();
+}
+
+void CommitCoordinator::failAll() {
+    for (auto& partition_handler : partitionHandlers) {
+        partition_handler->onMetadataCommitFailed();
+    }
+    for (auto& entry : inFlightCommits) {
+        entry.second.partitionHandler->onMetadataCommitFailed();
+    }
+    for (auto& entry : retryCommits) {
+        entry.second.partitionHandler->onMetadataCommitFailed();
+    }
+    partitionHandlers.clear();
+    inFlightCommits.clear();
+    retryCommits.clear();
+    finallyFailed = false;
+}
+
+void CommitCoordinator::dropRevoked(
+    const std::unordered_map<int, std::shared_ptr<PartitionHandler>>& current_handlers) {
+    std::lock_guard<std::mutex> lck(mtx);
+    auto revoked = [this, &current_handlers](const std::shared_ptr<PartitionHandler>& partition_handler) {
+        auto it = current_handlers.find(partition_handler->getPartitionId());
+        if (it != current_handlers.end() && it->second == partition_handler)
+            return false;
+        LOG(WARNING) << COMMIT_ID(kafkaConnector->getId()) << "Partition [" << partition_handler->getPartitionId()
+                     << "] got revoked before its metadata is committed, dropping its flush";
+        partition_handler->onMetadataCommitFailed();
+        return true;
+    };
+    partitionHandlers.erase(std::remove_if(partitionHandlers.begin(), partitionHandlers.end(), revoked),
+                            partitionHandlers.end());
+    for (auto it = inFlightCommits.begin(); it != inFlightCommits.end();) {
+        it = revoked(it->second.partitionHandler) ? inFlightCommits.erase(it) : std::next(it);
+    }
+    for (auto it = retryCommits.begin(); it != retryCommits.end();) {
+        it = revoked(it->second.partitionHandler) ? retryCommits.erase(it) : std::next(it);
+    }
+}
+
+void CommitCoordinator::offset_commit_cb(rd_kafka_t* rk, rd_kafka_resp_err_t err,
+                                         rd_kafka_topic_partition_list_t* offsets, void* opaque) {
+    CommitCoordinator* coordinator = static_cast<CommitCoordinator*>(opaque);
+    if (offsets == nullptr) {
+        LOG(WARNING) << COMMIT_ID(coordinator->kafkaConnector->getId())
+                     << "Metadata commit acknowledged without partitions: " << rd_kafka_err2str(err);
+        return;
+    }
+    coordinator->onCommitResults(err, offsets);
+}
+
+void CommitCoordinator::onCommitResults(rd_kafka_resp_err_t err, const rd_kafka_topic_partition_list_t* offsets) {
+    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+    auto [var_zone, var_topic] = with_settings([this](SETTINGS s) {
+        size_t idx = kafkaConnector->getId();
+        auto& var = s.config.kafka.configVariants[idx];
+        return std::make_tuple(var.zone, var.topic);
+    });
+    auto [max_number_of_kafka_commit_metadata_retries, kafka_commit_metadata_max_retry_delay_ms,
+          kafka_commit_metadata_initial_retry_delay_ms] = with_settings([](SETTINGS s) {
+        return std::make_tuple(s.config.kafka.consumerConf.max_number_of_kafka_commit_metadata_retries,
+                               s.config.kafka.consumerConf.kafka_commit_metadata_max_retry_delay_ms,
+                               s.config.kafka.consumerConf.kafka_commit_metadata_initial_retry_delay_ms);
+    });
+#ifdef _PRERELEASE
+    if (flip::Flip::instance().test_flip("[kafka-commit-error]")) {
+        LOG(INFO) << COMMIT_ID(kafkaConnector->getId()) << "[kafka-commit-error]: simulate kafka commit error";
+        err = rd_kafka_resp_err_t::RD_KAFKA_RESP_ERR_LISTENER_NOT_FOUND;
+    }
+#endif
+
+    auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < offsets->cnt; i++) {
+        const rd_kafka_topic_partition_t& toppar = offsets->elems[i];
+        auto it = inFlightCommits.find(TopicPartition(toppar.topic, toppar.partition));
+        if (it == inFlightCommits.end())
+            continue; // dropped after being sent, as the partition got revoked or the main loop is restarted.
+        InFlightCommit& in_flight = it->second;
+        std::string metadata = (toppar.metadata == nullptr)
+            ? in_flight.metadata
+            : std::string((char*)toppar.metadata, toppar.metadata_size);
+        if (toppar.offset != in_flight.offset || metadata != in_flight.metadata) {
+            LOG_KAFKA(3) << COMMIT_ID(kafkaConnector->getId()) << "Ignore the acknowledgement of an earlier commit of "
+                         << "partition [" << toppar.partition << "] at offset: " << toppar.offset;
+            continue;
+        }
+
+        kafkaconnector_metrics->commit_time_for_offset_commit_by_kafka_connectors
+            ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+            .observe(std::chrono::duration_cast<std::chrono::microseconds>(now - in_flight.sentAt).count());
+
+        // the request level error applies to all of the partitions in the request.
+        rd_kafka_resp_err_t partition_err = err ? err : toppar.err;
+        if (!partition_err) {
+            kafkaconnector_metrics->committed_offset_by_kafka_connector
+                ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+                .update(in_flight.offset);
+            in_flight.partitionHandler->onMetadataCommitted(in_flight.offset, in_flight.metadata);
+        } else {
+            LOG(ERROR) << COMMIT_ID(kafkaConnector->getId()) << "Error in committing metadata of partition ["
+                       << toppar.partition << "]: " << rd_kafka_err2str(partition_err)
+                       << " for metadata: " << in_flight.metadata;
+            kafkaconnector_metrics->commit_offset_by_kafka_connectors_failed_total
+                ->labels({{"on_topic", var_topic},
+                          {"on_zone", var_zone},
+                          {"error_code", std::to_string(static_cast<int>(partition_err))}})
+                .increment();
+            if (in_flight.attempts >= max_number_of_kafka_commit_metadata_retries) {
+                LOG(ERROR) << COMMIT_ID(kafkaConnector->getId())
+                           << "Number of retries exceeded the maximum number of retries for partition ["
+                           << toppar.partition << "]. Returning failure now.";
+                in_flight.partitionHandler->onMetadataCommitFailed();
+                kafkaconnector_metrics->kafka_commit_metadata_finally_failed_total
+                    ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+                    .increment();
+                finallyFailed = true;
+            } else {
+                // The flush tasks of the failed commit stay with the partition handler, and the retried commit covers
+                // them along with the ones flushed since.
+                int delay_time = std::min(in_flight.attempts * kafka_commit_metadata_initial_retry_delay_ms,
+                                          kafka_commit_metadata_max_retry_delay_ms);
+                LOG(ERROR) << COMMIT_ID(kafkaConnector->getId()) << "Retry to commit metadata of partition ["
+                           << toppar.partition << "] after " << delay_time << " (ms).";
+                retryCommits[it->first] = RetryCommit{in_flight.partitionHandler, in_flight.attempts,
+                                                      now + std::chrono::milliseconds(delay_time)};
+            }
+        }
+        inFlightCommits.erase(it);
+    }
+}
+
+void CommitCoordinator::checkCommittedMetadata(rd_kafka_t* rk,
+                                               const std::vector<std::shared_ptr<PartitionHandler>>& to_commit) {
+    auto toppar_to_check = rd_kafka_topic_partition_list_new(to_commit.size());
+    for (auto& partition_handler : to_commit) {
+        rd_kafka_topic_partition_list_add(toppar_to_check, partition_handler->getTopic().c_str(),
+                                          partition_handler->getPartitionId());
+    }
+
+    // A single request for the committed metadata of all of the partitions.
+    auto committed_toppar = RebalanceHandler::get_committed_metadata(toppar_to_check, rk);
+    rd_kafka_topic_partition_list_destroy(toppar_to_check);
+    if (committed_toppar == nullptr)
+        return;
+
+    for (auto& partition_handler : to_commit) {
+        auto committed = rd_kafka_topic_partition_list_find(
+            committed_toppar, partition_handler->getTopic().c_str(), partition_handler->getPartitionId());
+        if (committed != nullptr) {
+            partition_handler->checkCommittedMetadata(committed);
+        }
+    }
+    rd_kafka_topic_partition_list_destroy(committed_toppar);
+}
+
+KafkaConnectorError CommitCoordinator::commit(rd_kafka_t* rk) {
+    std::lock_guard<std::mutex> lck(mtx);
+    // The acknowledgements arrived since the last commit get their partitions' flush tasks launched, or their
+    // partitions scheduled for a retry.
+    if (commitQueue != nullptr) {
+        rd_kafka_queue_poll_callback(commitQueue, 0);
+    }
+
+    // The partitions to commit now are the added ones and the ones due for a retry. An added partition with its commit
+    // still in flight, or with its retry not due yet, is deferred to a later iteration.
+    auto now = std::chrono::steady_clock::now();
+    std::map<TopicPartition, std::pair<std::shared_ptr<PartitionHandler>, uint32_t>> to_commit;
+    std::vector<std::shared_ptr<PartitionHandler>> deferred;
+    for (auto& partition_handler : partitionHandlers) {
+        TopicPartition key(partition_handler->getTopic(), partition_handler->getPartitionId());
+        auto retry = retryCommits.find(key);
+        if (inFlightCommits.count(key) > 0 || (retry != retryCommits.end() && retry->second.retryAt > now)) {
+            if (std::find(deferred.begin(), deferred.end(), partition_handler) == deferred.end())
+                deferred.push_back(partition_handler);
+        } else {
+            to_commit.emplace(key, std::make_pair(partition_handler, 0U));
+        }
+    }
+    partitionHandlers.swap(deferred);
+    for (auto it = retryCommits.begin(); it != retryCommits.end();) {
+        if (it->second.retryAt > now) {
+            ++it;
+            continue;
+        }
+        to_commit[it->first] = std::make_pair(it->second.partitionHandler, it->second.attempts);
+        it = retryCommits.erase(it);
+    }
+
+    if (!to_commit.empty()) {
+        std::vector<std::shared_ptr<PartitionHandler>> handlers_to_commit;
+        for (auto& entry : to_commit) {
+            handlers_to_commit.push_back(entry.second.first);
+        }
+        checkCommittedMetadata(rk, handlers_to_commit);
+
+        auto toppar_to_commit = rd_kafka_topic_partition_list_new(to_commit.size());
+        for (auto& entry : to_commit) {
+            auto& partition_handler = entry.second.first;
+            partition_handler->addToCommitList(toppar_to_commit);
+            auto toppar =
+                rd_kafka_topic_partition_list_find(toppar_to_commit, entry.first.first.c_str(), entry.first.second);
+            inFlightCommits[entry.first] =
+                InFlightCommit{partition_handler, toppar->offset,
+                               std::string((char*)toppar->metadata, toppar->metadata_size), entry.second.second + 1,
+                               now};
+        }
+
+        // The result of each partition is delivered to offset_commit_cb when the commit queue is served, from the
+        // commit of a later iteration.
+        rd_kafka_resp_err_t err = rd_kafka_commit_queue(rk, toppar_to_commit, commitQueue, offset_commit_cb, this);
+        if (err) {
+            // the request is not sent, with all of its partitions failed at once.
+            onCommitResults(err, toppar_to_commit);
+        }
+        rd_kafka_topic_partition_list_destroy(toppar_to_commit);
+    }
+
+    return finallyFailed ? KafkaConnectorError::KAFKA_ERROR : KafkaConnectorError::NO_ERROR;
+}
+
+} // namespace kafka
@@ -0,0 +1,118 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include "PartitionHandler.h"
+
+#include <librdkafka/rdkafka.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kafka {
+
+class KafkaConnector;
+
+/**
+ * It gathers the partitions whose buffers got flushed in one iteration of the kafka connector main loop, and commits
+ * the metadata of all of these partitions to Kafka with a single asynchronous commit request on its own commit queue.
+ * The commit queue is served by the main loop at the start of each commit, and the offset commit callback delivers the
+ * result of each partition to its partition handler, which launches its flush tasks only after its own metadata commit
+ * is acknowledged, so that the exactly-once guarantee is preserved.
+ *
+ * A partition has at most one commit in flight. A partition flushed again before the acknowledgement is deferred to
+ * the iteration after it, with the metadata committed then covering the flush tasks of both. A failed partition is
+ * retried from a later iteration once its retry delay passes, rather than the main loop sleeping on it.
+ */
+class CommitCoordinator {
+  public:
+    explicit CommitCoordinator(KafkaConnector* kafkaConnector_) : kafkaConnector(kafkaConnector_) {}
+    ~CommitCoordinator() = default;
+
+    // Thread-safe, as the partitions can be processed in parallel.
+    void add(const std::shared_ptr<PartitionHandler>& partition_handler);
+
+    bool empty() const { return partitionHandlers.empty() && inFlightCommits.empty() && retryCommits.empty(); }
+
+    // To create the commit queue of the consumer, invoked once the consumer is created.
+    void open(rd_kafka_t* rk);
+    // To drop all of the partitions, and to destroy the commit queue, invoked before the consumer is closed.
+    void close();
+
+    // To drop the added partitions, the partitions with a commit in flight and the ones waiting for a retry, with their
+    // flush tasks never launched. The acknowledgements still to come for the dropped commits are ignored.
+    void clear();
+
+    // To drop the partitions whose handlers are no longer the current ones, as they got revoked after being added,
+    // with their flush tasks never launched.
+    void dropRevoked(const std::unordered_map<int, std::shared_ptr<PartitionHandler>>& current_handlers);
+
+    /**
+     * To serve the acknowledgements that have arrived on the commit queue, and then to send a single commit request for
+     * the added partitions and the failed partitions due for a retry, without waiting for it. Each partition handler
+     * gets notified on its own commit result from a later call. Return KAFKA_ERROR if any of the partitions failed
+     * after the maximum number of retries.
+     */
+    KafkaConnectorError commit(rd_kafka_t* rk);
+
+  private:
+    using TopicPartition = std::pair<std::string, int32_t>;
+
+    struct InFlightCommit {
+        std::shared_ptr<PartitionHandler> partitionHandler;
+        int64_t offset;
+        std::string metadata;
+        uint32_t attempts; // the number of the commits sent for the partition so far, this one included
+        std::chrono::steady_clock::time_point sentAt;
+    };
+
+    struct RetryCommit {
+        std::shared_ptr<PartitionHandler> partitionHandler;
+        uint32_t attempts; // the number of the commits failed so far
+        std::chrono::steady_clock::time_point retryAt;
+    };
+
+    // topic and partition --> commit result, of the partitions in an acknowledgement.
+    using CommitResults = std::map<TopicPartition, rd_kafka_resp_err_t>;
+
+    // Served from commit() with mtx held, as the commit queue is only served there.
+    static void offset_commit_cb(rd_kafka_t* rk, rd_kafka_resp_err_t err, rd_kafka_topic_partition_list_t* offsets,
+                                 void* opaque);
+    void onCommitResults(const CommitResults& results, const rd_kafka_topic_partition_list_t* offsets);
+
+    void checkCommittedMetadata(rd_kafka_t* rk, const std::vector<std::shared_ptr<PartitionHandler>>& to_commit);
+    void failAll();
+
+    // the partitions added since the last commit, along with the ones deferred behind their commits in flight.
+    std::vector<std::shared_ptr<PartitionHandler>> partitionHandlers;
+    std::map<TopicPartition, InFlightCommit> inFlightCommits;
+    std::map<TopicPartition, RetryCommit> retryCommits;
+    // set by the callback once a partition fails after the maximum number of retries, and returned by commit().
+    bool finallyFailed = false;
+    rd_kafka_queue_t* commitQueue = nullptr;
+    std::mutex mtx;
+
+    KafkaConnector* kafkaConnector;
+};
+
+} // namespace kafka
@@ -159,6 +159,9 @@ void kafka::EventHandler::update_metrics(const std::string& stat_json) {
             kafkaconnector_metrics->librdkafka_topic_consumer_lag
                 ->labels({{"on_zone", zone_}, {"on_topic", topic_name}})
                 .update(topic_consumer_lag);
+            if (topic_name == topic_) {
+                consumer_lag_ = topic_consumer_lag;
+            }
         }
     }
     UPDATE_CONSUMER_METRIC(time);
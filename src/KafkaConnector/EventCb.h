@@ -21,6 +21,8 @@ limitations under the License.
 #include <librdkafka/rdkafkacpp.h>
 #include "../common/settings_factory.hpp"
 
+#include <atomic>
+
 namespace kafka {
 class EventHandler : public RdKafka::EventCb {
   public:
@@ -39,12 +41,16 @@ class EventHandler : public RdKafka::EventCb {
 
     std::string& get_stat() const;
 
+    // The total consumer lag of the topic from the last statistics, being -1 if not known.
+    int64_t get_consumer_lag() const { return consumer_lag_; }
+
   private:
     void update_metrics(const std::string& stat_json);
 
     std::string topic_;
     std::string zone_;
     urcu_data<std::string> stat_;
+    std::atomic<int64_t> consumer_lag_{-1};
 };
 } // namespace kafka
 #endif // NUCOLUMNARAGGR_EVENTCB_H
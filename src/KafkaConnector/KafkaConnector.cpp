@@ -26,11 +26,14 @@ limitations under the License.
 #include <mutex>
 #include <unordered_set>
 
+#include <algorithm>
 #include <cassert>
+#include <exception>
 #include <string>
 #include <set>
 #include <chrono>
 #include <thread>
+#include <tuple>
 
 #ifdef _PRERELEASE
 #include <flip/flip.hpp>
@@ -46,20 +49,37 @@ int64_t now() {
         .count();
 }
 
-KafkaConnectorError KafkaConnector::consumeBatch(size_t batch_size, int64_t batch_timeout) {
+namespace {
+
+// the delay before the first retry in ms, the factor that the delay grows by with each retry, and the errors allowed.
+std::tuple<int, double, int> getConsumeRetrySettings() {
+    return with_settings([](SETTINGS s) {
+        auto& conf = s.config.kafka.consumerConf;
+        return std::make_tuple(static_cast<int>(conf.consume_retry_delay_ms), conf.consume_retry_decay_factor,
+                               static_cast<int>(conf.consume_max_errors));
+    });
+}
+
+} // namespace
+
+KafkaConnectorError KafkaConnector::consumeBatch(size_t batch_size, int64_t batch_timeout, size_t batch_bytes) {
     clearCurrentBatch();
     currentBatch.reserve(batch_size);
 
+    if (consumerQueue != nullptr) {
+        return consumeBatchFromQueue(batch_size, batch_timeout, batch_bytes);
+    }
+
+    size_t current_batch_bytes = 0;
+
     int64_t end = now() + batch_timeout; // convert ms in batch_timeout to nano seconds
     int64_t remaining_timeout = batch_timeout;
 
-    // ToDo: read these from config
-    int delay_in_ms = 50;
-    double decay_factor = 2.5;
-    int max_error = 3;
+    auto [delay_in_ms, decay_factor, max_error] = getConsumeRetrySettings();
 
     int error = 0; // for doing retries
-    while (currentBatch.size() < batch_size && error <= max_error) {
+    while (currentBatch.size() < batch_size && (batch_bytes == 0 || current_batch_bytes < batch_bytes) &&
+           error <= max_error) {
         if (error > 0) {
             int exp_delay_ms = pow(decay_factor, error) * delay_in_ms;
             LOG(INFO) << KCON_ID(getId()) << "Kafka consumer consumeBatch delay for " << exp_delay_ms << " (ms)"
@@ -75,7 +95,8 @@ KafkaConnectorError KafkaConnector::consumeBatch(size_t batch_size, int64_t batc
             break;
 
         case RdKafka::ERR_NO_ERROR:
-            currentBatch.push_back(msg);
+            current_batch_bytes += msg->len();
+            currentBatch.emplace_back(msg);
             error = 0;
             break;
 
@@ -131,11 +152,92 @@ KafkaConnectorError KafkaConnector::consumeBatch(size_t batch_size, int64_t batc
     return KafkaConnectorError::KAFKA_ERROR;
 }
 
+KafkaConnectorError KafkaConnector::consumeBatchFromQueue(size_t batch_size, int64_t batch_timeout,
+                                                          size_t batch_bytes) {
+    int64_t end = now() + batch_timeout;
+    int64_t remaining_timeout = batch_timeout;
+    size_t current_batch_bytes = 0;
+
+    auto [delay_in_ms, decay_factor, max_error] = getConsumeRetrySettings();
+
+    int error = 0; // for doing retries
+    while (currentBatch.size() < batch_size && (batch_bytes == 0 || current_batch_bytes < batch_bytes) &&
+           error <= max_error) {
+        if (error > 0) {
+            int exp_delay_ms = pow(decay_factor, error) * delay_in_ms;
+            LOG(INFO) << KCON_ID(getId()) << "Kafka consumer consumeBatchFromQueue delay for " << exp_delay_ms
+                      << " (ms)"
+                      << " with current error count: " << error;
+            std::this_thread::sleep_for(std::chrono::milliseconds(exp_delay_ms));
+        }
+
+        // The rebalance callback can be invoked from within the queue call, and it clears the current batch at the
+        // partition revocation.
+        size_t messages_to_fetch = std::min(batch_size - currentBatch.size(), fetchedMessages.size());
+        ssize_t number_of_fetched = rd_kafka_consume_batch_queue(
+            consumerQueue, static_cast<int>(remaining_timeout), fetchedMessages.data(), messages_to_fetch);
+        if (number_of_fetched < 0) {
+            LOG(ERROR) << KCON_ID(getId()) << "Kafka rd_kafka_consume_batch_queue() returned error (" << error << "/"
+                       << max_error << "): " << rd_kafka_err2str(rd_kafka_last_error());
+            error++;
+            continue;
+        }
+
+        bool has_error = false;
+        for (ssize_t i = 0; i < number_of_fetched; i++) {
+            rd_kafka_message_t* rkmessage = fetchedMessages[i];
+            if (rkmessage->err != RD_KAFKA_RESP_ERR_NO_ERROR) {
+                LOG(ERROR) << KCON_ID(getId()) << "Kafka rd_kafka_consume_batch_queue() returned error (" << error
+                           << "/" << max_error << "): " << rd_kafka_message_errstr(rkmessage);
+                has_error = true;
+                rd_kafka_message_destroy(rkmessage);
+            } else if (partitionHandlers.find(rkmessage->partition) == partitionHandlers.end()) {
+                // fetched before the partition got revoked by the rebalance callback served in the same call.
+                LOG_KAFKA(3) << KCON_ID(getId()) << "Drop message [" << rkmessage->offset
+                             << "] of the revoked partition: " << rkmessage->partition;
+                rd_kafka_message_destroy(rkmessage);
+            } else {
+                current_batch_bytes += rkmessage->len;
+                currentBatch.emplace_back(rkmessage);
+            }
+        }
+        error = has_error ? error + 1 : 0;
+
+#ifdef _PRERELEASE
+        LOG(INFO) << KCON_ID(getId()) << "Consume " << number_of_fetched
+                  << " messages in consumeBatchFromQueue. CurrentBatch size: " << currentBatch.size();
+
+        if (auto consum_batch_size = flip::Flip::instance().get_test_flip<int>("[consum-batch-size]")) {
+            batch_size = consum_batch_size.get();
+            LOG(INFO) << KCON_ID(getId())
+                      << "In consumeBatchFromQueue, [consum-batch-size]: set kafka connector batch size: "
+                      << batch_size;
+        }
+#endif
+
+        remaining_timeout = end - now();
+        if (remaining_timeout <= 0)
+            break;
+    }
+#ifdef _PRERELEASE
+    if (flip::Flip::instance().test_flip("[message-consumption-error]")) {
+        LOG(INFO) << KCON_ID(getId()) << "[message-consumption-error]: simulate kafka connector consumption error";
+        error = max_error + 1;
+    }
+#endif
+    if (error <= max_error)
+        return KafkaConnectorError::NO_ERROR;
+    LOG(ERROR) << KCON_ID(getId()) << "Maximum error allowed (" << max_error
+               << ") exceeded. consumeBatchFromQueue returns error now.";
+    return KafkaConnectorError::KAFKA_ERROR;
+}
+
 void KafkaConnector::startConsumer() { // thread function
     try {
-        auto [kafka_batch_size, kafka_batch_timeout_ms] = with_settings([](SETTINGS s) {
+        auto [kafka_batch_size, kafka_batch_timeout_ms, kafka_pipeline_queue_capacity] = with_settings([](SETTINGS s) {
             return std::make_tuple(s.config.kafka.consumerConf.kafka_batch_size,
-                                   s.config.kafka.consumerConf.kafka_batch_timeout_ms);
+                                   s.config.kafka.consumerConf.kafka_batch_timeout_ms,
+                                   s.config.kafka.consumerConf.kafka_pipeline_queue_capacity);
         });
 
         auto [var_zone, var_topic] = with_settings([this](SETTINGS s) {
@@ -144,9 +246,27 @@ void KafkaConnector::startConsumer() { // thread function
         });
 
         LOG_KAFKA(1) << KCON_ID(getId()) << "KafkaConnector: batch_size : " << kafka_batch_size
-                     << " kafka_batch_timeout_ms: " << kafka_batch_timeout_ms << " on zone: " << var_zone
+                     << " kafka_batch_timeout_ms: " << kafka_batch_timeout_ms
+                     << " kafka_pipeline_queue_capacity: " << kafka_pipeline_queue_capacity << " on zone: " << var_zone
                      << " on topic: " << var_topic;
 
+        batchController = with_settings([kafka_batch_size = kafka_batch_size,
+                                         kafka_batch_timeout_ms = kafka_batch_timeout_ms](SETTINGS s) {
+            auto& conf = s.config.kafka.consumerConf;
+            if (!conf.adaptive_batch_enabled)
+                return std::unique_ptr<AdaptiveBatchController>();
+            return std::make_unique<AdaptiveBatchController>(
+                conf.adaptive_batch_min_size, kafka_batch_size, conf.adaptive_batch_min_bytes,
+                conf.adaptive_batch_max_bytes, conf.adaptive_batch_min_timeout_ms, kafka_batch_timeout_ms,
+                conf.adaptive_batch_target_latency_ms);
+        });
+        if (batchController != nullptr) {
+            auto budget = batchController->getBudget();
+            LOG_KAFKA(1) << KCON_ID(getId()) << "KafkaConnector: adaptive batching enabled, starting from "
+                         << budget.messages << " messages, " << budget.bytes << " bytes and " << budget.timeout_ms
+                         << " (ms)";
+        }
+
         std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
             nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
         kafkaconnector_metrics->mainloop_restarted_at_kafka_connector_total
@@ -181,16 +301,107 @@ void KafkaConnector::startConsumer() { // thread function
                 std::chrono::duration_cast<std::chrono::milliseconds>(connect_kafka_end - connect_kafka_start).count();
             LOG_KAFKA(1) << "Connecting Kafka elapsed time: " << connect_kafka_elapsed_time << " (ms)";
 
-            bool is_ok = true;
-            size_t empty_batches_encountered = 0;
+            if (kafka_pipeline_queue_capacity > 0) {
+                consumeInPipeline(kafka_batch_size, kafka_batch_timeout_ms, kafka_pipeline_queue_capacity, var_topic,
+                                  var_zone);
+            } else {
+                bool is_ok = true;
+                size_t empty_batches_encountered = 0;
+
+                // If freeze traffic flag shows up within the loop, we will have the loop finished but some messages
+                // may have the constructed blocks not persisted in the block retry loop and that will lead to is_ok to
+                // be false.
+                while (running && is_ok && !freeze_traffic_flag) {
+                    std::chrono::time_point<std::chrono::high_resolution_clock> batched_messsages_processing_start =
+                        std::chrono::high_resolution_clock::now();
+
+#ifdef _PRERELEASE
+                    if (auto consum_batch_size = flip::Flip::instance().get_test_flip<int>("[consum-batch-size]")) {
+                        kafka_batch_size = consum_batch_size.get();
+                        LOG(INFO) << KCON_ID(getId())
+                                  << "Before consumeBatch, [consum-batch-size]: set kafka connector batch size: "
+                                  << kafka_batch_size;
+                    }
+#endif
+
+                    auto budget = nextBatchBudget(kafka_batch_size, kafka_batch_timeout_ms);
+                    if (consumeBatch(budget.messages, budget.timeout_ms, budget.bytes) !=
+                        KafkaConnectorError::NO_ERROR) {
+                        LOG(ERROR) << KCON_ID(getId()) << "Error in consuming data.";
+                        break;
+                    }
 
-            // If freeze traffic flag shows up within the loop, we will have the loop finished but some messages may
-            // have the constructed blocks not persisted in the block retry loop and that will lead to is_ok to be
-            // false.
-            while (running && is_ok && !freeze_traffic_flag) {
-                std::chrono::time_point<std::chrono::high_resolution_clock> batched_messsages_processing_start =
-                    std::chrono::high_resolution_clock::now();
+#ifdef _PRERELEASE
+                    if (auto sleep_ms_after_consum =
+                            flip::Flip::instance().get_test_flip<int>("[sleep-ms-after-consum]")) {
+                        LOG(INFO) << KCON_ID(getId())
+                                  << "After consumeBatch, [sleep-ms-after-consum]: sleep time after kafka connector "
+                                     "consume(ms): "
+                                  << sleep_ms_after_consum.get() << ". currentBatch size: " << currentBatch.size();
+                        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms_after_consum.get()));
+                    }
+#endif
+
+                    reportFetchedBatch(currentBatch, budget.messages, empty_batches_encountered, var_topic,
+                                       var_zone);
+                    uint64_t flush_wait_us = 0;
+                    is_ok = processBatch(currentBatch, partitionHandlers, var_topic, var_zone, flush_wait_us);
+
+                    std::chrono::time_point<std::chrono::high_resolution_clock> batched_messsages_processing_end =
+                        std::chrono::high_resolution_clock::now();
+                    uint64_t time_diff = std::chrono::duration_cast<std::chrono::microseconds>(
+                                             batched_messsages_processing_end.time_since_epoch())
+                                             .count() -
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            batched_messsages_processing_start.time_since_epoch())
+                            .count();
+                    kafkaconnector_metrics->processing_time_for_batched_messages_by_kafka_connectors
+                        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+                        .observe(time_diff);
+                    if (is_ok) {
+                        adaptBatchBudget(currentBatch, time_diff, flush_wait_us, var_topic, var_zone);
+                    }
+                }
+            }
+
+            disconnectKafka();
+            backPressureController.clear();
+            clearCurrentBatch();
+            clearPartitionHandlers(); // Both rebalance_cb and persist failure will trigger rebuild of partition
+                                      // handlers.
+
+            LOG_KAFKA(1) << KCON_ID(getId()) << "End the main consumer loop";
+        }
+
+        // exit normally
+        LOG_KAFKA(1) << KCON_ID(getId()) << "exiting ...";
+    } catch (...) {
+        LOG(ERROR) << KCON_ID(getId()) << "caught unhandled exception, exiting ...";
+    }
+    notify_stopped();
+}
 
+void KafkaConnector::consumeInPipeline(size_t kafka_batch_size, int64_t kafka_batch_timeout_ms, size_t queue_capacity,
+                                       const std::string& var_topic, const std::string& var_zone) {
+    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+    auto& queue_occupancy = kafkaconnector_metrics->pipeline_queue_occupancy_in_kafka_connector->labels(
+        {{"on_topic", var_topic}, {"on_zone", var_zone}});
+    auto& fetch_stall_time = kafkaconnector_metrics->pipeline_stage_stall_time_in_kafka_connector->labels(
+        {{"on_topic", var_topic}, {"on_zone", var_zone}, {"stage", "fetch"}});
+    auto& process_stall_time = kafkaconnector_metrics->pipeline_stage_stall_time_in_kafka_connector->labels(
+        {{"on_topic", var_topic}, {"on_zone", var_zone}, {"stage", "process"}});
+
+    BoundedQueue<FetchedBatch> fetched_batches(queue_capacity);
+    std::atomic<bool> fetch_failed(false);
+
+    // The fetch stage. The rebalance callback is served from within consumeBatch on this thread. It only waits for the
+    // process stage to take its snapshot of the partition handlers, or to finish a metadata commit in progress, but
+    // not for the decoding or the flushing of the batch being processed.
+    std::thread fetcher([&] {
+        try {
+            size_t empty_batches_encountered = 0;
+            while (running && !freeze_traffic_flag) {
 #ifdef _PRERELEASE
                 if (auto consum_batch_size = flip::Flip::instance().get_test_flip<int>("[consum-batch-size]")) {
                     kafka_batch_size = consum_batch_size.get();
@@ -199,9 +410,10 @@ void KafkaConnector::startConsumer() { // thread function
                               << kafka_batch_size;
                 }
 #endif
-
-                if (consumeBatch(kafka_batch_size, kafka_batch_timeout_ms) != KafkaConnectorError::NO_ERROR) {
+                auto budget = nextBatchBudget(kafka_batch_size, kafka_batch_timeout_ms);
+                if (consumeBatch(budget.messages, budget.timeout_ms, budget.bytes) != KafkaConnectorError::NO_ERROR) {
                     LOG(ERROR) << KCON_ID(getId()) << "Error in consuming data.";
+                    fetch_failed = true;
                     break;
                 }
 
@@ -215,115 +427,382 @@ void KafkaConnector::startConsumer() { // thread function
                 }
 #endif
 
-                if (currentBatch.size() == 0) {
-                    empty_batches_encountered++;
-                    // for empty batches, only shown it for every 5 minutes, to show that the connector is still
-                    // running.
-                    if (empty_batches_encountered % 300 == 0) {
-                        LOG_KAFKA(3) << KCON_ID(getId())
-                                     << "read empty batch, encounter: " << empty_batches_encountered;
-                    }
-                } else {
-                    LOG_KAFKA(3) << KCON_ID(getId()) << "read batch size: " << currentBatch.size()
-                                 << ", last offset: " << currentBatch.back()->offset();
-                }
-                // during processing a batch we cannot change the partitions
-                for (auto msg : currentBatch) {
-                    auto it = partitionHandlers.find(msg->partition());
-                    assert(it != partitionHandlers.end());
-
-                    LOG_KAFKA(5) << KCON_ID(getId()) << "Consuming Message offset: " << msg->offset()
-                                 << " partition: " << msg->partition() << " length: " << msg->len()
-                                 << " message timestamp type: " << msg->timestamp().type
-                                 << " message timestamp: " << msg->timestamp().timestamp
-                                 << " message lag time (millisecond): "
-                                 << std::chrono::duration_cast<std::chrono::milliseconds>(
-                                        std::chrono::system_clock::now().time_since_epoch())
-                                        .count() -
-                            msg->timestamp().timestamp
-                                 << " payload: " << std::string((const char*)msg->payload(), msg->len());
-
-                    kafkaconnector_metrics->batched_messages_processed_by_kafka_connectors_bytes_total
-                        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
-                        .increment(msg->len());
-                    kafkaconnector_metrics->bytes_from_batched_messages_by_kafka_connectors
-                        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
-                        .observe(msg->len()); // histogram
-                    kafkaconnector_metrics->batched_messages_processed_by_kafka_connectors_total
-                        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
-                        .increment();
-                    kafkaconnector_metrics->current_offset_being_processed_by_kafka_connector
-                        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
-                        .update(msg->offset());
-
-                    LOG_KAFKA(5) << KCON_ID(getId()) << "Going to call consume of the partition handler for message ["
-                                 << msg->offset() << "]";
-                    auto error = it->second->consume(msg);
-                    if (error != NO_ERROR) {
-                        LOG(ERROR) << KCON_ID(getId()) << "KafkaConnector [" << idx << "] failed to append msg due to "
-                                   << getKafkaConnectorErrorName(error) << ", ending consumer loop ...";
-                        is_ok = false; // Recreate kafka connector from last commit.
-                        break;
-                    }
+                reportFetchedBatch(currentBatch, budget.messages, empty_batches_encountered, var_topic, var_zone);
+
+                // the batch is tagged with the partition handlers that its messages are fetched under, which only
+                // change within consumeBatch on this thread. The empty batches are also handed over, for the process
+                // stage to flush the buffers on timeout.
+                FetchedBatch batch{std::move(currentBatch), partitionHandlers};
+                currentBatch = std::vector<KafkaMessage>();
+
+                auto push_start = std::chrono::steady_clock::now();
+                bool pushed = fetched_batches.push(std::move(batch));
+                fetch_stall_time.observe(
+                    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - push_start)
+                        .count());
+                if (!pushed) {
+                    break; // the process stage has stopped.
                 }
+                queue_occupancy.update(fetched_batches.size());
+            }
+        } catch (...) {
+            LOG(ERROR) << KCON_ID(getId()) << "Fetch stage caught unhandled exception";
+            fetch_failed = true;
+        }
+        fetched_batches.close();
+    });
 
-                if (!is_ok) {
-                    break;
-                }
+    // The process stage, which decodes the batch into the buffers, and then commits the metadata and flushes the
+    // buffers, in the order of the batches being fetched.
+    FetchedBatch batch;
+    while (running && !freeze_traffic_flag) {
+        auto pop_start = std::chrono::steady_clock::now();
+        bool popped = fetched_batches.pop(batch);
+        process_stall_time.observe(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - pop_start)
+                .count());
+        if (!popped) {
+            break; // the fetch stage has stopped.
+        }
+        queue_occupancy.update(fetched_batches.size());
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> batched_messsages_processing_start =
+            std::chrono::high_resolution_clock::now();
+        bool is_ok = true;
+        uint64_t flush_wait_us = 0;
+        // The batch is processed against a snapshot of the partition handlers, as the rebalance callback can change
+        // them meanwhile. A revoked handler still gets its messages decoded, but its metadata is not committed, and
+        // thus its flush tasks are never launched.
+        std::unordered_map<int, std::shared_ptr<PartitionHandler>> partition_handlers;
+        {
+            std::lock_guard<std::mutex> lck(partitionMtx);
+            dropRevokedMessages(batch);
+            partition_handlers = partitionHandlers;
+        }
+        is_ok = processBatch(batch.messages, partition_handlers, var_topic, var_zone, flush_wait_us);
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> batched_messsages_processing_end =
+            std::chrono::high_resolution_clock::now();
+        uint64_t time_diff =
+            std::chrono::duration_cast<std::chrono::microseconds>(batched_messsages_processing_end.time_since_epoch())
+                .count() -
+            std::chrono::duration_cast<std::chrono::microseconds>(batched_messsages_processing_start.time_since_epoch())
+                .count();
+        kafkaconnector_metrics->processing_time_for_batched_messages_by_kafka_connectors
+            ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+            .observe(time_diff);
+        if (is_ok) {
+            // The budgets take effect from the next batch fetched, with the batches already queued keeping theirs.
+            adaptBatchBudget(batch.messages, time_diff, flush_wait_us, var_topic, var_zone);
+        }
+        batch.messages.clear();
 
-                size_t number_of_partitions = partitionHandlers.size();
-                kafkaconnector_metrics->partitions_in_kafka_connectors
-                    ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
-                    .update(number_of_partitions);
-
-                LOG_KAFKA(4) << KCON_ID(getId()) << "Flushing " << partitionHandlers.size() << " partition handlers";
-                // ToDo later we can do this for loop in parallel
-                for (auto& entry : partitionHandlers) {
-                    if (entry.second->consumeMode() && entry.second->getOffset() != Metadata::EARLIEST_OFFSET) {
-                        auto error = entry.second->checkBuffers(consumer->c_ptr());
-                        if (error != KafkaConnectorError::NO_ERROR) {
-                            LOG(ERROR) << KCON_ID(getId())
-                                       << "Check flush buffers failed in partition: " << entry.second->getPartitionId()
-                                       << " due to: " << getKafkaConnectorErrorName(error);
-                            is_ok = false; // Recreate kafka connector from last commit.
+        if (!is_ok) {
+            break; // Recreate kafka connector from last commit.
+        }
+    }
+
+    // to stop the fetch stage, with the batches not processed yet being dropped, as the kafka connector is to be
+    // recreated from the last commit.
+    fetched_batches.close();
+    fetcher.join();
+    fetched_batches.clear();
+    queue_occupancy.update(0);
+    if (fetch_failed) {
+        LOG(ERROR) << KCON_ID(getId()) << "Fetch stage failed, ending consumer loop ...";
+    }
+}
+
+void KafkaConnector::dropRevokedMessages(FetchedBatch& batch) {
+    auto revoked = [this, &batch](const KafkaMessage& msg) {
+        auto current = partitionHandlers.find(msg.partition());
+        auto fetched = batch.partitionHandlers.find(msg.partition());
+        return current == partitionHandlers.end() || fetched == batch.partitionHandlers.end() ||
+            current->second != fetched->second;
+    };
+    size_t number_of_messages = batch.messages.size();
+    batch.messages.erase(std::remove_if(batch.messages.begin(), batch.messages.end(), revoked), batch.messages.end());
+    if (batch.messages.size() < number_of_messages) {
+        LOG_KAFKA(3) << KCON_ID(getId()) << "Drop " << number_of_messages - batch.messages.size()
+                     << " messages fetched before their partitions got revoked";
+    }
+}
+
+void KafkaConnector::reportFetchedBatch(const std::vector<KafkaMessage>& batch, size_t kafka_batch_size,
+                                        size_t& empty_batches_encountered, const std::string& var_topic,
+                                        const std::string& var_zone) {
+    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+
+    if (kafka_batch_size > 0) {
+        kafkaconnector_metrics->batch_fill_ratio_by_kafka_connectors
+            ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+            .observe(batch.size() * 100 / kafka_batch_size); // histogram, in percentage
+    }
+
+    if (batch.size() == 0) {
+        empty_batches_encountered++;
+        // for empty batches, only shown it for every 5 minutes, to show that the connector is still
+        // running.
+        if (empty_batches_encountered % 300 == 0) {
+            LOG_KAFKA(3) << KCON_ID(getId())
+                         << "read empty batch, encounter: " << empty_batches_encountered;
+        }
+    } else {
+        LOG_KAFKA(3) << KCON_ID(getId()) << "read batch size: " << batch.size()
+                     << ", last offset: " << batch.back().offset();
+    }
+}
+
+AdaptiveBatchController::Budget KafkaConnector::nextBatchBudget(size_t kafka_batch_size,
+                                                                int64_t kafka_batch_timeout_ms) {
+    if (batchController == nullptr) {
+        return {kafka_batch_size, 0, kafka_batch_timeout_ms};
+    }
+    return batchController->getBudget();
+}
+
+void KafkaConnector::adaptBatchBudget(const std::vector<KafkaMessage>& batch, uint64_t process_time_us,
+                                      uint64_t flush_wait_us, const std::string& var_topic,
+                                      const std::string& var_zone) {
+    if (batchController == nullptr) {
+        return;
+    }
+
+    size_t batch_bytes = 0;
+    for (auto& msg : batch) {
+        batch_bytes += msg.len();
+    }
+    batchController->update(batch.size(), batch_bytes, evCb.get_consumer_lag(), process_time_us, flush_wait_us);
+
+    auto budget = batchController->getBudget();
+    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+    kafkaconnector_metrics->adaptive_batch_budget_in_kafka_connector
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}, {"budget", "messages"}})
+        .update(budget.messages);
+    kafkaconnector_metrics->adaptive_batch_budget_in_kafka_connector
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}, {"budget", "bytes"}})
+        .update(budget.bytes);
+    kafkaconnector_metrics->adaptive_batch_budget_in_kafka_connector
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}, {"budget", "timeout_ms"}})
+        .update(budget.timeout_ms);
+}
+
+bool KafkaConnector::processBatch(std::vector<KafkaMessage>& batch,
+                                  const std::unordered_map<int, std::shared_ptr<PartitionHandler>>& partition_handlers,
+                                  const std::string& var_topic, const std::string& var_zone, uint64_t& flush_wait_us) {
+    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+    bool is_ok = true;
+    maxCheckBuffersTimeUs = 0;
+    flush_wait_us = 0;
+
+    size_t number_of_partitions = partition_handlers.size();
+    kafkaconnector_metrics->partitions_in_kafka_connectors
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+        .update(number_of_partitions);
+
+    if (partition_thread_pool != nullptr && number_of_partitions > 1) {
+        auto error = processBatchByPartitions(batch, partition_handlers, var_topic, var_zone);
+        if (error != NO_ERROR) {
+            LOG(ERROR) << KCON_ID(getId()) << "KafkaConnector [" << idx
+                       << "] failed to process batch by partitions due to "
+                       << getKafkaConnectorErrorName(error) << ", ending consumer loop ...";
+            commitCoordinator.clear();
+            return false; // Recreate kafka connector from last commit.
+        }
+    } else {
+        for (auto& msg : batch) {
+            auto it = partition_handlers.find(msg.partition());
+            assert(it != partition_handlers.end());
+
+            auto error = consumeMessage(msg, *it->second, var_topic, var_zone);
+            if (error != NO_ERROR) {
+                LOG(ERROR) << KCON_ID(getId()) << "KafkaConnector [" << idx
+                           << "] failed to append msg due to " << getKafkaConnectorErrorName(error)
+                           << ", ending consumer loop ...";
+                is_ok = false; // Recreate kafka connector from last commit.
+                break;
+            }
+        }
+
+        if (!is_ok) {
+            return false;
+        }
+
+        LOG_KAFKA(4) << KCON_ID(getId()) << "Flushing " << partition_handlers.size()
+                     << " partition handlers";
+        for (auto& entry : partition_handlers) {
+            if (checkPartitionBuffers(entry.second) != KafkaConnectorError::NO_ERROR) {
+                is_ok = false; // Recreate kafka connector from last commit.
+                break;
+            }
+        }
+    }
+
+    if (is_ok) {
+        // The rebalance callback waits for the commit request being sent, which is then ahead of the rejoin of the
+        // consumer group. The partitions revoked while the batch was processed are left out of the commit, along with
+        // their commits still in flight, whose acknowledgements are ignored.
+        std::lock_guard<std::mutex> commit_lck(commitMtx);
+        std::unordered_map<int, std::shared_ptr<PartitionHandler>> current_handlers;
+        {
+            std::lock_guard<std::mutex> lck(partitionMtx);
+            current_handlers = partitionHandlers;
+        }
+        commitCoordinator.dropRevoked(current_handlers);
+
+        // One metadata commit for all of the partitions flushed in this iteration, sent without waiting for the
+        // acknowledgement, which launches the flush tasks from a later iteration.
+        auto commit_start = std::chrono::steady_clock::now();
+        auto commit_error = commitCoordinator.commit(consumer->c_ptr());
+        // the partitions are checked in parallel with the partition thread pool, and thus the longest check counts.
+        flush_wait_us = maxCheckBuffersTimeUs +
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - commit_start)
+                .count();
+        if (commit_error != KafkaConnectorError::NO_ERROR) {
+            LOG(ERROR) << KCON_ID(getId()) << "Metadata commit failed, ending consumer loop ...";
+            is_ok = false; // Recreate kafka connector from last commit.
+        } else {
+            backPressureController.update(consumer.get(), current_handlers);
+        }
+    } else {
+        commitCoordinator.clear();
+    }
+
+    return is_ok;
+}
+
+KafkaConnectorError KafkaConnector::consumeMessage(const KafkaMessage& msg, PartitionHandler& partition_handler,
+                                                   const std::string& var_topic, const std::string& var_zone) {
+    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+
+    LOG_KAFKA(5) << KCON_ID(getId()) << "Consuming Message offset: " << msg.offset()
+                 << " partition: " << msg.partition() << " length: " << msg.len()
+                 << " message timestamp type: " << msg.timestampType() << " message timestamp: " << msg.timestamp()
+                 << " message lag time (millisecond): "
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count() -
+            msg.timestamp()
+                 << " payload: " << std::string(msg.payload(), msg.len());
+
+    kafkaconnector_metrics->batched_messages_processed_by_kafka_connectors_bytes_total
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+        .increment(msg.len());
+    kafkaconnector_metrics->bytes_from_batched_messages_by_kafka_connectors
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+        .observe(msg.len()); // histogram
+    kafkaconnector_metrics->batched_messages_processed_by_kafka_connectors_total
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+        .increment();
+    kafkaconnector_metrics->current_offset_being_processed_by_kafka_connector
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+        .update(msg.offset());
+
+    LOG_KAFKA(5) << KCON_ID(getId()) << "Going to call consume of the partition handler for message ["
+                 << msg.offset() << "]";
+    return partition_handler.consume(msg);
+}
+
+KafkaConnectorError
+KafkaConnector::checkPartitionBuffers(const std::shared_ptr<PartitionHandler>& partition_handler) {
+    if (partition_handler->consumeMode() && partition_handler->getOffset() != Metadata::EARLIEST_OFFSET) {
+        bool commit_required = false;
+        auto check_start = std::chrono::steady_clock::now();
+        auto error = partition_handler->checkBuffers(commit_required);
+        uint64_t check_time_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - check_start)
+                .count();
+        uint64_t max_check_time_us = maxCheckBuffersTimeUs;
+        while (check_time_us > max_check_time_us &&
+               !maxCheckBuffersTimeUs.compare_exchange_weak(max_check_time_us, check_time_us)) {
+        }
+        if (error != KafkaConnectorError::NO_ERROR) {
+            LOG(ERROR) << KCON_ID(getId())
+                       << "Check flush buffers failed in partition: " << partition_handler->getPartitionId()
+                       << " due to: " << getKafkaConnectorErrorName(error);
+        } else if (commit_required) {
+            commitCoordinator.add(partition_handler);
+        }
+        return error;
+    }
+    return KafkaConnectorError::NO_ERROR;
+}
+
+/**
+ * Each partition handler gets its messages of the current batch consumed, followed by its buffers checked, in a task
+ * on the partition thread pool. The messages of a partition are handed over to a single task in the fetched order,
+ * so that each partition handler still sees its messages in the offset order. The partition handlers are the snapshot
+ * that the batch is processed against, which the rebalance callback does not change.
+ */
+KafkaConnectorError KafkaConnector::processBatchByPartitions(
+    const std::vector<KafkaMessage>& batch,
+    const std::unordered_map<int, std::shared_ptr<PartitionHandler>>& partition_handlers, const std::string& var_topic,
+    const std::string& var_zone) {
+    std::unordered_map<int, std::vector<const KafkaMessage*>> messages_by_partition;
+    for (auto& msg : batch) {
+        messages_by_partition[msg.partition()].push_back(&msg);
+    }
+
+    std::mutex completion_mtx;
+    std::condition_variable completion_cv;
+    size_t pending_tasks = partition_handlers.size();
+    KafkaConnectorError result = KafkaConnectorError::NO_ERROR;
+    std::exception_ptr exception = nullptr;
+
+    LOG_KAFKA(4) << KCON_ID(getId()) << "Processing " << batch.size() << " messages and flushing "
+                 << partition_handlers.size() << " partition handlers in parallel";
+    for (auto& entry : partition_handlers) {
+        std::shared_ptr<PartitionHandler> partition_handler = entry.second;
+        auto messages_it = messages_by_partition.find(entry.first);
+        const std::vector<const KafkaMessage*>* messages =
+            (messages_it == messages_by_partition.end()) ? nullptr : &messages_it->second;
+
+        partition_thread_pool->enqueue([&, partition_handler, messages]() {
+            KafkaConnectorError error = KafkaConnectorError::NO_ERROR;
+            std::exception_ptr task_exception = nullptr;
+            try {
+                if (messages != nullptr) {
+                    for (const KafkaMessage* msg : *messages) {
+                        error = consumeMessage(*msg, *partition_handler, var_topic, var_zone);
+                        if (error != NO_ERROR) {
+                            LOG(ERROR) << KCON_ID(getId()) << "Partition [" << partition_handler->getPartitionId()
+                                       << "] failed to append msg due to " << getKafkaConnectorErrorName(error);
                             break;
                         }
                     }
                 }
 
-                std::chrono::time_point<std::chrono::high_resolution_clock> batched_messsages_processing_end =
-                    std::chrono::high_resolution_clock::now();
-                uint64_t time_diff = std::chrono::duration_cast<std::chrono::microseconds>(
-                                         batched_messsages_processing_end.time_since_epoch())
-                                         .count() -
-                    std::chrono::duration_cast<std::chrono::microseconds>(
-                        batched_messsages_processing_start.time_since_epoch())
-                        .count();
-                kafkaconnector_metrics->processing_time_for_batched_messages_by_kafka_connectors
-                    ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
-                    .observe(time_diff);
+                if (error == NO_ERROR) {
+                    error = checkPartitionBuffers(partition_handler);
+                }
+            } catch (...) {
+                task_exception = std::current_exception();
             }
 
-            disconnectKafka();
-            clearCurrentBatch();
-            clearPartitionHandlers(); // Both rebalance_cb and persist failure will trigger rebuild of partition
-                                      // handlers.
-
-            LOG_KAFKA(1) << KCON_ID(getId()) << "End the main consumer loop";
-        }
+            std::lock_guard<std::mutex> lck(completion_mtx);
+            if (result == NO_ERROR)
+                result = error;
+            if (exception == nullptr)
+                exception = task_exception;
+            if (--pending_tasks == 0)
+                completion_cv.notify_all();
+        });
+    }
 
-        // exit normally
-        LOG_KAFKA(1) << KCON_ID(getId()) << "exiting ...";
-    } catch (...) {
-        LOG(ERROR) << KCON_ID(getId()) << "caught unhandled exception, exiting ...";
+    std::unique_lock<std::mutex> lck(completion_mtx);
+    completion_cv.wait(lck, [&pending_tasks] { return pending_tasks == 0; });
+    if (exception != nullptr) {
+        std::rethrow_exception(exception);
     }
-    notify_stopped();
+    return result;
 }
 
 void KafkaConnector::clearCurrentBatch() {
-    for (auto msg : currentBatch) {
-        delete msg;
-    }
+    // the message holders release the messages, and the capacity of the batch gets retained.
     currentBatch.clear();
 }
 void KafkaConnector::notify_stopped() {
@@ -370,6 +849,14 @@ void KafkaConnector::wait() {
 }
 
 void KafkaConnector::disconnectKafka() {
+    // the commits still in flight are dropped, as the main loop restarts from the last acknowledged commit.
+    commitCoordinator.close();
+
+    if (consumerQueue != nullptr) {
+        rd_kafka_queue_destroy(consumerQueue);
+        consumerQueue = nullptr;
+    }
+
     if (consumer) {
         LOG(INFO) << KCON_ID(getId()) << "Closing Kafka consumer";
 
@@ -392,6 +879,11 @@ void KafkaConnector::connectKafka() {
         return s.config.kafka.configVariants[idx].topic;
     });
 
+    auto [consume_from_queue, queue_fetch_size] = with_settings([](SETTINGS s) {
+        return std::make_tuple(s.config.kafka.consumerConf.kafka_batch_consume_from_queue,
+                               s.config.kafka.consumerConf.kafka_batch_queue_fetch_size);
+    });
+
     std::string err = "";
     // ToDo read from config
     int kafka_retry_interval = 1000;
@@ -405,6 +897,15 @@ void KafkaConnector::connectKafka() {
             if (!errCode) {
                 consumer.swap(new_consumer);
                 LOG(INFO) << KCON_ID(getId()) << "Succeeded to subscribe to topics: " << topic;
+                commitCoordinator.open(consumer->c_ptr());
+                if (consume_from_queue && queue_fetch_size > 0) {
+                    // The consumer queue also has the main queue forwarded to it, so that the rebalance and event
+                    // callbacks get served from within rd_kafka_consume_batch_queue.
+                    consumerQueue = rd_kafka_queue_get_consumer(consumer->c_ptr());
+                    fetchedMessages.resize(queue_fetch_size);
+                    LOG(INFO) << KCON_ID(getId())
+                              << "Consume batch from the consumer queue with fetch size: " << queue_fetch_size;
+                }
                 break;
             } else {
                 LOG(ERROR) << KCON_ID(getId()) << "Failed to subscribe to topics: " << topic
@@ -547,7 +1048,45 @@ void KafkaConnector::storePreviousAssigmentInformation() {
     }
 }
 
+void KafkaConnector::removePartitionHandlersNoLocking(const std::vector<int>& revoked_partitions) {
+    for (int partition : revoked_partitions) {
+        auto it = partitionHandlers.find(partition);
+        if (it == partitionHandlers.end())
+            continue;
+        // store partition information of the revoked partition to the rebalances
+        if (!rebalances.empty()) {
+            rebalances.back().initialMetadata[partition] = it->second->getInitialMetadata();
+            rebalances.back().replayedBatches[partition] = it->second->getSerializedReplayedBatches();
+        }
+        partitionHandlers.erase(it);
+    }
+
+    currentBatch.erase(std::remove_if(currentBatch.begin(), currentBatch.end(),
+                                      [this](const KafkaMessage& msg) {
+                                          return partitionHandlers.find(msg.partition()) == partitionHandlers.end();
+                                      }),
+                       currentBatch.end());
+}
+
+bool KafkaConnector::allowsMetadataVersion(int version) {
+    if (version >= 2)
+        return true;
+    std::lock_guard<std::mutex> lck(partitionMtx);
+    for (auto& entry : partitionHandlers) {
+        if (entry.second->getMaxInFlightTasks() > 1) {
+            LOG(ERROR) << KCON_ID(getId()) << "Refuse to set metadata version " << version << ", as partition ["
+                       << entry.first << "] allows " << entry.second->getMaxInFlightTasks()
+                       << " flush tasks of a table in flight, which requires metadata version 2. Restart with "
+                       << "max_in_flight_flush_tasks_per_table set to 1 first.";
+            return false;
+        }
+    }
+    return true;
+}
+
 bool KafkaConnector::setMetadataVersion(int version) {
+    if (!allowsMetadataVersion(version))
+        return false;
     auto result = Metadata::setVersion(version);
     if (result)
         LOG_KAFKA(1) << "metadata version set to " << version;
@@ -16,11 +16,17 @@ limitations under the License.
 
 #pragma once
 
+#include "AdaptiveBatchController.h"
+#include "BackPressureController.h"
+#include "BoundedQueue.h"
+#include "CommitCoordinator.h"
 #include "GenericThreadPool.h"
+#include "KafkaMessage.h"
 #include "KafkaConnector/Metadata.h"
 #include "PartitionHandler.h"
 #include "RebalanceCb.h"
 #include "EventCb.h"
+#include "TableRegistry.h"
 #include "global.h"
 
 #include <librdkafka/rdkafka.h>
@@ -92,6 +98,16 @@ struct Rebalance {
     }
 };
 
+/**
+ * A batch handed over from the fetch stage to the process stage of the pipelined main loop, tagged with the partition
+ * handlers that the batch is fetched under. A partition whose handler got replaced or removed in between has been
+ * revoked, and its messages are to be fetched again from the last commit.
+ */
+struct FetchedBatch {
+    std::vector<KafkaMessage> messages;
+    std::unordered_map<int, std::shared_ptr<PartitionHandler>> partitionHandlers;
+};
+
 /**
  * This is the main class that handles connection to the Kafka for a a topic.
  */
@@ -101,6 +117,8 @@ class KafkaConnector {
     std::unique_ptr<RdKafka::Conf> config;
     // const KafkaConnectorParameters& connector_parameters;
     std::shared_ptr<GenericThreadPool> thread_pool;
+    // the optional pool to process the partitions of a batch in parallel, being nullptr if not enabled.
+    std::shared_ptr<GenericThreadPool> partition_thread_pool;
     std::atomic<bool> running;
 
     std::atomic<bool> freeze_traffic_flag; // the in-memory fag set from external command
@@ -118,10 +136,30 @@ class KafkaConnector {
     // rdkafka variables
     std::unique_ptr<RdKafka::KafkaConsumer> consumer;
 
+    // the consumer queue and the pre-allocated fetch array used by the batch fetch mode, with consumerQueue being
+    // nullptr if the batch fetch mode is not enabled.
+    rd_kafka_queue_t* consumerQueue;
+    std::vector<rd_kafka_message_t*> fetchedMessages;
+
     RebalanceHandler rbCb;
 
     EventHandler evCb;
 
+    // to commit the metadata of all of the flushed partitions in one iteration of the main loop.
+    CommitCoordinator commitCoordinator;
+
+    // to pause the partitions whose tables reach their in-flight flush limit, instead of blocking the main loop.
+    BackPressureController backPressureController;
+
+    // to tune the batch budgets toward the target loop latency, being nullptr if adaptive batching is disabled.
+    std::unique_ptr<AdaptiveBatchController> batchController;
+
+    // the longest buffer check of the partitions in the batch being processed, in microseconds.
+    std::atomic<uint64_t> maxCheckBuffersTimeUs{0};
+
+    // the table IDs shared by the partition handlers, kept across the partition re-assignments.
+    TableRegistry tableRegistry;
+
     // Backend database health checking function
     BackendServerHealthCheckFunction database_health_checker;
 
@@ -131,6 +169,34 @@ class KafkaConnector {
     void checkUntilPersistentFreezeFlagRemoved(const std::string& var_zone, const std::string& var_topic);
 
     void startConsumer();
+    KafkaConnectorError consumeBatchFromQueue(size_t batch_size, int64_t batch_timeout, size_t batch_bytes);
+    KafkaConnectorError consumeMessage(const KafkaMessage& msg, PartitionHandler& partition_handler,
+                                       const std::string& var_topic, const std::string& var_zone);
+    KafkaConnectorError checkPartitionBuffers(const std::shared_ptr<PartitionHandler>& partition_handler);
+    KafkaConnectorError
+    processBatchByPartitions(const std::vector<KafkaMessage>& batch,
+                             const std::unordered_map<int, std::shared_ptr<PartitionHandler>>& partition_handlers,
+                             const std::string& var_topic, const std::string& var_zone);
+    // To drop the messages of the partitions revoked after the batch is fetched, invoked with partitionMtx held.
+    void dropRevokedMessages(FetchedBatch& batch);
+    void reportFetchedBatch(const std::vector<KafkaMessage>& batch, size_t kafka_batch_size,
+                            size_t& empty_batches_encountered, const std::string& var_topic,
+                            const std::string& var_zone);
+    // To append the batch to the given partition handlers, and then flush the buffers and commit the metadata of the
+    // partitions that are still assigned. Return false if the kafka connector needs to be recreated from the last
+    // commit. flush_wait_us is set to the time spent in flushing the buffers and committing the metadata.
+    bool processBatch(std::vector<KafkaMessage>& batch,
+                      const std::unordered_map<int, std::shared_ptr<PartitionHandler>>& partition_handlers,
+                      const std::string& var_topic, const std::string& var_zone, uint64_t& flush_wait_us);
+    // The budgets of the next batch, being the configured ones if adaptive batching is disabled.
+    AdaptiveBatchController::Budget nextBatchBudget(size_t kafka_batch_size, int64_t kafka_batch_timeout_ms);
+    // To feed the batch just processed to the adaptive batching, and export the resulting budgets.
+    void adaptBatchBudget(const std::vector<KafkaMessage>& batch, uint64_t process_time_us, uint64_t flush_wait_us,
+                          const std::string& var_topic, const std::string& var_zone);
+    // The main loop with the fetch stage running in its own thread, ahead of the process stage by up to queue_capacity
+    // batches. It returns when the kafka connector needs to be recreated.
+    void consumeInPipeline(size_t kafka_batch_size, int64_t kafka_batch_timeout_ms, size_t queue_capacity,
+                           const std::string& var_topic, const std::string& var_zone);
     void notify_stopped();
     void wait_stopped();
 
@@ -140,18 +206,23 @@ class KafkaConnector {
   public:
     // todo: idx is bad, need to refactor later.
     KafkaConnector(size_t idx_, RdKafka::Conf* config_, std::shared_ptr<GenericThreadPool> thread_pool_,
-                   BackendServerHealthCheckFunction database_health_checker_) :
+                   BackendServerHealthCheckFunction database_health_checker_,
+                   std::shared_ptr<GenericThreadPool> partition_thread_pool_ = nullptr) :
             idx(idx_),
             config(config_),
             thread_pool(thread_pool_),
+            partition_thread_pool(partition_thread_pool_),
             running(false),
             freeze_traffic_flag(false),
             freeze_traffic_status(false),
             stopped(false),
             stopCompleted(false),
             consumer(nullptr),
+            consumerQueue(nullptr),
             rbCb{this},
             evCb{idx_},
+            commitCoordinator{this},
+            backPressureController{this},
             database_health_checker(database_health_checker_) {
         std::string err;
         std::string autoOffsetReset;
@@ -183,12 +254,21 @@ class KafkaConnector {
     // partitions & rebalances
     std::unordered_map<int, std::shared_ptr<PartitionHandler>> partitionHandlers;
     std::mutex partitionMtx;
-
-    // NOTE: since the whole kafka connector is in a single thread, and this thread is also re-used for librdkafka for
-    // the rebalancing purpose. And the partition handlers also belong to the kafka connector. Therefore, there is no
-    // need to have locking in place.
+    // held across the metadata commit, and by the rebalance callback ahead of partitionMtx.
+    std::mutex commitMtx;
+
+    // NOTE: the handler map is owned by the thread that fetches the batches, which is the consumer thread, or the fetch
+    // stage thread in the pipeline mode. The rebalance callback is served on that same thread from within consumeBatch,
+    // and changes the map with partitionMtx held. With the partition thread pool enabled, the pool threads are only
+    // handed the handlers of their own partitions for the batch being processed, and never access the map; in the
+    // pipeline mode the process stage works on a snapshot of the map copied under partitionMtx. The caller of the
+    // following is thus expected to hold partitionMtx, as the rebalance callback does.
     void clearPartitionHandlersNoLocking() { partitionHandlers.clear(); }
 
+    // To remove the handlers of the partitions revoked by an incremental rebalance, along with their messages in the
+    // current batch, with the handlers of the rest of the partitions kept.
+    void removePartitionHandlersNoLocking(const std::vector<int>& revoked_partitions);
+
     void clearPartitionHandlers() {
         std::lock_guard<std::mutex> lck(partitionMtx);
         clearPartitionHandlersNoLocking();
@@ -203,10 +283,12 @@ class KafkaConnector {
 
     // current batch
     void clearCurrentBatch();
-    std::vector<RdKafka::Message*> currentBatch;
-    KafkaConnectorError consumeBatch(size_t batch_size, int64_t batch_timeout); // return false on error
+    std::vector<KafkaMessage> currentBatch;
+    // return false on error. batch_bytes bounds the total payload of the batch, with 0 being unbounded.
+    KafkaConnectorError consumeBatch(size_t batch_size, int64_t batch_timeout, size_t batch_bytes = 0);
 
     size_t getId() { return idx; }
+    TableRegistry& getTableRegistry() { return tableRegistry; }
     bool isRunning() { return running && !freeze_traffic_flag; }
 
     // to debug consume/replay issue
@@ -226,5 +308,8 @@ class KafkaConnector {
     // To set and get the metadata version
     int getMetadataVersion() const;
     bool setMetadataVersion(int version);
+    // Whether the metadata version can be switched to. A version older than 2 is refused while any of the partition
+    // handlers allows more than one flush task of a table in flight, as it can not record the splits of these tasks.
+    bool allowsMetadataVersion(int version);
 };
 } // namespace kafka
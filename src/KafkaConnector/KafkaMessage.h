@@ -0,0 +1,126 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <librdkafka/rdkafka.h>
+#include <librdkafka/rdkafkacpp.h>
+
+#include <string>
+#include <utility>
+
+namespace kafka {
+
+/**
+ * A light-weight holder of a consumed Kafka message. It owns either a message returned by the C++ consumer API
+ * (consumer->consume()), or a raw rd_kafka_message_t returned by the C queue API (rd_kafka_consume_batch_queue), and
+ * exposes the few fields that the partition handlers need directly from the underlying rd_kafka_message_t.
+ *
+ * The holders are kept by value in the connector's current batch, so that the batch vector (and its capacity) is
+ * re-used across the consumer loop iterations, and no per-message RdKafka::Message wrapper has to be heap-allocated
+ * in the batch fetch mode.
+ */
+class KafkaMessage {
+  public:
+    // takes the ownership of the message returned by the C++ consumer API.
+    explicit KafkaMessage(RdKafka::Message* msg_) : msg(msg_), rkmessage(msg_->c_ptr()) {}
+
+    // takes the ownership of the message returned by the C queue API.
+    explicit KafkaMessage(rd_kafka_message_t* rkmessage_) : msg(nullptr), rkmessage(rkmessage_) {}
+
+    KafkaMessage(const KafkaMessage&) = delete;
+    KafkaMessage& operator=(const KafkaMessage&) = delete;
+
+    KafkaMessage(KafkaMessage&& other) noexcept :
+            msg(std::exchange(other.msg, nullptr)), rkmessage(std::exchange(other.rkmessage, nullptr)) {}
+
+    KafkaMessage& operator=(KafkaMessage&& other) noexcept {
+        if (this != &other) {
+            release();
+            msg = std::exchange(other.msg, nullptr);
+            rkmessage = std::exchange(other.rkmessage, nullptr);
+        }
+        return *this;
+    }
+
+    ~KafkaMessage() { release(); }
+
+    int64_t offset() const { return rkmessage->offset; }
+    int32_t partition() const { return rkmessage->partition; }
+    const char* payload() const { return static_cast<const char*>(rkmessage->payload); }
+    size_t len() const { return rkmessage->len; }
+    rd_kafka_resp_err_t err() const { return rkmessage->err; }
+
+    int64_t timestamp() const {
+        rd_kafka_timestamp_type_t tstype;
+        return rd_kafka_message_timestamp(rkmessage, &tstype);
+    }
+
+    rd_kafka_timestamp_type_t timestampType() const {
+        rd_kafka_timestamp_type_t tstype;
+        rd_kafka_message_timestamp(rkmessage, &tstype);
+        return tstype;
+    }
+
+    /**
+     * To retrieve the value of the first header with the specified name, without the value being copied. The value
+     * stays valid for the life-time of the message. Return false if the message does not have such header or the
+     * header has an empty value.
+     */
+    bool getHeader(const char* name, const char*& value, size_t& value_size) const {
+        rd_kafka_headers_t* hdrs = nullptr;
+        if (rd_kafka_message_headers(rkmessage, &hdrs) != RD_KAFKA_RESP_ERR_NO_ERROR)
+            return false;
+
+        const void* header_value = nullptr;
+        size_t header_size = 0;
+        if (rd_kafka_header_get(hdrs, 0, name, &header_value, &header_size) != RD_KAFKA_RESP_ERR_NO_ERROR ||
+            header_value == nullptr)
+            return false;
+
+        // the producers may have the string terminator included in the header value.
+        value = static_cast<const char*>(header_value);
+        while (header_size > 0 && value[header_size - 1] == '\0')
+            header_size--;
+        value_size = header_size;
+        return value_size > 0;
+    }
+
+    bool getHeader(const char* name, std::string& value) const {
+        const char* header_value = nullptr;
+        size_t header_size = 0;
+        if (!getHeader(name, header_value, header_size))
+            return false;
+        value.assign(header_value, header_size);
+        return true;
+    }
+
+  private:
+    void release() {
+        if (msg != nullptr) {
+            delete msg; // the C++ wrapper destroys the underlying rd_kafka_message_t
+        } else if (rkmessage != nullptr) {
+            rd_kafka_message_destroy(rkmessage);
+        }
+        msg = nullptr;
+        rkmessage = nullptr;
+    }
+
+    RdKafka::Message* msg;
+    rd_kafka_message_t* rkmessage;
+};
+
+} // namespace kafka
@@ -15,8 +15,11 @@ limitations under the License.
 **************************************************************************/
 
 #include "Metadata.h"
+#include "common/logging.hpp"
 #include "sstream"
+#include <charconv>
 #include <string>
+#include <system_error>
 
 extern int getDefaultMetadataVersion();
 
@@ -28,14 +31,15 @@ void Metadata::update(std::string table, int64_t begin, int64_t end, int64_t cou
     offsets[table].begin = begin;
     offsets[table].end = end;
     offsets[table].count = count;
+    offsets[table].splits.clear();
 }
 
+void Metadata::update(std::string table, const Offset& offset) { offsets[table] = offset; }
+
 void Metadata::addFrom(Metadata* saved) {
     reference = saved->reference;
     for (auto& offset : saved->offsets) {
-        offsets[offset.first].begin = offset.second.begin;
-        offsets[offset.first].end = offset.second.end;
-        offsets[offset.first].count = offset.second.count;
+        offsets[offset.first] = offset.second;
     }
 }
 
@@ -57,6 +61,41 @@ int64_t Metadata::max() {
     return max_;
 }
 
+/**
+ * Version 2 appends the splits of the tables having more than one batch in flight, as the 4th part of the metadata:
+ * table,number_of_splits,end,count,... As the older versions only read the first 3 parts, they see each table with
+ * all of its batches in flight merged into one, and would replay them as one block that the deduplication of the
+ * backend does not recognize, duplicating the rows.
+ *
+ * Rolling back to a binary that does not know version 2 therefore requires the partitions to be drained first:
+ * restart with max_in_flight_flush_tasks_per_table set to 1, so that no splits are left in the committed metadata,
+ * then set the metadata version to 1 (refused while any partition handler still allows more than one flush task of
+ * a table in flight), and roll back once every partition has committed its metadata with version 1.
+ */
+std::string Metadata::serialize_v2() const {
+    std::ostringstream ss;
+    ss << "2" << referenceSeparator << replica_id;
+    for (auto it = offsets.begin(); it != offsets.end(); it++) {
+        ss << separator;
+        ss << it->first << separator << it->second.begin << separator << it->second.end << separator
+           << it->second.count;
+    }
+    ss << referenceSeparator << reference << referenceSeparator;
+    bool first = true;
+    for (auto it = offsets.begin(); it != offsets.end(); it++) {
+        if (it->second.splits.empty())
+            continue;
+        if (!first)
+            ss << separator;
+        first = false;
+        ss << it->first << separator << it->second.splits.size();
+        for (auto& split : it->second.splits) {
+            ss << separator << split.end << separator << split.count;
+        }
+    }
+    return ss.str();
+}
+
 std::string Metadata::serialize_v1() const {
     std::ostringstream ss;
     ss << "1" << referenceSeparator << replica_id;
@@ -87,6 +126,8 @@ std::string Metadata::serialize(int version_) const {
         return serialize_v0();
     else if (version_ == 1)
         return serialize_v1();
+    else if (version_ == 2)
+        return serialize_v2();
     else
         return ""; // implement future versions here
 }
@@ -117,6 +158,76 @@ void Metadata::deserialize_v1(const std::string& meta) {
     }
 }
 
+// To parse the whole string as an integer, with false returned rather than an exception thrown if it is malformed.
+static bool parseInteger(const std::string& str, int64_t& value) {
+    auto result = std::from_chars(str.data(), str.data() + str.size(), value);
+    return result.ec == std::errc() && result.ptr == str.data() + str.size();
+}
+
+/**
+ * The splits drive how the REPLAY re-forms the batches in flight, so they are only taken if each table having them is
+ * in the metadata, and its split ends are ascending within [begin, end), ahead of its last batch that ends at end.
+ * Otherwise, for truncated or inconsistent metadata, all of the splits are dropped, and each table is replayed as the
+ * single window of version 1.
+ */
+void Metadata::deserialize_v2(const std::string& meta) {
+    deserialize_v1(meta);
+    std::vector<std::string> parts;
+    Metadata::split(meta, parts, ",,");
+    if (parts.size() < 4)
+        return;
+
+    std::map<std::string, std::vector<Split>> table_splits;
+    std::string error;
+    std::stringstream s_stream(parts[3]);
+    while (s_stream.good() && error.empty()) {
+        std::string table;
+        getline(s_stream, table, separator);
+        if (table.empty())
+            break;
+        std::string size_str;
+        getline(s_stream, size_str, separator);
+
+        auto it = offsets.find(table);
+        int64_t size = 0;
+        if (it == offsets.end() || table_splits.count(table) > 0) {
+            error = "table: " + table + " is not in the metadata or has its splits repeated";
+        } else if (!parseInteger(size_str, size) || size <= 0) {
+            error = "table: " + table + " has malformed number of splits: " + size_str;
+        }
+
+        auto& splits = table_splits[table];
+        int64_t previous_end = (it == offsets.end()) ? 0 : it->second.begin - 1;
+        for (int64_t i = 0; i < size && error.empty(); i++) {
+            std::string end_str;
+            getline(s_stream, end_str, separator);
+            std::string count_str;
+            getline(s_stream, count_str, separator);
+
+            int64_t split_end = 0;
+            int64_t split_count = 0;
+            if (!parseInteger(end_str, split_end) || !parseInteger(count_str, split_count)) {
+                error = "table: " + table + " has truncated or malformed split: " + end_str + "," + count_str;
+            } else if (split_end <= previous_end || split_end >= it->second.end || split_count < 0) {
+                error = "table: " + table + " has split: " + end_str + "," + count_str + " out of order or outside of ["
+                    + std::to_string(it->second.begin) + ", " + std::to_string(it->second.end) + "]";
+            } else {
+                splits.emplace_back(split_end, split_count);
+                previous_end = split_end;
+            }
+        }
+    }
+
+    if (!error.empty()) {
+        LOG(WARNING) << "Drop the splits of metadata: " << meta << " as the " << error
+                     << ", with each table to be replayed as a single window";
+        return;
+    }
+    for (auto& entry : table_splits) {
+        offsets[entry.first].splits = std::move(entry.second);
+    }
+}
+
 // Note that even when metadata is version 0, when we parse it we use the default version number for this object.
 // so we don't set version in this function.
 void Metadata::deserialize_v0(const std::string& meta) {
@@ -145,7 +256,9 @@ void Metadata::deserialize(const std::string& meta) {
         auto index = meta.find(",,");
         if (index != std::string::npos) {
             auto metadata_version_ = std::stoi(meta.substr(0, index));
-            if (metadata_version_ >= 1) { // Future versions must be backward compatible with this version.
+            if (metadata_version_ >= 2) {
+                deserialize_v2(meta);
+            } else if (metadata_version_ >= 1) { // Future versions must be backward compatible with this version.
                 deserialize_v1(meta);
             }
         } else { // old formats (without version number)
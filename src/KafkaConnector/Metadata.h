@@ -24,17 +24,29 @@ limitations under the License.
 extern int getLatestMetdataVersion();
 namespace kafka {
 
+// The end offset and the count of a batch within the batches of a table tracked by a single Offset.
+struct Split {
+    Split(int64_t end_ = -1, int64_t count_ = 0) : end(end_), count(count_) {}
+    int64_t end;
+    int64_t count;
+};
+
 struct Offset {
   public:
     Offset(int64_t begin_ = -1, int64_t end_ = -1, int64_t count_ = 0) : begin(begin_), end(end_), count(count_) {}
     int64_t begin;
     int64_t end;
     int64_t count;
+    // When more than one batch of the table is in flight, [begin, end] spans all of them, and splits holds the end and
+    // count of each batch but the last one, in the offset order. The last batch ends at end with count. Only carried
+    // by metadata version 2 and later.
+    std::vector<Split> splits;
 };
 
 /**
  * Keeps track of the metadata for a single partition. For each table it keeps track of the begin and end offset
- * of the last batch sent for that table.
+ * of the last batch sent for that table. With metadata version 2, it can also keep track of the consecutive batches
+ * of the table that are sent but not acknowledged yet, so that all of them can be re-constructed by the REPLAY.
  */
 class Metadata {
   protected:
@@ -56,6 +68,7 @@ class Metadata {
 
     void addFrom(Metadata* saved);
     void update(std::string table, int64_t begin, int64_t end, int64_t count);
+    void update(std::string table, const Offset& offset);
     int64_t min();
     int64_t max();
     int64_t getReference() { return reference; }
@@ -69,9 +82,11 @@ class Metadata {
         return false;
     }
     static int getVersion() { return metadataVersion; }
+    std::string serialize_v2() const;
     std::string serialize_v1() const;
     std::string serialize_v0() const;
     std::string serialize(int version_ = -1) const;
+    void deserialize_v2(const std::string& meta);
     void deserialize_v1(const std::string& meta);
     void deserialize_v0(const std::string& meta);
     void deserialize(const std::string& meta);
@@ -23,5 +23,8 @@ int getDefaultMetadataVersion() { return 0; }
  * If getDefaultMetadataVersion returns 0, but getLatestMetadataVersion returns 1, that means:
  * Current code can understand metadata versions 0 and 1, but it commits its metdata with verion 0.
  * We can ask the server to use version 1 to commits its metdata using HTTP API setMetadataVersion?version=1
+ *
+ * Version 2 is required for more than one flush task of a table to be in flight (max_in_flight_flush_tasks_per_table).
+ * See Metadata::serialize_v2 for the steps to roll back from version 2.
  */
-int getLatestMetdataVersion() { return 1; }
+int getLatestMetdataVersion() { return 2; }
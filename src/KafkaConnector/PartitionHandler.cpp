@@ -27,6 +27,7 @@ limitations under the License.
 #include "global.h"
 #include "nlohmann/json.hpp"
 
+#include <algorithm>
 #include <sstream>
 #include <chrono>
 #include <string>
@@ -54,7 +55,10 @@ std::string PartitionHandler::print_toppar_list(const rd_kafka_topic_partition_l
 
 PartitionHandler::PartitionHandler(const std::string& topic_, int partition_, int64_t offset_, std::string& metadata_,
                                    KafkaConnector* kafkaConnector_) :
-        topic(topic_), partitionId(partition_), kafkaConnector(kafkaConnector_) {
+        tableRegistry(kafkaConnector_->getTableRegistry()),
+        topic(topic_),
+        partitionId(partition_),
+        kafkaConnector(kafkaConnector_) {
     savedMetadata.deserialize(metadata_);
     previousMetadata = metadata_;
 
@@ -69,26 +73,41 @@ PartitionHandler::PartitionHandler(const std::string& topic_, int partition_, in
     auto replica_id = with_settings([](SETTINGS s) { return s.config.databaseServer.replica_id; });
     status.setReplicaId(replica_id);
 
+    // The batches in flight beyond the first one can only be recorded by metadata version 2 and later.
+    maxInFlightTasks = with_settings(
+        [](SETTINGS s) { return s.config.kafka.consumerConf.max_in_flight_flush_tasks_per_table; });
+    if (maxInFlightTasks == 0) {
+        maxInFlightTasks = 1;
+    } else if (maxInFlightTasks > 1 && Metadata::getVersion() < 2) {
+        LOG(WARNING) << PART_ID(partitionId) << "max_in_flight_flush_tasks_per_table: " << maxInFlightTasks
+                     << " requires metadata version 2, but metadata version " << Metadata::getVersion()
+                     << " is in use. Falling back to 1.";
+        maxInFlightTasks = 1;
+    }
+
     // Adding buffers of the metadata
     auto tables = savedMetadata.getTables();
     for (auto& table : tables) {
         CHECK(GlobalContext::instance().getBufferFactory() != nullptr)
             << "Partition Handler can not retrieve Buffer Factory.";
 
-        with_settings([this, &table](SETTINGS s) {
+        size_t table_id = tableRegistry.getId(table);
+        reserveTable(table_id);
+        replayPlanner.addTable(table_id, savedMetadata.getOffset(table));
+        with_settings([this, &table, table_id](SETTINGS s) {
             try {
-                buffers[table] = GlobalContext::instance().getBufferFactory()->createBuffer(
+                buffers[table_id] = GlobalContext::instance().getBufferFactory()->createBuffer(
                     partitionId, table, s.config.kafka.consumerConf.buffer_batch_processing_size,
                     s.config.kafka.consumerConf.buffer_batch_processing_timeout_ms, kafkaConnector);
-                buffers[table]->setCount(savedMetadata.getOffset(table).count);
+                buffers[table_id]->setCount(replayPlanner.getWindow(table_id).count);
             } catch (...) {
                 LOG(ERROR) << PART_ID(partitionId) << "Exception during creating buffer for table: " << table
                            << " when initializing PartitionHandler.";
-                buffers[table] = nullptr;
+                buffers[table_id] = nullptr;
             }
         });
 
-        CHECK(buffers[table] != nullptr) << "Buffer for table: " << table << " can not be created";
+        CHECK(buffers[table_id] != nullptr) << "Buffer for table: " << table << " can not be created";
     }
 
     PartitionState state;
@@ -112,106 +131,195 @@ PartitionHandler::PartitionHandler(const std::string& topic_, int partition_, in
                  << " mode, offsets: [" << begin << ", " << end << "]. Current pos: " << pos;
 }
 
-KafkaConnectorError PartitionHandler::commitMetadata(const rd_kafka_topic_partition_list_t* toppar_to_commit,
-                                                     rd_kafka_t* rk) {
-    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
-        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
-    auto var_zone = with_settings([this](SETTINGS s) {
-        size_t idx = kafkaConnector->getId();
-        auto& var = s.config.kafka.configVariants[idx];
-        return var.zone;
-    });
+void PartitionHandler::addToCommitList(rd_kafka_topic_partition_list_t* toppar_list) {
+    auto toppar = rd_kafka_topic_partition_list_add(toppar_list, topic.c_str(), partitionId);
+    toppar->offset = status.getMinOffset(); // Commit offset.
+    toppar->metadata = strdup(status.getSerializedMetadata().c_str());
+    toppar->metadata_size = strlen((char*)toppar->metadata);
+    committingTasks.insert(committingTasks.end(), pendingTasks.begin(), pendingTasks.end());
+    pendingTasks.clear();
 
-    auto max_number_of_kafka_commit_metadata_retries = with_settings(
-        [this](SETTINGS s) { return s.config.kafka.consumerConf.max_number_of_kafka_commit_metadata_retries; });
-
-    auto kafka_commit_metadata_max_retry_delay_ms = with_settings(
-        [this](SETTINGS s) { return s.config.kafka.consumerConf.kafka_commit_metadata_max_retry_delay_ms; });
-    auto kafka_commit_metadata_initial_retry_delay_ms = with_settings(
-        [this](SETTINGS s) { return s.config.kafka.consumerConf.kafka_commit_metadata_initial_retry_delay_ms; });
+    LOG_KAFKA(3) << PART_ID(partitionId) << "Kafka committing metadata offset: [" << status.getMinOffset() << ","
+                 << status.getMaxOffset() << "]";
+}
 
+void PartitionHandler::checkCommittedMetadata(const rd_kafka_topic_partition_t* committed_toppar) {
     // Check the current metadata to make sure it has not changed by another aggregator
-    auto committed_toppar = RebalanceHandler::get_committed_metadata(toppar_to_commit, rk);
-    if (committed_toppar != nullptr) {
-        std::string current_metadata((char*)committed_toppar->elems[0].metadata,
-                                     committed_toppar->elems[0].metadata_size);
-        if (previousMetadata != current_metadata) {
-            LOG(ERROR) << PART_ID(partitionId)
-                       << "Unexpected metadata found on the partition. Probably it is changed by another aggregator."
-                       << "\nExpected metadata: " << previousMetadata << "\nCurrent metadata: " << current_metadata;
-            // Use metrics to capture: current kafka connector is the owner and no one else should have modified the
-            // metadata.
-            kafkaconnector_metrics->metadata_committed_by_different_connector_total
-                ->labels({{"on_topic", topic}, {"on_zone", var_zone}})
-                .increment();
-        } else {
-            LOG_KAFKA(3) << PART_ID(partitionId) << "Metadata is expected: "
-                         << "\nExpected metadata: " << previousMetadata << "\nCurrent metadata: " << current_metadata;
-        }
-        rd_kafka_topic_partition_list_destroy(committed_toppar);
+    std::string current_metadata((char*)committed_toppar->metadata, committed_toppar->metadata_size);
+    if (previousMetadata != current_metadata) {
+        LOG(ERROR) << PART_ID(partitionId)
+                   << "Unexpected metadata found on the partition. Probably it is changed by another aggregator."
+                   << "\nExpected metadata: " << previousMetadata << "\nCurrent metadata: " << current_metadata;
+        // Use metrics to capture: current kafka connector is the owner and no one else should have modified the
+        // metadata.
+        std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+            nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+        auto var_zone = with_settings([this](SETTINGS s) {
+            size_t idx = kafkaConnector->getId();
+            auto& var = s.config.kafka.configVariants[idx];
+            return var.zone;
+        });
+        kafkaconnector_metrics->metadata_committed_by_different_connector_total
+            ->labels({{"on_topic", topic}, {"on_zone", var_zone}})
+            .increment();
+    } else {
+        LOG_KAFKA(3) << PART_ID(partitionId) << "Metadata is expected: "
+                     << "\nExpected metadata: " << previousMetadata << "\nCurrent metadata: " << current_metadata;
     }
+}
 
-    KafkaConnectorError result = KafkaConnectorError::NO_ERROR;
-    rd_kafka_resp_err_t err;
+void PartitionHandler::onMetadataCommitted(int64_t committed_offset, const std::string& committed_metadata) {
+    LOG_KAFKA(1) << PART_ID(partitionId) << "Committed metadata at offset: " << committed_offset << ": \""
+                 << committed_metadata << "\"";
+    previousMetadata = committed_metadata;
 
-    std::chrono::time_point<std::chrono::high_resolution_clock> offset_commit_start =
-        std::chrono::high_resolution_clock::now();
-    for (uint32_t retry = 0; retry < max_number_of_kafka_commit_metadata_retries; retry++) {
-        if (retry > 0) {
-            int delay_time = std::min(retry * kafka_commit_metadata_initial_retry_delay_ms,
-                                      kafka_commit_metadata_max_retry_delay_ms);
-            LOG(ERROR) << PART_ID(partitionId) << "Retry to commit metadata after " << delay_time << " (ms).";
-            std::this_thread::sleep_for(std::chrono::milliseconds(delay_time));
+    // The metadata that covers the flushed blocks is now persisted on Kafka, so the flush tasks can be launched. The
+    // tasks created after the commit is sent are left to the next commit.
+    for (auto& task : committingTasks) {
+        if (task != nullptr) {
+            task->start();
         }
-        err = rd_kafka_commit(rk, toppar_to_commit, 0);
+    }
+    committingTasks.clear();
+    // The following is only for debugging/testing purpose.
+    status.updateLastCommittedMetadataAndOffset();
+}
+
+void PartitionHandler::onMetadataCommitFailed() {
+    LOG(ERROR) << PART_ID(partitionId) << "Metadata commit failed, should reconsume data block from kafka";
+    // The flush tasks are never launched, and the whole kafka connector main loop gets restarted from the last commit.
+    committingTasks.clear();
+    pendingTasks.clear();
+}
+
+void PartitionHandler::reserveTable(size_t table_id) {
+    if (table_id < buffers.size())
+        return;
+    // The registry is shared by the partitions, so grow to cover all of the tables known so far.
+    size_t number_of_tables = std::max(table_id + 1, tableRegistry.size());
+    buffers.resize(number_of_tables);
+    inFlightBlocks.resize(number_of_tables);
+    replayPlanner.reserveTable(number_of_tables - 1);
+    tablesInMetadata.resize(number_of_tables, false);
+}
+
+bool PartitionHandler::resolveTable(const KafkaMessage& msg, size_t& table_id) {
+    const char* table = nullptr;
+    size_t table_size = 0;
+    if (!msg.getHeader("table", table, table_size))
+        return false;
+
+    if (lastTableId == NO_TABLE || lastTableName.compare(0, std::string::npos, table, table_size) != 0) {
+        lastTableId = tableRegistry.getId(table, table_size);
+        lastTableName.assign(table, table_size);
+        reserveTable(lastTableId);
+    }
+    table_id = lastTableId;
+    return true;
+}
+
+void PartitionHandler::removeSavedTable(size_t table_id, const std::string& table) {
+    savedMetadata.remove(table);
+    replayPlanner.removeTable(table_id);
+}
+
+bool PartitionHandler::reapInFlightBlocks(size_t table_id, bool& window_shrunk) {
+    window_shrunk = false;
+    auto& blocks = inFlightBlocks[table_id];
+    // The tasks can finish out of order, and a failure of any of them is reported right away. The whole kafka
+    // connector main loop then gets restarted from the last commit, whose metadata covers the failed task.
+    for (auto& block : blocks) {
+        if (block.task == nullptr || !block.task->isDone())
+            continue;
+        // The task is done, and the following only collects its result.
+        auto blockWait_result = block.task->blockWait();
 #ifdef _PRERELEASE
-        if (flip::Flip::instance().test_flip("[kafka-commit-error]")) {
-            LOG(INFO) << PART_ID(partitionId) << "[kafka-commit-error]: simulate kafka commit error";
-            err = rd_kafka_resp_err_t::RD_KAFKA_RESP_ERR_LISTENER_NOT_FOUND;
+        if (flip::Flip::instance().test_flip("[block-wait-return-false]")) {
+            LOG(INFO) << "[block-wait-return-false]: simulate aggregator to clickhouse blockWait error";
+            blockWait_result = false;
         }
 #endif
-        if (err) {
-            LOG(ERROR) << PART_ID(partitionId) << "Error in committing metadata: " << rd_kafka_err2str(err)
-                       << " for metadata: " << print_toppar_list(toppar_to_commit);
-            kafkaconnector_metrics->commit_offset_by_kafka_connectors_failed_total
-                ->labels(
-                    {{"on_topic", topic}, {"on_zone", var_zone}, {"error_code", std::to_string(static_cast<int>(err))}})
-                .increment();
-            result = KafkaConnectorError::KAFKA_ERROR;
+        if (!blockWait_result) {
+            LOG(ERROR) << PART_ID(partitionId) << "Flush task failed on table " << tableRegistry.getName(table_id)
+                       << " for batch [" << block.batch.begin << "," << block.batch.end << "]";
+            return false;
+        }
+        block.task = nullptr;
+    }
+
+    // The acknowledged tasks are dropped in order, with the latest tracked batch kept for the metadata.
+    while (!blocks.empty() && blocks.front().task == nullptr &&
+           (blocks.size() > 1 || blocks.front().batch.begin == Metadata::EARLIEST_OFFSET)) {
+        window_shrunk = window_shrunk || blocks.front().batch.begin != Metadata::EARLIEST_OFFSET;
+        blocks.pop_front();
+    }
+    return true;
+}
+
+size_t PartitionHandler::countInFlight(size_t table_id) const {
+    size_t count = 0;
+    for (auto& block : inFlightBlocks[table_id]) {
+        if (block.task != nullptr)
+            count++;
+    }
+    return count;
+}
+
+void PartitionHandler::addInFlightBlock(size_t table_id, const std::string& table, const FlushTaskPtr& task,
+                                        const Offset& batch) {
+    auto& blocks = inFlightBlocks[table_id];
+    blocks.push_back({task, batch});
+    while (blocks.size() > 1 && blocks.front().task == nullptr) {
+        blocks.pop_front();
+    }
+    updateTableMetadata(table_id, table);
+}
+
+void PartitionHandler::updateTableMetadata(size_t table_id, const std::string& table) {
+    Offset window;
+    for (auto& block : inFlightBlocks[table_id]) {
+        if (block.batch.begin == Metadata::EARLIEST_OFFSET)
+            continue;
+        if (window.begin == Metadata::EARLIEST_OFFSET) {
+            window.begin = block.batch.begin;
         } else {
-            LOG_KAFKA(1) << PART_ID(partitionId) << "Committed metadata: " << print_toppar_list(toppar_to_commit);
-            kafkaconnector_metrics->committed_offset_by_kafka_connector
-                ->labels({{"on_topic", topic}, {"on_zone", var_zone}})
-                .update(toppar_to_commit->elems[0].offset);
-            break;
+            window.splits.emplace_back(window.end, window.count);
         }
+        window.end = block.batch.end;
+        window.count = block.batch.count;
     }
-    std::chrono::time_point<std::chrono::high_resolution_clock> offset_commit_end =
-        std::chrono::high_resolution_clock::now();
-    uint64_t time_diff =
-        std::chrono::duration_cast<std::chrono::microseconds>(offset_commit_end.time_since_epoch()).count() -
-        std::chrono::duration_cast<std::chrono::microseconds>(offset_commit_start.time_since_epoch()).count();
-    kafkaconnector_metrics->commit_time_for_offset_commit_by_kafka_connectors
-        ->labels({{"on_topic", topic}, {"on_zone", var_zone}})
-        .observe(time_diff);
+    if (window.begin != Metadata::EARLIEST_OFFSET) {
+        status.updateMetadata(table, window);
+    }
+}
 
-    if (result == KafkaConnectorError::NO_ERROR) {
-        previousMetadata = "";
-        for (size_t i = 0; i < toppar_to_commit->elems[0].metadata_size; i++) {
-            previousMetadata.push_back(((char*)toppar_to_commit->elems[0].metadata)[i]);
+void PartitionHandler::reportReplayProgress(size_t table_id, const std::string& table, int64_t offset,
+                                            const std::string& var_topic, const std::string& var_zone) {
+    std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
+        nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
+    std::string partition = std::to_string(partitionId);
+    kafkaconnector_metrics->replay_remaining_offsets_in_kafka_connector
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}, {"partition", partition}, {"table", table}})
+        .update(replayPlanner.remaining(table_id, offset));
+    kafkaconnector_metrics->replay_pending_tables_in_kafka_connector
+        ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}, {"partition", partition}})
+        .update(replayPlanner.pendingTables());
+}
+
+void PartitionHandler::clearReplayProgress(const std::string& var_topic, const std::string& var_zone) {
+    for (size_t table_id = 0; table_id < buffers.size(); table_id++) {
+        if (replayPlanner.getWindow(table_id).begin != Metadata::EARLIEST_OFFSET) {
+            replayPlanner.removeTable(table_id);
+            reportReplayProgress(table_id, tableRegistry.getName(table_id), 0, var_topic, var_zone);
         }
     }
-    if (result != KafkaConnectorError::NO_ERROR)
-        LOG(ERROR) << PART_ID(partitionId)
-                   << "Number of retries exceeded the maximum number of retries. Rerturning failure now.";
-    return result;
 }
 
 /**
  * It picks a buffer from a table queue. It tries the queue in circular manner.
  * It returns nullptr if now the table has a buffer ready for flush.
  */
-KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
+KafkaConnectorError PartitionHandler::consume(const KafkaMessage& msg) {
     std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
         nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
 
@@ -221,12 +329,13 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
         return std::make_tuple(var.zone, var.topic);
     });
 
-    LOG_KAFKA(4) << PART_ID(partitionId) << "Consuming message [" << msg->offset() << "] in state "
+    LOG_KAFKA(4) << PART_ID(partitionId) << "Consuming message [" << msg.offset() << "] in state "
                  << (status.getState() == REPLAY ? "REPLAY" : "CONSUME");
     // Currently if the kakfa message header format is wrong, we return NO_ERROR as we expect that this should not
     // happen.
-    if (!msg->headers() || msg->headers()->get("table").size() == 0) {
-        LOG(ERROR) << PART_ID(partitionId) << "Table is not set as the header for message [" << msg->offset()
+    size_t table_id = NO_TABLE;
+    if (!resolveTable(msg, table_id)) {
+        LOG(ERROR) << PART_ID(partitionId) << "Table is not set as the header for message [" << msg.offset()
                    << "]. This message is in bad format and will be ignored.";
         // To have metric to monitor this message in wrong format situation
         kafkaconnector_metrics->kafka_message_in_wrong_format_total
@@ -234,10 +343,11 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
             .increment();
         return NO_ERROR;
     }
+    const std::string& table = lastTableName;
     // Checking the offset
     auto last_known_offset = status.getLastKnownOffset();
     // Abnormal condition 1: Message offset = 0 is an abnormal situation.
-    if (last_known_offset > 0 && msg->offset() == 0) {
+    if (last_known_offset > 0 && msg.offset() == 0) {
         LOG(WARNING) << PART_ID(partitionId)
                      << "Kafka offset got reset. All exisiting buffers will flush. The new message will be consumed. "
                         "offset before reset: "
@@ -257,23 +367,24 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
         // Furthermore, this buffer "end" to be set to -1 is not needed for the re-wind (the next condition being
         // checked), as skipping the messages that have offset lower than the buffer's "end" offset is actually correct.
         status.clearMetadata();
+        std::fill(tablesInMetadata.begin(), tablesInMetadata.end(), false);
         status.setState(CONSUME);
-    } else if (msg->offset() <= last_known_offset) {
+    } else if (msg.offset() <= last_known_offset) {
         // Abnormal condition 2: kafka message rewound
         LOG(WARNING) << PART_ID(partitionId)
                      << "Kafka offset got rewound. Message will be ignored. last known offset: " << last_known_offset
-                     << " new offset: " << msg->offset();
+                     << " new offset: " << msg.offset();
         kafkaconnector_metrics->kafka_offset_went_backward_total
             ->labels({{"on_topic", identified_topic},
                       {"partition", std::to_string(partitionId)},
                       {"on_zone", identified_zone}})
             .increment();
         return NO_ERROR; // message rejected to be consumed.
-    } else if (msg->offset() > last_known_offset + 1) {
+    } else if (msg.offset() > last_known_offset + 1) {
         // Abnormal condition 3:  kafka message offset jumps dis-continuously
         LOG(WARNING) << PART_ID(partitionId)
                      << "Kafka offset is larger than what expected. Message will be still consumed. last known offset: "
-                     << last_known_offset << " new offset: " << msg->offset();
+                     << last_known_offset << " new offset: " << msg.offset();
         kafkaconnector_metrics->kafka_offset_larger_than_expected_total
             ->labels({{"on_topic", identified_topic},
                       {"partition", std::to_string(partitionId)},
@@ -282,9 +393,7 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
     }
 
     // Message accepted to be consumed, so we continue with the rest.
-    status.setLastKnownOffset(msg->offset());
-
-    std::string table = (char*)(msg->headers()->get("table")[0].value());
+    status.setLastKnownOffset(msg.offset());
 
     /**
      * When reference is -1, it is either at the beginning of the whole system being just started, or we have flushed
@@ -299,17 +408,20 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
         // Setting the reference to be the current message offset. Since in current Version = 0, reference will not be
         // persisted for saved metadata.  Thus next time the new partition handler gets created, the reference is reset
         // to -1 again.
-        status.setReference(msg->offset());
+        status.setReference(msg.offset());
         // Note that all buffers are created at the Partition Handler constructor based on the tables specified in the
         // saved-metadata.
-        for (auto buffer : buffers) {
-            buffer.second->setCount(0);
+        for (size_t id = 0; id < buffers.size(); id++) {
+            auto& buffer = buffers[id];
+            if (buffer == nullptr)
+                continue;
+            buffer->setCount(0);
 
             // Because this is the beginning of the partition handler's execution (due to reference = -1), we should not
             // have the situation that the buffer is not empty.
-            if (!buffer.second->empty()) {
+            if (!buffer->empty()) {
                 LOG(ERROR) << PART_ID(partitionId)
-                           << "Reference is -1 while buffer is not empty. Table= " << buffer.first;
+                           << "Reference is -1 while buffer is not empty. Table= " << tableRegistry.getName(id);
                 kafkaconnector_metrics->partition_handler_reference_wrong_total
                     ->labels({{"on_topic", identified_topic}, {"on_zone", identified_zone}})
                     .increment();
@@ -322,26 +434,26 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
      * the current message, not the tables identified in the saved metadata from which this Partition Handler is
      * created.
      */
-    auto it = buffers.find(table);
-    if (it == buffers.end()) {
+    auto& buffer = buffers[table_id];
+    if (buffer == nullptr) {
         CHECK(GlobalContext::instance().getBufferFactory() != nullptr)
             << "Partition Handler can not retrieve Buffer Factory.";
         try {
-            with_settings([this, &table](SETTINGS s) {
-                buffers[table] = GlobalContext::instance().getBufferFactory()->createBuffer(
+            with_settings([this, &table, &buffer](SETTINGS s) {
+                buffer = GlobalContext::instance().getBufferFactory()->createBuffer(
                     partitionId, table, s.config.kafka.consumerConf.buffer_batch_processing_size,
                     s.config.kafka.consumerConf.buffer_batch_processing_timeout_ms, kafkaConnector);
             });
             // metadata records (begin, end, count)
-            buffers[table]->setCount(0);
+            buffer->setCount(0);
         } catch (...) {
             LOG(ERROR) << PART_ID(partitionId) << "Exception during creating buffer for table: " << table
-                       << ". when message offset reaches: " << msg->offset();
-            buffers[table] = nullptr;
+                       << ". when message offset reaches: " << msg.offset();
+            buffer = nullptr;
         }
 
         // If the buffer can not be created from above, then CHECK will fail and the whole process exits.
-        CHECK(buffers[table] != nullptr) << "Buffer for table: " << table << " can not be created ";
+        CHECK(buffer != nullptr) << "Buffer for table: " << table << " can not be created ";
     }
 
     /**
@@ -358,21 +470,21 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
     */
     int count = 0;
     if (savedMetadata.getReference() == -1) { // metadata version 0
-        count = buffers[table]->count() + 1;
+        count = buffer->count() + 1;
     } else {
         // In the following condition, this table is still under REPLAY mode. Therefore the count has been included
         // in the saved metadata, and count does not get advanced.
-        if (msg->offset() <= savedMetadata.getOffset(table).end) {
-            count = savedMetadata.getOffset(table).count;
+        if (msg.offset() <= replayPlanner.getWindow(table_id).end) {
+            count = replayPlanner.countAt(table_id, msg.offset());
         } else {
             // In the following condition, this table is not in the REPLAY mode any more, and thus we use the regular
             // counting method.
-            count = buffers[table]->count() + 1;
+            count = buffer->count() + 1;
         }
     }
-    buffers[table]->setCount(count);
+    buffer->setCount(count);
     if (status.getState() == REPLAY) {
-        pos = msg->offset();
+        pos = msg.offset();
         if (pos > end) {
             /*At this special condition, we need to check whether it should be an issue when pos > end, for all of the
             tables, *not just the current table.
@@ -413,7 +525,8 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
             // For all of the tables, even though some tables have already finished replay earlier, the last table that
             // finishes the replay is at pos = end.
             status.setState(CONSUME);
-            if (!append(table, (const char*)msg->payload(), msg->len(), msg->offset(), msg->timestamp().timestamp)) {
+            clearReplayProgress(identified_topic, identified_zone);
+            if (!append(table_id, table, msg.payload(), msg.len(), msg.offset(), msg.timestamp())) {
                 return MSG_ERROR;
             }
             kafkaconnector_metrics->batched_messages_replayed_by_kafka_connectors_total
@@ -421,7 +534,7 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
                 .increment();
             kafkaconnector_metrics->batched_messages_replayed_by_kafka_connectors_bytes_total
                 ->labels({{"on_topic", identified_topic}, {"on_zone", identified_zone}})
-                .increment(msg->len());
+                .increment(msg.len());
 
             return NO_ERROR;
         } else if (pos < begin) {
@@ -436,7 +549,8 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
             // The solution is for us to immediately go to the consume mode since this condition violates what is
             // expected in the normal situation.
             status.setState(CONSUME);
-            if (!append(table, (const char*)msg->payload(), msg->len(), msg->offset(), msg->timestamp().timestamp)) {
+            clearReplayProgress(identified_topic, identified_zone);
+            if (!append(table_id, table, msg.payload(), msg.len(), msg.offset(), msg.timestamp())) {
                 return MSG_ERROR;
             }
 
@@ -445,12 +559,12 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
                 .increment();
             kafkaconnector_metrics->batched_messages_replayed_by_kafka_connectors_bytes_total
                 ->labels({{"on_topic", identified_topic}, {"on_zone", identified_zone}})
-                .increment(msg->len());
+                .increment(msg.len());
 
             return NO_ERROR;
         }
 
-        auto offset = savedMetadata.getOffset(table);
+        auto offset = replayPlanner.getWindow(table_id);
         // -1 means for this particular table, no metadata has been recorded at all. It could be that the replay of this
         // table is done, and the table entry gets removed from the savedMetadata, and thus the above getOffset(.)
         // return -1 when table can not be found any more.
@@ -458,31 +572,30 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
             // The condition that the message offset passed the "end" offset of the table. So for this table, it is
             // already in the CONSUME mode. In fact, when it comes here, all tables should be already in the CONSUME
             // mode.
-            if (msg->offset() > offset.end) {
-                LOG_KAFKA(4) << PART_ID(partitionId) << "Appending message [" << msg->offset()
+            if (msg.offset() > offset.end) {
+                LOG_KAFKA(4) << PART_ID(partitionId) << "Appending message [" << msg.offset()
                              << "] in consume mode for table (" << table << ")";
-                if (!append(table, (const char*)msg->payload(), msg->len(), msg->offset(),
-                            msg->timestamp().timestamp)) {
+                if (!append(table_id, table, msg.payload(), msg.len(), msg.offset(), msg.timestamp())) {
                     return MSG_ERROR;
                 }
                 // Because we have the other saved-metadata removed for the situation when offset = end, so this entire
                 // if-condition block should never come in the normal situation.
-                savedMetadata.remove(table);
+                removeSavedTable(table_id, table);
             } else if (offset.begin <= offset.end) {
                 // The following condition is normal.
-                if (msg->offset() >= offset.begin) {
+                if (replayPlanner.decide(table_id, msg.offset()) == ReplayPlanner::REPLAY) {
                     // The following records the first message at the REPLAY mode
-                    if (msg->offset() == offset.begin) {
+                    if (msg.offset() == offset.begin) {
                         LOG_KAFKA(4) << PART_ID(partitionId) << "Enter table [" << table << "] replay batch, start ["
                                      << offset.begin << "]"
                                      << " end[ " << offset.end << "]";
                     }
-                    if (!append(table, (const char*)msg->payload(), msg->len(), msg->offset(),
-                                msg->timestamp().timestamp)) {
+                    if (!append(table_id, table, msg.payload(), msg.len(), msg.offset(), msg.timestamp())) {
                         return MSG_ERROR;
                     }
                     LOG_KAFKA(4) << PART_ID(partitionId) << "buffer for [" << table
-                                 << "] begin: " << buffers[table]->begin() << " end: " << buffers[table]->end();
+                                 << "] begin: " << buffer->begin() << " end: " << buffer->end();
+                    reportReplayProgress(table_id, table, msg.offset(), identified_topic, identified_zone);
                 } else {
                     /* We ignore the message as it is older than the begin of the last batch for this table. That can
                      * happen because the entire replay starts with "min" of all of the tables. And thus for a
@@ -493,29 +606,27 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
                      * replaying from 1 (min(1,4)).Msg at Offset 2 gets covered in this range, and thus will be read But
                      * we will ignore offset = 2 here at table 2.
                      */
+                    kafkaconnector_metrics->batched_messages_replay_ignored_by_kafka_connectors_total
+                        ->labels({{"on_topic", identified_topic}, {"on_zone", identified_zone}})
+                        .increment();
                 }
 
-                // This situation means that this message is the last message to be replayed for this table.
-                if (msg->offset() == offset.end) {
+                // This situation means that this message is the last message of a batch to be replayed for this table,
+                // with the batches before the last one only present when more than one batch was in flight.
+                if (replayPlanner.isBatchEnd(table_id, msg.offset())) {
 
                     LOG_KAFKA(1) << PART_ID(partitionId)
                                  << " reconstruction of the previous buffer is done. Flushing buffer now.";
                     LOG_KAFKA(2) << PART_ID(partitionId) << "Updating replay batch for table: " << table
-                                 << " begin: " << buffers[table]->begin() << " end: " << buffers[table]->end();
-                    status.updateReplayedBatch(table, buffers[table]->begin(), buffers[table]->end(),
-                                               buffers[table]->count());
+                                 << " begin: " << buffer->begin() << " end: " << buffer->end();
+                    status.updateReplayedBatch(table, buffer->begin(), buffer->end(), buffer->count());
                     LOG_KAFKA(2) << PART_ID(partitionId) << "Replay batches: " << status.getSerializedReplayedBatches();
 
-                    // Update state information (in particular, count, which matters here in) to the in-memory status
-                    // Actually, there is no begin and end that need to be updated as it is still in the REPLAY mode.
-                    status.updateMetadata(table, buffers[table]->begin(), buffers[table]->end(),
-                                          buffers[table]->count());
-
-                    auto task = buffers[table]->flush();
-                    auto table_task = activeTasks.find(table);
+                    Offset batch(buffer->begin(), buffer->end(), buffer->count());
+                    auto task = buffer->flush();
                     // Note the following situation should not happen in the normal situation when the partition handler
-                    // is at the end of the REPLAY mode and only one task per table will ever be launched at this time.
-                    if (table_task != activeTasks.end() && !table_task->second->isDone()) {
+                    // is in the REPLAY mode, as the replayed batches of a table are at most the in-flight ones.
+                    if (countInFlight(table_id) >= maxInFlightTasks) {
                         LOG(WARNING) << PART_ID(partitionId)
                                      << "flush task should have been finished but it is not, table " << table;
 
@@ -524,9 +635,16 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
                             ->labels({{"on_topic", identified_topic}, {"on_zone", identified_zone}, {"table", table}})
                             .increment();
                     }
-                    activeTasks[table] = task;
-                    task->start();               // Only one task per table in the REPLAY mode can happen.
-                    savedMetadata.remove(table); // Remove the entry from the metadata tracker.
+                    // Update state information (in particular, count, which matters here in) to the in-memory status.
+                    // The replayed batches are already covered by the saved metadata, and thus the task is launched
+                    // without another metadata commit.
+                    addInFlightBlock(table_id, table, task, batch);
+                    task->start();
+                    if (msg.offset() != offset.end) {
+                        return NO_ERROR; // More batches of the table are to be replayed.
+                    }
+                    removeSavedTable(table_id, table); // Remove the entry from the metadata tracker.
+                    reportReplayProgress(table_id, table, msg.offset(), identified_topic, identified_zone);
                     // The following condition happens when all of the tables are removed from saved-metadata after
                     // being replayed. Thus, the whole partition handler now moves to the CONSUME mode.
                     if (savedMetadata.empty()) {
@@ -542,28 +660,33 @@ KafkaConnectorError PartitionHandler::consume(RdKafka::Message* msg) {
                     }
                 }
             } else {
-                LOG_KAFKA(4) << PART_ID(partitionId) << "Message " << msg->offset() << " is not consumed for table ["
+                LOG_KAFKA(4) << PART_ID(partitionId) << "Message " << msg.offset() << " is not consumed for table ["
                              << table << "], as this messages is already applied by the store.";
+                kafkaconnector_metrics->batched_messages_replay_ignored_by_kafka_connectors_total
+                    ->labels({{"on_topic", identified_topic}, {"on_zone", identified_zone}})
+                    .increment();
             }
         } else {
             // Do not have any metadata, directly go to the Consume mode for this table.
-            LOG_KAFKA(4) << PART_ID(partitionId) << "Appending message [" << msg->offset()
+            LOG_KAFKA(4) << PART_ID(partitionId) << "Appending message [" << msg.offset()
                          << "] in consume mode for table (" << table
                          << ") that either does not have metadata or the reconstruction of its previous batch is done";
-            if (!append(table, (const char*)msg->payload(), msg->len(), msg->offset(), msg->timestamp().timestamp)) {
+            if (!append(table_id, table, msg.payload(), msg.len(), msg.offset(), msg.timestamp())) {
                 return MSG_ERROR;
             }
         }
     } else { // We are at the Consume mode
-        if (!append(table, (const char*)msg->payload(), msg->len(), msg->offset(), msg->timestamp().timestamp)) {
+        if (!append(table_id, table, msg.payload(), msg.len(), msg.offset(), msg.timestamp())) {
             return MSG_ERROR;
         }
     }
     return NO_ERROR;
 } // namespace kafka
 
-KafkaConnectorError PartitionHandler::checkBuffers(rd_kafka_t* rk) {
+KafkaConnectorError PartitionHandler::checkBuffers(bool& commit_required) {
     KafkaConnectorError result = KafkaConnectorError::NO_ERROR;
+    commit_required = false;
+    backPressure = NO_BACK_PRESSURE;
 
     //_log_info(logger, "entering check buffer for Partition [%d]", partitionId);
     LOG_KAFKA(3) << PART_ID(partitionId) << "checking buffer, offset: [" << status.getMinOffset() << ","
@@ -580,10 +703,34 @@ KafkaConnectorError PartitionHandler::checkBuffers(rd_kafka_t* rk) {
 
     int64_t currentLastOffset = status.getLastKnownOffset();
     std::vector<FlushTaskPtr> new_tasks;
-    bool commitRequired = false;
-    for (auto& entry : buffers) {
-        auto table = entry.first;
-        auto buffer = entry.second;
+    for (size_t table_id = 0; table_id < buffers.size(); table_id++) {
+        auto& buffer = buffers[table_id];
+        if (buffer == nullptr)
+            continue;
+
+        // The finished flush tasks are collected whether the buffer is flushable or not, so that a failure is found
+        // early, and the acknowledged batches leave the metadata as soon as possible.
+        bool window_shrunk = false;
+        if (!reapInFlightBlocks(table_id, window_shrunk)) {
+            kafkaconnector_metrics->task_block_wait_failed_in_kafka_connectors
+                ->labels({{"on_topic", identified_topic}, {"on_zone", identified_zone}})
+                .increment();
+
+            LOG(ERROR) << PART_ID(partitionId) << "Flush task failed on table " << tableRegistry.getName(table_id)
+                       << ", return CH_ERROR";
+            result = KafkaConnectorError::CH_ERROR;
+            commit_required = false;
+            break; // Return error for any flush failure.
+        }
+        // Note: when block waiting fails, the entire kafka-connector main loop will be reset, including removing all of
+        // the partition handlers, and thus all associated tasks will be aborted any way. So in the above block the flow
+        // exits due to block-wait failure.
+
+        const std::string& table = tableRegistry.getName(table_id);
+        if (window_shrunk) {
+            updateTableMetadata(table_id, table);
+            commit_required = true;
+        }
         if (!buffer->flushable())
             continue;
         // We do not want to create new metadata to the Broker to represent the state that
@@ -601,93 +748,56 @@ KafkaConnectorError PartitionHandler::checkBuffers(rd_kafka_t* rk) {
         //            buffer->begin(), buffer->end());
         LOG_KAFKA(3) << PART_ID(partitionId) << "Buffer {" << table << "[" << buffer->begin() << "," << buffer->end()
                      << "]} is flushable.";
-        auto task_it = activeTasks.find(table);
-        // We have a pending task that has been launched, and we need to wait for it to finish.
-        if (task_it != activeTasks.end()) {
-            if (task_it->second == nullptr) {
-                LOG_KAFKA(1) << PART_ID(partitionId) << "encounter task to be nullptr on table: " << table;
-            } else {
-                if (!task_it->second->isDone()) {
-                    LOG_KAFKA(3) << PART_ID(partitionId) << "waiting for the previous task on table: " << table;
-                }
-                auto blockWait_result = task_it->second->blockWait();
-#ifdef _PRERELEASE
-                if (flip::Flip::instance().test_flip("[block-wait-return-false]")) {
-                    LOG(INFO) << "[block-wait-return-false]: simulate aggregator to clickhouse blockWait error";
-                    blockWait_result = false;
-                }
-#endif
-                if (!blockWait_result) {
-                    kafkaconnector_metrics->task_block_wait_failed_in_kafka_connectors
-                        ->labels({{"on_topic", identified_topic}, {"on_zone", identified_zone}})
-                        .increment();
-
-                    LOG(ERROR) << PART_ID(partitionId) << "Flush task failed on table " << table << ", return CH_ERROR";
-                    result = KafkaConnectorError::CH_ERROR;
-                    commitRequired = false;
-                    break; // Return error for any flush failure.
-                }
-
-                // Note: when block waiting fails, the entire kafka-connector main loop will be reset, including
-                // removing all of the partition handlers, and thus all associated tasks will be aborted any way. So in
-                // the above block the flow exits due to block-wait failure.
-                activeTasks.erase(task_it);
-            }
+        // The table has reached its in-flight limit. Rather than blocking the kafka connector thread on the earlier
+        // tasks, the buffer is left to the next check, and the partition gets paused until a task finishes, so that
+        // the other tables and partitions keep being consumed and the consumer keeps polling.
+        size_t in_flight = countInFlight(table_id);
+        if (in_flight >= maxInFlightTasks) {
+            LOG_KAFKA(3) << PART_ID(partitionId) << in_flight << " previous tasks on table: " << table
+                         << " are still in flight, back-pressure on the partition";
+            backPressure = IN_FLIGHT_LIMIT;
+            continue;
         }
 
-        commitRequired = true;
         if (buffer->empty()) {
+            // The special marker would drop the batches still in flight from the metadata, so it waits for them.
+            if (in_flight > 0)
+                continue;
+            commit_required = true;
             // At the first time the buffer is empty, the special marker is written down. If the buffer continues to
             // be empty in the next check buffer, there is no actual status update happened  on this metadata, even
             // though the following method is still invoked (invoked, but no actual value update), because the earlier
             // decision logic has already conveyed "buffer is empty and begin = end + 1".
             status.updateMetadata(table, currentLastOffset + 1, currentLastOffset, buffer->count());
+            inFlightBlocks[table_id].clear();
             // ToDo check buffer flush of Xinglong's code
             LOG_KAFKA(4) << PART_ID(partitionId) << "Buffer is empty but flushable for table: " << table;
             auto task = buffer->flush();
             if (task != nullptr) {
                 LOG(WARNING) << "Empty task should be nullptr";
                 new_tasks.push_back(task);
-                activeTasks[table] = task;
+                inFlightBlocks[table_id].push_back({task, Offset()});
             }
         } else {
-            status.updateMetadata(table, buffer->begin(), buffer->end(), buffer->count());
+            commit_required = true;
+            // The metadata of the table spans the batches still in flight and the new one, and it is committed before
+            // the new task gets launched.
+            Offset batch(buffer->begin(), buffer->end(), buffer->count());
             auto task = buffer->flush();
             if (task != nullptr) {
                 new_tasks.push_back(task);
-                activeTasks[table] = task;
             }
+            addInFlightBlock(table_id, table, task, batch);
         }
     }
 
-    // If commit required, perform metadata commit first, and when commit succeeds, then launch the pending tasks
-    if (commitRequired) {
-        auto toppar_list = rd_kafka_topic_partition_list_new(1);
-        rd_kafka_topic_partition_list_add(toppar_list, topic.c_str(), partitionId);
-        toppar_list->elems[0].offset = status.getMinOffset(); // Commit offset.
-        toppar_list->elems[0].metadata = strdup(status.getSerializedMetadata().c_str());
-        toppar_list->elems[0].metadata_size = strlen((char*)toppar_list->elems[0].metadata);
-
-        LOG_KAFKA(3) << PART_ID(partitionId) << "Kafka committing metadata offset: [" << status.getMinOffset() << ","
-                     << status.getMaxOffset() << "]";
-
-        if (commitMetadata(toppar_list, rk) != KafkaConnectorError::NO_ERROR) {
-            LOG(ERROR) << PART_ID(partitionId) << "Metadata commit failed, should reconsume data block from kafka";
-            kafkaconnector_metrics->kafka_commit_metadata_finally_failed_total
-                ->labels({{"on_topic", identified_topic}, {"on_zone", identified_zone}})
-                .increment();
-            result = KafkaConnectorError::KAFKA_ERROR;
-        } else {
-            for (auto& task : new_tasks) {
-                if (task != nullptr) {
-                    task->start();
-                }
-            }
-            // The following is only for debugging/testing purpose.
-            status.updateLastCommittedMetadataAndOffset();
-        }
-        rd_kafka_topic_partition_list_destroy(toppar_list);
+    // If commit required, the metadata commit is performed first (by the commit coordinator), and only when the commit
+    // succeeds, the pending tasks get launched. The tasks still pending from an earlier check, whose commit is deferred
+    // behind the one in flight, are kept.
+    if (commit_required) {
+        pendingTasks.insert(pendingTasks.end(), new_tasks.begin(), new_tasks.end());
     }
+
     std::chrono::time_point<std::chrono::high_resolution_clock> check_buffers_end =
         std::chrono::high_resolution_clock::now();
     uint64_t time_diff =
@@ -707,8 +817,8 @@ KafkaConnectorError PartitionHandler::checkBuffers(rd_kafka_t* rk) {
  does not happen and the same replica pick up this partition, it will go through the Partition Handler initialization
  again.
  */
-bool PartitionHandler::append(std::string table, const char* data, size_t data_size, int64_t offset,
-                              int64_t msg_timestamp) {
+bool PartitionHandler::append(size_t table_id, const std::string& table, const char* data, size_t data_size,
+                              int64_t offset, int64_t msg_timestamp) {
     std::shared_ptr<nuclm::KafkaConnectorMetrics> kafkaconnector_metrics =
         nuclm::MetricsCollector::instance().getKafkaConnectorMetrics();
     auto [identified_zone, identified_topic] = with_settings([this](SETTINGS s) {
@@ -725,12 +835,13 @@ bool PartitionHandler::append(std::string table, const char* data, size_t data_s
                      msg_timestamp);
 
     /**
-     * The buffers[table]->end() indicates the last messages appended to the buffer. Note: end is defaulted to -1.
+     * The buffers[table_id]->end() indicates the last messages appended to the buffer. Note: end is defaulted to -1.
      * When offset is less than or equal to this end, then this means Kafka message got rewound or is duplicated.
      * This should not happen in the normal situation.
      */
-    if (offset > buffers[table]->end()) {
-        if (buffers[table]->append(data, data_size, offset, msg_timestamp)) {
+    auto& buffer = buffers[table_id];
+    if (offset > buffer->end()) {
+        if (buffer->append(data, data_size, offset, msg_timestamp)) {
             LOG_KAFKA(5) << PART_ID(partitionId) << "appended msg: " << offset;
 
             // Important: if the table is missing on the metadata, add it to the metadata.
@@ -738,8 +849,11 @@ bool PartitionHandler::append(std::string table, const char* data, size_t data_s
             // consumed, we will record this special marker to indicate that "at least this is the message that we
             // should start for replaying; not any message earlier". otherwise, the replay can go to a higher offset due
             // to the other table, and therefore replay will miss some messages that belong to this table.
-            if (status.getOffset(table).begin == -1) {
-                status.updateMetadata(table, offset, offset - 1, 0);
+            if (!tablesInMetadata[table_id]) {
+                if (status.getOffset(table).begin == -1) {
+                    status.updateMetadata(table, offset, offset - 1, 0);
+                }
+                tablesInMetadata[table_id] = true;
             }
             return true;
         } else {
@@ -762,9 +876,16 @@ bool PartitionHandler::append(std::string table, const char* data, size_t data_s
 
 // This method only handles the situation when the whole message offset gets reset to 0.
 void PartitionHandler::flushAll() {
-    for (auto buffer : buffers) {
-        auto task = buffer.second->flush();
-        activeTasks[buffer.first] = task;
+    for (size_t table_id = 0; table_id < buffers.size(); table_id++) {
+        if (buffers[table_id] == nullptr)
+            continue;
+        auto task = buffers[table_id]->flush();
+        // The metadata gets cleared after the offset reset, and thus none of the batches is tracked any more.
+        auto& blocks = inFlightBlocks[table_id];
+        for (auto& block : blocks) {
+            block.batch = Offset();
+        }
+        blocks.push_back({task, Offset()});
         task->start();
     }
 }
@@ -19,6 +19,9 @@ limitations under the License.
 #include "FlushTask.h"
 #include "Metadata.h"
 #include "Buffer.h"
+#include "KafkaMessage.h"
+#include "ReplayPlanner.h"
+#include "TableRegistry.h"
 
 #include <librdkafka/rdkafka.h>
 #include <librdkafka/rdkafkacpp.h>
@@ -26,6 +29,7 @@ limitations under the License.
 
 #include <mutex>
 #include <condition_variable>
+#include <deque>
 #include <queue>
 #include <iostream>
 #include "common/logging.hpp"
@@ -40,6 +44,12 @@ static std::vector<std::string> KafkaConnectorErrorNames = {"NO_ERROR", "KAFKA_E
 
 inline std::string getKafkaConnectorErrorName(KafkaConnectorError error) { return KafkaConnectorErrorNames[error]; }
 
+// The reason for a partition to be paused by the back-pressure controller.
+enum BackPressureReason { NO_BACK_PRESSURE = 0, IN_FLIGHT_LIMIT = 1 };
+static std::vector<std::string> BackPressureReasonNames = {"none", "in_flight_limit"};
+
+inline std::string getBackPressureReasonName(BackPressureReason reason) { return BackPressureReasonNames[reason]; }
+
 class KafkaConnector;
 
 /**
@@ -100,6 +110,10 @@ class PartitionHandler {
             std::lock_guard<std::mutex> lck(mtx);
             metadata.update(table, begin_, end_, count);
         }
+        void updateMetadata(const std::string& table, const Offset& offset) {
+            std::lock_guard<std::mutex> lck(mtx);
+            metadata.update(table, offset);
+        }
 
         void clearMetadata() {
             std::lock_guard<std::mutex> lck(mtx);
@@ -173,15 +187,34 @@ class PartitionHandler {
         std::mutex mtx;
     };
 
+    // A flush task of a table along with the batch that it flushes.
+    struct InFlightBlock {
+        FlushTaskPtr task; // nullptr once the task is acknowledged
+        Offset batch;      // with begin being -1 if the batch is not tracked by the metadata
+    };
+
   private:
     PartitionHandlerStatus status;
-    std::unordered_map<std::string, std::shared_ptr<Buffer>>
-        buffers; // buffers that we are currently filling  table --> Buffer
-    std::unordered_map<std::string, FlushTaskPtr> activeTasks; // table --> FlushTask
+    // The per-table state is indexed by the table ID given by the table registry of the kafka connector, with the
+    // entries of the tables not seen by this partition yet being nullptr.
+    TableRegistry& tableRegistry;
+    std::vector<std::shared_ptr<Buffer>> buffers; // buffers that we are currently filling  table ID --> Buffer
+    // table ID --> the flush tasks from the earliest one not acknowledged yet to the latest one, in the offset order.
+    // The metadata of the table spans all of them, so that a failure rewinds to the earliest one not acknowledged.
+    std::vector<std::deque<InFlightBlock>> inFlightBlocks;
+    size_t maxInFlightTasks; // the number of flush tasks of a table allowed to be in flight at the same time
+    std::vector<bool> tablesInMetadata; // table ID --> whether the table is already recorded in the status metadata
+    // flush tasks created by checkBuffers, to be launched only after the metadata commit gets acknowledged.
+    std::vector<FlushTaskPtr> pendingTasks;
+    // flush tasks covered by the metadata commit in flight, to be launched once the commit is acknowledged.
+    std::vector<FlushTaskPtr> committingTasks;
+    // the back-pressure found by the last checkBuffers, for the partition to be paused until it is gone.
+    BackPressureReason backPressure = NO_BACK_PRESSURE;
 
     // Metadata metadata;      // metadata containing metadata for all tables for this partition
     Metadata savedMetadata; // what we read from Kafka upon recovery. One time initialization, and we only remove from
                             // it
+    ReplayPlanner replayPlanner; // the replay windows of the tables in savedMetadata, indexed by the table ID
     std::string previousMetadata;
 
     std::string topic;
@@ -198,7 +231,31 @@ class PartitionHandler {
     // reference back to the kafka connector.
     KafkaConnector* kafkaConnector;
 
-    bool append(std::string table, const char* data, size_t data_size, int64_t offset, int64_t msg_timestamp);
+    // The table of the last consumed message, to skip the table registry lookup when the following messages are for
+    // the same table, which is always the case for the topics with a single table.
+    static constexpr size_t NO_TABLE = static_cast<size_t>(-1);
+    size_t lastTableId = NO_TABLE;
+    std::string lastTableName;
+
+    // To resolve the table ID of the message, with false returned if the message does not have the table header.
+    bool resolveTable(const KafkaMessage& msg, size_t& table_id);
+    // To make room for the table ID in the per-table state.
+    void reserveTable(size_t table_id);
+    void removeSavedTable(size_t table_id, const std::string& table);
+    // To collect the results of the finished flush tasks of the table, with false returned if any of them failed.
+    // window_shrunk is set to true if the acknowledged tasks at the front are dropped from the in-flight window.
+    bool reapInFlightBlocks(size_t table_id, bool& window_shrunk);
+    size_t countInFlight(size_t table_id) const;
+    // To add the flushed batch of the table to its in-flight window, and to set the metadata of the table to span the
+    // whole window.
+    void addInFlightBlock(size_t table_id, const std::string& table, const FlushTaskPtr& task, const Offset& batch);
+    void updateTableMetadata(size_t table_id, const std::string& table);
+    // To export the replay progress of the table at the offset, and to reset it when the REPLAY mode is left.
+    void reportReplayProgress(size_t table_id, const std::string& table, int64_t offset, const std::string& var_topic,
+                              const std::string& var_zone);
+    void clearReplayProgress(const std::string& var_topic, const std::string& var_zone);
+    bool append(size_t table_id, const std::string& table, const char* data, size_t data_size, int64_t offset,
+                int64_t msg_timestamp);
     void flushAll();
 
   public:
@@ -211,11 +268,25 @@ class PartitionHandler {
 
     int64_t getOffset() { return status.getLastKnownOffset(); }
     bool consumeMode() { return status.getState() == CONSUME; }
-    KafkaConnectorError consume(RdKafka::Message* msg);
-    KafkaConnectorError checkBuffers(rd_kafka_t* rk);
-
-    KafkaConnectorError commitMetadata(const rd_kafka_topic_partition_list_t* toppar_to_commit, rd_kafka_t* rk);
+    KafkaConnectorError consume(const KafkaMessage& msg);
+    // To flush the flushable buffers, with commit_required to be true if the metadata needs to be committed before
+    // the resulted flush tasks can be launched. A flushable buffer whose table has reached its in-flight limit is left
+    // to the next check, with the back-pressure raised on the partition.
+    KafkaConnectorError checkBuffers(bool& commit_required);
+    BackPressureReason getBackPressure() const { return backPressure; }
+
+    // The following are invoked by the commit coordinator, for the metadata commit that follows checkBuffers. The
+    // pending flush tasks are taken by the commit added to the list, and a retried commit takes the tasks of the
+    // failed one along with the pending tasks created since, as its metadata covers all of them.
+    void addToCommitList(rd_kafka_topic_partition_list_t* toppar_list);
+    void checkCommittedMetadata(const rd_kafka_topic_partition_t* committed_toppar);
+    void onMetadataCommitted(int64_t committed_offset, const std::string& committed_metadata);
+    void onMetadataCommitFailed();
+
+    const std::string& getTopic() const { return topic; }
     int getPartitionId() { return partitionId; }
+    // fixed at the construction, according to the metadata version in use at that time.
+    size_t getMaxInFlightTasks() const { return maxInFlightTasks; }
     nlohmann::json toJson() { return status.toJson(); }
     std::string getSerializedReplayedBatches() { return status.getSerializedReplayedBatches(); }
     std::string getInitialMetadata() { return status.getInitialMetadata(); }
@@ -30,6 +30,8 @@ limitations under the License.
 namespace kafka {
 void RebalanceHandler::rebalance_cb(RdKafka::KafkaConsumer* consumer, RdKafka::ErrorCode err,
                                     std::vector<RdKafka::TopicPartition*>& partitions) {
+    // the metadata commit request being sent goes out before the partitions being committed can be revoked.
+    std::lock_guard<std::mutex> commit_lck(kafkaConnector->commitMtx);
     std::lock_guard<std::mutex> lck(kafkaConnector->partitionMtx);
     auto [var_zone, var_topic] = with_settings([this](SETTINGS s) {
         size_t idx = kafkaConnector->getId();
@@ -43,32 +45,70 @@ void RebalanceHandler::rebalance_cb(RdKafka::KafkaConsumer* consumer, RdKafka::E
     std::chrono::time_point<std::chrono::high_resolution_clock> rebalancing_start_time =
         std::chrono::high_resolution_clock::now();
 
+    // With the cooperative-sticky assignor, the partitions passed in are only the ones added to or removed from the
+    // current assignment, and the partitions kept by this consumer carry on without being replayed.
+    bool incremental = consumer->rebalance_protocol() == "COOPERATIVE";
+
     if (err == RdKafka::ERR__ASSIGN_PARTITIONS) {
         std::string assigned_partitions = "";
         for (auto topic_partition : partitions) {
             assigned_partitions +=
                 std::to_string(topic_partition->partition()) + "[" + std::to_string(topic_partition->offset()) + "],";
         }
-        LOG(INFO) << REB_ID(kafkaConnector->getId())
-                  << " [ASSIGN_PARTITIONS] assigning partitions with offset: " << assigned_partitions;
-        if (!createPartitionHandlers(partitions, consumer)) {
+        LOG(INFO) << REB_ID(kafkaConnector->getId()) << " [ASSIGN_PARTITIONS] assigning partitions"
+                  << (incremental ? " incrementally" : "") << " with offset: " << assigned_partitions;
+        if (!createPartitionHandlers(partitions, consumer, incremental)) {
             LOG(ERROR) << REB_ID(kafkaConnector->getId()) << "Failed to create partition handlers ";
             return;
         } else {
             LOG_KAFKA(2) << REB_ID(kafkaConnector->getId()) << "Initialized partition handlers";
         }
-        auto errcode = consumer->assign(partitions);
-        if (errcode == RdKafka::ERR_NO_ERROR) {
-            LOG_KAFKA(1) << REB_ID(kafkaConnector->getId()) << "Succeeded to assign " << partitions.size()
-                         << " partitions";
+        if (incremental) {
+            RdKafka::Error* error = consumer->incremental_assign(partitions);
+            if (error == nullptr) {
+                LOG_KAFKA(1) << REB_ID(kafkaConnector->getId()) << "Succeeded to incrementally assign "
+                             << partitions.size() << " partitions";
+            } else {
+                LOG(ERROR) << REB_ID(kafkaConnector->getId()) << "Failed to incrementally assign " << partitions.size()
+                           << " partitions due to: " << error->str();
+                delete error;
+            }
         } else {
-            LOG(ERROR) << REB_ID(kafkaConnector->getId()) << "Failed to assign " << partitions.size() << " partitions";
+            auto errcode = consumer->assign(partitions);
+            if (errcode == RdKafka::ERR_NO_ERROR) {
+                LOG_KAFKA(1) << REB_ID(kafkaConnector->getId()) << "Succeeded to assign " << partitions.size()
+                             << " partitions";
+            } else {
+                LOG(ERROR) << REB_ID(kafkaConnector->getId()) << "Failed to assign " << partitions.size()
+                           << " partitions";
+            }
         }
 
         kafkaconnector_metrics->partition_rebalancing_assigned_by_kafka_connector
             ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
             .increment(1);
 
+    } else if (err == RdKafka::ERR__REVOKE_PARTITIONS && incremental) {
+        LOG(INFO) << REB_ID(kafkaConnector->getId()) << " [REVOKE_PARTITIONS] incrementally revoking "
+                  << partitions.size() << " partitions";
+        RdKafka::Error* error = consumer->incremental_unassign(partitions);
+        if (error == nullptr) {
+            LOG_KAFKA(1) << REB_ID(kafkaConnector->getId()) << "Succeeded to incrementally unassign";
+            std::vector<int> revoked_partitions;
+            for (auto topic_partition : partitions) {
+                revoked_partitions.push_back(topic_partition->partition());
+            }
+            // Only the handlers of the revoked partitions are torn down, with the rest kept as they are.
+            kafkaConnector->removePartitionHandlersNoLocking(revoked_partitions);
+        } else {
+            LOG(ERROR) << REB_ID(kafkaConnector->getId()) << "Failed to incrementally unassign due to: "
+                       << error->str();
+            delete error;
+        }
+
+        kafkaconnector_metrics->partition_rebalancing_assigned_by_kafka_connector
+            ->labels({{"on_topic", var_topic}, {"on_zone", var_zone}})
+            .decrement(1);
     } else if (err == RdKafka::ERR__REVOKE_PARTITIONS) {
         LOG(INFO) << REB_ID(kafkaConnector->getId()) << " [REVOKE_PARTITIONS] revoking partitions";
         auto errcode = consumer->unassign();
@@ -76,8 +116,8 @@ void RebalanceHandler::rebalance_cb(RdKafka::KafkaConsumer* consumer, RdKafka::E
             LOG_KAFKA(1) << REB_ID(kafkaConnector->getId()) << "Succeeded to unassign";
             // store partition information to the rebalances
             kafkaConnector->storePreviousAssigmentInformation();
-            // Note that no locking method invocation is not necessary because the rebalance_cb from librdkafka runtime
-            // and the main kafka connector (in which clear partition handler is also invoked) work in the same thread.
+            // The no-locking method is invoked, as partitionMtx is held for the whole callback, which is served on the
+            // thread owning the handler map (see KafkaConnector::clearPartitionHandlersNoLocking).
             kafkaConnector->clearPartitionHandlersNoLocking();
             kafkaConnector->clearCurrentBatch();
         } else {
@@ -101,7 +141,7 @@ void RebalanceHandler::rebalance_cb(RdKafka::KafkaConsumer* consumer, RdKafka::E
 }
 
 bool RebalanceHandler::createPartitionHandlers(std::vector<RdKafka::TopicPartition*>& new_assignment,
-                                               RdKafka::KafkaConsumer* consumer) {
+                                               RdKafka::KafkaConsumer* consumer, bool incremental) {
     // LOG_KAFKA(1) << REB_ID(kafkaConnector->getId()) << "Rebalancing is progress. Current size of rebalances history:
     // "
     //              << kafkaConnector->rebalances.size();
@@ -119,30 +159,39 @@ bool RebalanceHandler::createPartitionHandlers(std::vector<RdKafka::TopicPartiti
     kafkaConnector->rebalances.emplace_back();
     if (kafkaConnector->rebalances.size() > kafkaConnector->rebalanceSize)
         kafkaConnector->rebalances.pop_front();
-    CHECK(kafkaConnector->partitionHandlers.empty());
+    if (!incremental) {
+        CHECK(kafkaConnector->partitionHandlers.empty());
+    }
+
+    // A single request for the committed metadata of all of the newly assigned partitions, instead of one blocking
+    // request per partition.
+    auto toppar_to_check = rd_kafka_topic_partition_list_new(new_assignment.size());
     for (auto topic_partition : new_assignment) {
-        LOG_KAFKA(1) << REB_ID(kafkaConnector->getId()) << "Assigning new partition: " << topic_partition->partition();
-        auto toppar_to_check = rd_kafka_topic_partition_list_new(1);
         rd_kafka_topic_partition_list_add(toppar_to_check, topic_partition->topic().c_str(),
                                           topic_partition->partition());
-        auto committed_toppar = get_committed_metadata(toppar_to_check, consumer->c_ptr());
-        rd_kafka_topic_partition_list_destroy(toppar_to_check);
-        if (committed_toppar != nullptr) {
-            CHECK(committed_toppar->cnt > 0);
-            std::string metadata((char*)committed_toppar->elems[0].metadata, committed_toppar->elems[0].metadata_size);
-            auto offset = committed_toppar->elems[0].offset;
-            kafkaConnector->partitionHandlers.insert(std::make_pair(
-                topic_partition->partition(),
-                std::make_shared<PartitionHandler>(topic_partition->topic(), topic_partition->partition(), offset,
-                                                   metadata, kafkaConnector)));
-            rd_kafka_topic_partition_list_destroy(committed_toppar);
-        } else {
-            LOG_KAFKA(1) << REB_ID(kafkaConnector->getId())
-                         << "Unable to fetch commit metadata, so failed to create partition handler for topic: "
-                         << topic_partition->topic() << ", partition: " << topic_partition->partition();
-            return false;
-        }
     }
+    auto committed_toppar = get_committed_metadata(toppar_to_check, consumer->c_ptr());
+    rd_kafka_topic_partition_list_destroy(toppar_to_check);
+    if (committed_toppar == nullptr) {
+        LOG_KAFKA(1) << REB_ID(kafkaConnector->getId())
+                     << "Unable to fetch commit metadata, so failed to create partition handlers for "
+                     << new_assignment.size() << " partitions";
+        return false;
+    }
+
+    for (auto topic_partition : new_assignment) {
+        LOG_KAFKA(1) << REB_ID(kafkaConnector->getId()) << "Assigning new partition: " << topic_partition->partition();
+        auto committed = rd_kafka_topic_partition_list_find(committed_toppar, topic_partition->topic().c_str(),
+                                                            topic_partition->partition());
+        CHECK(committed != nullptr);
+        std::string metadata((char*)committed->metadata, committed->metadata_size);
+        auto offset = committed->offset;
+        kafkaConnector->partitionHandlers.insert_or_assign(
+            topic_partition->partition(),
+            std::make_shared<PartitionHandler>(topic_partition->topic(), topic_partition->partition(), offset, metadata,
+                                               kafkaConnector));
+    }
+    rd_kafka_topic_partition_list_destroy(committed_toppar);
     return true;
 }
 
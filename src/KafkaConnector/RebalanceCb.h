@@ -41,8 +41,9 @@ class RebalanceHandler : public RdKafka::RebalanceCb {
     get_committed_metadata(const rd_kafka_topic_partition_list_t* toppar_to_check, rd_kafka_t* rk);
 
   private:
+    // incremental to be true if the new assignment is added to the current one, by the cooperative rebalance protocol.
     bool createPartitionHandlers(std::vector<RdKafka::TopicPartition*>& new_assignment,
-                                 RdKafka::KafkaConsumer* consumer);
+                                 RdKafka::KafkaConsumer* consumer, bool incremental);
     KafkaConnector* kafkaConnector;
 };
 } // namespace kafka
@@ -0,0 +1,125 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include "Metadata.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kafka {
+
+/**
+ * It plans the REPLAY of a partition out of the saved metadata, with one window per table indexed by the table ID. The
+ * window of a table is the last batch [begin, end] of the table that has to be re-constructed, or the special marker
+ * [end + 1, end] when the table has nothing to replay. With more than one batch of the table in flight at the time of
+ * the commit, the window spans all of these batches, and each of them is re-constructed as it was sent.
+ *
+ * For each message read during the REPLAY, the planner decides whether the message is to be skipped without being
+ * decoded (it is older than the window of its table), replayed (it falls in the window), or consumed as usual (its
+ * table has no window or the window is passed). It also keeps track of how far each table is from finishing its
+ * replay, to be exported as the replay progress.
+ *
+ * Note that the partition can not be seeked past the messages to be skipped, as the table of a message is only known
+ * from its header, and the tables not being replayed need every message from their own begin offset.
+ */
+class ReplayPlanner {
+  public:
+    enum Decision { SKIP = 0, REPLAY = 1, CONSUME = 2 };
+
+    // To set the window of the table from its offset in the saved metadata.
+    void addTable(size_t table_id, const Offset& saved_offset) {
+        reserveTable(table_id);
+        windows[table_id] = saved_offset;
+        if (saved_offset.begin != Metadata::EARLIEST_OFFSET && saved_offset.begin <= saved_offset.end) {
+            pending++;
+        }
+    }
+
+    // To drop the window of the table, once the replay of the table is done.
+    void removeTable(size_t table_id) {
+        if (table_id >= windows.size())
+            return;
+        if (isReplaying(table_id)) {
+            pending--;
+        }
+        windows[table_id] = Offset();
+    }
+
+    void reserveTable(size_t table_id) {
+        if (table_id >= windows.size())
+            windows.resize(table_id + 1);
+    }
+
+    // The window of the table, with begin being -1 if the table has no window.
+    const Offset& getWindow(size_t table_id) const { return windows[table_id]; }
+
+    Decision decide(size_t table_id, int64_t offset) const {
+        const Offset& window = windows[table_id];
+        if (window.begin == Metadata::EARLIEST_OFFSET || offset > window.end)
+            return CONSUME;
+        if (window.begin > window.end)
+            return SKIP; // the message is already applied by the store.
+        return offset < window.begin ? SKIP : REPLAY;
+    }
+
+    // Whether the offset ends one of the batches to be re-constructed for the table.
+    bool isBatchEnd(size_t table_id, int64_t offset) const {
+        const Offset& window = windows[table_id];
+        if (offset == window.end)
+            return true;
+        for (auto& split : window.splits) {
+            if (offset == split.end)
+                return true;
+        }
+        return false;
+    }
+
+    // The count recorded for the batch of the table that covers the offset.
+    int64_t countAt(size_t table_id, int64_t offset) const {
+        const Offset& window = windows[table_id];
+        for (auto& split : window.splits) {
+            if (offset <= split.end)
+                return split.count;
+        }
+        return window.count;
+    }
+
+    // The number of offsets left before the replay of the table is done, being 0 if the table is not replaying.
+    int64_t remaining(size_t table_id, int64_t offset) const {
+        if (!isReplaying(table_id))
+            return 0;
+        const Offset& window = windows[table_id];
+        return window.end - std::max(offset, window.begin - 1);
+    }
+
+    // The number of tables whose replay is not done yet.
+    size_t pendingTables() const { return pending; }
+
+  private:
+    bool isReplaying(size_t table_id) const {
+        const Offset& window = windows[table_id];
+        return window.begin != Metadata::EARLIEST_OFFSET && window.begin <= window.end;
+    }
+
+    std::vector<Offset> windows; // table ID --> replay window
+    size_t pending = 0;
+};
+
+} // namespace kafka
@@ -0,0 +1,83 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace kafka {
+
+/**
+ * It maps the table names carried by the Kafka message headers to dense table IDs, so that the partition handlers can
+ * keep their per-table state in vectors indexed by the table ID, instead of the maps keyed by the table name. A table
+ * gets its ID at the first time it is seen by the kafka connector, and the ID never changes afterwards. It is shared by
+ * all of the partition handlers of the kafka connector, which can be processed in parallel.
+ */
+class TableRegistry {
+  public:
+    TableRegistry() = default;
+    ~TableRegistry() = default;
+
+    TableRegistry(const TableRegistry&) = delete;
+    TableRegistry& operator=(const TableRegistry&) = delete;
+
+    // Return the ID of the table, with the table being registered if it is seen for the first time.
+    size_t getId(const char* name, size_t name_size) {
+        std::string_view key(name, name_size);
+        {
+            std::shared_lock<std::shared_mutex> lck(mtx);
+            auto it = ids.find(key);
+            if (it != ids.end())
+                return it->second;
+        }
+
+        std::unique_lock<std::shared_mutex> lck(mtx);
+        auto it = ids.find(key);
+        if (it != ids.end())
+            return it->second;
+        size_t id = names.size();
+        names.emplace_back(name, name_size);
+        // the key refers to the name held by the deque, which does not move when the deque grows.
+        ids.emplace(std::string_view(names.back()), id);
+        return id;
+    }
+
+    size_t getId(const std::string& name) { return getId(name.data(), name.size()); }
+
+    // The returned name stays valid for the life-time of the registry.
+    const std::string& getName(size_t id) {
+        std::shared_lock<std::shared_mutex> lck(mtx);
+        return names[id];
+    }
+
+    size_t size() {
+        std::shared_lock<std::shared_mutex> lck(mtx);
+        return names.size();
+    }
+
+  private:
+    std::deque<std::string> names; // table ID --> table name
+    std::unordered_map<std::string_view, size_t> ids; // table name --> table ID
+    std::shared_mutex mtx;
+};
+
+} // namespace kafka
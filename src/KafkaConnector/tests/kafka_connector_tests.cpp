@@ -41,7 +41,9 @@ namespace filesystem = boost::filesystem;
 #include <algorithm>
 #include <fstream>
 #include <glog/logging.h>
+#include <map>
 #include <unordered_map>
+#include <vector>
 
 #include <thread>
 #include <chrono>
@@ -223,6 +225,55 @@ int checkBatchesContent(std::string& filename, int num_of_messages,
     return 0;
 }
 
+/**
+ * Each batch of a partition and a table should have its messages in the ascending offset order, and no two batches of
+ * the same partition and table should overlap, which is what the partition handler sees when its messages are
+ * consumed in the offset order. A message consumed out of order would be dropped as rewound, and thus be missing from
+ * the total number of messages.
+ * @param filename
+ * @param num_of_messages
+ */
+int checkBatchesInOffsetOrder(std::string& filename, int num_of_messages) {
+    LOG_KAFKA(2) << "Checking offset order of the output file: " << filename;
+    std::map<std::pair<int, std::string>, std::vector<Offset>> batches;
+    std::ifstream infile(filename);
+    std::string line;
+    int message_num = 0;
+    while (std::getline(infile, line)) {
+        if (line.find("new batch>") == std::string::npos)
+            continue;
+        int batch_size = stoi(line.substr(line.find(">") + 1));
+        std::getline(infile, line);
+        int partition_id = stoi(line.substr(line.find("=") + 1));
+        std::getline(infile, line);
+        std::string table = line.substr(line.find("=") + 1);
+
+        int begin = -1;
+        int previous = -1;
+        for (int i = 0; i < batch_size; i++) {
+            std::getline(infile, line);
+            int offset = stoi(line.substr(0, line.find(":")));
+            CHK_GT(offset, previous);
+            if (begin == -1)
+                begin = offset;
+            previous = offset;
+            message_num++;
+        }
+        batches[{partition_id, table}].push_back({begin, previous});
+    }
+    CHK_EQ(num_of_messages, message_num);
+
+    for (auto& entry : batches) {
+        auto& table_batches = entry.second;
+        std::sort(table_batches.begin(), table_batches.end(),
+                  [](const Offset& lhs, const Offset& rhs) { return lhs.begin < rhs.begin; });
+        for (size_t i = 1; i < table_batches.size(); i++) {
+            CHK_GT(table_batches[i].begin, table_batches[i - 1].end);
+        }
+    }
+    return 0;
+}
+
 RdKafka::Conf* createConfig() {
     auto kafka_consumer_params = SETTINGS_PARAM(config.kafka.consumerConf);
     // pick the first configuration variant
@@ -333,6 +384,52 @@ int happy_path(int num_of_messages, int num_of_tables, int message_size, int num
     return 0;
 }
 
+/**
+ * The partitions of each batch are processed in parallel on the partition thread pool, with each partition handler
+ * still seeing its messages in the offset order.
+ */
+int parallel_partitions_test(int num_of_messages, int num_of_tables, int message_size, int num_of_partitions,
+                             int producer_delay, std::string output_file) {
+    kafka::SimpleFlushTask::clearInvariantChecker();
+    // clearing the output
+    std::ofstream ofs;
+    ofs.open(output_file, std::ofstream::out | std::ofstream::trunc);
+    ofs.close();
+
+    // call runProducer to create the topic and put messages
+    auto t = runProducer(num_of_messages, num_of_tables, message_size, num_of_partitions, true, producer_delay);
+    // Create Kafka Config
+    auto conf = createConfig();
+
+    std::shared_ptr<kafka::GenericThreadPool> thread_pool = std::make_shared<kafka::SimpleThreadPool>();
+    thread_pool->init();
+    std::shared_ptr<kafka::GenericThreadPool> partition_thread_pool = std::make_shared<kafka::SimpleThreadPool>();
+    partition_thread_pool->init();
+
+    LOG(INFO) << "Waiting for the producer to finish.";
+    t.first->join();
+    LOG(INFO) << "Producer thread joined";
+
+    kafka::KafkaConnector kafkaConnector(0, conf, thread_pool, nullptr, partition_thread_pool);
+    kafkaConnector.start();
+
+    sleepSec(10);
+    kafkaConnector.stop();
+    kafkaConnector.wait();
+    thread_pool->shutdown();
+    partition_thread_pool->shutdown();
+
+    LOG(INFO) << "Stopping FileWriter.";
+    FileWriter::getInstance()->stop();
+    LOG(INFO) << "FileWriter stopped.";
+
+    if (checkBatchesInOffsetOrder(output_file, num_of_messages))
+        return -1;
+    if (checkCompleteness(num_of_messages, num_of_partitions))
+        return -1;
+    return 0;
+}
+
 int replay_test(int num_of_messages, int num_of_tables, int message_size, int num_of_partitions, int producer_delay,
                 std::string output_file) {
     kafka::SimpleFlushTask::clearInvariantChecker();
@@ -586,6 +683,8 @@ int main(int argc, char** argv) {
 
     ts.doTest("happy_path_2_table_1_partition", happy_path, 100, 2, 10, 1, 0, "batches.txt");
     ts.doTest("happy_path_2_table_2_partition", happy_path, 100, 2, 10, 2, 0, "batches.txt");
+    ts.doTest("parallel_partitions_test_3_table_4_partition", parallel_partitions_test, 400, 3, 10, 4, 0,
+              "batches.txt");
     ts.doTest("replay_test_1_table_1_partition", replay_test, 100, 1, 10, 1, 10, "batches.txt");
     ts.doTest("replay_test_3_table_1_partition", replay_test, 100, 3, 10, 1, 10, "batches.txt");
     ts.doTest("replay_test_2_table_2_partition", replay_test, 100, 2, 10, 2, 10, "batches.txt");
@@ -26,6 +26,8 @@ limitations under the License.
 #include "test_common.h"
 #include "KafkaConnector/Metadata.h"
 #include <stdio.h>
+#include <string>
+#include <vector>
 // NOTE: required for static variable initialization for ThreadRegistry and URCU defined in libutils.
 THREAD_BUFFER_INIT;
 // We need to extern declare all the modules, so that registered modules are usable.
@@ -131,6 +133,85 @@ int deserialize_test_from_v1() {
     return 0;
 }
 
+int serialize_test_v2() {
+    kafka::Metadata metadata("replica1", 0);
+    metadata.update("myTable1", 1, 10, 10);
+    kafka::Offset offset(5, 30, 12);
+    offset.splits.emplace_back(14, 4);
+    offset.splits.emplace_back(20, 8);
+    metadata.update("myTable2", offset);
+
+    CHK_EQ(std::string("2,,replica1,myTable1,1,10,10,myTable2,5,30,12,,0,,myTable2,2,14,4,20,8"),
+           metadata.serialize(2));
+    // The older versions see the batches in flight merged into one.
+    CHK_EQ(std::string("1,,replica1,myTable1,1,10,10,myTable2,5,30,12,,0"), metadata.serialize(1));
+
+    kafka::Metadata metadata2;
+    metadata2.deserialize(metadata.serialize(2));
+    CHK_EQ(0, metadata2.getReference());
+    CHK_EQ(1, metadata2.getOffset("myTable1").begin);
+    CHK_EQ(10, metadata2.getOffset("myTable1").end);
+    CHK_EQ(0, metadata2.getOffset("myTable1").splits.size());
+
+    CHK_EQ(5, metadata2.getOffset("myTable2").begin);
+    CHK_EQ(30, metadata2.getOffset("myTable2").end);
+    CHK_EQ(12, metadata2.getOffset("myTable2").count);
+    CHK_EQ(2, metadata2.getOffset("myTable2").splits.size());
+    CHK_EQ(14, metadata2.getOffset("myTable2").splits[0].end);
+    CHK_EQ(4, metadata2.getOffset("myTable2").splits[0].count);
+    CHK_EQ(20, metadata2.getOffset("myTable2").splits[1].end);
+    CHK_EQ(8, metadata2.getOffset("myTable2").splits[1].count);
+    CHK_EQ(metadata.serialize(2), metadata2.serialize(2));
+
+    // A single batch per table makes no splits.
+    metadata.update("myTable2", 21, 30, 12);
+    CHK_EQ(std::string("2,,replica1,myTable1,1,10,10,myTable2,21,30,12,,0,,"), metadata.serialize(2));
+
+    kafka::Metadata metadata3;
+    metadata3.deserialize(metadata.serialize(2));
+    CHK_EQ(21, metadata3.getOffset("myTable2").begin);
+    CHK_EQ(0, metadata3.getOffset("myTable2").splits.size());
+    return 0;
+}
+
+int deserialize_test_from_malformed_v2() {
+    const std::string windows = "2,,replica1,myTable1,1,10,10,myTable2,5,30,12,,0,,";
+    const std::vector<std::string> malformed_splits{
+        "myTable2,2,14,4",             // truncated, with a split missing
+        "myTable2,2,14,4,20",          // truncated, with a count missing
+        "myTable2,x,14,4",             // malformed number of splits
+        "myTable2,-1",                 // negative number of splits
+        "myTable2,2,20,8,14,4",        // descending
+        "myTable2,2,14,4,14,8",        // overlapping
+        "myTable2,1,4,4",              // before the begin
+        "myTable2,1,30,4",             // at the end, leaving the last batch empty
+        "myTable2,1,14,-4",            // negative count
+        "myTable3,1,14,4",             // table not in the metadata
+        "myTable2,1,14,4,myTable2,1,20,8", // repeated
+        "myTable1,1,5,5,myTable2,1,40,4",  // valid for myTable1, but not for myTable2
+    };
+
+    for (auto& splits : malformed_splits) {
+        kafka::Metadata metadata;
+        metadata.deserialize(windows + splits);
+        // the splits are dropped, with the windows of version 1 kept.
+        CHK_EQ(0, metadata.getReference());
+        CHK_EQ(1, metadata.getOffset("myTable1").begin);
+        CHK_EQ(10, metadata.getOffset("myTable1").end);
+        CHK_EQ(0, metadata.getOffset("myTable1").splits.size());
+        CHK_EQ(5, metadata.getOffset("myTable2").begin);
+        CHK_EQ(30, metadata.getOffset("myTable2").end);
+        CHK_EQ(12, metadata.getOffset("myTable2").count);
+        CHK_EQ(0, metadata.getOffset("myTable2").splits.size());
+    }
+
+    kafka::Metadata metadata;
+    metadata.deserialize(windows + "myTable1,1,5,5,myTable2,2,14,4,20,8");
+    CHK_EQ(1, metadata.getOffset("myTable1").splits.size());
+    CHK_EQ(2, metadata.getOffset("myTable2").splits.size());
+    return 0;
+}
+
 int add_from_version_0() {
     kafka::Metadata metadata;
     kafka::Metadata::setVersion(0);
@@ -162,6 +243,8 @@ int main(int argc, char** argv) {
     ts.doTest("version_test test", version_test);
     ts.doTest("deserialize_test test", deserialize_test_from_v0);
     ts.doTest("deserialize_test test", deserialize_test_from_v1);
+    ts.doTest("serialize_test_v2 test", serialize_test_v2);
+    ts.doTest("deserialize_test_from_malformed_v2 test", deserialize_test_from_malformed_v2);
     ts.doTest("add_from_version_0 test", add_from_version_0);
     return 0;
 }
@@ -28,9 +28,16 @@ limitations under the License.
 #include <IO/WriteHelpers.h>
 
 #include <Serializable/ISerializableDataType.h>
+#include <Serializable/ProtobufReader.h>
+
+#include <nucolumnar/aggregator/v1/nucolumnaraggregator.pb.h>
 
 namespace nuclm {
 
+namespace ErrorCodes {
+extern const int SERIALIZATION_METHOD_NOT_IMPLEMENTED;
+} // namespace ErrorCodes
+
 ISerializableDataType::ISerializableDataType() {}
 
 ISerializableDataType::~ISerializableDataType() {}
@@ -39,4 +46,32 @@ DB::String ISerializableDataType::getName() const { return doGetName(); }
 
 DB::String ISerializableDataType::doGetName() const { return getFamilyName(); }
 
+void ISerializableDataType::deserializeProtobufColumn(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                                      size_t& rows_added) const {
+    rows_added = 0;
+    size_t number_of_rows = protobuf.getNumberOfRows();
+    column.reserve(column.size() + number_of_rows);
+    for (size_t row = 0; row < number_of_rows; row++) {
+        ProtobufReader reader(protobuf.getValueP(row));
+        bool row_added = false;
+        deserializeProtobuf(column, reader, true, row_added);
+        if (row_added) {
+            rows_added++;
+        }
+        protobuf.addBytesRead(reader.getTotalBytesRead());
+    }
+}
+
+void ISerializableDataType::serializeColumnarValues(const DB::IColumn& column,
+                                                    nucolumnar::aggregator::v1::ColumnValues& values) const {
+    std::string exception_message = getName() + " columnar serialization is not implemented";
+    throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+}
+
+bool ISerializableDataType::deserializeColumnarValues(DB::IColumn& column,
+                                                      const nucolumnar::aggregator::v1::ColumnValues& values,
+                                                      size_t number_of_rows) const {
+    return false;
+}
+
 } // namespace nuclm
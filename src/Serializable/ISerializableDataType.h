@@ -26,6 +26,10 @@ limitations under the License.
 #include <boost/noncopyable.hpp>
 #include <memory>
 
+namespace nucolumnar::aggregator::v1 {
+class ColumnValues;
+} // namespace nucolumnar::aggregator::v1
+
 namespace nuclm {
 
 class ISerializableDataType;
@@ -34,6 +38,7 @@ using SerializableDataTypePtr = std::shared_ptr<const ISerializableDataType>;
 using SerializableDataTypes = std::vector<SerializableDataTypePtr>;
 
 class ProtobufReader;
+class ProtobufColumnReader;
 class ProtobufWriter;
 
 /** Properties of data type.
@@ -62,12 +67,37 @@ class ISerializableDataType : private boost::noncopyable {
     /// Data type id. It's used for runtime type checks.
     virtual DB::TypeIndex getTypeId() const = 0;
 
-    /** Serialize to a protobuf. */
+    /** Serialize the value of the row to a protobuf, with value_index advanced by the number of the scalar values
+     * written (the elements of an array, each counted by itself). The value written is what deserializeProtobuf reads
+     * back into the same value.
+     */
     virtual void serializeProtobuf(const DB::IColumn& column, size_t row_num, ProtobufWriter& protobuf,
                                    size_t& value_index) const = 0;
     virtual void deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf, bool allow_add_row,
                                      bool& row_added) const = 0;
 
+    /** Deserialize the values of one column across all of the rows of a batch, with one value appended to the column
+     * per row. rows_added is less than the number of rows if some of the values can not be decoded. The default is to
+     * call deserializeProtobuf value by value, and the types with a type-specialized loop fall back to it when the
+     * values are not all of the same expected kind.
+     */
+    virtual void deserializeProtobufColumn(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                           size_t& rows_added) const;
+
+    /** Serialize all of the rows of the column to the packed values of the columnar encoding (ColumnValues in
+     * nucolumnaraggregator.proto), in the packed field that the type is carried by. The default is to throw, for the
+     * types not carried by the columnar encoding.
+     */
+    virtual void serializeColumnarValues(const DB::IColumn& column,
+                                         nucolumnar::aggregator::v1::ColumnValues& values) const;
+
+    /** Deserialize the packed values of the columnar encoding, with number_of_rows values appended to the column in
+     * bulk. Return false with nothing appended to the column if the values do not carry number_of_rows values in the
+     * packed field of the type.
+     */
+    virtual bool deserializeColumnarValues(DB::IColumn& column, const nucolumnar::aggregator::v1::ColumnValues& values,
+                                           size_t number_of_rows) const;
+
   protected:
     virtual DB::String doGetName() const;
 
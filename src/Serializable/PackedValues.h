@@ -0,0 +1,60 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <google/protobuf/repeated_field.h>
+
+#include <cstddef>
+
+namespace nuclm {
+
+/**
+ * The bulk copies between the packed repeated fields of the columnar encoding (ColumnValues in
+ * nucolumnaraggregator.proto) and the containers of the columns, with each value converted to the other type.
+ */
+class PackedValues {
+  public:
+    // Return false with nothing appended if the packed field does not carry number_of_rows values.
+    template <typename Container, typename Packed>
+    static bool append(Container& container, const google::protobuf::RepeatedField<Packed>& packed,
+                       size_t number_of_rows) {
+        if (static_cast<size_t>(packed.size()) != number_of_rows) {
+            return false;
+        }
+        using ValueType = typename Container::value_type;
+        size_t old_size = container.size();
+        container.resize(old_size + number_of_rows);
+        const Packed* source = packed.data();
+        ValueType* destination = container.data() + old_size;
+        for (size_t i = 0; i < number_of_rows; i++) {
+            destination[i] = static_cast<ValueType>(source[i]);
+        }
+        return true;
+    }
+
+    template <typename Packed, typename Container>
+    static void assign(google::protobuf::RepeatedField<Packed>& packed, const Container& container) {
+        size_t number_of_rows = container.size();
+        packed.Resize(static_cast<int>(number_of_rows), Packed{});
+        Packed* destination = packed.mutable_data();
+        for (size_t i = 0; i < number_of_rows; i++) {
+            destination[i] = static_cast<Packed>(container[i]);
+        }
+    }
+};
+
+} // namespace nuclm
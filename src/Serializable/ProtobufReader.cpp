@@ -60,4 +60,14 @@ void ProtobufReader::addNullBytes() {
     total_bytes_read += length;
 }
 
+bool ProtobufColumnReader::allOfKind(nucolumnar::datatypes::v1::ValueP::KindCase kind) const {
+    size_t number_of_rows = getNumberOfRows();
+    for (size_t row = 0; row < number_of_rows; row++) {
+        if (getValueP(row).kind_case() != kind) {
+            return false;
+        }
+    }
+    return true;
+}
+
 } // namespace nuclm
@@ -16,6 +16,7 @@ limitations under the License.
 
 #pragma once
 
+#include <nucolumnar/aggregator/v1/nucolumnaraggregator.pb.h>
 #include <nucolumnar/datatypes/v1/columnartypes.pb.h>
 #include <Columns/ColumnString.h>
 
@@ -44,4 +45,38 @@ class ProtobufReader {
     size_t total_bytes_read;
 };
 
+/**
+ * To read the values of one column across all of the rows of a batch, for the column-at-a-time deserialization. The
+ * rows are expected to have been checked to all carry the column.
+ */
+class ProtobufColumnReader {
+  public:
+    using Rows = google::protobuf::RepeatedPtrField<nucolumnar::aggregator::v1::DataBindingList>;
+
+    ProtobufColumnReader(const Rows& rows_, size_t column_index_) :
+            rows(rows_), column_index(column_index_), total_bytes_read(0) {}
+
+    ~ProtobufColumnReader() = default;
+
+    size_t getNumberOfRows() const { return rows.size(); }
+
+    size_t getColumnIndex() const { return column_index; }
+
+    const nucolumnar::datatypes::v1::ValueP& getValueP(size_t row) const {
+        return rows.Get(static_cast<int>(row)).values(static_cast<int>(column_index));
+    }
+
+    // Whether the values of all of the rows are of the kind, for the type-specialized loop to not check each value.
+    bool allOfKind(nucolumnar::datatypes::v1::ValueP::KindCase kind) const;
+
+    size_t getTotalBytesRead() const { return total_bytes_read; }
+
+    void addBytesRead(size_t size) { total_bytes_read += size; }
+
+  private:
+    const Rows& rows;
+    size_t column_index;
+    size_t total_bytes_read;
+};
+
 } // namespace nuclm
@@ -0,0 +1,41 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include <Serializable/ProtobufWriter.h>
+
+namespace nuclm {
+
+void ProtobufWriter::writeString(const char* data, size_t size) {
+    // assign() keeps the capacity of the string held by the value of the previous row.
+    if (value_p.has_string_value()) {
+        value_p.mutable_string_value()->assign(data, size);
+    } else {
+        value_p.set_string_value(data, size);
+    }
+}
+
+void ProtobufWriter::writeTimestamp(uint64_t milliseconds) {
+    value_p.mutable_timestamp()->set_milliseconds(milliseconds);
+}
+
+nucolumnar::datatypes::v1::ListValueP& ProtobufWriter::writeList() {
+    // The elements cleared are kept by the repeated field, to be reused by the elements added next.
+    nucolumnar::datatypes::v1::ListValueP* list = value_p.mutable_list_value();
+    list->clear_value();
+    return *list;
+}
+
+} // namespace nuclm
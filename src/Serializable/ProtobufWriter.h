@@ -16,12 +16,44 @@ limitations under the License.
 
 #pragma once
 
+#include <nucolumnar/datatypes/v1/columnartypes.pb.h>
+
+#include <cstddef>
+#include <cstdint>
+
 namespace nuclm {
 
+/**
+ * To write one value into the ValueP (columnartypes.proto) of a row, the counterpart of ProtobufReader. The serializer
+ * of each type writes the kind that its deserializer reads back into the same value. The ValueP can be reused across
+ * the rows, as each write replaces the kind that the value held before.
+ */
 class ProtobufWriter {
   public:
-    ProtobufWriter() = default;
+    ProtobufWriter(nucolumnar::datatypes::v1::ValueP& value_p_) : value_p(value_p_) {}
+
     ~ProtobufWriter() = default;
+
+    nucolumnar::datatypes::v1::ValueP& getValueP() { return value_p; }
+
+    void writeNull() { value_p.set_null_value(nucolumnar::datatypes::v1::NullValueP::NULL_VALUE); }
+    void writeInt(int32_t value) { value_p.set_int_value(value); }
+    void writeLong(int64_t value) { value_p.set_long_value(value); }
+    void writeUInt(uint32_t value) { value_p.set_uint_value(value); }
+    void writeULong(uint64_t value) { value_p.set_ulong_value(value); }
+    void writeDouble(double value) { value_p.set_double_value(value); }
+    void writeBool(bool value) { value_p.set_bool_value(value); }
+
+    void writeString(const char* data, size_t size);
+
+    // the milliseconds since the Unix epoch, which is what the Date, DateTime and DateTime64 deserializers read.
+    void writeTimestamp(uint64_t milliseconds);
+
+    // To start a list value that is empty, for the elements to be written by the writers of its added values.
+    nucolumnar::datatypes::v1::ListValueP& writeList();
+
+  private:
+    nucolumnar::datatypes::v1::ValueP& value_p;
 };
 
 } // namespace nuclm
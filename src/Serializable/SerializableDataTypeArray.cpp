@@ -39,7 +39,6 @@ namespace nuclm {
 namespace ErrorCodes {
 extern const int NUMBER_OF_ARGUMENTS_DOESNT_MATCH;
 extern const int ILLEGAL_TYPE_OF_ARGUMENT;
-extern const int SERIALIZATION_METHOD_NOT_IMPLEMENTED;
 extern const int CANNOT_READ_ARRAY_FROM_PROTOBUF;
 
 } // namespace ErrorCodes
@@ -49,8 +48,18 @@ SerializableDataTypeArray::SerializableDataTypeArray(const SerializableDataTypeP
 
 void SerializableDataTypeArray::serializeProtobuf(const DB::IColumn& column, size_t row_num, ProtobufWriter& protobuf,
                                                   size_t& value_index) const {
-    std::string exception_message = std::string(getFamilyName()) + " protobuf-based serialization is not implemented";
-    throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+    const DB::ColumnArray& column_array = assert_cast<const DB::ColumnArray&>(column);
+    const DB::IColumn& nested_column = column_array.getData();
+    const DB::ColumnArray::Offsets& offsets = column_array.getOffsets();
+
+    // the offset before the first row is 0, as the offsets are padded to the left.
+    size_t offset = offsets[row_num - 1];
+    size_t next_offset = offsets[row_num];
+    nucolumnar::datatypes::v1::ListValueP& list = protobuf.writeList();
+    for (size_t i = offset; i < next_offset; ++i) {
+        ProtobufWriter element_writer(*list.add_value());
+        nested_serializable_data_type->serializeProtobuf(nested_column, i, element_writer, value_index);
+    }
 }
 
 void SerializableDataTypeArray::deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf, bool allow_add_row,
@@ -103,6 +112,48 @@ void SerializableDataTypeArray::deserializeProtobuf(DB::IColumn& column, Protobu
     }
 }
 
+void SerializableDataTypeArray::serializeColumnarValues(const DB::IColumn& column,
+                                                        nucolumnar::aggregator::v1::ColumnValues& values) const {
+    const DB::ColumnArray& column_array = assert_cast<const DB::ColumnArray&>(column);
+    const DB::ColumnArray::Offsets& offsets = column_array.getOffsets();
+    size_t number_of_rows = offsets.size();
+
+    google::protobuf::RepeatedField<uint64_t>* array_sizes = values.mutable_array_sizes();
+    array_sizes->Resize(static_cast<int>(number_of_rows), 0);
+    for (size_t row = 0; row < number_of_rows; row++) {
+        array_sizes->Set(static_cast<int>(row), offsets[row] - offsets[row - 1]);
+    }
+    nested_serializable_data_type->serializeColumnarValues(column_array.getData(), *values.mutable_array_elements());
+}
+
+bool SerializableDataTypeArray::deserializeColumnarValues(DB::IColumn& column,
+                                                          const nucolumnar::aggregator::v1::ColumnValues& values,
+                                                          size_t number_of_rows) const {
+    const google::protobuf::RepeatedField<uint64_t>& array_sizes = values.array_sizes();
+    if (static_cast<size_t>(array_sizes.size()) != number_of_rows) {
+        return false;
+    }
+    size_t number_of_elements = 0;
+    for (uint64_t array_size : array_sizes) {
+        number_of_elements += array_size;
+    }
+
+    DB::ColumnArray& column_array = assert_cast<DB::ColumnArray&>(column);
+    if (!nested_serializable_data_type->deserializeColumnarValues(column_array.getData(), values.array_elements(),
+                                                                  number_of_elements)) {
+        return false;
+    }
+
+    DB::ColumnArray::Offsets& offsets = column_array.getOffsets();
+    size_t current_offset = offsets.back();
+    offsets.reserve(offsets.size() + number_of_rows);
+    for (uint64_t array_size : array_sizes) {
+        current_offset += array_size;
+        offsets.push_back(current_offset);
+    }
+    return true;
+}
+
 bool SerializableDataTypeArray::equals(const ISerializableDataType& rhs) const {
     return typeid(rhs) == typeid(*this) &&
         nested_serializable_data_type->equals(
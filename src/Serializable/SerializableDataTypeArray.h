@@ -40,6 +40,10 @@ class SerializableDataTypeArray final : public ISerializableDataType {
                            size_t& value_index) const override;
     void deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf, bool allow_add_row,
                              bool& row_added) const override;
+    void serializeColumnarValues(const DB::IColumn& column,
+                                 nucolumnar::aggregator::v1::ColumnValues& values) const override;
+    bool deserializeColumnarValues(DB::IColumn& column, const nucolumnar::aggregator::v1::ColumnValues& values,
+                                   size_t number_of_rows) const override;
 
     bool equals(const ISerializableDataType& rhs) const override;
 
@@ -22,6 +22,7 @@ limitations under the License.
 #include <Serializable/SerializableDataTypeFactory.h>
 #include <Serializable/ProtobufReader.h>
 #include <Serializable/ProtobufWriter.h>
+#include <Serializable/TimestampConversion.h>
 #include "common/logging.hpp"
 
 #include <common/LocalDateTime.h>
@@ -30,14 +31,13 @@ limitations under the License.
 
 namespace nuclm {
 
-namespace ErrorCodes {
-extern const int SERIALIZATION_METHOD_NOT_IMPLEMENTED;
-} // namespace ErrorCodes
-
 void SerializableDataTypeDate::serializeProtobuf(const DB::IColumn& column, size_t row_num, ProtobufWriter& protobuf,
                                                  size_t& value_index) const {
-    std::string exception_message = std::string(getFamilyName()) + " protobuf-based serialization is not implemented";
-    throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+    // the start of the day in the local time zone, which the deserializer turns back into the same day.
+    DB::UInt16 day = assert_cast<const DB::ColumnUInt16&>(column).getData()[row_num];
+    time_t seconds = DateLUT::instance().fromDayNum(DayNum(day));
+    protobuf.writeTimestamp(static_cast<uint64_t>(seconds) * 1000);
+    value_index++;
 }
 
 void SerializableDataTypeDate::deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf, bool allow_add_row,
@@ -62,6 +62,25 @@ void SerializableDataTypeDate::deserializeProtobuf(DB::IColumn& column, Protobuf
         container.back() = t;
 }
 
+void SerializableDataTypeDate::deserializeProtobufColumn(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                                         size_t& rows_added) const {
+    if (!protobuf.allOfKind(nucolumnar::datatypes::v1::ValueP::KindCase::kTimestamp)) {
+        ISerializableDataType::deserializeProtobufColumn(column, protobuf, rows_added);
+        return;
+    }
+
+    DB::PaddedPODArray<uint64_t> milliseconds;
+    TimestampConversion::gatherMilliseconds(protobuf, milliseconds);
+    auto& container = assert_cast<DB::ColumnUInt16&>(column).getData();
+    size_t old_size = container.size();
+    container.resize(old_size + milliseconds.size());
+    TimestampConversion::toDate(milliseconds.data(), milliseconds.size(), DateLUT::instance(),
+                                container.data() + old_size);
+
+    rows_added = milliseconds.size();
+    protobuf.addBytesRead(milliseconds.size() * sizeof(uint64_t));
+}
+
 bool SerializableDataTypeDate::equals(const ISerializableDataType& rhs) const { return typeid(rhs) == typeid(*this); }
 
 void registerDataTypeDate(SerializableDataTypeFactory& factory) {
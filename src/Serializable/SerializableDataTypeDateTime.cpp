@@ -21,6 +21,7 @@ limitations under the License.
 #include <Serializable/SerializableDataTypeFactory.h>
 #include <Serializable/ProtobufReader.h>
 #include <Serializable/ProtobufWriter.h>
+#include <Serializable/TimestampConversion.h>
 #include "common/logging.hpp"
 
 #include <Common/typeid_cast.h>
@@ -38,7 +39,6 @@ namespace nuclm {
 namespace ErrorCodes {
 extern const int NUMBER_OF_ARGUMENTS_DOESNT_MATCH;
 extern const int ILLEGAL_TYPE_OF_ARGUMENT;
-extern const int SERIALIZATION_METHOD_NOT_IMPLEMENTED;
 } // namespace ErrorCodes
 
 SerializableDataTypeDateTime::SerializableDataTypeDateTime(const std::string& time_zone_name) :
@@ -57,8 +57,9 @@ std::string SerializableDataTypeDateTime::doGetName() const {
 
 void SerializableDataTypeDateTime::serializeProtobuf(const DB::IColumn& column, size_t row_num,
                                                      ProtobufWriter& protobuf, size_t& value_index) const {
-    std::string exception_message = std::string(getFamilyName()) + " protobuf-based serialization is not implemented";
-    throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+    DB::UInt32 seconds = assert_cast<const DB::ColumnUInt32&>(column).getData()[row_num];
+    protobuf.writeTimestamp(static_cast<uint64_t>(seconds) * 1000);
+    value_index++;
 }
 
 void SerializableDataTypeDateTime::deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf,
@@ -82,6 +83,24 @@ void SerializableDataTypeDateTime::deserializeProtobuf(DB::IColumn& column, Prot
         container.back() = t;
 }
 
+void SerializableDataTypeDateTime::deserializeProtobufColumn(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                                             size_t& rows_added) const {
+    if (!protobuf.allOfKind(nucolumnar::datatypes::v1::ValueP::KindCase::kTimestamp)) {
+        ISerializableDataType::deserializeProtobufColumn(column, protobuf, rows_added);
+        return;
+    }
+
+    DB::PaddedPODArray<uint64_t> milliseconds;
+    TimestampConversion::gatherMilliseconds(protobuf, milliseconds);
+    auto& container = assert_cast<DB::ColumnUInt32&>(column).getData();
+    size_t old_size = container.size();
+    container.resize(old_size + milliseconds.size());
+    TimestampConversion::toDateTime(milliseconds.data(), milliseconds.size(), container.data() + old_size);
+
+    rows_added = milliseconds.size();
+    protobuf.addBytesRead(milliseconds.size() * sizeof(uint64_t));
+}
+
 bool SerializableDataTypeDateTime::equals(const ISerializableDataType& rhs) const {
     /// DateTime with different timezones are equal, because:
     /// "all types with different time zones are equivalent and may be used interchangingly."
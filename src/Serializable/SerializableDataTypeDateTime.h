@@ -57,6 +57,8 @@ class SerializableDataTypeDateTime final : public SerializableDataTypeNumberBase
                            size_t& value_index) const override;
     void deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf, bool allow_add_row,
                              bool& row_added) const override;
+    void deserializeProtobufColumn(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                   size_t& rows_added) const override;
 
     bool canBeInsideNullable() const override { return true; }
 
@@ -21,11 +21,13 @@ limitations under the License.
 #include <Serializable/SerializableDataTypeFactory.h>
 #include <Serializable/ProtobufReader.h>
 #include <Serializable/ProtobufWriter.h>
+#include <Serializable/TimestampConversion.h>
 #include "common/logging.hpp"
 
 #include <Common/typeid_cast.h>
 #include <Common/assert_cast.h>
 #include <Columns/ColumnDecimal.h>
+#include <common/intExp.h>
 
 #include <IO/WriteBufferFromString.h>
 #include <IO/Operators.h>
@@ -38,7 +40,6 @@ namespace nuclm {
 namespace ErrorCodes {
 extern const int NUMBER_OF_ARGUMENTS_DOESNT_MATCH;
 extern const int ILLEGAL_TYPE_OF_ARGUMENT;
-extern const int SERIALIZATION_METHOD_NOT_IMPLEMENTED;
 } // namespace ErrorCodes
 
 SerializableDataTypeDateTime64::SerializableDataTypeDateTime64(UInt32 scale_, const std::string& time_zone_name) :
@@ -58,8 +59,13 @@ std::string SerializableDataTypeDateTime64::doGetName() const {
 
 void SerializableDataTypeDateTime64::serializeProtobuf(const DB::IColumn& column, size_t row_num,
                                                        ProtobufWriter& protobuf, size_t& value_index) const {
-    std::string exception_message = std::string(getFamilyName()) + " protobuf-based serialization is not implemented";
-    throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+    // The milliseconds of the value, with the precision beyond the millisecond dropped. Note that for the scale beyond
+    // 3, the deserializer takes the milliseconds as the fraction, and thus only the scale up to 3 gets back the value.
+    DB::Int64 value = assert_cast<const DB::ColumnDecimal<DB::DateTime64>&>(column).getData()[row_num].value;
+    DB::Int64 milliseconds = (scale <= 3) ? value * static_cast<DB::Int64>(intExp10(3 - scale))
+                                          : value / static_cast<DB::Int64>(intExp10(scale - 3));
+    protobuf.writeTimestamp(static_cast<uint64_t>(milliseconds));
+    value_index++;
 }
 
 void SerializableDataTypeDateTime64::deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf,
@@ -100,6 +106,57 @@ void SerializableDataTypeDateTime64::deserializeProtobuf(DB::IColumn& column, Pr
         container.back() = datetime64;
 }
 
+void SerializableDataTypeDateTime64::deserializeProtobufColumn(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                                               size_t& rows_added) const {
+    if (!protobuf.allOfKind(nucolumnar::datatypes::v1::ValueP::KindCase::kTimestamp)) {
+        ISerializableDataType::deserializeProtobufColumn(column, protobuf, rows_added);
+        return;
+    }
+
+    DB::PaddedPODArray<uint64_t> milliseconds;
+    TimestampConversion::gatherMilliseconds(protobuf, milliseconds);
+    auto& container = assert_cast<DB::ColumnDecimal<DB::DateTime64>&>(column).getData();
+    size_t old_size = container.size();
+    container.resize(old_size + milliseconds.size());
+    if (!TimestampConversion::toDateTime64(milliseconds.data(), milliseconds.size(), scale,
+                                           container.data() + old_size)) {
+        container.resize(old_size);
+        ISerializableDataType::deserializeProtobufColumn(column, protobuf, rows_added);
+        return;
+    }
+
+    rows_added = milliseconds.size();
+    protobuf.addBytesRead(milliseconds.size() * sizeof(DB::DateTime64));
+}
+
+void SerializableDataTypeDateTime64::serializeColumnarValues(const DB::IColumn& column,
+                                                             nucolumnar::aggregator::v1::ColumnValues& values) const {
+    // the ticks at the scale of the column, with nothing lost as with the milliseconds of the timestamp.
+    const auto& container = assert_cast<const DB::ColumnDecimal<DB::DateTime64>&>(column).getData();
+    size_t number_of_rows = container.size();
+    google::protobuf::RepeatedField<int64_t>* long_values = values.mutable_long_values();
+    long_values->Resize(static_cast<int>(number_of_rows), 0);
+    for (size_t row = 0; row < number_of_rows; row++) {
+        long_values->Set(static_cast<int>(row), container[row].value);
+    }
+}
+
+bool SerializableDataTypeDateTime64::deserializeColumnarValues(DB::IColumn& column,
+                                                               const nucolumnar::aggregator::v1::ColumnValues& values,
+                                                               size_t number_of_rows) const {
+    const google::protobuf::RepeatedField<int64_t>& long_values = values.long_values();
+    if (static_cast<size_t>(long_values.size()) != number_of_rows) {
+        return false;
+    }
+    auto& container = assert_cast<DB::ColumnDecimal<DB::DateTime64>&>(column).getData();
+    size_t old_size = container.size();
+    container.resize(old_size + number_of_rows);
+    for (size_t row = 0; row < number_of_rows; row++) {
+        container[old_size + row] = DB::DateTime64(long_values.Get(static_cast<int>(row)));
+    }
+    return true;
+}
+
 bool SerializableDataTypeDateTime64::equals(const ISerializableDataType& rhs) const {
     if (const auto* ptype = typeid_cast<const SerializableDataTypeDateTime64*>(&rhs)) {
         return this->scale == ptype->getScale();
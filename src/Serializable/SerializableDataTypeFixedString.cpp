@@ -46,7 +46,6 @@ extern const int CANNOT_READ_ALL_DATA;
 extern const int TOO_LARGE_STRING_SIZE;
 extern const int NUMBER_OF_ARGUMENTS_DOESNT_MATCH;
 extern const int UNEXPECTED_AST_STRUCTURE;
-extern const int SERIALIZATION_METHOD_NOT_IMPLEMENTED;
 
 } // namespace ErrorCodes
 
@@ -54,8 +53,10 @@ std::string SerializableDataTypeFixedString::doGetName() const { return "FixedSt
 
 void SerializableDataTypeFixedString::serializeProtobuf(const DB::IColumn& column, size_t row_num,
                                                         ProtobufWriter& protobuf, size_t& value_index) const {
-    std::string exception_message = std::string(getFamilyName()) + " protobuf-based serialization is not implemented";
-    throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+    // all of the n bytes, including the padding, which the deserializer pads to anyway.
+    StringRef value = assert_cast<const DB::ColumnFixedString&>(column).getDataAt(row_num);
+    protobuf.writeString(value.data, value.size);
+    value_index++;
 }
 
 static inline void alignStringLength(const SerializableDataTypeFixedString& type, DB::ColumnFixedString::Chars& data,
@@ -97,6 +98,42 @@ void SerializableDataTypeFixedString::deserializeProtobuf(DB::IColumn& column, P
     }
 }
 
+void SerializableDataTypeFixedString::serializeColumnarValues(const DB::IColumn& column,
+                                                              nucolumnar::aggregator::v1::ColumnValues& values) const {
+    const auto& column_string = assert_cast<const DB::ColumnFixedString&>(column);
+    size_t number_of_rows = column_string.size();
+    google::protobuf::RepeatedPtrField<std::string>* bytes_values = values.mutable_bytes_values();
+    bytes_values->Reserve(static_cast<int>(number_of_rows));
+    for (size_t row = 0; row < number_of_rows; row++) {
+        StringRef value = column_string.getDataAt(row);
+        bytes_values->Add()->assign(value.data, value.size);
+    }
+}
+
+bool SerializableDataTypeFixedString::deserializeColumnarValues(DB::IColumn& column,
+                                                                const nucolumnar::aggregator::v1::ColumnValues& values,
+                                                                size_t number_of_rows) const {
+    const google::protobuf::RepeatedPtrField<std::string>& bytes_values = values.bytes_values();
+    if (static_cast<size_t>(bytes_values.size()) != number_of_rows) {
+        return false;
+    }
+    for (const std::string& value : bytes_values) {
+        if (value.size() > n) {
+            throw DB::Exception("Too large value for " + getName(), ErrorCodes::TOO_LARGE_STRING_SIZE);
+        }
+    }
+
+    // The shorter values are padded with the zeros, as what deserializeProtobuf does.
+    DB::ColumnFixedString::Chars& data = assert_cast<DB::ColumnFixedString&>(column).getChars();
+    size_t old_size = data.size();
+    data.resize_fill(old_size + n * number_of_rows);
+    for (size_t row = 0; row < number_of_rows; row++) {
+        const std::string& value = bytes_values.Get(static_cast<int>(row));
+        ::memcpy(data.data() + old_size + row * n, value.data(), value.size());
+    }
+    return true;
+}
+
 bool SerializableDataTypeFixedString::equals(const ISerializableDataType& rhs) const {
     return typeid(rhs) == typeid(*this) && n == static_cast<const SerializableDataTypeFixedString&>(rhs).n;
 }
@@ -46,7 +46,6 @@ namespace ErrorCodes {
 extern const int NUMBER_OF_ARGUMENTS_DOESNT_MATCH;
 extern const int LOGICAL_ERROR;
 extern const int ILLEGAL_TYPE_OF_ARGUMENT;
-extern const int SERIALIZATION_METHOD_NOT_IMPLEMENTED;
 } // namespace ErrorCodes
 
 namespace {
@@ -77,8 +76,11 @@ SerializableDataTypeLowCardinality::SerializableDataTypeLowCardinality(
 
 void SerializableDataTypeLowCardinality::serializeProtobuf(const DB::IColumn& column, size_t row_num,
                                                            ProtobufWriter& protobuf, size_t& value_index) const {
-    std::string exception_message = std::string(getFamilyName()) + " protobuf-based serialization is not implemented";
-    throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+    // the value in the dictionary, which is of the nested type (that is Nullable if the LowCardinality type is).
+    const auto& low_cardinality_column = getColumnLowCardinality(column);
+    nested_serializable_data_type->serializeProtobuf(*low_cardinality_column.getDictionary().getNestedColumn(),
+                                                     low_cardinality_column.getIndexAt(row_num), protobuf,
+                                                     value_index);
 }
 
 void SerializableDataTypeLowCardinality::deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf,
@@ -89,11 +91,44 @@ void SerializableDataTypeLowCardinality::deserializeProtobuf(DB::IColumn& column
                    << "column name: " << temp_column->getName() << " family name: " << temp_column->getFamilyName();
 
     nested_serializable_data_type.get()->deserializeProtobuf(*temp_column, protobuf, allow_add_row, row_added);
-    low_cardinality_column.insertFromFullColumn(*temp_column, 0);
+    if (row_added) {
+        low_cardinality_column.insertFromFullColumn(*temp_column, 0);
+    }
 
     // the protobuf statics is performed in the nested type.
 }
 
+void SerializableDataTypeLowCardinality::deserializeProtobufColumn(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                                                   size_t& rows_added) const {
+    auto& low_cardinality_column = getColumnLowCardinality(column);
+    auto full_column = low_cardinality_column.getDictionary().getNestedColumn()->cloneEmpty();
+    full_column->reserve(protobuf.getNumberOfRows());
+    nested_serializable_data_type->deserializeProtobufColumn(*full_column, protobuf, rows_added);
+
+    // The unique column of the dictionary keeps a hash table from the values to their indexes, and thus each of the
+    // values is a hash table lookup, with only the values not seen before in the column added to the dictionary.
+    low_cardinality_column.insertRangeFromFullColumn(*full_column, 0, full_column->size());
+
+    // the protobuf statics is performed in the nested type.
+}
+
+void SerializableDataTypeLowCardinality::serializeColumnarValues(
+    const DB::IColumn& column, nucolumnar::aggregator::v1::ColumnValues& values) const {
+    DB::ColumnPtr full_column = getColumnLowCardinality(column).convertToFullColumn();
+    nested_serializable_data_type->serializeColumnarValues(*full_column, values);
+}
+
+bool SerializableDataTypeLowCardinality::deserializeColumnarValues(
+    DB::IColumn& column, const nucolumnar::aggregator::v1::ColumnValues& values, size_t number_of_rows) const {
+    auto& low_cardinality_column = getColumnLowCardinality(column);
+    auto full_column = low_cardinality_column.getDictionary().getNestedColumn()->cloneEmpty();
+    if (!nested_serializable_data_type->deserializeColumnarValues(*full_column, values, number_of_rows)) {
+        return false;
+    }
+    low_cardinality_column.insertRangeFromFullColumn(*full_column, 0, number_of_rows);
+    return true;
+}
+
 bool SerializableDataTypeLowCardinality::equals(const ISerializableDataType& rhs) const {
     if (typeid(rhs) != typeid(*this))
         return false;
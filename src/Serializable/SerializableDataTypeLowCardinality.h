@@ -41,6 +41,16 @@ class SerializableDataTypeLowCardinality final : public ISerializableDataType {
                            size_t& value_index) const override;
     void deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf, bool allow_add_row,
                              bool& row_added) const override;
+    void serializeColumnarValues(const DB::IColumn& column,
+                                 nucolumnar::aggregator::v1::ColumnValues& values) const override;
+    bool deserializeColumnarValues(DB::IColumn& column, const nucolumnar::aggregator::v1::ColumnValues& values,
+                                   size_t number_of_rows) const override;
+
+    /** The values of all of the rows are decoded by the nested type into one full column, which is then looked up in
+     * the dictionary of the column in one go, rather than one temporary column and one dictionary insertion per value.
+     */
+    void deserializeProtobufColumn(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                   size_t& rows_added) const override;
 
     bool equals(const ISerializableDataType& rhs) const override;
 
@@ -42,7 +42,6 @@ namespace nuclm {
 namespace ErrorCodes {
 extern const int NUMBER_OF_ARGUMENTS_DOESNT_MATCH;
 extern const int ILLEGAL_TYPE_OF_ARGUMENT;
-extern const int SERIALIZATION_METHOD_NOT_IMPLEMENTED;
 } // namespace ErrorCodes
 
 SerializableDataTypeNullable::SerializableDataTypeNullable(
@@ -94,8 +93,13 @@ static ReturnType safeDeserialize(DB::IColumn& column, const DB::IDataType& nest
 
 void SerializableDataTypeNullable::serializeProtobuf(const DB::IColumn& column, size_t row_num,
                                                      ProtobufWriter& protobuf, size_t& value_index) const {
-    std::string exception_message = std::string(getFamilyName()) + " protobuf-based serialization is not implemented";
-    throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+    const DB::ColumnNullable& col = assert_cast<const DB::ColumnNullable&>(column);
+    if (col.isNullAt(row_num)) {
+        protobuf.writeNull();
+        value_index++;
+    } else {
+        nested_serializable_data_type->serializeProtobuf(col.getNestedColumn(), row_num, protobuf, value_index);
+    }
 }
 
 void SerializableDataTypeNullable::deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf,
@@ -148,6 +152,54 @@ void SerializableDataTypeNullable::deserializeProtobuf(DB::IColumn& column, Prot
     }
 }
 
+void SerializableDataTypeNullable::serializeColumnarValues(const DB::IColumn& column,
+                                                           nucolumnar::aggregator::v1::ColumnValues& values) const {
+    const DB::ColumnNullable& col = assert_cast<const DB::ColumnNullable&>(column);
+    const DB::NullMap& null_map = col.getNullMapData();
+    size_t number_of_rows = null_map.size();
+
+    std::string* null_bitmap = values.mutable_null_bitmap();
+    null_bitmap->assign((number_of_rows + 7) / 8, 0);
+    bool has_null = false;
+    for (size_t row = 0; row < number_of_rows; row++) {
+        if (null_map[row]) {
+            (*null_bitmap)[row / 8] |= static_cast<char>(1 << (row % 8));
+            has_null = true;
+        }
+    }
+    if (!has_null) {
+        null_bitmap->clear();
+    }
+
+    // The nested column carries the default values for the null rows.
+    nested_serializable_data_type->serializeColumnarValues(col.getNestedColumn(), values);
+}
+
+bool SerializableDataTypeNullable::deserializeColumnarValues(DB::IColumn& column,
+                                                             const nucolumnar::aggregator::v1::ColumnValues& values,
+                                                             size_t number_of_rows) const {
+    const std::string& null_bitmap = values.null_bitmap();
+    if (!null_bitmap.empty() && null_bitmap.size() != (number_of_rows + 7) / 8) {
+        return false;
+    }
+
+    DB::ColumnNullable& col = assert_cast<DB::ColumnNullable&>(column);
+    if (!nested_serializable_data_type->deserializeColumnarValues(col.getNestedColumn(), values, number_of_rows)) {
+        return false;
+    }
+
+    DB::NullMap& null_map = col.getNullMapData();
+    size_t old_size = null_map.size();
+    null_map.resize_fill(old_size + number_of_rows, 0);
+    if (!null_bitmap.empty()) {
+        const auto* bits = reinterpret_cast<const uint8_t*>(null_bitmap.data());
+        for (size_t row = 0; row < number_of_rows; row++) {
+            null_map[old_size + row] = (bits[row / 8] >> (row % 8)) & 1;
+        }
+    }
+    return true;
+}
+
 bool SerializableDataTypeNullable::equals(const ISerializableDataType& rhs) const {
     return rhs.isNullable() &&
         nested_serializable_data_type->equals(
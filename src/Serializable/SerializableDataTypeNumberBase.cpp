@@ -19,6 +19,7 @@ limitations under the License.
 
 #include <Serializable/SerializableDataTypeNumberBase.h>
 #include <Serializable/ProtobufReader.h>
+#include <Serializable/PackedValues.h>
 #include <Serializable/ProtobufWriter.h>
 
 #include "common/logging.hpp"
@@ -43,8 +44,27 @@ extern const int SERIALIZATION_METHOD_NOT_IMPLEMENTED;
 template <typename T>
 void SerializableDataTypeNumberBase<T>::serializeProtobuf(const DB::IColumn& column, size_t row_num,
                                                           ProtobufWriter& protobuf, size_t& value_index) const {
-    std::string exception_message = std::string(getFamilyName()) + " protobuf-based serialization is not implemented";
-    throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+    if constexpr (sizeof(T) > sizeof(uint64_t)) {
+        // UInt128 has no kind in ValueP to be carried by.
+        std::string exception_message =
+            std::string(getFamilyName()) + " protobuf-based serialization is not implemented";
+        throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+    } else {
+        T value = assert_cast<const DB::ColumnVector<T>&>(column).getData()[row_num];
+        // the narrowest kind that holds the values of the type, which deserializeProtobuf converts back without loss.
+        if constexpr (std::is_floating_point_v<T>) {
+            protobuf.writeDouble(value);
+        } else if constexpr (std::is_same_v<T, DB::UInt64>) {
+            protobuf.writeULong(value);
+        } else if constexpr (std::is_same_v<T, DB::Int64>) {
+            protobuf.writeLong(value);
+        } else if constexpr (is_unsigned_v<T>) {
+            protobuf.writeUInt(value);
+        } else {
+            protobuf.writeInt(value);
+        }
+    }
+    value_index++;
 }
 
 template <typename T>
@@ -124,6 +144,107 @@ void SerializableDataTypeNumberBase<T>::deserializeProtobuf(DB::IColumn& column,
         container.back() = value;
 }
 
+template <typename T, typename GetValue>
+static void appendValuesOfAllRows(DB::PaddedPODArray<T>& container, const ProtobufColumnReader& protobuf,
+                                  GetValue get_value) {
+    size_t number_of_rows = protobuf.getNumberOfRows();
+    for (size_t row = 0; row < number_of_rows; row++) {
+        T value{};
+        value = get_value(protobuf.getValueP(row));
+        container.push_back(value);
+    }
+}
+
+template <typename T>
+bool SerializableDataTypeNumberBase<T>::deserializeProtobufColumnOfSameKind(DB::IColumn& column,
+                                                                           ProtobufColumnReader& protobuf,
+                                                                           size_t& rows_added) const {
+    using ValueP = nucolumnar::datatypes::v1::ValueP;
+    rows_added = 0;
+    size_t number_of_rows = protobuf.getNumberOfRows();
+    if (number_of_rows == 0) {
+        return true;
+    }
+
+    ValueP::KindCase kind = protobuf.getValueP(0).kind_case();
+    switch (kind) {
+    case ValueP::KindCase::kIntValue:
+    case ValueP::KindCase::kLongValue:
+    case ValueP::KindCase::kUintValue:
+    case ValueP::KindCase::kUlongValue:
+    case ValueP::KindCase::kDoubleValue:
+    case ValueP::KindCase::kBoolValue:
+        break;
+    default:
+        return false;
+    }
+    if (!protobuf.allOfKind(kind)) {
+        return false;
+    }
+
+    auto& container = typeid_cast<DB::ColumnVector<T>&>(column).getData();
+    container.reserve(container.size() + number_of_rows);
+    // the same conversions as deserializeProtobuf, with the kind switched on once for the whole column.
+    switch (kind) {
+    case ValueP::KindCase::kIntValue:
+        appendValuesOfAllRows<T>(container, protobuf, [](const ValueP& v) { return v.int_value(); });
+        break;
+    case ValueP::KindCase::kLongValue:
+        appendValuesOfAllRows<T>(container, protobuf, [](const ValueP& v) { return v.long_value(); });
+        break;
+    case ValueP::KindCase::kUintValue:
+        appendValuesOfAllRows<T>(container, protobuf, [](const ValueP& v) { return v.uint_value(); });
+        break;
+    case ValueP::KindCase::kUlongValue:
+        appendValuesOfAllRows<T>(container, protobuf, [](const ValueP& v) { return v.ulong_value(); });
+        break;
+    case ValueP::KindCase::kDoubleValue:
+        appendValuesOfAllRows<T>(container, protobuf, [](const ValueP& v) { return v.double_value(); });
+        break;
+    default:
+        appendValuesOfAllRows<T>(container, protobuf, [](const ValueP& v) { return v.bool_value(); });
+        break;
+    }
+
+    protobuf.addBytesRead(number_of_rows * sizeof(T));
+    rows_added = number_of_rows;
+    return true;
+}
+
+template <typename T>
+void SerializableDataTypeNumberBase<T>::serializeColumnarValues(
+    const DB::IColumn& column, nucolumnar::aggregator::v1::ColumnValues& values) const {
+    if constexpr (sizeof(T) > sizeof(uint64_t)) {
+        ISerializableDataType::serializeColumnarValues(column, values);
+    } else {
+        const auto& container = assert_cast<const DB::ColumnVector<T>&>(column).getData();
+        if constexpr (std::is_floating_point_v<T>) {
+            PackedValues::assign(*values.mutable_double_values(), container);
+        } else if constexpr (is_unsigned_v<T>) {
+            PackedValues::assign(*values.mutable_ulong_values(), container);
+        } else {
+            PackedValues::assign(*values.mutable_long_values(), container);
+        }
+    }
+}
+
+template <typename T>
+bool SerializableDataTypeNumberBase<T>::deserializeColumnarValues(
+    DB::IColumn& column, const nucolumnar::aggregator::v1::ColumnValues& values, size_t number_of_rows) const {
+    if constexpr (sizeof(T) > sizeof(uint64_t)) {
+        return false;
+    } else {
+        auto& container = assert_cast<DB::ColumnVector<T>&>(column).getData();
+        if constexpr (std::is_floating_point_v<T>) {
+            return PackedValues::append(container, values.double_values(), number_of_rows);
+        } else if constexpr (is_unsigned_v<T>) {
+            return PackedValues::append(container, values.ulong_values(), number_of_rows);
+        } else {
+            return PackedValues::append(container, values.long_values(), number_of_rows);
+        }
+    }
+}
+
 template <typename T> bool SerializableDataTypeNumberBase<T>::isValueRepresentedByInteger() const {
     return is_integer_v<T>;
 }
@@ -41,6 +41,10 @@ template <typename T> class SerializableDataTypeNumberBase : public ISerializabl
                            size_t& value_index) const override;
     void deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf, bool allow_add_row,
                              bool& row_added) const override;
+    void serializeColumnarValues(const DB::IColumn& column,
+                                 nucolumnar::aggregator::v1::ColumnValues& values) const override;
+    bool deserializeColumnarValues(DB::IColumn& column, const nucolumnar::aggregator::v1::ColumnValues& values,
+                                   size_t number_of_rows) const override;
 
     bool isParametric() const override { return false; }
     bool haveSubtypes() const override { return false; }
@@ -49,6 +53,14 @@ template <typename T> class SerializableDataTypeNumberBase : public ISerializabl
     bool isValueRepresentedByInteger() const override;
     bool isValueRepresentedByUnsignedInteger() const override;
     bool canBeInsideLowCardinality() const override { return true; }
+
+  protected:
+    /**
+     * The type-specialized loop of the column-at-a-time deserialization, which only applies when the values of all
+     * of the rows are of the same numeric kind. Return false with nothing appended to the column otherwise.
+     */
+    bool deserializeProtobufColumnOfSameKind(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                             size_t& rows_added) const;
 };
 
 } // namespace nuclm
@@ -20,6 +20,7 @@ limitations under the License.
 #include <Serializable/SerializableDataTypeString.h>
 #include <Serializable/SerializableDataTypeFactory.h>
 #include <Serializable/ProtobufReader.h>
+#include <Serializable/ProtobufWriter.h>
 
 #include <Columns/ColumnString.h>
 #include <Common/typeid_cast.h>
@@ -27,14 +28,11 @@ limitations under the License.
 
 namespace nuclm {
 
-namespace ErrorCodes {
-extern const int SERIALIZATION_METHOD_NOT_IMPLEMENTED;
-} // namespace ErrorCodes
-
 void SerializableDataTypeString::serializeProtobuf(const DB::IColumn& column, size_t row_num, ProtobufWriter& protobuf,
                                                    size_t& value_index) const {
-    std::string exception_message = std::string(getFamilyName()) + " protobuf-based serialization is not implemented";
-    throw DB::Exception(exception_message, ErrorCodes::SERIALIZATION_METHOD_NOT_IMPLEMENTED);
+    StringRef value = assert_cast<const DB::ColumnString&>(column).getDataAt(row_num);
+    protobuf.writeString(value.data, value.size);
+    value_index++;
 }
 
 void SerializableDataTypeString::deserializeProtobuf(DB::IColumn& column, ProtobufReader& protobuf, bool allow_add_row,
@@ -60,6 +58,82 @@ void SerializableDataTypeString::deserializeProtobuf(DB::IColumn& column, Protob
     }
 }
 
+void SerializableDataTypeString::deserializeProtobufColumn(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                                           size_t& rows_added) const {
+    size_t number_of_rows = protobuf.getNumberOfRows();
+    if (!protobuf.allOfKind(nucolumnar::datatypes::v1::ValueP::KindCase::kStringValue)) {
+        ISerializableDataType::deserializeProtobufColumn(column, protobuf, rows_added);
+        return;
+    }
+
+    auto& column_string = assert_cast<DB::ColumnString&>(column);
+    DB::ColumnString::Chars& data = column_string.getChars();
+    DB::ColumnString::Offsets& offsets = column_string.getOffsets();
+
+    // Size the column once for all of the rows, each with its terminating '\0', and then copy the strings in.
+    size_t total_length = 0;
+    for (size_t row = 0; row < number_of_rows; row++) {
+        total_length += protobuf.getValueP(row).string_value().size();
+    }
+    size_t old_size = data.size();
+    data.resize(old_size + total_length + number_of_rows);
+    offsets.reserve(offsets.size() + number_of_rows);
+
+    size_t current_size = old_size;
+    for (size_t row = 0; row < number_of_rows; row++) {
+        const std::string& val = protobuf.getValueP(row).string_value();
+        size_t length = val.size();
+        ::memcpy(data.data() + current_size, val.data(), length);
+        current_size += length;
+        data[current_size++] = 0;
+        offsets.push_back(current_size);
+    }
+
+    protobuf.addBytesRead(total_length);
+    rows_added = number_of_rows;
+}
+
+void SerializableDataTypeString::serializeColumnarValues(const DB::IColumn& column,
+                                                         nucolumnar::aggregator::v1::ColumnValues& values) const {
+    const auto& column_string = assert_cast<const DB::ColumnString&>(column);
+    size_t number_of_rows = column_string.size();
+    google::protobuf::RepeatedPtrField<std::string>* bytes_values = values.mutable_bytes_values();
+    bytes_values->Reserve(static_cast<int>(number_of_rows));
+    for (size_t row = 0; row < number_of_rows; row++) {
+        StringRef value = column_string.getDataAt(row);
+        bytes_values->Add()->assign(value.data, value.size);
+    }
+}
+
+bool SerializableDataTypeString::deserializeColumnarValues(DB::IColumn& column,
+                                                           const nucolumnar::aggregator::v1::ColumnValues& values,
+                                                           size_t number_of_rows) const {
+    const google::protobuf::RepeatedPtrField<std::string>& bytes_values = values.bytes_values();
+    if (static_cast<size_t>(bytes_values.size()) != number_of_rows) {
+        return false;
+    }
+
+    auto& column_string = assert_cast<DB::ColumnString&>(column);
+    DB::ColumnString::Chars& data = column_string.getChars();
+    DB::ColumnString::Offsets& offsets = column_string.getOffsets();
+
+    // the same as deserializeProtobufColumn, with the column sized once for all of the strings.
+    size_t total_length = 0;
+    for (const std::string& value : bytes_values) {
+        total_length += value.size();
+    }
+    size_t current_size = data.size();
+    data.resize(current_size + total_length + number_of_rows);
+    offsets.reserve(offsets.size() + number_of_rows);
+    for (const std::string& value : bytes_values) {
+        ::memcpy(data.data() + current_size, value.data(), value.size());
+        current_size += value.size();
+        data[current_size++] = 0;
+        offsets.push_back(current_size);
+    }
+    return true;
+}
+
 bool SerializableDataTypeString::equals(const ISerializableDataType& rhs) const { return typeid(rhs) == typeid(*this); }
 
 void registerDataTypeString(SerializableDataTypeFactory& factory) {
@@ -26,6 +26,15 @@ limitations under the License.
 namespace nuclm {
 
 template <typename T> class SerializableDataTypeNumber final : public SerializableDataTypeNumberBase<T> {
+  public:
+    // Date and DateTime decode their own kinds of values, and thus only the plain numbers take the specialized loop.
+    void deserializeProtobufColumn(DB::IColumn& column, ProtobufColumnReader& protobuf,
+                                   size_t& rows_added) const override {
+        if (!this->deserializeProtobufColumnOfSameKind(column, protobuf, rows_added)) {
+            ISerializableDataType::deserializeProtobufColumn(column, protobuf, rows_added);
+        }
+    }
+
     bool equals(const ISerializableDataType& rhs) const override { return typeid(rhs) == typeid(*this); }
     bool canBeInsideNullable() const override { return true; }
 };
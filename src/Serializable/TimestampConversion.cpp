@@ -0,0 +1,102 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#include <Serializable/TimestampConversion.h>
+
+#include <common/LocalDateTime.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace nuclm {
+
+namespace {
+constexpr uint64_t SECONDS_PER_DAY = 86400;
+
+// The seconds up to which the day number in UTC is the plain division, well within the table of any time zone.
+constexpr uint64_t MAX_SECONDS_OF_DIVIDED_DATE = 0xFFFFFFFFULL - SECONDS_PER_DAY;
+} // namespace
+
+void TimestampConversion::gatherMilliseconds(const ProtobufColumnReader& protobuf,
+                                             DB::PaddedPODArray<uint64_t>& milliseconds) {
+    size_t number_of_rows = protobuf.getNumberOfRows();
+    milliseconds.resize(number_of_rows);
+    for (size_t row = 0; row < number_of_rows; row++) {
+        milliseconds[row] = protobuf.getValueP(row).timestamp().milliseconds();
+    }
+}
+
+bool TimestampConversion::isUTC(const DateLUTImpl& time_zone) {
+    const std::string& name = time_zone.getTimeZone();
+    return name == "UTC" || name == "Etc/UTC" || name == "UCT" || name == "Etc/UCT" || name == "GMT" ||
+        name == "Etc/GMT" || name == "Universal" || name == "Zulu";
+}
+
+void TimestampConversion::toDate(const uint64_t* milliseconds, size_t size, const DateLUTImpl& time_zone,
+                                 DB::UInt16* result) {
+    uint64_t max_milliseconds = 0;
+    for (size_t i = 0; i < size; i++) {
+        max_milliseconds = std::max(max_milliseconds, milliseconds[i]);
+    }
+
+    if (isUTC(time_zone) && max_milliseconds / 1000 <= MAX_SECONDS_OF_DIVIDED_DATE) {
+        for (size_t i = 0; i < size; i++) {
+            result[i] = static_cast<DB::UInt16>(milliseconds[i] / 1000 / SECONDS_PER_DAY);
+        }
+        return;
+    }
+
+    // Note the day number is Int32, but our date range still falls into the two-byte representation.
+    for (size_t i = 0; i < size; i++) {
+        time_t seconds = static_cast<time_t>(milliseconds[i] / 1000);
+        result[i] = static_cast<DB::UInt16>(time_zone.toDayNum(seconds).toUnderType());
+    }
+}
+
+void TimestampConversion::toDateTime(const uint64_t* milliseconds, size_t size, DB::UInt32* result) {
+    for (size_t i = 0; i < size; i++) {
+        result[i] = static_cast<DB::UInt32>(static_cast<time_t>(milliseconds[i]) / 1000);
+    }
+}
+
+bool TimestampConversion::toDateTime64(const uint64_t* milliseconds, size_t size, UInt32 scale,
+                                       DB::DateTime64* result) {
+    // The sub-second part is kept at millisecond precision at best: 387 ms is 0, 3, 38 and then 387 from scale 3 on.
+    int64_t multiplier = 1;
+    for (UInt32 i = 0; i < scale; i++) {
+        multiplier *= 10;
+    }
+    uint64_t divisor = scale == 0 ? 1000 : (scale == 1 ? 100 : (scale == 2 ? 10 : 1));
+
+    uint64_t max_milliseconds = 0;
+    for (size_t i = 0; i < size; i++) {
+        max_milliseconds = std::max(max_milliseconds, milliseconds[i]);
+    }
+    // Beyond that, the whole seconds turn negative or the DateTime64 overflows, both to go value by value.
+    if (max_milliseconds > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) ||
+        max_milliseconds / 1000 > static_cast<uint64_t>(std::numeric_limits<int64_t>::max() / multiplier)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        uint64_t whole = milliseconds[i] / 1000;
+        uint64_t fractional = (milliseconds[i] - whole * 1000) / divisor;
+        result[i] = DB::DateTime64(static_cast<int64_t>(whole) * multiplier + static_cast<int64_t>(fractional));
+    }
+    return true;
+}
+
+} // namespace nuclm
@@ -0,0 +1,59 @@
+/************************************************************************
+Copyright 2021, eBay, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+**************************************************************************/
+
+#pragma once
+
+#include <Serializable/ProtobufReader.h>
+
+#include <Common/PODArray.h>
+#include <Core/Types.h>
+
+#include <cstdint>
+
+class DateLUTImpl;
+
+namespace nuclm {
+
+/**
+ * The batch conversions of the timestamps carried by the messages, in milliseconds since the Unix epoch, into the
+ * values of the Date, DateTime and DateTime64 columns. Each conversion produces exactly what the deserializeProtobuf
+ * of the corresponding type produces value by value, but in one pass over an array of the timestamps, with the
+ * arithmetic kept free of branches and of calls for the compiler to vectorize the loops.
+ */
+class TimestampConversion {
+  public:
+    // To collect the timestamps of the column across all of the rows, which are expected to all carry a timestamp.
+    static void gatherMilliseconds(const ProtobufColumnReader& protobuf, DB::PaddedPODArray<uint64_t>& milliseconds);
+
+    /**
+     * To Date, as the day number in the time zone. A time zone with no offset from UTC, which is what the servers
+     * run with, has the day number computed by a division instead of a lookup in the table of the time zone.
+     */
+    static void toDate(const uint64_t* milliseconds, size_t size, const DateLUTImpl& time_zone, DB::UInt16* result);
+
+    // To DateTime, as the number of seconds since the Unix epoch.
+    static void toDateTime(const uint64_t* milliseconds, size_t size, DB::UInt32* result);
+
+    /**
+     * To DateTime64 with the scale. Return false with nothing converted if some of the timestamps overflow the
+     * DateTime64 at the scale, for the caller to go value by value and to get the overflow reported.
+     */
+    static bool toDateTime64(const uint64_t* milliseconds, size_t size, UInt32 scale, DB::DateTime64* result);
+
+    static bool isUTC(const DateLUTImpl& time_zone);
+};
+
+} // namespace nuclm
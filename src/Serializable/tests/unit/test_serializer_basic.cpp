@@ -27,6 +27,11 @@ limitations under the License.
 #include <Aggregator/ProtobufBatchReader.h>
 #include <Aggregator/TableColumnsDescription.h>
 #include <Aggregator/AggregatorLoaderManager.h>
+#include <Serializable/SerializableDataTypeFactory.h>
+#include <Serializable/ProtobufReader.h>
+
+#include <Columns/ColumnString.h>
+#include <Columns/ColumnsNumber.h>
 
 #include <nucolumnar/aggregator/v1/nucolumnaraggregator.pb.h>
 #include <nucolumnar/datatypes/v1/columnartypes.pb.h>
@@ -384,6 +389,66 @@ TEST_F(SerializerForProtobufRelatedTest, testSerializationOnNumberAndStringMulti
     LOG(INFO) << "structure dumped in block holder: " << structure;
 }
 
+/**
+ * The column-at-a-time deserialization, with the type-specialized loop taken when the values of a column are all of
+ * the same kind, and the value-by-value deserialization taken otherwise, to produce the same columns.
+ */
+TEST_F(SerializerForProtobufRelatedTest, testColumnAtATimeDeserializationOnNumberAndString) {
+    nucolumnar::aggregator::v1::SqlWithBatchBindings bindings;
+    size_t number_of_rows = 100;
+    for (size_t row = 0; row < number_of_rows; row++) {
+        nucolumnar::aggregator::v1::DataBindingList* binding = bindings.add_batch_bindings();
+        // column 0: all with long values.
+        binding->add_values()->set_long_value(row * 1000);
+        // column 1: all with string values.
+        binding->add_values()->set_string_value("graphdb-" + std::to_string(row));
+        // column 2: with int and ulong values mixed.
+        if (row % 2 == 0) {
+            binding->add_values()->set_int_value(row);
+        } else {
+            binding->add_values()->set_ulong_value(row);
+        }
+    }
+
+    auto& factory = nuclm::SerializableDataTypeFactory::instance();
+    nuclm::SerializableDataTypePtr uint64_serializer = factory.get("UInt64");
+    nuclm::SerializableDataTypePtr string_serializer = factory.get("String");
+
+    auto long_column = DB::ColumnUInt64::create();
+    nuclm::ProtobufColumnReader long_reader(bindings.batch_bindings(), 0);
+    size_t rows_added = 0;
+    uint64_serializer->deserializeProtobufColumn(*long_column, long_reader, rows_added);
+    ASSERT_EQ(rows_added, number_of_rows);
+    ASSERT_EQ(long_reader.getTotalBytesRead(), number_of_rows * sizeof(DB::UInt64));
+
+    auto string_column = DB::ColumnString::create();
+    nuclm::ProtobufColumnReader string_reader(bindings.batch_bindings(), 1);
+    string_serializer->deserializeProtobufColumn(*string_column, string_reader, rows_added);
+    ASSERT_EQ(rows_added, number_of_rows);
+
+    auto mixed_column = DB::ColumnUInt64::create();
+    nuclm::ProtobufColumnReader mixed_reader(bindings.batch_bindings(), 2);
+    ASSERT_FALSE(mixed_reader.allOfKind(nucolumnar::datatypes::v1::ValueP::KindCase::kIntValue));
+    uint64_serializer->deserializeProtobufColumn(*mixed_column, mixed_reader, rows_added);
+    ASSERT_EQ(rows_added, number_of_rows);
+
+    for (size_t row = 0; row < number_of_rows; row++) {
+        ASSERT_EQ(long_column->getElement(row), row * 1000);
+        ASSERT_EQ(string_column->getDataAt(row).toString(), "graphdb-" + std::to_string(row));
+        ASSERT_EQ(mixed_column->getElement(row), row);
+    }
+
+    // the values that can not be decoded by the type are not appended.
+    nucolumnar::aggregator::v1::SqlWithBatchBindings invalid_bindings;
+    invalid_bindings.add_batch_bindings()->add_values()->set_string_value("not-a-number");
+    invalid_bindings.add_batch_bindings()->add_values()->set_long_value(1);
+    auto invalid_column = DB::ColumnUInt64::create();
+    nuclm::ProtobufColumnReader invalid_reader(invalid_bindings.batch_bindings(), 0);
+    uint64_serializer->deserializeProtobufColumn(*invalid_column, invalid_reader, rows_added);
+    ASSERT_EQ(rows_added, (size_t)1);
+    ASSERT_EQ(invalid_column->size(), (size_t)1);
+}
+
 // Call RUN_ALL_TESTS() in main()
 int main(int argc, char** argv) {
 
@@ -30,6 +30,9 @@ limitations under the License.
 
 #include <Serializable/SerializableDataTypeFactory.h>
 #include <Serializable/SerializableDataTypeLowCardinality.h>
+#include <Serializable/ProtobufReader.h>
+
+#include <Columns/ColumnLowCardinality.h>
 
 #include <DataTypes/IDataType.h>
 #include <DataTypes/DataTypeFactory.h>
@@ -40,6 +43,7 @@ limitations under the License.
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -454,6 +458,113 @@ TEST_F(SerializerForProtobufWithLowCardinalityRelatedTest, testSerializationOnNu
     ASSERT_FALSE(failed);
 }
 
+/**
+ * The column-at-a-time deserialization of a LowCardinality column gives the same values as the value-at-a-time one, on
+ * the strings of high cardinality (all distinct) and of low cardinality (16 distinct values), with nulls in the
+ * nullable dictionary, and with the column appended to after the values already in it.
+ */
+TEST_F(SerializerForProtobufWithLowCardinalityRelatedTest, testLowCardinalityColumnAndRowDeserializationMatch) {
+    const size_t number_of_rows = 1000;
+    for (const std::string type_name : {"LowCardinality(String)", "LowCardinality(Nullable(String))"}) {
+        bool nullable = (type_name == "LowCardinality(Nullable(String))");
+        nuclm::SerializableDataTypePtr serializer = nuclm::SerializableDataTypeFactory::instance().get(type_name);
+        DB::DataTypePtr data_type = DB::DataTypeFactory::instance().get(type_name);
+
+        for (size_t distinct_values : {number_of_rows, (size_t)16}) {
+            nucolumnar::aggregator::v1::SqlWithBatchBindings bindings;
+            for (size_t row = 0; row < number_of_rows; row++) {
+                nucolumnar::datatypes::v1::ValueP* value = bindings.add_batch_bindings()->add_values();
+                if (nullable && row % 7 == 0) {
+                    value->set_null_value(nucolumnar::datatypes::v1::NullValueP::NULL_VALUE);
+                } else {
+                    value->set_string_value("graphdb-" + std::to_string(row % distinct_values));
+                }
+            }
+
+            // the same rows twice, for the second time to be looked up in the dictionary built by the first time.
+            DB::MutableColumnPtr row_column = data_type->createColumn();
+            DB::MutableColumnPtr column = data_type->createColumn();
+            for (size_t round = 0; round < 2; round++) {
+                nuclm::ProtobufColumnReader row_reader(bindings.batch_bindings(), 0);
+                for (size_t row = 0; row < number_of_rows; row++) {
+                    nuclm::ProtobufReader reader(row_reader.getValueP(row));
+                    bool row_added = false;
+                    serializer->deserializeProtobuf(*row_column, reader, true, row_added);
+                    ASSERT_TRUE(row_added);
+                }
+
+                nuclm::ProtobufColumnReader column_reader(bindings.batch_bindings(), 0);
+                size_t rows_added = 0;
+                serializer->deserializeProtobufColumn(*column, column_reader, rows_added);
+                ASSERT_EQ(rows_added, number_of_rows);
+            }
+
+            ASSERT_EQ(column->size(), 2 * number_of_rows);
+            ASSERT_EQ(row_column->size(), 2 * number_of_rows);
+            auto& low_cardinality_column = typeid_cast<DB::ColumnLowCardinality&>(*column);
+            auto& row_low_cardinality_column = typeid_cast<DB::ColumnLowCardinality&>(*row_column);
+            ASSERT_EQ(low_cardinality_column.getDictionary().size(), row_low_cardinality_column.getDictionary().size());
+            for (size_t row = 0; row < 2 * number_of_rows; row++) {
+                ASSERT_EQ(column->isNullAt(row), row_column->isNullAt(row)) << type_name << " row: " << row;
+                ASSERT_EQ(column->getDataAt(row).toString(), row_column->getDataAt(row).toString())
+                    << type_name << " row: " << row;
+            }
+        }
+    }
+}
+
+/**
+ * Not a correctness test, but a benchmark of the value-at-a-time deserialization of a LowCardinality(String) column
+ * against the column-at-a-time one, on the strings of high cardinality (all distinct) and of low cardinality (16
+ * distinct values). Disabled by default, and to be run with --gtest_also_run_disabled_tests.
+ */
+TEST_F(SerializerForProtobufWithLowCardinalityRelatedTest, DISABLED_benchmarkLowCardinalityColumnDeserialization) {
+    const size_t number_of_rows = 100000;
+    const size_t number_of_runs = 5;
+    nuclm::SerializableDataTypePtr serializer =
+        nuclm::SerializableDataTypeFactory::instance().get("LowCardinality(String)");
+    DB::DataTypePtr data_type = DB::DataTypeFactory::instance().get("LowCardinality(String)");
+
+    for (size_t distinct_values : {number_of_rows, (size_t)16}) {
+        nucolumnar::aggregator::v1::SqlWithBatchBindings bindings;
+        for (size_t row = 0; row < number_of_rows; row++) {
+            bindings.add_batch_bindings()->add_values()->set_string_value("graphdb-" +
+                                                                          std::to_string(row % distinct_values));
+        }
+
+        uint64_t row_path_us = 0;
+        uint64_t column_path_us = 0;
+        for (size_t run = 0; run < number_of_runs; run++) {
+            DB::MutableColumnPtr row_column = data_type->createColumn();
+            auto start = std::chrono::steady_clock::now();
+            nuclm::ProtobufColumnReader row_reader(bindings.batch_bindings(), 0);
+            for (size_t row = 0; row < number_of_rows; row++) {
+                nuclm::ProtobufReader reader(row_reader.getValueP(row));
+                bool row_added = false;
+                serializer->deserializeProtobuf(*row_column, reader, true, row_added);
+                ASSERT_TRUE(row_added);
+            }
+            auto middle = std::chrono::steady_clock::now();
+
+            DB::MutableColumnPtr column = data_type->createColumn();
+            nuclm::ProtobufColumnReader column_reader(bindings.batch_bindings(), 0);
+            size_t rows_added = 0;
+            serializer->deserializeProtobufColumn(*column, column_reader, rows_added);
+            auto end = std::chrono::steady_clock::now();
+
+            row_path_us += std::chrono::duration_cast<std::chrono::microseconds>(middle - start).count();
+            column_path_us += std::chrono::duration_cast<std::chrono::microseconds>(end - middle).count();
+            ASSERT_EQ(rows_added, number_of_rows);
+            ASSERT_EQ(column->size(), row_column->size());
+        }
+
+        LOG(INFO) << "LowCardinality(String) with " << distinct_values << " distinct values in " << number_of_rows
+                  << " rows, average over " << number_of_runs << " runs, value-at-a-time: "
+                  << row_path_us / number_of_runs << " us, column-at-a-time: " << column_path_us / number_of_runs
+                  << " us";
+    }
+}
+
 // Call RUN_ALL_TESTS() in main()
 int main(int argc, char** argv) {
 
@@ -23,14 +23,29 @@ limitations under the License.
 #include "common/logging.hpp"
 #include "common/settings_factory.hpp"
 
+#include <Serializable/SerializableDataTypeDate.h>
+#include <Serializable/SerializableDataTypeDateTime.h>
+#include <Serializable/SerializableDataTypeDateTime64.h>
+#include <Serializable/ProtobufReader.h>
+#include <Serializable/TimestampConversion.h>
+
+#include <Columns/ColumnsNumber.h>
+#include <Columns/ColumnDecimal.h>
+#include <Common/Exception.h>
 #include <DataTypes/DataTypeString.h>
 #include <common/LocalDateTime.h>
 
+#include <nucolumnar/aggregator/v1/nucolumnaraggregator.pb.h>
+#include <nucolumnar/datatypes/v1/columnartypes.pb.h>
+
 #include <Poco/Timespan.h>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <functional>
+#include <random>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -96,6 +111,180 @@ TEST(KafkaConnectorTimeUsedNow, testFunctioNowUnit) {
     LOG(INFO) << " now is (in nano seconds): " << time_now;
 }
 
+static nucolumnar::aggregator::v1::SqlWithBatchBindings buildTimestampBindings(size_t number_of_rows) {
+    nucolumnar::aggregator::v1::SqlWithBatchBindings bindings;
+    // the edges of the seconds and of the days, followed by the timestamps from 1970 to 2100.
+    std::vector<uint64_t> timestamps{0, 999, 1000, 86399999, 86400000, 1579817878440};
+    std::mt19937_64 generator(20200123);
+    std::uniform_int_distribution<uint64_t> distribution(0, 4102444800000ULL);
+    while (timestamps.size() < number_of_rows) {
+        timestamps.push_back(distribution(generator));
+    }
+    for (size_t row = 0; row < number_of_rows; row++) {
+        bindings.add_batch_bindings()->add_values()->mutable_timestamp()->set_milliseconds(timestamps[row]);
+    }
+    return bindings;
+}
+
+static void deserializeValueByValue(const nuclm::ISerializableDataType& serializer, DB::IColumn& column,
+                                    const nucolumnar::aggregator::v1::SqlWithBatchBindings& bindings) {
+    nuclm::ProtobufColumnReader column_reader(bindings.batch_bindings(), 0);
+    for (size_t row = 0; row < column_reader.getNumberOfRows(); row++) {
+        nuclm::ProtobufReader reader(column_reader.getValueP(row));
+        bool row_added = false;
+        serializer.deserializeProtobuf(column, reader, true, row_added);
+        ASSERT_TRUE(row_added);
+    }
+}
+
+static void deserializeColumnAtATime(const nuclm::ISerializableDataType& serializer, DB::IColumn& column,
+                                     const nucolumnar::aggregator::v1::SqlWithBatchBindings& bindings) {
+    nuclm::ProtobufColumnReader column_reader(bindings.batch_bindings(), 0);
+    size_t rows_added = 0;
+    serializer.deserializeProtobufColumn(column, column_reader, rows_added);
+    ASSERT_EQ(rows_added, column_reader.getNumberOfRows());
+}
+
+static void assertSameColumns(const DB::IColumn& expected, const DB::IColumn& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t row = 0; row < expected.size(); row++) {
+        ASSERT_EQ(expected.compareAt(row, row, actual, 1), 0) << "at row: " << row;
+    }
+}
+
+TEST(SerializerForProtobuf, testTimestampConversionMatchesValueByValue) {
+    auto bindings = buildTimestampBindings(10000);
+
+    nuclm::SerializableDataTypeDate date_serializer;
+    auto expected_dates = DB::ColumnUInt16::create();
+    auto dates = DB::ColumnUInt16::create();
+    deserializeValueByValue(date_serializer, *expected_dates, bindings);
+    deserializeColumnAtATime(date_serializer, *dates, bindings);
+    assertSameColumns(*expected_dates, *dates);
+
+    nuclm::SerializableDataTypeDateTime datetime_serializer;
+    auto expected_datetimes = DB::ColumnUInt32::create();
+    auto datetimes = DB::ColumnUInt32::create();
+    deserializeValueByValue(datetime_serializer, *expected_datetimes, bindings);
+    deserializeColumnAtATime(datetime_serializer, *datetimes, bindings);
+    assertSameColumns(*expected_datetimes, *datetimes);
+
+    for (UInt32 scale = 0; scale <= 6; scale++) {
+        nuclm::SerializableDataTypeDateTime64 datetime64_serializer(scale);
+        auto expected_datetime64s = DB::ColumnDecimal<DB::DateTime64>::create(0, scale);
+        auto datetime64s = DB::ColumnDecimal<DB::DateTime64>::create(0, scale);
+        deserializeValueByValue(datetime64_serializer, *expected_datetime64s, bindings);
+        deserializeColumnAtATime(datetime64_serializer, *datetime64s, bindings);
+        assertSameColumns(*expected_datetime64s, *datetime64s);
+    }
+}
+
+TEST(SerializerForProtobuf, testDateConversionInAndOutOfUTC) {
+    auto bindings = buildTimestampBindings(10000);
+    nuclm::ProtobufColumnReader column_reader(bindings.batch_bindings(), 0);
+    DB::PaddedPODArray<uint64_t> milliseconds;
+    nuclm::TimestampConversion::gatherMilliseconds(column_reader, milliseconds);
+
+    for (const char* time_zone_name : {"UTC", "America/Phoenix", "Asia/Shanghai"}) {
+        const DateLUTImpl& time_zone = DateLUT::instance(time_zone_name);
+        ASSERT_EQ(nuclm::TimestampConversion::isUTC(time_zone), std::string(time_zone_name) == "UTC");
+
+        DB::PaddedPODArray<DB::UInt16> dates(milliseconds.size());
+        nuclm::TimestampConversion::toDate(milliseconds.data(), milliseconds.size(), time_zone, dates.data());
+        for (size_t i = 0; i < milliseconds.size(); i++) {
+            time_t seconds = (time_t)(milliseconds[i] / 1000);
+            ASSERT_EQ(dates[i], (DB::UInt16)time_zone.toDayNum(seconds).toUnderType()) << "in: " << time_zone_name;
+        }
+    }
+}
+
+TEST(SerializerForProtobuf, testDateTime64ConversionOverflowGoesValueByValue) {
+    // the whole seconds of the timestamp overflow DateTime64(9), which is left for the value by value conversion.
+    uint64_t milliseconds[] = {1579817878440, 9300000000000000ULL};
+    DB::DateTime64 result[2];
+    ASSERT_TRUE(nuclm::TimestampConversion::toDateTime64(milliseconds, 1, 9, result));
+    ASSERT_FALSE(nuclm::TimestampConversion::toDateTime64(milliseconds, 2, 9, result));
+    ASSERT_TRUE(nuclm::TimestampConversion::toDateTime64(milliseconds, 2, 3, result));
+    ASSERT_EQ(result[1].value, 9300000000000000LL);
+}
+
+/**
+ * Beyond scale 3, both of the conversions take the milliseconds as the fraction. A timestamp that overflows the
+ * DateTime64 of the scale makes the column-at-a-time conversion fall back to the value-at-a-time one, which then fails
+ * on the same row.
+ */
+TEST(SerializerForProtobuf, testDateTime64ConversionMatchesValueByValueBeyondMilliseconds) {
+    auto bindings = buildTimestampBindings(1000);
+    for (UInt32 scale = 4; scale <= 9; scale++) {
+        nuclm::SerializableDataTypeDateTime64 datetime64_serializer(scale);
+        auto expected_datetime64s = DB::ColumnDecimal<DB::DateTime64>::create(0, scale);
+        auto datetime64s = DB::ColumnDecimal<DB::DateTime64>::create(0, scale);
+        deserializeValueByValue(datetime64_serializer, *expected_datetime64s, bindings);
+        deserializeColumnAtATime(datetime64_serializer, *datetime64s, bindings);
+        assertSameColumns(*expected_datetime64s, *datetime64s);
+    }
+
+    // the whole seconds of the last timestamp overflow DateTime64(6) and DateTime64(9), but not DateTime64(3).
+    bindings.add_batch_bindings()->add_values()->mutable_timestamp()->set_milliseconds(9300000000000000ULL);
+    for (UInt32 scale : {3, 6, 9}) {
+        nuclm::SerializableDataTypeDateTime64 datetime64_serializer(scale);
+        auto expected_datetime64s = DB::ColumnDecimal<DB::DateTime64>::create(0, scale);
+        auto datetime64s = DB::ColumnDecimal<DB::DateTime64>::create(0, scale);
+        if (scale == 3) {
+            deserializeValueByValue(datetime64_serializer, *expected_datetime64s, bindings);
+            deserializeColumnAtATime(datetime64_serializer, *datetime64s, bindings);
+            ASSERT_EQ(datetime64s->getData().back().value, 9300000000000000LL);
+        } else {
+            ASSERT_THROW(deserializeValueByValue(datetime64_serializer, *expected_datetime64s, bindings),
+                         DB::Exception);
+            ASSERT_THROW(deserializeColumnAtATime(datetime64_serializer, *datetime64s, bindings), DB::Exception);
+            ASSERT_EQ(datetime64s->size(), (size_t)bindings.batch_bindings_size() - 1);
+        }
+        assertSameColumns(*expected_datetime64s, *datetime64s);
+    }
+}
+
+/**
+ * Not a correctness test, but a benchmark of the value-at-a-time deserialization of the Date, DateTime and DateTime64
+ * columns against the batch conversion of the column-at-a-time one. Disabled by default, and to be run with
+ * --gtest_also_run_disabled_tests.
+ */
+TEST(SerializerForProtobuf, DISABLED_benchmarkTimestampConversion) {
+    const size_t number_of_rows = 200000;
+    const size_t number_of_runs = 5;
+    auto bindings = buildTimestampBindings(number_of_rows);
+
+    auto benchmark = [&](const std::string& name, const nuclm::ISerializableDataType& serializer,
+                         const std::function<DB::MutableColumnPtr()>& create_column) {
+        uint64_t value_by_value_us = 0;
+        uint64_t column_at_a_time_us = 0;
+        for (size_t run = 0; run < number_of_runs; run++) {
+            auto expected = create_column();
+            auto start = std::chrono::steady_clock::now();
+            deserializeValueByValue(serializer, *expected, bindings);
+            auto middle = std::chrono::steady_clock::now();
+            auto actual = create_column();
+            deserializeColumnAtATime(serializer, *actual, bindings);
+            auto end = std::chrono::steady_clock::now();
+            assertSameColumns(*expected, *actual);
+
+            value_by_value_us += std::chrono::duration_cast<std::chrono::microseconds>(middle - start).count();
+            column_at_a_time_us += std::chrono::duration_cast<std::chrono::microseconds>(end - middle).count();
+        }
+        LOG(INFO) << name << " with " << number_of_rows << " rows, average over " << number_of_runs
+                  << " runs, value-at-a-time: " << value_by_value_us / number_of_runs
+                  << " us, column-at-a-time: " << column_at_a_time_us / number_of_runs << " us";
+    };
+
+    benchmark("Date in time zone " + DateLUT::instance().getTimeZone(), nuclm::SerializableDataTypeDate(),
+              [] { return DB::ColumnUInt16::create(); });
+    benchmark("DateTime", nuclm::SerializableDataTypeDateTime(), [] { return DB::ColumnUInt32::create(); });
+    for (UInt32 scale : {0, 3, 6}) {
+        benchmark("DateTime64(" + std::to_string(scale) + ")", nuclm::SerializableDataTypeDateTime64(scale),
+                  [scale] { return DB::ColumnDecimal<DB::DateTime64>::create(0, scale); });
+    }
+}
+
 // Call RUN_ALL_TESTS() in main()
 int main(int argc, char** argv) {
 
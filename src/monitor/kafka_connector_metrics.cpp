@@ -38,6 +38,12 @@ const std::string KafkaConnectorMetrics::ProcessingTimeForKafkaBatchedMessagesRe
     "nucolumnar_aggregator_batched_messages_processing_in_kafka_connector_microseconds";
 const std::string KafkaConnectorMetrics::BytesFromKafkaBatchedMessagesProcessed_Metric_Name =
     "nucolumnar_aggregator_bytes_from_batched_messages_in_kafka_connector";
+const std::string KafkaConnectorMetrics::BatchFillRatioByKafkaConnectors_Metric_Name =
+    "nucolumnar_aggregator_batch_fill_ratio_in_kafka_connector_percent";
+const std::string KafkaConnectorMetrics::PipelineQueueOccupancyInKafkaConnector_Metric_Name =
+    "nucolumnar_aggregator_pipeline_queue_occupancy_in_kafka_connector";
+const std::string KafkaConnectorMetrics::PipelineStageStallTimeInKafkaConnector_Metric_Name =
+    "nucolumnar_aggregator_pipeline_stage_stall_time_in_kafka_connector_in_microseconds";
 
 const std::string KafkaConnectorMetrics::CommitTimeForOffsetCommitByKafkaConnectors_Metric_Name =
     "nucolumnar_aggregator_offset_commit_in_kafka_connector_in_microseconds";
@@ -48,6 +54,14 @@ const std::string KafkaConnectorMetrics::AllTasksWaitTimeByKafkaConnectors_Metri
 
 const std::string KafkaConnectorMetrics::TaskBlockWaitFailedInKafkaConnectors_Metric_Name =
     "nucolumnar_aggregator_block_wait_failed_in_kafka_connector_in_total";
+const std::string KafkaConnectorMetrics::PartitionPausedByBackPressure_Metric_Name =
+    "nucolumnar_aggregator_partition_paused_by_back_pressure_in_kafka_connector_total";
+const std::string KafkaConnectorMetrics::PartitionPauseTimeByBackPressure_Metric_Name =
+    "nucolumnar_aggregator_partition_pause_time_by_back_pressure_in_kafka_connector_in_microseconds";
+const std::string KafkaConnectorMetrics::PartitionsPausedInKafkaConnector_Metric_Name =
+    "nucolumnar_aggregator_partitions_paused_in_kafka_connector";
+const std::string KafkaConnectorMetrics::AdaptiveBatchBudgetInKafkaConnector_Metric_Name =
+    "nucolumnar_aggregator_adaptive_batch_budget_in_kafka_connector";
 
 const std::string KafkaConnectorMetrics::TotalNumberOfKafkaMessagesReplayed_Metric_Name =
     "nucolumnar_aggregator_batched_messages_replayed_in_kafka_connector_total";
@@ -55,6 +69,10 @@ const std::string KafkaConnectorMetrics::BytesFromKafkaMessagesReplayed_Metric_N
     "nucolumnar_aggregator_batched_messages_replayed_bytes_in_kafka_connector_total";
 const std::string KafkaConnectorMetrics::TotalNumberOfKafkaMessagesIgnoredForReplay_Metric_Name =
     "nucolumnar_aggregator_batched_messages_replay_ignored_in_kafka_connector_total";
+const std::string KafkaConnectorMetrics::ReplayRemainingOffsetsInKafkaConnector_Metric_Name =
+    "nucolumnar_aggregator_replay_remaining_offsets_in_kafka_connector";
+const std::string KafkaConnectorMetrics::ReplayPendingTablesInKafkaConnector_Metric_Name =
+    "nucolumnar_aggregator_replay_pending_tables_in_kafka_connector";
 
 const std::string KafkaConnectorMetrics::CommitFailedByKafkaConnectors_Metric_Name =
     "nucolumnar_aggregator_offset_commit_failed_in_kafka_connector_total";
@@ -205,12 +223,33 @@ KafkaConnectorMetrics::KafkaConnectorMetrics(monitor::NuDataMetricsFactory& fact
         "one processing loop",
         {"on_topic", "on_zone"}, monitor::HistogramBuckets::ExponentialOfTwoBuckets);
 
+    // metric: PipelineQueueOccupancyInKafkaConnector_Metric_Name
+    pipeline_queue_occupancy_in_kafka_connector = &factory.registerMetric<monitor::_gauge>(
+        PipelineQueueOccupancyInKafkaConnector_Metric_Name,
+        "nucolumnar aggregator number of fetched batches queued between the fetch stage and the process stage of the "
+        "kafka connector",
+        {"on_topic", "on_zone"});
+
+    // metric: PipelineStageStallTimeInKafkaConnector_Metric_Name
+    pipeline_stage_stall_time_in_kafka_connector = &factory.registerMetric<monitor::_histogram>(
+        PipelineStageStallTimeInKafkaConnector_Metric_Name,
+        "nucolumnar aggregator time that a pipeline stage of the kafka connector is blocked on the batch queue, with "
+        "the fetch stage blocked on a full queue and the process stage blocked on an empty queue",
+        {"on_topic", "on_zone", "stage"}, monitor::HistogramBuckets::ExponentialOfTwoBuckets);
+
     // metric: BytesFromKakfaBatchedMessagesReceived_Metric_Name
     bytes_from_batched_messages_by_kafka_connectors = &factory.registerMetric<monitor::_histogram>(
         BytesFromKafkaBatchedMessagesProcessed_Metric_Name,
         "nucolumnar aggregator bytes from batched messages processed by the kafka connector", {"on_topic", "on_zone"},
         monitor::HistogramBuckets::ExponentialOfTwoBuckets);
 
+    // metric: BatchFillRatioByKafkaConnectors_Metric_Name
+    batch_fill_ratio_by_kafka_connectors = &factory.registerMetric<monitor::_histogram>(
+        BatchFillRatioByKafkaConnectors_Metric_Name,
+        "nucolumnar aggregator percentage of the configured batch size filled by one batch consumed by the kafka "
+        "connector",
+        {"on_topic", "on_zone"}, monitor::HistogramBuckets::PercentageBuckets);
+
     // metric: CommitTimeForOffsetCommitByKafakConnectors_Metric_Name
     commit_time_for_offset_commit_by_kafka_connectors = &factory.registerMetric<monitor::_histogram>(
         CommitTimeForOffsetCommitByKafkaConnectors_Metric_Name,
@@ -234,6 +273,29 @@ KafkaConnectorMetrics::KafkaConnectorMetrics(monitor::NuDataMetricsFactory& fact
         TaskBlockWaitFailedInKafkaConnectors_Metric_Name,
         "nucolumnar aggregator block waited in tasks by the kafka connector", {"on_topic", "on_zone"});
 
+    // metric: PartitionPausedByBackPressure_Metric_Name
+    partition_paused_by_back_pressure_total = &factory.registerMetric<monitor::_counter>(
+        PartitionPausedByBackPressure_Metric_Name,
+        "nucolumnar aggregator total number of partitions paused by the kafka connector due to back-pressure",
+        {"on_topic", "on_zone", "reason"});
+
+    // metric: PartitionPauseTimeByBackPressure_Metric_Name
+    partition_pause_time_by_back_pressure = &factory.registerMetric<monitor::_histogram>(
+        PartitionPauseTimeByBackPressure_Metric_Name,
+        "nucolumnar aggregator time in microseconds that a partition stays paused due to back-pressure",
+        {"on_topic", "on_zone", "reason"}, monitor::HistogramBuckets::ExponentialOfTwoBuckets);
+
+    // metric: PartitionsPausedInKafkaConnector_Metric_Name
+    partitions_paused_in_kafka_connector = &factory.registerMetric<monitor::_gauge>(
+        PartitionsPausedInKafkaConnector_Metric_Name,
+        "nucolumnar aggregator number of partitions currently paused by the kafka connector", {"on_topic", "on_zone"});
+
+    // metric: AdaptiveBatchBudgetInKafkaConnector_Metric_Name
+    adaptive_batch_budget_in_kafka_connector = &factory.registerMetric<monitor::_gauge>(
+        AdaptiveBatchBudgetInKafkaConnector_Metric_Name,
+        "nucolumnar aggregator budget of the next kafka batch tuned by the adaptive batching",
+        {"on_topic", "on_zone", "budget"});
+
     // metric: TotalNumberOfKafkaMessagesReplayed_Metric_Name
     batched_messages_replayed_by_kafka_connectors_total = &factory.registerMetric<monitor::_counter>(
         TotalNumberOfKafkaMessagesReplayed_Metric_Name,
@@ -246,13 +308,23 @@ KafkaConnectorMetrics::KafkaConnectorMetrics(monitor::NuDataMetricsFactory& fact
         {"on_topic", "on_zone"});
 
     // metric: TotalNumberOfKafkaMessagesIgnoredForReplay_Metric_Name
-    // NOTE:  at this time, no code instrumented on the following metrics, as not sure how to capture this metric in the
-    // source code.
     batched_messages_replay_ignored_by_kafka_connectors_total = &factory.registerMetric<monitor::_counter>(
         TotalNumberOfKafkaMessagesIgnoredForReplay_Metric_Name,
         "nucolumnar aggregator batched messages to be replayed but then ignored by the kafka connector",
         {"on_topic", "on_zone"});
 
+    // metric: ReplayRemainingOffsetsInKafkaConnector_Metric_Name
+    replay_remaining_offsets_in_kafka_connector = &factory.registerMetric<monitor::_gauge>(
+        ReplayRemainingOffsetsInKafkaConnector_Metric_Name,
+        "nucolumnar aggregator number of offsets left for a table to finish its replay in a partition",
+        {"on_topic", "on_zone", "partition", "table"});
+
+    // metric: ReplayPendingTablesInKafkaConnector_Metric_Name
+    replay_pending_tables_in_kafka_connector = &factory.registerMetric<monitor::_gauge>(
+        ReplayPendingTablesInKafkaConnector_Metric_Name,
+        "nucolumnar aggregator number of tables whose replay is not done yet in a partition",
+        {"on_topic", "on_zone", "partition"});
+
     // metric: CommitFailedByKafkaConnectors_Metric_Name
     commit_offset_by_kafka_connectors_failed_total = &factory.registerMetric<monitor::_counter>(
         CommitFailedByKafkaConnectors_Metric_Name, "nucolumnar aggregator offset commit failed by the kafka connector",
@@ -33,16 +33,26 @@ struct KafkaConnectorMetrics {
 
     static const std::string ProcessingTimeForKafkaBatchedMessagesReceived_Metric_Name;
     static const std::string BytesFromKafkaBatchedMessagesProcessed_Metric_Name; // as a histogram
+    static const std::string BatchFillRatioByKafkaConnectors_Metric_Name;       // as a histogram, in percentage
+    static const std::string PipelineQueueOccupancyInKafkaConnector_Metric_Name; // as a gauge
+    static const std::string PipelineStageStallTimeInKafkaConnector_Metric_Name; // as a histogram, in microseconds
 
     static const std::string CommitTimeForOffsetCommitByKafkaConnectors_Metric_Name;
     static const std::string TaskCompletionWaitTimeByKafkaConnectors_Metric_Name;
     static const std::string AllTasksWaitTimeByKafkaConnectors_Metric_Name;
 
     static const std::string TaskBlockWaitFailedInKafkaConnectors_Metric_Name;
+    // the back-pressure on the partitions whose tables reach their in-flight flush limit
+    static const std::string PartitionPausedByBackPressure_Metric_Name;
+    static const std::string PartitionPauseTimeByBackPressure_Metric_Name; // as a histogram, in microseconds
+    static const std::string PartitionsPausedInKafkaConnector_Metric_Name;  // as a gauge
+    static const std::string AdaptiveBatchBudgetInKafkaConnector_Metric_Name; // as a gauge
 
     static const std::string TotalNumberOfKafkaMessagesReplayed_Metric_Name;
     static const std::string BytesFromKafkaMessagesReplayed_Metric_Name;
     static const std::string TotalNumberOfKafkaMessagesIgnoredForReplay_Metric_Name;
+    static const std::string ReplayRemainingOffsetsInKafkaConnector_Metric_Name; // as a gauge
+    static const std::string ReplayPendingTablesInKafkaConnector_Metric_Name;    // as a gauge
 
     static const std::string CommitFailedByKafkaConnectors_Metric_Name;
 
@@ -114,17 +124,29 @@ struct KafkaConnectorMetrics {
 
     monitor::MetricFamily<monitor::_histogram>* processing_time_for_batched_messages_by_kafka_connectors;
     monitor::MetricFamily<monitor::_histogram>* bytes_from_batched_messages_by_kafka_connectors;
+    // the percentage of the configured kafka batch size being filled by each consumeBatch
+    monitor::MetricFamily<monitor::_histogram>* batch_fill_ratio_by_kafka_connectors;
+    // the fetched batches waiting in the queue between the fetch and process stages of the pipelined main loop
+    monitor::MetricFamily<monitor::_gauge>* pipeline_queue_occupancy_in_kafka_connector;
+    monitor::MetricFamily<monitor::_histogram>* pipeline_stage_stall_time_in_kafka_connector;
 
     monitor::MetricFamily<monitor::_histogram>* commit_time_for_offset_commit_by_kafka_connectors;
     monitor::MetricFamily<monitor::_histogram>* task_completion_waittime_by_kafka_connectors;
 
     monitor::MetricFamily<monitor::_counter>* task_block_wait_failed_in_kafka_connectors;
+    monitor::MetricFamily<monitor::_counter>* partition_paused_by_back_pressure_total;
+    monitor::MetricFamily<monitor::_histogram>* partition_pause_time_by_back_pressure;
+    monitor::MetricFamily<monitor::_gauge>* partitions_paused_in_kafka_connector;
+    monitor::MetricFamily<monitor::_gauge>* adaptive_batch_budget_in_kafka_connector;
 
     monitor::MetricFamily<monitor::_histogram>* all_tasks_completion_waittime_by_kafka_connectors;
 
     monitor::MetricFamily<monitor::_counter>* batched_messages_replayed_by_kafka_connectors_total;
     monitor::MetricFamily<monitor::_counter>* batched_messages_replayed_by_kafka_connectors_bytes_total;
     monitor::MetricFamily<monitor::_counter>* batched_messages_replay_ignored_by_kafka_connectors_total;
+    // the replay progress: the offsets left for a table to finish its replay, and the tables still under replay
+    monitor::MetricFamily<monitor::_gauge>* replay_remaining_offsets_in_kafka_connector;
+    monitor::MetricFamily<monitor::_gauge>* replay_pending_tables_in_kafka_connector;
 
     monitor::MetricFamily<monitor::_counter>* commit_offset_by_kafka_connectors_failed_total;
 
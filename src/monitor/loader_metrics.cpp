@@ -63,6 +63,23 @@ const std::string LoaderMetrics::NumberOfErrorsPassedFromClickHouseServer_Metric
 const std::string LoaderMetrics::EndToEndLagTimeObservedAtLoader_Metric_Name =
     "nucolumnar_aggregator_end_to_end_lag_time_at_loader";
 
+const std::string LoaderMetrics::ProtobufArenaBytesInBuffers_Metric_Name =
+    "nucolumnar_aggregator_protobuf_arena_bytes_in_buffers";
+const std::string LoaderMetrics::ProtobufArenaResetsInBuffers_Metric_Name =
+    "nucolumnar_aggregator_protobuf_arena_resets_in_buffers_total";
+
+const std::string LoaderMetrics::DefaultsFillingActionsCacheHits_Metric_Name =
+    "nucolumnar_aggregator_defaults_filling_actions_cache_hits_total";
+const std::string LoaderMetrics::DefaultsFillingActionsCacheMisses_Metric_Name =
+    "nucolumnar_aggregator_defaults_filling_actions_cache_misses_total";
+
+const std::string LoaderMetrics::BlockColumnsPoolBlocks_Metric_Name = "nucolumnar_aggregator_block_columns_pool_blocks";
+const std::string LoaderMetrics::BlockColumnsPoolBytes_Metric_Name = "nucolumnar_aggregator_block_columns_pool_bytes";
+const std::string LoaderMetrics::BlockColumnsPoolHits_Metric_Name =
+    "nucolumnar_aggregator_block_columns_pool_hits_total";
+const std::string LoaderMetrics::BlockColumnsPoolMisses_Metric_Name =
+    "nucolumnar_aggregator_block_columns_pool_misses_total";
+
 LoaderMetrics::LoaderMetrics(monitor::NuDataMetricsFactory& factory) {
     // metric: ConnectionTo_DB_Metric_Name
     connection_to_db_metrics = &factory.registerMetric<monitor::_gauge>(
@@ -165,5 +182,43 @@ LoaderMetrics::LoaderMetrics(monitor::NuDataMetricsFactory& factory) {
     end_to_end_lag_time_at_loader = &factory.registerMetric<monitor::_histogram>(
         EndToEndLagTimeObservedAtLoader_Metric_Name, "total end-to-end lag time observed at the loader in milliseconds",
         {"table"}, monitor::HistogramBuckets::ExponentialOfTwoBuckets);
+
+    // metric: ProtobufArenaBytesInBuffers_Metric_Name, with kind being "used" or "initial_block"
+    protobuf_arena_bytes_in_buffers = &factory.registerMetric<monitor::_gauge>(
+        ProtobufArenaBytesInBuffers_Metric_Name, "bytes of protobuf arena for parsing batched messages in buffers",
+        {"table", "kind"});
+
+    // metric: ProtobufArenaResetsInBuffers_Metric_Name
+    protobuf_arena_resets_in_buffers_total = &factory.registerMetric<monitor::_counter>(
+        ProtobufArenaResetsInBuffers_Metric_Name, "total number of protobuf arena resets in buffers", {"table"});
+
+    // metric: DefaultsFillingActionsCacheHits_Metric_Name
+    defaults_filling_actions_cache_hits_total = &factory.registerMetric<monitor::_counter>(
+        DefaultsFillingActionsCacheHits_Metric_Name, "total number of defaults filling actions found in cache",
+        {"table"});
+
+    // metric: DefaultsFillingActionsCacheMisses_Metric_Name
+    defaults_filling_actions_cache_misses_total = &factory.registerMetric<monitor::_counter>(
+        DefaultsFillingActionsCacheMisses_Metric_Name,
+        "total number of defaults filling actions compiled on cache miss", {"table"});
+
+    // metric: BlockColumnsPoolBlocks_Metric_Name
+    block_columns_pool_blocks = &factory.registerMetric<monitor::_gauge>(
+        BlockColumnsPoolBlocks_Metric_Name, "number of blocks of recycled columns held by block columns pool",
+        {"table"});
+
+    // metric: BlockColumnsPoolBytes_Metric_Name
+    block_columns_pool_bytes = &factory.registerMetric<monitor::_gauge>(
+        BlockColumnsPoolBytes_Metric_Name, "bytes allocated to recycled columns held by block columns pool", {"table"});
+
+    // metric: BlockColumnsPoolHits_Metric_Name
+    block_columns_pool_hits_total = &factory.registerMetric<monitor::_counter>(
+        BlockColumnsPoolHits_Metric_Name, "total number of blocks for buffers taken from block columns pool",
+        {"table"});
+
+    // metric: BlockColumnsPoolMisses_Metric_Name
+    block_columns_pool_misses_total = &factory.registerMetric<monitor::_counter>(
+        BlockColumnsPoolMisses_Metric_Name, "total number of blocks for buffers created on block columns pool miss",
+        {"table"});
 }
 } // namespace nuclm
@@ -53,6 +53,20 @@ struct LoaderMetrics {
     // a block gets received successfully by the ClickHouse shard
     static const std::string EndToEndLagTimeObservedAtLoader_Metric_Name;
 
+    // the arenas that the buffers parse the batched messages on
+    static const std::string ProtobufArenaBytesInBuffers_Metric_Name;
+    static const std::string ProtobufArenaResetsInBuffers_Metric_Name;
+
+    // the compiled actions that fill the missing columns with their defaults
+    static const std::string DefaultsFillingActionsCacheHits_Metric_Name;
+    static const std::string DefaultsFillingActionsCacheMisses_Metric_Name;
+
+    // the pool of the columns recycled from the flushed blocks
+    static const std::string BlockColumnsPoolBlocks_Metric_Name;
+    static const std::string BlockColumnsPoolBytes_Metric_Name;
+    static const std::string BlockColumnsPoolHits_Metric_Name;
+    static const std::string BlockColumnsPoolMisses_Metric_Name;
+
     monitor::MetricFamily<monitor::_gauge>* connection_to_db_metrics;
     monitor::MetricFamily<monitor::_gauge>* number_of_tables_retrieved_from_db_metrics;
     monitor::MetricFamily<monitor::_counter>* total_batched_kafka_messages_received_metrics;
@@ -103,6 +117,22 @@ struct LoaderMetrics {
     // end-to-end lag time
     monitor::MetricFamily<monitor::_histogram>* end_to_end_lag_time_at_loader;
 
+    // bytes of the protobuf arena of a buffer, used by the last message parsed, and of the initial block reused
+    monitor::MetricFamily<monitor::_gauge>* protobuf_arena_bytes_in_buffers;
+    // resets of the protobuf arenas of the buffers, one per message parsed
+    monitor::MetricFamily<monitor::_counter>* protobuf_arena_resets_in_buffers_total;
+
+    // lookups of the compiled defaults filling actions that are found in the cache, or that have to be compiled
+    monitor::MetricFamily<monitor::_counter>* defaults_filling_actions_cache_hits_total;
+    monitor::MetricFamily<monitor::_counter>* defaults_filling_actions_cache_misses_total;
+
+    // blocks of recycled columns held by the pool of a table, and the bytes allocated to them
+    monitor::MetricFamily<monitor::_gauge>* block_columns_pool_blocks;
+    monitor::MetricFamily<monitor::_gauge>* block_columns_pool_bytes;
+    // blocks for the buffers to build in that are taken from the pool, or that are created on pool miss
+    monitor::MetricFamily<monitor::_counter>* block_columns_pool_hits_total;
+    monitor::MetricFamily<monitor::_counter>* block_columns_pool_misses_total;
+
     LoaderMetrics(monitor::NuDataMetricsFactory& factory);
 };
 
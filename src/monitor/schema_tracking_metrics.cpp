@@ -32,6 +32,10 @@ const std::string SchemaTrackingMetrics::SchemaUpdateAtGlobalTable_Metric_Name =
     "nucolumnar_aggregator_schema_update_at_global_table_total";
 const std::string SchemaTrackingMetrics::SchemaVersionAtGlobalTable_Metric_Name =
     "nucolumnar_aggregator_schema_version_at_global_table";
+const std::string SchemaTrackingMetrics::SchemaRegistryRefreshTime_Metric_Name =
+    "nucolumnar_aggregator_schema_registry_refresh_time_in_microseconds";
+const std::string SchemaTrackingMetrics::SchemaRegistryCoalescedRequests_Metric_Name =
+    "nucolumnar_aggregator_schema_registry_coalesced_requests_total";
 
 SchemaTrackingMetrics::SchemaTrackingMetrics(monitor::NuDataMetricsFactory& factory) {
     schema_tracking_not_with_latest_schema_total = &factory.registerMetric<monitor::_counter>(
@@ -61,5 +65,16 @@ SchemaTrackingMetrics::SchemaTrackingMetrics(monitor::NuDataMetricsFactory& fact
         SchemaVersionAtGlobalTable_Metric_Name,
         "nucolumnar aggregator table schema version for aggregator loader manager's global table",
         {"table", "version"});
+
+    schema_registry_refresh_time = &factory.registerMetric<monitor::_histogram>(
+        SchemaRegistryRefreshTime_Metric_Name,
+        "nucolumnar aggregator time in microseconds for the schema registry to fetch the table definition", {"table"},
+        monitor::HistogramBuckets::ExponentialOfTwoBuckets);
+
+    schema_registry_coalesced_requests_total = &factory.registerMetric<monitor::_counter>(
+        SchemaRegistryCoalescedRequests_Metric_Name,
+        "nucolumnar aggregator total number of schema hash resolutions served by the schema registry without a fetch "
+        "of their own",
+        {"table"});
 }
 } // namespace nuclm
@@ -29,6 +29,8 @@ struct SchemaTrackingMetrics {
     static const std::string ServicePassedSchemaVersion_Metric_Name;
     static const std::string SchemaUpdateAtGlobalTable_Metric_Name;
     static const std::string SchemaVersionAtGlobalTable_Metric_Name;
+    static const std::string SchemaRegistryRefreshTime_Metric_Name;
+    static const std::string SchemaRegistryCoalescedRequests_Metric_Name;
 
     monitor::MetricFamily<monitor::_counter>* schema_tracking_not_with_latest_schema_total;
     monitor::MetricFamily<monitor::_counter>* schema_tracking_new_schema_fetched_total;
@@ -39,6 +41,9 @@ struct SchemaTrackingMetrics {
     monitor::MetricFamily<monitor::_counter>* schema_update_at_global_table_total;
     monitor::MetricFamily<monitor::_gauge>* schema_version_at_global_table;
 
+    monitor::MetricFamily<monitor::_histogram>* schema_registry_refresh_time;
+    monitor::MetricFamily<monitor::_counter>* schema_registry_coalesced_requests_total;
+
     SchemaTrackingMetrics(monitor::NuDataMetricsFactory& factory);
 };
 